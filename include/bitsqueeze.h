@@ -1,6 +1,7 @@
 #ifndef BITSQUEEZE_H
 #define BITSQUEEZE_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -56,18 +57,660 @@ int bsq_compress_2d(const float *src,
                     bitsqueeze_buffer_t **out,
                     const float *im);
 
+/* Exact byte count of the buffer bsq_compress_1d / bsq_compress_2d would produce, without compressing (0 if unsupported). */
+int64_t bsq_compute_packed_size_1d(bsq_method_t method, uint64_t num_elements);
+
+int64_t bsq_compute_packed_size_2d(bsq_method_t method,
+                                   uint16_t num_tokens,
+                                   uint16_t num_features,
+                                   float sparse_ratio);
+
+/*
+ * Compress into caller-owned memory instead of allocating. dst must be 8-byte aligned and hold at least
+ * bsq_compute_packed_size_*() bytes; on success it holds a valid bitsqueeze_buffer_t that must NOT be passed
+ * to bsq_free. A buffer produced by an earlier call (or by bsq_compress_*) can be passed back in to re-use it.
+ */
+int bsq_compress_1d_into(const float *src,
+                         uint64_t num_elements,
+                         bsq_method_t method,
+                         void *dst,
+                         int64_t dst_size,
+                         const float *im);
+
+int bsq_compress_2d_into(const float *src,
+                         uint16_t num_tokens,
+                         uint16_t num_features,
+                         float sparse_ratio,
+                         bsq_method_t method,
+                         void *dst,
+                         int64_t dst_size,
+                         const float *im);
+
+/* Element type of a 16-bit source tensor for the *_typed entry points. */
+typedef enum {
+    BSQ_DTYPE_FP16 = 0,   /* IEEE half precision */
+    BSQ_DTYPE_BF16 = 1
+} bsq_dtype_t;
+
+/*
+ * bsq_compress_* for FP16 / BF16 sources (src holds uint16_t values of dtype). The input is widened a chunk at
+ * a time inside the encode loop instead of into a full float copy; the result is that of bsq_compress_* on the
+ * widened values. 1D methods go through the 1d variants, TOPK / TOPK_IM through the 2d ones; im stays float.
+ */
+int bsq_compress_1d_typed(const void *src,
+                          bsq_dtype_t dtype,
+                          uint64_t num_elements,
+                          bsq_method_t method,
+                          bitsqueeze_buffer_t **out,
+                          const float *im);
+
+int bsq_compress_2d_typed(const void *src,
+                          bsq_dtype_t dtype,
+                          uint16_t num_tokens,
+                          uint16_t num_features,
+                          float sparse_ratio,
+                          bsq_method_t method,
+                          bitsqueeze_buffer_t **out,
+                          const float *im);
+
+int bsq_compress_1d_typed_into(const void *src,
+                               bsq_dtype_t dtype,
+                               uint64_t num_elements,
+                               bsq_method_t method,
+                               void *dst,
+                               int64_t dst_size,
+                               const float *im);
+
+int bsq_compress_2d_typed_into(const void *src,
+                               bsq_dtype_t dtype,
+                               uint16_t num_tokens,
+                               uint16_t num_features,
+                               float sparse_ratio,
+                               bsq_method_t method,
+                               void *dst,
+                               int64_t dst_size,
+                               const float *im);
+
 int bsq_decompress(const bitsqueeze_buffer_t *buf,
                    float *dst,
                    uint64_t dst_num_elements);
 
+/* Decode elements [offset, offset + count) of a 1D buffer into dst[0 .. count),
+ * touching only the blocks that overlap the range. */
+int bsq_decompress_range(const bitsqueeze_buffer_t *buf,
+                         uint64_t offset,
+                         uint64_t count,
+                         float *dst);
+
+/* Densify only the listed token rows of a TOPK / TOPK_IM buffer into dst, packed
+ * row after row (num_rows * num_features floats). */
+int bsq_decompress_rows(const bitsqueeze_buffer_t *buf,
+                        const uint16_t *token_indices,
+                        uint32_t num_rows,
+                        float *dst,
+                        uint64_t dst_num_elements);
+
+/* y = W x for the rows x cols matrix W stored row-major in a 1D Q8_0, Q4_0, Q2_K, Q2_K_FAST, NF4, MXFP4 or
+ * NVFP4 buffer, dequantizing one block at a time instead of the whole matrix. cols must be a multiple of
+ * the block size (256 for Q2_K). */
+int bsq_gemv(const bitsqueeze_buffer_t *buf,
+             uint64_t rows,
+             uint64_t cols,
+             const float *x,
+             float *y);
+
+/* y = x W^T for num_tokens rows of x (num_tokens x cols) against the rows x cols matrix W stored row-major in
+ * any 1D buffer; y is num_tokens x rows. W is decoded one 64 x 256 tile at a time and each tile is reused by
+ * every token, so W is dequantized exactly once; tiles of output rows run in parallel. */
+int bsq_gemm(const bitsqueeze_buffer_t *buf,
+             uint64_t rows,
+             uint64_t cols,
+             const float *x,
+             uint64_t num_tokens,
+             float *y);
+
+/* Quantize num_tokens rows of cols activations (cols a multiple of 32) into 32-element Q8 blocks: codes
+ * (num_tokens * cols) and scales (num_tokens * cols / 32), rounded exactly as Q8_0. */
+int bsq_quantize_q8(const float *x,
+                    uint64_t num_tokens,
+                    uint64_t cols,
+                    int8_t *codes,
+                    float *scales);
+
+/* bsq_gemv against activations from bsq_quantize_q8, for Q8_0 and Q4_0 weights: each block pair is
+ * multiplied in int32 (AVX-512 VNNI, AVX-VNNI or AVX2 when the CPU has them) and scaled once. */
+int bsq_gemv_q8(const bitsqueeze_buffer_t *buf,
+                uint64_t rows,
+                uint64_t cols,
+                const int8_t *x_codes,
+                const float *x_scales,
+                float *y);
+
+/* Products with a TOPK / TOPK_IM buffer S of [num_tokens, num_features] that read only its kept entries.
+ * bsq_spmm: out [num_tokens, out_features] = S W, W dense row-major [num_features, out_features].
+ * bsq_spmm_t: out [num_rows, num_tokens] = D S^T, D dense row-major [num_rows, num_features].
+ * bsq_spmv: y [num_tokens] = S x, x of num_features. */
+int bsq_spmm(const bitsqueeze_buffer_t *buf,
+             const float *dense,
+             uint64_t out_features,
+             float *out);
+
+int bsq_spmm_t(const bitsqueeze_buffer_t *buf,
+               const float *dense,
+               uint64_t num_rows,
+               float *out);
+
+int bsq_spmv(const bitsqueeze_buffer_t *buf, const float *x, float *y);
+
+/* Reductions over the decoded values of buf, computed block by block without a full decompression. Q8_0 and
+ * Q4_0 work from per-block integer code sums, TOPK / TOPK_IM from the kept values alone. */
+typedef struct {
+    double sum;
+    double sum_squares;   /* sqrt gives the L2 norm */
+    double abs_max;
+} bsq_reduction_t;
+
+int bsq_reduce(const bitsqueeze_buffer_t *buf, bsq_reduction_t *out);
+
+/* Dot product of the decoded values of buf with x (num_elements must match, tokens x features for 2D). */
+int bsq_dot(const bitsqueeze_buffer_t *buf, const float *x, uint64_t num_elements, double *result);
+
+/* Dot product of two buffers of the same length: any 1D pair (Q8_0 with Q8_0 or Q4_0 on integer kernels), or
+ * two TOPK / TOPK_IM buffers of one shape. */
+int bsq_dot_buffers(const bitsqueeze_buffer_t *a, const bitsqueeze_buffer_t *b, double *result);
+
+/* One tensor of a batch: dst follows the rules of bsq_compress_1d_into. */
+typedef struct {
+    const float  *src;
+    uint64_t      num_elements;
+    bsq_method_t  method;
+    const float  *im;         /* optional, as for bsq_compress_1d */
+    void         *dst;
+    int64_t       dst_size;
+} bsq_compress_desc_t;
+
+typedef struct {
+    const bitsqueeze_buffer_t *src;
+    float                     *dst;
+    uint64_t                   dst_num_elements;
+} bsq_decompress_desc_t;
+
+/* Process many tensors in one parallel region: every tensor is cut into block-aligned chunks and all chunks
+ * share a single dynamic schedule, so small tensors no longer each pay for a fork/join. 1D methods only for
+ * compression; the output is byte-identical to compressing the tensors one by one. */
+int bsq_compress_batch(const bsq_compress_desc_t *descs, uint32_t count);
+
+int bsq_decompress_batch(const bsq_decompress_desc_t *descs, uint32_t count);
+
+/* Positional sink of a stream: store size bytes at offset of the packed buffer. Non-zero fails the stream. */
+typedef int (*bsq_stream_write_fn)(void *user, uint64_t offset, const void *data, uint64_t size);
+
+typedef struct bsq_stream bsq_stream_t;
+
+/*
+ * Encode a 1D tensor of num_elements values that arrives in chunks of any size, holding at most one window
+ * of input. The writer receives the layout of bsq_compress_1d_into (bsq_compute_packed_size_1d bytes), a run
+ * of blocks at a time and the header last, ready for load_bsq_from_buffer / bsq_view_from_buffer.
+ */
+bsq_stream_t *bsq_stream_begin(bsq_method_t method,
+                               uint64_t num_elements,
+                               bsq_stream_write_fn write,
+                               void *user);
+
+/* FP8, FP4, NVFP4 and NF4_DQ need their tensor-wide scale before the first feed: pass the whole tensor
+ * through bsq_stream_scan once (same result as bsq_compress_1d), or set the stored scale directly
+ * (FP8 / FP4 scale, NVFP4 tensor_scale, NF4_DQ dq_scale). */
+int bsq_stream_scan(bsq_stream_t *stream, const float *src, uint64_t count);
+
+int bsq_stream_set_scale(bsq_stream_t *stream, float scale);
+
+/* im, when used, must accompany every feed. */
+int bsq_stream_feed(bsq_stream_t *stream, const float *src, uint64_t count, const float *im);
+
+/* Encode the last partial window and write the header. Always frees stream; fails if fewer than
+ * num_elements values were fed or any earlier call failed. */
+int bsq_stream_end(bsq_stream_t *stream);
+
+/* Allocation hooks for every buffer the library returns (bsq_compress_*, load_*, allocate_*_array). */
+#define BSQ_ALLOC_UNINITIALIZED 1u      /* the caller overwrites every byte; skip zeroing */
+
+typedef struct {
+    /* alignment is 0 (malloc's) or a power of two; flags takes BSQ_ALLOC_UNINITIALIZED. */
+    void *(*alloc)(void *user, size_t size, size_t alignment, uint32_t flags);
+    void  (*free)(void *user, void *ptr);
+    void  *user;
+} bsq_allocator_t;
+
+/* Install allocator, or restore calloc/free with NULL. Not thread-safe; a block must be freed by the
+ * allocator that made it, so switch only while no library buffer is live. */
+int bsq_set_allocator(const bsq_allocator_t *allocator);
+
+/*
+ * Size-class pool that caches freed blocks for reuse, up to max_cached_bytes. Thread-safe; serves
+ * alignments up to 64 bytes. With BSQ_POOL_HUGE_PAGES, blocks of 2 MiB or more are mapped with
+ * transparent huge pages where the OS offers them (Linux).
+ */
+#define BSQ_POOL_HUGE_PAGES 1u
+
+typedef struct bsq_pool bsq_pool_t;
+
+typedef struct {
+    uint64_t hits;              /* allocations served from the cache */
+    uint64_t misses;            /* allocations that went to the system */
+    uint64_t cached_bytes;
+    uint64_t live_bytes;
+} bsq_pool_stats_t;
+
+bsq_pool_t *bsq_pool_create(uint64_t max_cached_bytes, uint32_t flags);
+
+/* Releases the cached blocks; blocks still live must not be freed through the pool afterwards. */
+void bsq_pool_destroy(bsq_pool_t *pool);
+
+/* The alloc/free pair of the pool (user is the bsq_pool_t), for bsq_set_allocator. */
+void *bsq_pool_alloc(void *user, size_t size, size_t alignment, uint32_t flags);
+
+void bsq_pool_release(void *user, void *ptr);
+
+bsq_allocator_t bsq_pool_allocator(bsq_pool_t *pool);
+
+void bsq_pool_get_stats(bsq_pool_t *pool, bsq_pool_stats_t *stats);
+
+/*
+ * Reusable execution context: a thread count, optional CPU pinning and per-thread scratch that is sized on
+ * first use and recycled. Repeated bsq_ctx_* calls on the same shapes make no heap allocations. A context is
+ * not thread-safe; give each calling thread its own.
+ */
+typedef struct bsq_ctx bsq_ctx_t;
+
+/* num_threads 0 keeps the OpenMP default (OMP_NUM_THREADS); otherwise it applies only to calls through ctx. */
+bsq_ctx_t *bsq_ctx_create(int num_threads);
+
+void bsq_ctx_free(bsq_ctx_t *ctx);
+
+/* Pin worker thread i of the calling thread's OpenMP team to cpus[i % num_cpus] on the next call (Linux only).
+ * The pinning outlives the call, as the runtime keeps its threads. */
+int bsq_ctx_set_affinity(bsq_ctx_t *ctx, const int *cpus, uint32_t num_cpus);
+
+/* Scratch bytes the context currently holds. */
+uint64_t bsq_ctx_scratch_bytes(const bsq_ctx_t *ctx);
+
+int bsq_ctx_compress_1d_into(bsq_ctx_t *ctx,
+                             const float *src,
+                             uint64_t num_elements,
+                             bsq_method_t method,
+                             void *dst,
+                             int64_t dst_size,
+                             const float *im);
+
+int bsq_ctx_compress_2d_into(bsq_ctx_t *ctx,
+                             const float *src,
+                             uint16_t num_tokens,
+                             uint16_t num_features,
+                             float sparse_ratio,
+                             bsq_method_t method,
+                             void *dst,
+                             int64_t dst_size,
+                             const float *im);
+
+int bsq_ctx_decompress(bsq_ctx_t *ctx,
+                       const bitsqueeze_buffer_t *buf,
+                       float *dst,
+                       uint64_t dst_num_elements);
+
+int bsq_ctx_decompress_range(bsq_ctx_t *ctx,
+                             const bitsqueeze_buffer_t *buf,
+                             uint64_t offset,
+                             uint64_t count,
+                             float *dst);
+
+int bsq_ctx_decompress_rows(bsq_ctx_t *ctx,
+                            const bitsqueeze_buffer_t *buf,
+                            const uint16_t *token_indices,
+                            uint32_t num_rows,
+                            float *dst,
+                            uint64_t dst_num_elements);
+
+int bsq_ctx_apply(bsq_ctx_t *ctx,
+                  const bitsqueeze_buffer_t *buf,
+                  float *dst,
+                  uint64_t dst_num_elements);
+
 int bsq_apply(const bitsqueeze_buffer_t *buf,
                    float *dst,
                    uint64_t dst_num_elements);
 
+/* dst += alpha * decompress(buf) in one pass for every method: TOPK / TOPK_IM scatter-add their kept entries,
+ * other formats add each decoded chunk while it is still in cache. */
+int bsq_accumulate(const bitsqueeze_buffer_t *buf,
+                   float *dst,
+                   uint64_t dst_num_elements,
+                   float alpha);
+
 int64_t bsq_get_packed_size(const bitsqueeze_buffer_t *buf);
 
 bitsqueeze_buffer_t *load_bsq_from_buffer(const void *buffer, int64_t buffer_size);
 
+/* Read-only view over packed bytes, e.g. a mapped file. Only the codec header
+ * is copied into the view; pass &view.buf to bsq_decompress / bsq_apply. */
+typedef struct {
+    bitsqueeze_buffer_t buf;
+    uint64_t payload_header[8];   /* private */
+} bsq_view_t;
+
+/* Validate the packed bytes at buffer (8-byte aligned) and point view into them
+ * without copying the payload. The bytes must outlive the view, which must not
+ * be passed to bsq_free. Returns 0 on success. */
+int bsq_view_from_buffer(const void *buffer, int64_t buffer_size, bsq_view_t *view);
+
+/* Portable serialized form: versioned, pointer-free, little-endian, with 64-byte-aligned
+ * sections. Safe to move between hosts of any endianness and word size. */
+int64_t bsq_get_portable_size(const bitsqueeze_buffer_t *buf);
+
+/* Write buf in portable form into dst, which must hold bsq_get_portable_size(buf) bytes. */
+int bsq_write_portable(const bitsqueeze_buffer_t *buf, void *dst, int64_t dst_size);
+
+/* Zero-copy view over portable bytes (8-byte aligned, e.g. a mapped file). Little-endian
+ * hosts only; returns 1 elsewhere, where bsq_load_portable must be used instead. */
+int bsq_view_portable(const void *src, int64_t src_size, bsq_view_t *view);
+
+/* Decode portable bytes into a new buffer on any host. Release with bsq_free. */
+bitsqueeze_buffer_t *bsq_load_portable(const void *src, int64_t src_size);
+
+/* Container file holding many named tensors in portable form behind an index.
+ * Writers stream tensors and write the index on close; readers map the file and
+ * touch only the index on open, paging tensors in as they are viewed. */
+typedef struct bsq_container_writer bsq_container_writer_t;
+typedef struct bsq_container bsq_container_t;
+
+bsq_container_writer_t *bsq_container_writer_open(const char *path);
+
+int bsq_container_writer_add(bsq_container_writer_t *writer,
+                             const char *name,
+                             const bitsqueeze_buffer_t *buf);
+
+/* Write the index and close the file; frees writer. Returns 0 on success. */
+int bsq_container_writer_close(bsq_container_writer_t *writer);
+
+bsq_container_t *bsq_container_open(const char *path);
+
+void bsq_container_close(bsq_container_t *container);
+
+uint32_t bsq_container_num_tensors(const bsq_container_t *container);
+
+/* Index of the first tensor called name, or -1. */
+int64_t bsq_container_find(const bsq_container_t *container, const char *name);
+
+const char *bsq_container_name(const bsq_container_t *container, uint32_t index);
+
+/* Method and shape from the index, without touching the tensor's pages. */
+int bsq_container_info(const bsq_container_t *container,
+                       uint32_t index,
+                       bsq_method_t *method,
+                       bsq_shape_t *shape);
+
+/* Zero-copy view into the mapping (see bsq_view_portable); valid until bsq_container_close. */
+int bsq_container_view(const bsq_container_t *container, uint32_t index, bsq_view_t *view);
+
+/* Decoded copy of a tensor on any host. Release with bsq_free. */
+bitsqueeze_buffer_t *bsq_container_load(const bsq_container_t *container, uint32_t index);
+
+/* Paging hints for one tensor's bytes (madvise WILLNEED / DONTNEED). */
+int bsq_container_prefetch(const bsq_container_t *container, uint32_t index);
+
+int bsq_container_evict(const bsq_container_t *container, uint32_t index);
+
+/*
+ * In-place re-quantization of modified regions. src is the whole updated tensor (blocks are re-encoded from
+ * all of their elements); only the blocks touching the dirty elements are rewritten. FP8, FP4, NVFP4 and
+ * NF4_DQ keep their tensor scale while the dirty blocks fit under it and re-quantize the whole tensor
+ * otherwise. TOPK/TOPK_IM update whole token rows.
+ */
+
+/* Elements per dirty-bitmap bit of buf (a token row for TOPK/TOPK_IM); 0 when buf cannot be updated. */
+uint64_t bsq_update_block_size(const bitsqueeze_buffer_t *buf);
+
+int bsq_update_range(bitsqueeze_buffer_t *buf,
+                     const float *src,
+                     uint64_t offset,
+                     uint64_t count,
+                     const float *im);
+
+/* Bit i of dirty_blocks (LSB first) marks block i of bsq_update_block_size(buf) elements. */
+int bsq_update_blocks(bitsqueeze_buffer_t *buf,
+                      const float *src,
+                      const uint8_t *dirty_blocks,
+                      const float *im);
+
+/*
+ * Asynchronous jobs on a persistent worker pool inside the library. Each worker runs one job at a time with
+ * its own bsq_ctx_t of threads_per_job OpenMP threads (0: the OpenMP default), so jobs never use the
+ * submitter's team. Source and destination memory must stay valid until the job reaches a final status.
+ */
+typedef struct bsq_async bsq_async_t;
+typedef struct bsq_job bsq_job_t;
+
+typedef enum {
+    BSQ_JOB_QUEUED = 0,
+    BSQ_JOB_RUNNING,
+    BSQ_JOB_DONE,
+    BSQ_JOB_FAILED,
+    BSQ_JOB_CANCELLED
+} bsq_job_status_t;
+
+/* Runs once per job with its final status, on the worker (or on the thread that cancelled it). The handle
+ * is not passed: it may already be released by the time the callback runs. */
+typedef void (*bsq_job_callback_fn)(void *user, bsq_job_status_t status);
+
+#define BSQ_ASYNC_NO_WAIT 1u            /* submit returns NULL instead of blocking on a full queue */
+
+/* At most queue_depth jobs wait for a worker; further submits block (or fail with BSQ_ASYNC_NO_WAIT). */
+bsq_async_t *bsq_async_create(uint32_t num_workers, int threads_per_job, uint32_t queue_depth, uint32_t flags);
+
+/* Cancel queued jobs, finish running ones and stop the workers. Handles stay valid for bsq_job_release. */
+void bsq_async_destroy(bsq_async_t *async);
+
+bsq_job_t *bsq_async_compress_1d_into(bsq_async_t *async,
+                                      const float *src,
+                                      uint64_t num_elements,
+                                      bsq_method_t method,
+                                      void *dst,
+                                      int64_t dst_size,
+                                      const float *im,
+                                      bsq_job_callback_fn callback,
+                                      void *user);
+
+bsq_job_t *bsq_async_compress_2d_into(bsq_async_t *async,
+                                      const float *src,
+                                      uint16_t num_tokens,
+                                      uint16_t num_features,
+                                      float sparse_ratio,
+                                      bsq_method_t method,
+                                      void *dst,
+                                      int64_t dst_size,
+                                      const float *im,
+                                      bsq_job_callback_fn callback,
+                                      void *user);
+
+bsq_job_t *bsq_async_decompress(bsq_async_t *async,
+                                const bitsqueeze_buffer_t *buf,
+                                float *dst,
+                                uint64_t dst_num_elements,
+                                bsq_job_callback_fn callback,
+                                void *user);
+
+bsq_job_status_t bsq_job_poll(const bsq_job_t *job);
+
+bsq_job_status_t bsq_job_wait(bsq_job_t *job);
+
+/* 0 when the job was still queued and will not run; 1 once a worker has it. */
+int bsq_job_cancel(bsq_job_t *job);
+
+/* Cancel or wait for an unfinished job, then free the handle. */
+void bsq_job_release(bsq_job_t *job);
+
+/*
+ * KV offload pipeline over num_layers same-shape tensors. The caller fills a staging buffer from
+ * bsq_offload_stage and commits it with bsq_offload_store, which compresses in the background while the next
+ * layer is computed; num_staging buffers rotate, so staging blocks only when that many stores are in flight.
+ * bsq_offload_load returns a layer decompressed and queues the next lookahead layers (wrapping to layer 0).
+ * Jobs run on async, or on a private two-worker pool when it is NULL. TOPK_IM is not supported. Not
+ * thread-safe: one producer/consumer thread drives a pipeline.
+ */
+typedef struct bsq_offload bsq_offload_t;
+
+typedef struct {
+    uint64_t stores;
+    uint64_t loads;
+    uint64_t prefetch_hits;     /* loads whose layer was already queued or decoded */
+    uint64_t store_stall_ns;    /* time staging and storing waited for earlier compression */
+    uint64_t load_stall_ns;     /* time loads waited for decompression */
+} bsq_offload_stats_t;
+
+/* shape uses num_elements for 1D methods and num_tokens/num_features/sparse_ratio for TOPK. */
+bsq_offload_t *bsq_offload_create(bsq_method_t method,
+                                  const bsq_shape_t *shape,
+                                  uint32_t num_layers,
+                                  uint32_t num_staging,
+                                  uint32_t lookahead,
+                                  bsq_async_t *async);
+
+void bsq_offload_destroy(bsq_offload_t *off);
+
+/* Staging buffer for the next store; repeated calls before bsq_offload_store return the same one. */
+float *bsq_offload_stage(bsq_offload_t *off);
+
+/* Compress the staged buffer into layer in the background. */
+int bsq_offload_store(bsq_offload_t *off, uint32_t layer);
+
+/* Decompressed layer, valid until the next bsq_offload_load or bsq_offload_store; NULL if it was never
+ * stored or failed to compress. */
+const float *bsq_offload_load(bsq_offload_t *off, uint32_t layer);
+
+/* Compressed layer once its store has finished, valid until the layer is stored again. */
+const bitsqueeze_buffer_t *bsq_offload_buffer(bsq_offload_t *off, uint32_t layer);
+
+/* Wait for every store; non-zero if any layer failed to compress. */
+int bsq_offload_sync(bsq_offload_t *off);
+
+void bsq_offload_get_stats(const bsq_offload_t *off, bsq_offload_stats_t *stats);
+
+/*
+ * Appendable 2D tensor for caches that grow a few tokens at a time. Rows go into chunks of doubling capacity
+ * (initial_capacity up to 32768 rows), so an append quantizes only its own rows and never moves earlier ones.
+ * Takes TOPK/TOPK_IM and block formats whose blocks tile a row of num_features; tensor-scale formats (FP8,
+ * FP4, NVFP4, NF4_DQ) are rejected. Not thread-safe.
+ */
+typedef struct bsq_append bsq_append_t;
+
+bsq_append_t *bsq_append_create(bsq_method_t method,
+                                uint16_t num_features,
+                                float sparse_ratio,
+                                uint32_t initial_capacity);
+
+void bsq_append_free(bsq_append_t *app);
+
+/* Quantize num_tokens rows of src (im alongside, as for compression) onto the end. */
+int bsq_append_tokens(bsq_append_t *app, const float *src, uint64_t num_tokens, const float *im);
+
+uint64_t bsq_append_num_tokens(const bsq_append_t *app);
+
+/* Decode rows [first, first + count) back to back into dst. */
+int bsq_append_decompress_range(const bsq_append_t *app, uint64_t first, uint64_t count, float *dst);
+
+/* Decode every row; dst_num_elements must cover num_tokens * num_features. */
+int bsq_append_decompress(const bsq_append_t *app, float *dst, uint64_t dst_num_elements);
+
+/* Copy all rows into one ordinary buffer (1D, or 2D for TOPK/TOPK_IM up to 65535 rows); release with bsq_free. */
+int bsq_append_pack(const bsq_append_t *app, bitsqueeze_buffer_t **out);
+
+/*
+ * Error-feedback compressor for gradients. It keeps a float residual of the tensor's shape, starting at zero.
+ * Each call compresses grad + residual and stores what the quantization lost as the next residual, so the
+ * error is carried over instead of dropped. Block formats do this in one fused pass per cache-sized slice.
+ * Tensor-scale formats (FP8, FP4, NVFP4, NF4_DQ) make three passes. Not thread-safe.
+ */
+typedef struct bsq_feedback bsq_feedback_t;
+
+/* Any 1D method. */
+bsq_feedback_t *bsq_feedback_create_1d(bsq_method_t method, uint64_t num_elements);
+
+/* TOPK/TOPK_IM. */
+bsq_feedback_t *bsq_feedback_create_2d(bsq_method_t method,
+                                       uint16_t num_tokens,
+                                       uint16_t num_features,
+                                       float sparse_ratio);
+
+void bsq_feedback_free(bsq_feedback_t *fb);
+
+/* Compress grad + residual (im alongside, as for compression) and keep the error as the new residual. *out
+ * points at the compressor's packed buffer, which stays valid until the next call and must not be freed. */
+int bsq_feedback_compress(bsq_feedback_t *fb,
+                          const float *grad,
+                          const float *im,
+                          const bitsqueeze_buffer_t **out);
+
+/* The residual the next call will add to grad. */
+const float *bsq_feedback_residual(const bsq_feedback_t *fb);
+
+/* Zero the residual, e.g. after the model is re-synchronized. */
+void bsq_feedback_reset(bsq_feedback_t *fb);
+
+/*
+ * Collectives over compressed tensors between the processes of a job. Same-host ranks can share memory;
+ * TCP (loopback on one box) stands in for the network. Every rank must make the same calls in the same
+ * order. A separate thread sends chunk i + 1 while the caller decodes chunk i. After a failed call the
+ * group is out of step and must be re-created.
+ */
+typedef struct bsq_comm bsq_comm_t;
+
+typedef enum {
+    BSQ_TRANSPORT_SHM = 0,   /* address: POSIX shared-memory name ("/job-42") unique to the group */
+    BSQ_TRANSPORT_TCP = 1    /* address: "host:port"; rank r listens on port + r */
+} bsq_transport_kind_t;
+
+typedef enum {
+    BSQ_COLLECTIVE_RING = 0,
+    BSQ_COLLECTIVE_TREE = 1
+} bsq_collective_algo_t;
+
+/* Join the group as rank of world_size; blocks until every rank has joined (up to 60 s). Linux only. */
+bsq_comm_t *bsq_comm_create(bsq_transport_kind_t transport,
+                            const char *address,
+                            uint32_t rank,
+                            uint32_t world_size);
+
+void bsq_comm_free(bsq_comm_t *comm);
+
+uint32_t bsq_comm_rank(const bsq_comm_t *comm);
+
+uint32_t bsq_comm_size(const bsq_comm_t *comm);
+
+/* Sum data across ranks in place. Partial sums travel as method (any 1D method) in 64K-element chunks,
+ * and the final sum is encoded once, so every rank ends with bit-identical values. */
+int bsq_allreduce(bsq_comm_t *comm,
+                  float *data,
+                  uint64_t num_elements,
+                  bsq_method_t method,
+                  bsq_collective_algo_t algo);
+
+/* Decode every rank's buf (same method and shape everywhere, TOPK included) into dst in rank order.
+ * dst_num_elements must cover world_size times the elements of buf. */
+int bsq_allgather(bsq_comm_t *comm,
+                  const bitsqueeze_buffer_t *buf,
+                  float *dst,
+                  uint64_t dst_num_elements,
+                  bsq_collective_algo_t algo);
+
+/*
+ * Re-encode a 1D buffer as dst_method, with the same result as bsq_compress_1d on its decoded values but
+ * without decoding the whole tensor: Q8_0 -> Q4_0 / Q2_K_FAST, MXFP8 -> MXFP4, FP8 -> NVFP4 and FP16 <-> BF16
+ * convert block by block in one pass; other pairs go through small decoded chunks.
+ */
+int bsq_transcode(const bitsqueeze_buffer_t *src, bsq_method_t dst_method, bitsqueeze_buffer_t **out);
+
+/* bsq_transcode into caller memory, under the rules of bsq_compress_1d_into. */
+int bsq_transcode_into(const bitsqueeze_buffer_t *src, bsq_method_t dst_method, void *dst, int64_t dst_size);
+
 void bsq_free(bitsqueeze_buffer_t *buf);
 
 #ifdef __cplusplus
@@ -0,0 +1,97 @@
+#ifndef BITSQUEEZE_ASYNC_HPP
+#define BITSQUEEZE_ASYNC_HPP
+
+#include <atomic>
+#include <coroutine>
+#include <utility>
+
+#include "bitsqueeze.h"
+
+/* C++20 coroutine wrapper over the bsq_async_* API: co_await a job for its final bsq_job_status_t. */
+namespace bsq {
+
+/*
+ * Submits in await_suspend and resumes the awaiting coroutine from the job callback, i.e. on a worker thread
+ * (or inline when the job finished first). Submission blocks on a full queue unless the pool was created with
+ * BSQ_ASYNC_NO_WAIT, in which case the await yields BSQ_JOB_FAILED.
+ */
+template <typename Submit>
+class job_awaitable {
+public:
+    explicit job_awaitable(Submit submit) : submit_(std::move(submit)) {}
+    job_awaitable(const job_awaitable &) = delete;
+    job_awaitable &operator=(const job_awaitable &) = delete;
+    ~job_awaitable() { bsq_job_release(job_); }
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> handle) noexcept {
+        handle_ = handle;
+        job_ = submit_(&job_awaitable::on_done, this);
+        if (!job_) {
+            status_ = BSQ_JOB_FAILED;
+            return false;
+        }
+        /* Whichever of this and on_done comes second continues the coroutine. */
+        return !arrived_.exchange(true, std::memory_order_acq_rel);
+    }
+
+    bsq_job_status_t await_resume() noexcept {
+        bsq_job_release(job_);
+        job_ = nullptr;
+        return status_;
+    }
+
+private:
+    static void on_done(void *user, bsq_job_status_t status) {
+        job_awaitable *self = static_cast<job_awaitable *>(user);
+        self->status_ = status;
+        if (self->arrived_.exchange(true, std::memory_order_acq_rel)) self->handle_.resume();
+    }
+
+    Submit                  submit_;
+    std::coroutine_handle<> handle_;
+    bsq_job_t              *job_ = nullptr;
+    bsq_job_status_t        status_ = BSQ_JOB_QUEUED;
+    std::atomic<bool>       arrived_{false};
+};
+
+inline auto compress_1d_into(bsq_async_t *async,
+                             const float *src,
+                             uint64_t num_elements,
+                             bsq_method_t method,
+                             void *dst,
+                             int64_t dst_size,
+                             const float *im = nullptr) {
+    return job_awaitable([=](bsq_job_callback_fn callback, void *user) {
+        return bsq_async_compress_1d_into(async, src, num_elements, method, dst, dst_size, im, callback, user);
+    });
+}
+
+inline auto compress_2d_into(bsq_async_t *async,
+                             const float *src,
+                             uint16_t num_tokens,
+                             uint16_t num_features,
+                             float sparse_ratio,
+                             bsq_method_t method,
+                             void *dst,
+                             int64_t dst_size,
+                             const float *im = nullptr) {
+    return job_awaitable([=](bsq_job_callback_fn callback, void *user) {
+        return bsq_async_compress_2d_into(async, src, num_tokens, num_features, sparse_ratio, method,
+                                          dst, dst_size, im, callback, user);
+    });
+}
+
+inline auto decompress(bsq_async_t *async,
+                       const bitsqueeze_buffer_t *buf,
+                       float *dst,
+                       uint64_t dst_num_elements) {
+    return job_awaitable([=](bsq_job_callback_fn callback, void *user) {
+        return bsq_async_decompress(async, buf, dst, dst_num_elements, callback, user);
+    });
+}
+
+}  // namespace bsq
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef BITSQUEEZE_INTERNAL_H
+#define BITSQUEEZE_INTERNAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "bitsqueeze.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Helpers shared by src/bitsqueeze.c and the modules layered on top of it; not installed. */
+
+/* sizeof the codec header struct stored at the start of a payload, 0 for unknown methods. */
+size_t bsq_payload_header_size(bsq_method_t method);
+
+/* Lay out the codec header of buf->payload from buf->method and buf->shape. */
+int bsq_init_payload(bitsqueeze_buffer_t *buf);
+
+/* Validate dst (alignment, dst_size) and lay out an empty buffer of method/shape in it; NULL on failure. */
+bitsqueeze_buffer_t *bsq_prepare_buffer(bsq_method_t method,
+                                        const bsq_shape_t *shape,
+                                        void *dst,
+                                        int64_t dst_size);
+
+/* Quantize src into a payload laid out by bsq_prepare_buffer or bsq_init_payload. */
+int bsq_compress_payload(bitsqueeze_buffer_t *buf, const float *src, const float *im);
+
+/* bsq_compress_payload without opening a parallel region, for callers that already split the work across threads. */
+int bsq_compress_payload_serial(bitsqueeze_buffer_t *buf, const float *src, const float *im);
+
+/* bsq_accumulate without opening a parallel region. */
+int bsq_accumulate_serial(const bitsqueeze_buffer_t *buf, float *dst, uint64_t dst_num_elements, float alpha);
+
+/* bsq_compress_payload with per-thread working memory (see bsq_payload_thread_scratch_size); NULL allocates. */
+int bsq_compress_payload_scratch(bitsqueeze_buffer_t *buf,
+                                 const float *src,
+                                 const float *im,
+                                 void *const *thread_scratch);
+
+/* Bytes of working memory each OpenMP thread needs to compress buf, 0 when the codec needs none. */
+size_t bsq_payload_thread_scratch_size(const bitsqueeze_buffer_t *buf);
+
+/* Scope one call to ctx: apply its thread count (and affinity, once); returns what bsq_ctx_leave restores. */
+int bsq_ctx_enter(bsq_ctx_t *ctx);
+
+void bsq_ctx_leave(bsq_ctx_t *ctx, int saved);
+
+/* One slot of at least size bytes per thread of an entered ctx, grown on demand and kept for later calls. */
+void *const *bsq_ctx_thread_scratch(bsq_ctx_t *ctx, size_t size);
+
+/* Build the lazily initialised lookup tables of method (the IQ2 grids) ahead of a parallel region that
+ * compresses with it; a no-op for other methods. Building them is not thread-safe, so callers that encode
+ * chunks or slices concurrently call this once before the loop. */
+void bsq_prepare_codec_tables(bsq_method_t method);
+
+/* bsq_decompress_range without opening a parallel region, for callers that already split the work across threads. */
+int bsq_decompress_range_serial(const bitsqueeze_buffer_t *buf, uint64_t offset, uint64_t count, float *dst);
+
+/* Non-zero when the counts in the codec header disagree with each other or with buf->shape. */
+int bsq_validate_payload_header(const bitsqueeze_buffer_t *buf);
+
+/* Upper bound on the codec arrays behind one payload header. */
+#define BSQ_MAX_PAYLOAD_ARRAYS 4
+
+/* Non-zero for formats whose encoding depends on a scale taken over the whole tensor. */
+int bsq_payload_has_tensor_scale(bsq_method_t method);
+
+/* Tensor scale stored in a tensor-scale payload (dq_scale for NF4_DQ), 0 for other formats. */
+float bsq_payload_tensor_scale(const bitsqueeze_buffer_t *buf);
+
+/* Overwrite the tensor scale of a tensor-scale payload, e.g. with the one a slice of it was encoded under. */
+void bsq_set_payload_tensor_scale(bitsqueeze_buffer_t *buf, float scale);
+
+/* Tensor scale a tensor-scale format derives from its statistic: the finite absmax, or for NF4_DQ the
+ * largest block scale. */
+float bsq_tensor_scale_for_absmax(bsq_method_t method, float abs_max);
+
+/* That statistic over count values of panel, which starts on a block boundary: the finite absmax, or for NF4_DQ
+ * the largest nf4_dq_block_scale() of its blocks of block_size. */
+float bsq_tensor_scale_statistic(bsq_method_t method, uint64_t block_size, const float *panel, uint64_t count);
+
+/* Quantize src into a tensor-scale payload under a fixed scale. */
+int bsq_compress_payload_scaled(bitsqueeze_buffer_t *buf, const float *src, float scale);
+
+/* bsq_compress_payload_scaled without opening a parallel region. */
+int bsq_compress_payload_scaled_serial(bitsqueeze_buffer_t *buf, const float *src, float scale);
+
+/* Elements per independently coded unit (block or super block) of buf, 1 for element-wise formats,
+ * 0 when the payload cannot be split (2D sparsity). Tensor-scale formats split only under a fixed scale. */
+uint64_t bsq_payload_granule(const bitsqueeze_buffer_t *buf);
+
+/* Rewrite the counts of buf's codec header (and shape) for count elements; array pointers are untouched. */
+int bsq_resize_payload(bitsqueeze_buffer_t *buf, uint64_t count);
+
+/* Codec arrays of buf and their byte sizes in layout order; returns how many (0 for unknown methods). */
+uint32_t bsq_payload_arrays(const bitsqueeze_buffer_t *buf, void **arrays, uint64_t *sizes);
+
+/* Point the codec arrays of buf at arrays[], in bsq_payload_arrays order. */
+void bsq_attach_payload_arrays(bitsqueeze_buffer_t *buf, void *const *arrays);
+
+/* Point slice at elements [first, first + count) of buf's payload: a codec header sized for count whose
+ * arrays alias buf's. first must be a multiple of bsq_payload_granule(buf). */
+int bsq_slice_payload(const bitsqueeze_buffer_t *buf, uint64_t first, uint64_t count, bsq_view_t *slice);
+
+/* Point slice at token rows [first, first + count) of buf: whole sparse rows for TOPK/TOPK_IM, otherwise
+ * elements [first, first + count) * row_elements under the bsq_slice_payload alignment rule. */
+int bsq_slice_payload_rows(const bitsqueeze_buffer_t *buf,
+                           uint64_t row_elements,
+                           uint64_t first,
+                           uint64_t count,
+                           bsq_view_t *slice);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
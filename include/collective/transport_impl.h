@@ -0,0 +1,41 @@
+#ifndef TRANSPORT_IMPL_H
+#define TRANSPORT_IMPL_H
+
+#include <stdint.h>
+
+#include "bitsqueeze.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Seconds a blocked send or receive waits on a silent peer before failing, and a rank waits for the group. */
+#define BSQ_TRANSPORT_TIMEOUT_SEC 60
+/* Bytes of each directed shared-memory ring. */
+#define BSQ_SHM_RING_BYTES (1u << 20)
+
+/*
+ * Reliable, ordered byte streams between every pair of ranks of a group. One thread may send to a peer while
+ * another receives from it; two threads must not send to (or receive from) the same peer at once.
+ */
+typedef struct bsq_transport bsq_transport_t;
+
+/* Join the group and connect to every other rank; returns NULL on failure or timeout. */
+bsq_transport_t *bsq_transport_open(bsq_transport_kind_t kind,
+                                    const char *address,
+                                    uint32_t rank,
+                                    uint32_t world_size);
+
+void bsq_transport_close(bsq_transport_t *transport);
+
+/* Block until all size bytes are handed to peer; 0 on success. */
+int bsq_transport_send(bsq_transport_t *transport, uint32_t peer, const void *data, uint64_t size);
+
+/* Block until size bytes from peer are in data; 0 on success. */
+int bsq_transport_recv(bsq_transport_t *transport, uint32_t peer, void *data, uint64_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
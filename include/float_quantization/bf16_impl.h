@@ -16,6 +16,12 @@ typedef struct {
     uint16_t *data;         /* BF16 payload, length = num_elements */
 } bf16_array_t;
 
+/* Byte size of a bf16_array_t holding num_elements values, header included. */
+int64_t compute_bf16_array_size(uint64_t num_elements);
+
+/* Lay out a bf16_array_t in caller memory of at least compute_bf16_array_size() bytes. */
+bf16_array_t *init_bf16_array(void *buffer, uint64_t num_elements);
+
 bf16_array_t *allocate_bf16_array(uint64_t num_elements);
 
 void free_bf16_array(bf16_array_t *bf16_array);
@@ -28,9 +34,29 @@ int bf16_compress(const float *float_array,
                   uint64_t num_elements,
                   bf16_array_t **bf16_array);
 
+/* Quantize into an array prepared by init_bf16_array or allocate_bf16_array. */
+int bf16_compress_into(const float *float_array,
+                       bf16_array_t *bf16_array);
+
+/* bf16_compress_into without a parallel region, for callers that are already inside one. */
+int bf16_compress_into_serial(const float *float_array,
+                              bf16_array_t *bf16_array);
+
 int bf16_decompress(const bf16_array_t *bf16_array,
                     float *float_array);
 
+/* Decode elements [offset, offset + count) into float_array[0 .. count). */
+int bf16_decompress_range(const bf16_array_t *bf16_array,
+                          uint64_t offset,
+                          uint64_t count,
+                          float *float_array);
+
+/* bf16_decompress_range without a parallel region, for callers that are already inside one. */
+int bf16_decompress_range_serial(const bf16_array_t *bf16_array,
+                                 uint64_t offset,
+                                 uint64_t count,
+                                 float *float_array);
+
 #ifdef __cplusplus
 }
 #endif
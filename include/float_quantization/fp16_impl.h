@@ -16,6 +16,12 @@ typedef struct {
     uint16_t *data;         /* IEEE FP16 payload, length = num_elements */
 } fp16_array_t;
 
+/* Byte size of a fp16_array_t holding num_elements values, header included. */
+int64_t compute_fp16_array_size(uint64_t num_elements);
+
+/* Lay out a fp16_array_t in caller memory of at least compute_fp16_array_size() bytes. */
+fp16_array_t *init_fp16_array(void *buffer, uint64_t num_elements);
+
 fp16_array_t *allocate_fp16_array(uint64_t num_elements);
 
 void free_fp16_array(fp16_array_t *fp16_array);
@@ -28,9 +34,29 @@ int fp16_compress(const float *float_array,
                   uint64_t num_elements,
                   fp16_array_t **fp16_array);
 
+/* Quantize into an array prepared by init_fp16_array or allocate_fp16_array. */
+int fp16_compress_into(const float *float_array,
+                       fp16_array_t *fp16_array);
+
+/* fp16_compress_into without a parallel region, for callers that are already inside one. */
+int fp16_compress_into_serial(const float *float_array,
+                              fp16_array_t *fp16_array);
+
 int fp16_decompress(const fp16_array_t *fp16_array,
                     float *float_array);
 
+/* Decode elements [offset, offset + count) into float_array[0 .. count). */
+int fp16_decompress_range(const fp16_array_t *fp16_array,
+                          uint64_t offset,
+                          uint64_t count,
+                          float *float_array);
+
+/* fp16_decompress_range without a parallel region, for callers that are already inside one. */
+int fp16_decompress_range_serial(const fp16_array_t *fp16_array,
+                                 uint64_t offset,
+                                 uint64_t count,
+                                 float *float_array);
+
 #ifdef __cplusplus
 }
 #endif
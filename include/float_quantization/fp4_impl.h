@@ -18,6 +18,12 @@ typedef struct {
     uint8_t *data;   /* packed FP4 E2M1 payload, length = ceil(num_elements / 2) bytes */
 } fp4_array_t;
 
+/* Byte size of a fp4_array_t holding num_elements values, header included. */
+int64_t compute_fp4_array_size(uint64_t num_elements);
+
+/* Lay out a fp4_array_t in caller memory of at least compute_fp4_array_size() bytes. */
+fp4_array_t *init_fp4_array(void *buffer, uint64_t num_elements);
+
 fp4_array_t *allocate_fp4_array(uint64_t num_elements);
 
 void free_fp4_array(fp4_array_t *fp4_array);
@@ -30,9 +36,42 @@ int fp4_compress(const float *float_array,
                  uint64_t num_elements,
                  fp4_array_t **fp4_array);
 
+/* Quantize into an array prepared by init_fp4_array or allocate_fp4_array. */
+int fp4_compress_into(const float *float_array,
+                      fp4_array_t *fp4_array);
+
+/* fp4_compress_into without a parallel region, for callers that are already inside one. */
+int fp4_compress_into_serial(const float *float_array,
+                             fp4_array_t *fp4_array);
+
+/* Tensor scale fp4_compress_into would pick for a tensor whose largest finite |x| is abs_max. */
+float fp4_scale_for_absmax(float abs_max);
+
+/* fp4_compress_into with the tensor scale given rather than scanned from float_array. */
+int fp4_compress_into_scaled(const float *float_array,
+                             float scale,
+                             fp4_array_t *fp4_array);
+
+/* fp4_compress_into_scaled without a parallel region, for callers that are already inside one. */
+int fp4_compress_into_scaled_serial(const float *float_array,
+                                    float scale,
+                                    fp4_array_t *fp4_array);
+
 int fp4_decompress(const fp4_array_t *fp4_array,
                    float *float_array);
 
+/* Decode elements [offset, offset + count) into float_array[0 .. count). */
+int fp4_decompress_range(const fp4_array_t *fp4_array,
+                         uint64_t offset,
+                         uint64_t count,
+                         float *float_array);
+
+/* fp4_decompress_range without a parallel region, for callers that are already inside one. */
+int fp4_decompress_range_serial(const fp4_array_t *fp4_array,
+                                uint64_t offset,
+                                uint64_t count,
+                                float *float_array);
+
 #ifdef __cplusplus
 }
 #endif
@@ -18,6 +18,15 @@ typedef struct {
     uint8_t *data;   /* FP8 E4M3 payload, length = num_elements */
 } fp8_array_t;
 
+/* Value of one E4M3 code; MXFP8 uses the same encoding. */
+float fp8_e4m3_to_fp32(uint8_t code);
+
+/* Byte size of a fp8_array_t holding num_elements values, header included. */
+int64_t compute_fp8_array_size(uint64_t num_elements);
+
+/* Lay out a fp8_array_t in caller memory of at least compute_fp8_array_size() bytes. */
+fp8_array_t *init_fp8_array(void *buffer, uint64_t num_elements);
+
 fp8_array_t *allocate_fp8_array(uint64_t num_elements);
 
 void free_fp8_array(fp8_array_t *fp8_array);
@@ -30,9 +39,42 @@ int fp8_compress(const float *float_array,
                  uint64_t num_elements,
                  fp8_array_t **fp8_array);
 
+/* Quantize into an array prepared by init_fp8_array or allocate_fp8_array. */
+int fp8_compress_into(const float *float_array,
+                      fp8_array_t *fp8_array);
+
+/* fp8_compress_into without a parallel region, for callers that are already inside one. */
+int fp8_compress_into_serial(const float *float_array,
+                             fp8_array_t *fp8_array);
+
+/* Tensor scale fp8_compress_into would pick for a tensor whose largest finite |x| is abs_max. */
+float fp8_scale_for_absmax(float abs_max);
+
+/* fp8_compress_into with the tensor scale given rather than scanned from float_array. */
+int fp8_compress_into_scaled(const float *float_array,
+                             float scale,
+                             fp8_array_t *fp8_array);
+
+/* fp8_compress_into_scaled without a parallel region, for callers that are already inside one. */
+int fp8_compress_into_scaled_serial(const float *float_array,
+                                    float scale,
+                                    fp8_array_t *fp8_array);
+
 int fp8_decompress(const fp8_array_t *fp8_array,
                    float *float_array);
 
+/* Decode elements [offset, offset + count) into float_array[0 .. count). */
+int fp8_decompress_range(const fp8_array_t *fp8_array,
+                         uint64_t offset,
+                         uint64_t count,
+                         float *float_array);
+
+/* fp8_decompress_range without a parallel region, for callers that are already inside one. */
+int fp8_decompress_range_serial(const fp8_array_t *fp8_array,
+                                uint64_t offset,
+                                uint64_t count,
+                                float *float_array);
+
 #ifdef __cplusplus
 }
 #endif
@@ -21,6 +21,15 @@ typedef struct {
     uint8_t *data;           /* packed FP4 E2M1 payload, length = ceil(num_elements / 2) bytes */
 } mxfp4_array_t;
 
+/* Byte size of a mxfp4_array_t holding num_elements values, header included. */
+int64_t compute_mxfp4_array_size(uint64_t num_elements,
+                                 uint64_t block_size);
+
+/* Lay out a mxfp4_array_t in caller memory of at least compute_mxfp4_array_size() bytes. */
+mxfp4_array_t *init_mxfp4_array(void *buffer,
+                                uint64_t num_elements,
+                                uint64_t block_size);
+
 mxfp4_array_t *allocate_mxfp4_array(uint64_t num_elements,
                                     uint64_t block_size);
 
@@ -34,9 +43,40 @@ int mxfp4_compress(const float *float_array,
                    uint64_t num_elements,
                    mxfp4_array_t **mxfp4_array);
 
+/* Quantize count <= block_size values as one block: its scale exponent and (count + 1) / 2 packed bytes. */
+void mxfp4_quantize_block(const float *float_array, uint64_t count, int8_t *scale_exp, uint8_t *packed);
+
+/* Quantize into an array prepared by init_mxfp4_array or allocate_mxfp4_array. */
+int mxfp4_compress_into(const float *float_array,
+                        mxfp4_array_t *mxfp4_array);
+
+/* mxfp4_compress_into without a parallel region, for callers that are already inside one. */
+int mxfp4_compress_into_serial(const float *float_array,
+                               mxfp4_array_t *mxfp4_array);
+
 int mxfp4_decompress(const mxfp4_array_t *mxfp4_array,
                      float *float_array);
 
+/* Decode elements [offset, offset + count) into float_array[0 .. count). */
+int mxfp4_decompress_range(const mxfp4_array_t *mxfp4_array,
+                           uint64_t offset,
+                           uint64_t count,
+                           float *float_array);
+
+/* mxfp4_decompress_range without a parallel region, for callers that are already inside one. */
+int mxfp4_decompress_range_serial(const mxfp4_array_t *mxfp4_array,
+                                  uint64_t offset,
+                                  uint64_t count,
+                                  float *float_array);
+
+/* y[rows] = W x for W the rows x cols matrix stored row-major in mxfp4_array, without a float copy of W.
+ * cols must be a multiple of the block size. */
+int mxfp4_gemv(const mxfp4_array_t *mxfp4_array,
+               uint64_t rows,
+               uint64_t cols,
+               const float *x,
+               float *y);
+
 #ifdef __cplusplus
 }
 #endif
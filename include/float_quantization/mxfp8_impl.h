@@ -21,6 +21,15 @@ typedef struct {
     uint8_t *data;           /* FP8 E4M3 payload, length = num_elements */
 } mxfp8_array_t;
 
+/* Byte size of a mxfp8_array_t holding num_elements values, header included. */
+int64_t compute_mxfp8_array_size(uint64_t num_elements,
+                                 uint64_t block_size);
+
+/* Lay out a mxfp8_array_t in caller memory of at least compute_mxfp8_array_size() bytes. */
+mxfp8_array_t *init_mxfp8_array(void *buffer,
+                                uint64_t num_elements,
+                                uint64_t block_size);
+
 mxfp8_array_t *allocate_mxfp8_array(uint64_t num_elements,
                                     uint64_t block_size);
 
@@ -34,9 +43,29 @@ int mxfp8_compress(const float *float_array,
                    uint64_t num_elements,
                    mxfp8_array_t **mxfp8_array);
 
+/* Quantize into an array prepared by init_mxfp8_array or allocate_mxfp8_array. */
+int mxfp8_compress_into(const float *float_array,
+                        mxfp8_array_t *mxfp8_array);
+
+/* mxfp8_compress_into without a parallel region, for callers that are already inside one. */
+int mxfp8_compress_into_serial(const float *float_array,
+                               mxfp8_array_t *mxfp8_array);
+
 int mxfp8_decompress(const mxfp8_array_t *mxfp8_array,
                      float *float_array);
 
+/* Decode elements [offset, offset + count) into float_array[0 .. count). */
+int mxfp8_decompress_range(const mxfp8_array_t *mxfp8_array,
+                           uint64_t offset,
+                           uint64_t count,
+                           float *float_array);
+
+/* mxfp8_decompress_range without a parallel region, for callers that are already inside one. */
+int mxfp8_decompress_range_serial(const mxfp8_array_t *mxfp8_array,
+                                  uint64_t offset,
+                                  uint64_t count,
+                                  float *float_array);
+
 #ifdef __cplusplus
 }
 #endif
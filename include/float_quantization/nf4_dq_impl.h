@@ -28,6 +28,15 @@ typedef struct {
     uint8_t *data;           /* packed NF4_DQ codes, length = ceil(num_elements / 2) bytes */
 } nf4_dq_array_t;
 
+/* Byte size of a nf4_dq_array_t holding num_elements values, header included. */
+int64_t compute_nf4_dq_array_size(uint64_t num_elements,
+                                  uint64_t block_size);
+
+/* Lay out a nf4_dq_array_t in caller memory of at least compute_nf4_dq_array_size() bytes. */
+nf4_dq_array_t *init_nf4_dq_array(void *buffer,
+                                  uint64_t num_elements,
+                                  uint64_t block_size);
+
 nf4_dq_array_t *allocate_nf4_dq_array(uint64_t num_elements,
                                       uint64_t block_size);
 
@@ -41,9 +50,45 @@ int nf4_dq_compress(const float *float_array,
                     uint64_t num_elements,
                     nf4_dq_array_t **nf4_dq_array);
 
+/* Quantize into an array prepared by init_nf4_dq_array or allocate_nf4_dq_array. */
+int nf4_dq_compress_into(const float *float_array,
+                         nf4_dq_array_t *nf4_dq_array);
+
+/* nf4_dq_compress_into without a parallel region, for callers that are already inside one. */
+int nf4_dq_compress_into_serial(const float *float_array,
+                                nf4_dq_array_t *nf4_dq_array);
+
+/* FP32 scale of one block before FP8 coding: its largest finite |x|, or 1 for an all-zero block. */
+float nf4_dq_block_scale(const float *block, uint64_t len);
+
+/* dq_scale nf4_dq_compress_into would pick when the largest nf4_dq_block_scale() of the tensor is abs_max. */
+float nf4_dq_scale_for_absmax(float abs_max);
+
+/* nf4_dq_compress_into with dq_scale given rather than derived from float_array. */
+int nf4_dq_compress_into_scaled(const float *float_array,
+                                float dq_scale,
+                                nf4_dq_array_t *nf4_dq_array);
+
+/* nf4_dq_compress_into_scaled without a parallel region, for callers that are already inside one. */
+int nf4_dq_compress_into_scaled_serial(const float *float_array,
+                                       float dq_scale,
+                                       nf4_dq_array_t *nf4_dq_array);
+
 int nf4_dq_decompress(const nf4_dq_array_t *nf4_dq_array,
                       float *float_array);
 
+/* Decode elements [offset, offset + count) into float_array[0 .. count). */
+int nf4_dq_decompress_range(const nf4_dq_array_t *nf4_dq_array,
+                            uint64_t offset,
+                            uint64_t count,
+                            float *float_array);
+
+/* nf4_dq_decompress_range without a parallel region, for callers that are already inside one. */
+int nf4_dq_decompress_range_serial(const nf4_dq_array_t *nf4_dq_array,
+                                   uint64_t offset,
+                                   uint64_t count,
+                                   float *float_array);
+
 #ifdef __cplusplus
 }
 #endif
@@ -25,6 +25,15 @@ typedef struct {
     uint8_t *data;           /* packed NF4 codes, length = ceil(num_elements / 2) bytes */
 } nf4_array_t;
 
+/* Byte size of a nf4_array_t holding num_elements values, header included. */
+int64_t compute_nf4_array_size(uint64_t num_elements,
+                               uint64_t block_size);
+
+/* Lay out a nf4_array_t in caller memory of at least compute_nf4_array_size() bytes. */
+nf4_array_t *init_nf4_array(void *buffer,
+                            uint64_t num_elements,
+                            uint64_t block_size);
+
 nf4_array_t *allocate_nf4_array(uint64_t num_elements,
                                 uint64_t block_size);
 
@@ -38,9 +47,37 @@ int nf4_compress(const float *float_array,
                  uint64_t num_elements,
                  nf4_array_t **nf4_array);
 
+/* Quantize into an array prepared by init_nf4_array or allocate_nf4_array. */
+int nf4_compress_into(const float *float_array,
+                      nf4_array_t *nf4_array);
+
+/* nf4_compress_into without a parallel region, for callers that are already inside one. */
+int nf4_compress_into_serial(const float *float_array,
+                             nf4_array_t *nf4_array);
+
 int nf4_decompress(const nf4_array_t *nf4_array,
                    float *float_array);
 
+/* Decode elements [offset, offset + count) into float_array[0 .. count). */
+int nf4_decompress_range(const nf4_array_t *nf4_array,
+                         uint64_t offset,
+                         uint64_t count,
+                         float *float_array);
+
+/* nf4_decompress_range without a parallel region, for callers that are already inside one. */
+int nf4_decompress_range_serial(const nf4_array_t *nf4_array,
+                                uint64_t offset,
+                                uint64_t count,
+                                float *float_array);
+
+/* y[rows] = W x for W the rows x cols matrix stored row-major in nf4_array, without a float copy of W.
+ * cols must be a multiple of the block size. */
+int nf4_gemv(const nf4_array_t *nf4_array,
+             uint64_t rows,
+             uint64_t cols,
+             const float *x,
+             float *y);
+
 #ifdef __cplusplus
 }
 #endif
@@ -23,6 +23,15 @@ typedef struct {
     uint8_t *data;           /* packed FP4 E2M1 payload, length = ceil(num_elements / 2) bytes */
 } nvfp4_array_t;
 
+/* Byte size of a nvfp4_array_t holding num_elements values, header included. */
+int64_t compute_nvfp4_array_size(uint64_t num_elements,
+                                 uint64_t block_size);
+
+/* Lay out a nvfp4_array_t in caller memory of at least compute_nvfp4_array_size() bytes. */
+nvfp4_array_t *init_nvfp4_array(void *buffer,
+                                uint64_t num_elements,
+                                uint64_t block_size);
+
 nvfp4_array_t *allocate_nvfp4_array(uint64_t num_elements,
                                     uint64_t block_size);
 
@@ -36,9 +45,57 @@ int nvfp4_compress(const float *float_array,
                    uint64_t num_elements,
                    nvfp4_array_t **nvfp4_array);
 
+/* Quantize into an array prepared by init_nvfp4_array or allocate_nvfp4_array. */
+int nvfp4_compress_into(const float *float_array,
+                        nvfp4_array_t *nvfp4_array);
+
+/* nvfp4_compress_into without a parallel region, for callers that are already inside one. */
+int nvfp4_compress_into_serial(const float *float_array,
+                               nvfp4_array_t *nvfp4_array);
+
+/* Tensor scale nvfp4_compress_into would pick for a tensor whose largest finite |x| is abs_max. */
+float nvfp4_tensor_scale_for_absmax(float abs_max);
+
+/* Quantize count <= block_size values as one block under tensor_scale: its E4M3 block scale and packed nibbles. */
+void nvfp4_quantize_block(const float *float_array,
+                          uint64_t count,
+                          float tensor_scale,
+                          uint8_t *block_scale,
+                          uint8_t *packed);
+
+/* nvfp4_compress_into with the tensor scale given rather than scanned from float_array. */
+int nvfp4_compress_into_scaled(const float *float_array,
+                               float tensor_scale,
+                               nvfp4_array_t *nvfp4_array);
+
+/* nvfp4_compress_into_scaled without a parallel region, for callers that are already inside one. */
+int nvfp4_compress_into_scaled_serial(const float *float_array,
+                                      float tensor_scale,
+                                      nvfp4_array_t *nvfp4_array);
+
 int nvfp4_decompress(const nvfp4_array_t *nvfp4_array,
                      float *float_array);
 
+/* Decode elements [offset, offset + count) into float_array[0 .. count). */
+int nvfp4_decompress_range(const nvfp4_array_t *nvfp4_array,
+                           uint64_t offset,
+                           uint64_t count,
+                           float *float_array);
+
+/* nvfp4_decompress_range without a parallel region, for callers that are already inside one. */
+int nvfp4_decompress_range_serial(const nvfp4_array_t *nvfp4_array,
+                                  uint64_t offset,
+                                  uint64_t count,
+                                  float *float_array);
+
+/* y[rows] = W x for W the rows x cols matrix stored row-major in nvfp4_array, without a float copy of W.
+ * cols must be a multiple of the block size. */
+int nvfp4_gemv(const nvfp4_array_t *nvfp4_array,
+               uint64_t rows,
+               uint64_t cols,
+               const float *x,
+               float *y);
+
 #ifdef __cplusplus
 }
 #endif
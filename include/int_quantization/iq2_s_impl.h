@@ -43,6 +43,12 @@ void iq2_s_init(void);
  */
 void iq2_s_free_tables(void);
 
+/* Byte size of a iq2_s_array_t holding num_elements values, header included. */
+int64_t compute_iq2_s_array_size(uint64_t num_elements);
+
+/* Lay out a iq2_s_array_t in caller memory of at least compute_iq2_s_array_size() bytes. */
+iq2_s_array_t *init_iq2_s_array(void *buffer, uint64_t num_elements);
+
 iq2_s_array_t *allocate_iq2_s_array(uint64_t num_elements);
 
 void free_iq2_s_array(iq2_s_array_t *arr);
@@ -55,9 +61,29 @@ int iq2_s_compress(const float *float_array,
                    uint64_t num_elements,
                    iq2_s_array_t **out);
 
+/* Quantize into an array prepared by init_iq2_s_array or allocate_iq2_s_array. */
+int iq2_s_compress_into(const float *float_array,
+                        iq2_s_array_t *arr);
+
+/* iq2_s_compress_into without a parallel region, for callers that are already inside one. */
+int iq2_s_compress_into_serial(const float *float_array,
+                               iq2_s_array_t *arr);
+
 int iq2_s_decompress(const iq2_s_array_t *arr,
                      float *float_array);
 
+/* Decode elements [offset, offset + count) into float_array[0 .. count). */
+int iq2_s_decompress_range(const iq2_s_array_t *arr,
+                           uint64_t offset,
+                           uint64_t count,
+                           float *float_array);
+
+/* iq2_s_decompress_range without a parallel region, for callers that are already inside one. */
+int iq2_s_decompress_range_serial(const iq2_s_array_t *arr,
+                                  uint64_t offset,
+                                  uint64_t count,
+                                  float *float_array);
+
 #ifdef __cplusplus
 }
 #endif
@@ -12,6 +12,18 @@ int q2_k_fast_compress(const float *float_array,
                        uint64_t num_elements,
                        q2_k_array_t **q2_k_array);
 
+int q2_k_fast_compress_into(const float *float_array,
+                            q2_k_array_t *q2_k_array);
+
+/* q2_k_fast_compress_into without a parallel region, for callers that are already inside one. */
+int q2_k_fast_compress_into_serial(const float *float_array,
+                                   q2_k_array_t *q2_k_array);
+
+/* Quantize count <= WEIGHT_PER_SUPER_BLOCK values, zero-padded, into one super-block. */
+void q2_k_fast_quantize_super_block(const float *float_array,
+                                    uint64_t count,
+                                    super_block_q2_k *super_block);
+
 int q2_k_fast_decompress(const q2_k_array_t *q2_k_array,
                          float *float_array);
 
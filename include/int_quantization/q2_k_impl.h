@@ -36,6 +36,12 @@ typedef struct {
     
 } q2_k_array_t;
 
+/* Byte size of a q2_k_array_t holding num_elements values, header included. */
+int64_t compute_q2_k_array_size(uint64_t num_elements);
+
+/* Lay out a q2_k_array_t in caller memory of at least compute_q2_k_array_size() bytes. */
+q2_k_array_t *init_q2_k_array(void *buffer, uint64_t num_elements);
+
 q2_k_array_t *allocate_q2_k_array(uint64_t num_elements);
 
 void free_q2_k_array(q2_k_array_t *q2_k_array);
@@ -46,11 +52,42 @@ q2_k_array_t *load_q2_k_array_from_buffer(const void *buffer, int64_t buffer_siz
 
 int q2_k_compress(const float *float_array, uint64_t num_elements, q2_k_array_t **q2_k_array);
 
+/* Quantize into an array prepared by init_q2_k_array or allocate_q2_k_array. */
+int q2_k_compress_into(const float *float_array, q2_k_array_t *q2_k_array);
+
+/* q2_k_compress_into without a parallel region, for callers that are already inside one. */
+int q2_k_compress_into_serial(const float *float_array, q2_k_array_t *q2_k_array);
+
 // The importance_array should be non‑negative because the current error‑estimation equation assumes it is positive.
 int q2_k_im_compress(const float *float_array, const float *importance_array, uint64_t num_elements, q2_k_array_t **q2_k_array);
 
+int q2_k_im_compress_into(const float *float_array, const float *importance_array, q2_k_array_t *q2_k_array);
+
+/* q2_k_im_compress_into without a parallel region, for callers that are already inside one. */
+int q2_k_im_compress_into_serial(const float *float_array, const float *importance_array, q2_k_array_t *q2_k_array);
+
 int q2_k_decompress(const q2_k_array_t *q2_k_array, float *float_array);
 
+/* Decode elements [offset, offset + count) into float_array[0 .. count). */
+int q2_k_decompress_range(const q2_k_array_t *q2_k_array,
+                          uint64_t offset,
+                          uint64_t count,
+                          float *float_array);
+
+/* q2_k_decompress_range without a parallel region, for callers that are already inside one. */
+int q2_k_decompress_range_serial(const q2_k_array_t *q2_k_array,
+                                 uint64_t offset,
+                                 uint64_t count,
+                                 float *float_array);
+
+/* y[rows] = W x for W the rows x cols matrix stored row-major in q2_k_array, without a float copy of W.
+ * cols must be a multiple of WEIGHT_PER_SUPER_BLOCK. */
+int q2_k_gemv(const q2_k_array_t *q2_k_array,
+              uint64_t rows,
+              uint64_t cols,
+              const float *x,
+              float *y);
+
 #ifdef __cplusplus
 }
 #endif
@@ -22,6 +22,15 @@ typedef struct {
     int8_t *data;            /* for kquant, here need to contain quantized scale value + quantized value, otherwise it only need to store quantized value*/
 } q4_0_array_t;
 
+/* Byte size of a q4_0_array_t holding num_elements values, header included. */
+int64_t compute_q4_0_array_size(uint64_t num_elements,
+                                uint64_t block_size);
+
+/* Lay out a q4_0_array_t in caller memory of at least compute_q4_0_array_size() bytes. */
+q4_0_array_t *init_q4_0_array(void *buffer,
+                              uint64_t num_elements,
+                              uint64_t block_size);
+
 q4_0_array_t *allocate_q4_0_array(uint64_t num_elements,
                                        uint64_t block_size);                                       
 
@@ -36,9 +45,40 @@ int q4_0_compress(const float *float_array,
              uint8_t quantized_type,
              q4_0_array_t **q4_0_array);
 
+/* Quantize count <= block_size values as one block: its scale and (count + 1) / 2 packed bytes, high nibble first. */
+void q4_0_quantize_block(const float *float_array, uint64_t count, float *scale, uint8_t *packed);
+
+/* Quantize into an array prepared by init_q4_0_array or allocate_q4_0_array. */
+int q4_0_compress_into(const float *float_array,
+                       q4_0_array_t *q4_0_array);
+
+/* q4_0_compress_into without a parallel region, for callers that are already inside one. */
+int q4_0_compress_into_serial(const float *float_array,
+                              q4_0_array_t *q4_0_array);
+
 int q4_0_decompress(const q4_0_array_t *q4_0_array,
                float *float_array);
 
+/* Decode elements [offset, offset + count) into float_array[0 .. count). */
+int q4_0_decompress_range(const q4_0_array_t *q4_0_array,
+                          uint64_t offset,
+                          uint64_t count,
+                          float *float_array);
+
+/* q4_0_decompress_range without a parallel region, for callers that are already inside one. */
+int q4_0_decompress_range_serial(const q4_0_array_t *q4_0_array,
+                                 uint64_t offset,
+                                 uint64_t count,
+                                 float *float_array);
+
+/* y[rows] = W x for W the rows x cols matrix stored row-major in q4_0_array, without a float copy of W.
+ * cols must be a multiple of the block size. */
+int q4_0_gemv(const q4_0_array_t *q4_0_array,
+              uint64_t rows,
+              uint64_t cols,
+              const float *x,
+              float *y);
+
 #ifdef __cplusplus
 }
 #endif
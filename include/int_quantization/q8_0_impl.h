@@ -21,6 +21,15 @@ typedef struct {
     int8_t *data;            /* store quantized value*/
 } q8_0_array_t;
 
+/* Byte size of a q8_0_array_t holding num_elements values, header included. */
+int64_t compute_q8_0_array_size(uint64_t num_elements,
+                                uint64_t block_size);
+
+/* Lay out a q8_0_array_t in caller memory of at least compute_q8_0_array_size() bytes. */
+q8_0_array_t *init_q8_0_array(void *buffer,
+                              uint64_t num_elements,
+                              uint64_t block_size);
+
 q8_0_array_t *allocate_q8_0_array(uint64_t num_elements,
                                        uint64_t block_size);
                                     
@@ -34,9 +43,44 @@ int q8_0_compress(const float *float_array,
              uint64_t num_elements,
              q8_0_array_t **q8_0_array);
 
+/* Quantize into an array prepared by init_q8_0_array or allocate_q8_0_array. */
+int q8_0_compress_into(const float *float_array,
+                       q8_0_array_t *q8_0_array);
+
+/* q8_0_compress_into without a parallel region, for callers that are already inside one. */
+int q8_0_compress_into_serial(const float *float_array,
+                              q8_0_array_t *q8_0_array);
+
+/* Quantize float_array exactly as Q8_0 does, into bare DEFAULT_Q8_0_BLOCK_SIZE blocks: codes (num_elements)
+ * and scales (one per block). Meant for activations on their way into an integer dot product. */
+int q8_0_quantize_blocks(const float *float_array,
+                         uint64_t num_elements,
+                         int8_t *codes,
+                         float *scales);
+
 int q8_0_decompress(const q8_0_array_t *q8_0_array,
                float *float_array);
 
+/* Decode elements [offset, offset + count) into float_array[0 .. count). */
+int q8_0_decompress_range(const q8_0_array_t *q8_0_array,
+                          uint64_t offset,
+                          uint64_t count,
+                          float *float_array);
+
+/* q8_0_decompress_range without a parallel region, for callers that are already inside one. */
+int q8_0_decompress_range_serial(const q8_0_array_t *q8_0_array,
+                                 uint64_t offset,
+                                 uint64_t count,
+                                 float *float_array);
+
+/* y[rows] = W x for W the rows x cols matrix stored row-major in q8_0_array, without a float copy of W.
+ * cols must be a multiple of the block size. */
+int q8_0_gemv(const q8_0_array_t *q8_0_array,
+              uint64_t rows,
+              uint64_t cols,
+              const float *x,
+              float *y);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,55 @@
+#ifndef Q8_DOT_IMPL_H
+#define Q8_DOT_IMPL_H
+
+#include <stdint.h>
+
+#include "int_quantization/q8_0_impl.h"
+#include "int_quantization/q4_0_impl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Integer dot-product kernels between Q8_0 / Q4_0 weights and activations quantized by q8_0_quantize_blocks.
+ * Each DEFAULT_Q8_0_BLOCK_SIZE block is multiplied in int32 and then scaled by the weight and activation
+ * scales. The widest ISA the CPU supports is picked at run time. */
+typedef enum {
+    Q8_DOT_SCALAR = 0,
+    Q8_DOT_AVX2,          /* maddubs + madd */
+    Q8_DOT_AVX_VNNI,      /* VEX vpdpbusd */
+    Q8_DOT_AVX512_VNNI    /* EVEX vpdpbusd on 256-bit vectors */
+} q8_dot_isa_t;
+
+/* ISA the kernels use: the best one available, capped by q8_dot_set_max_isa. */
+q8_dot_isa_t q8_dot_isa(void);
+
+/* Cap the ISA (tests use this to compare every path); Q8_DOT_AVX512_VNNI removes the cap. */
+void q8_dot_set_max_isa(q8_dot_isa_t isa);
+
+/* y = W x for a rows x cols matrix (block size DEFAULT_Q8_0_BLOCK_SIZE, cols a multiple of it) against x
+ * given as cols codes and cols / DEFAULT_Q8_0_BLOCK_SIZE scales. */
+int q8_0_gemv_q8(const q8_0_array_t *q8_0_array,
+                 uint64_t rows,
+                 uint64_t cols,
+                 const int8_t *x_codes,
+                 const float *x_scales,
+                 float *y);
+
+int q4_0_gemv_q8(const q4_0_array_t *q4_0_array,
+                 uint64_t rows,
+                 uint64_t cols,
+                 const int8_t *x_codes,
+                 const float *x_scales,
+                 float *y);
+
+/* *result = w . x for the whole array taken as one row, in the calling thread; num_elements must be a multiple
+ * of DEFAULT_Q8_0_BLOCK_SIZE. */
+int q8_0_dot_q8(const q8_0_array_t *q8_0_array, const int8_t *x_codes, const float *x_scales, float *result);
+
+int q4_0_dot_q8(const q4_0_array_t *q4_0_array, const int8_t *x_codes, const float *x_scales, float *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef CONTAINER_IMPL_H
+#define CONTAINER_IMPL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Container file (version 1), all fields little-endian.
+ *
+ * Header, at offset 0:
+ *   0  char[4] magic "BSQC"
+ *   4  u16     version
+ *   6  u16     header_size
+ *   8  u32     num_tensors
+ *  12  u32     entry_size           bytes per index entry
+ *  16  u64     index_offset
+ *  24  u64     strings_offset       tensor names, each NUL-terminated
+ *  32  u64     strings_size
+ *  40  u64     total_size
+ *  48  u64     reserved[2]
+ *
+ * Index entry:
+ *   0  u64     data_offset          portable blob (see portable_impl.h), BSQ_PORTABLE_ALIGNMENT aligned
+ *   8  u64     data_size
+ *  16  u64     num_elements
+ *  24  u32     name_offset          into the string table
+ *  28  u32     name_length          excluding the NUL
+ *  32  u32     method
+ *  36  u16     num_tokens
+ *  38  u16     num_features
+ *  40  u32     sparse_ratio         f32 bits
+ *  44  u32     reserved
+ *  48  u64     reserved[2]
+ *
+ * The writer streams tensor blobs first and appends the index and string table on close,
+ * so opening a container only touches the header, the index and the names.
+ */
+
+#define BSQ_CONTAINER_MAGIC        "BSQC"
+#define BSQ_CONTAINER_VERSION      1
+#define BSQ_CONTAINER_HEADER_SIZE  64
+#define BSQ_CONTAINER_ENTRY_SIZE   64
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
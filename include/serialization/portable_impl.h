@@ -0,0 +1,84 @@
+#ifndef PORTABLE_IMPL_H
+#define PORTABLE_IMPL_H
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Portable serialized form (version 1). Every field is little-endian and fixed width;
+ * no pointers are stored.
+ *
+ *   0  char[4] magic "BSQP"
+ *   4  u16     version
+ *   6  u16     header_size          offset of the section table
+ *   8  u32     method               bsq_method_t
+ *  12  u32     num_sections
+ *  16  u64     num_elements         0 for TOPK / TOPK_IM
+ *  24  u64     block_size           0 when the method has no block_size field
+ *  32  u32     global_scale         f32 bits: FP8 / FP4 scale, NVFP4 tensor_scale, NF4_DQ dq_scale
+ *  36  u16     num_tokens
+ *  38  u16     num_features
+ *  40  u16     num_sparse_features
+ *  42  u16     reserved
+ *  44  u32     sparse_ratio         f32 bits
+ *  48  u64     total_size           bytes, multiple of BSQ_PORTABLE_ALIGNMENT
+ *  56  u64     reserved
+ *  64  num_sections x { u64 offset, u64 size }
+ *
+ * Sections hold the codec arrays in declaration order (e.g. Q8_0: scales, data), each
+ * starting at a multiple of BSQ_PORTABLE_ALIGNMENT from the start of the blob, with
+ * multi-byte elements stored little-endian.
+ */
+
+#define BSQ_PORTABLE_MAGIC         "BSQP"
+#define BSQ_PORTABLE_VERSION       1
+#define BSQ_PORTABLE_HEADER_SIZE   64
+#define BSQ_PORTABLE_SECTION_SIZE  16
+#define BSQ_PORTABLE_MAX_SECTIONS  4
+#define BSQ_PORTABLE_ALIGNMENT     64
+
+static inline int bsq_host_is_little_endian(void) {
+    const uint16_t probe = 1;
+    uint8_t first;
+    memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+static inline uint16_t bsq_load_le16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t bsq_load_le32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint64_t bsq_load_le64(const uint8_t *p) {
+    return (uint64_t)bsq_load_le32(p) | ((uint64_t)bsq_load_le32(p + 4) << 32);
+}
+
+static inline void bsq_store_le16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void bsq_store_le32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static inline void bsq_store_le64(uint8_t *p, uint64_t v) {
+    bsq_store_le32(p, (uint32_t)v);
+    bsq_store_le32(p + 4, (uint32_t)(v >> 32));
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
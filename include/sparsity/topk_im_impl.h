@@ -10,6 +10,18 @@ extern "C" {
 /* Given a 2D float array of size num_tokens by num_features, and a 2D importance array of size num_tokens by num_features that holds the importance score for the corresponding indexed values in the float array, use this information to find the top k values, where k is determined by spase_ratio multiplied by num_features, since the top k is selected per token, and then wrap everything inside sparse_array. */
 int topk_im_compress(const float *float_array, const float *importance_array, uint16_t num_tokens, uint16_t num_features,  float sparse_ratio, sparse_array_t **sparse_array);
 
+/* Same as topk_im_compress, but writes into an array prepared by init_sparse_array or allocate_sparse_array. */
+int topk_im_compress_into(const float *float_array, const float *importance_array, sparse_array_t *sparse_array);
+
+/* Working memory topk_im_compress_into_scratch needs per OpenMP thread. */
+size_t topk_im_thread_scratch_size(const sparse_array_t *sparse_array);
+
+/* topk_im_compress_into working in thread_scratch[omp thread id] (see topk_compress_into_scratch). */
+int topk_im_compress_into_scratch(const float *float_array, const float *importance_array, sparse_array_t *sparse_array, void *const *thread_scratch);
+
+/* topk_im_compress_into without a parallel region, for callers that are already inside one. */
+int topk_im_compress_into_serial(const float *float_array, const float *importance_array, sparse_array_t *sparse_array);
+
 /* Given a sparse_array, recover the original 2D float array by filling the zero values with sparse values, this should be identical to topk_decompress. */
 int topk_im_decompress(const sparse_array_t *sparse_array, float *float_array);
 
@@ -25,6 +25,12 @@ typedef struct {
     float *values;                      /* Flattened array of corresponding sparse values; length is (num_tokens * num_sparse_features). */
 } sparse_array_t;
 
+/* Byte size of a sparse_array_t for the given shape, header included (0 on invalid shape). */
+uint64_t compute_sparse_array_size(uint16_t num_tokens, uint16_t num_features, float sparse_ratio);
+
+/* Lay out a sparse_array_t in caller memory of at least compute_sparse_array_size() bytes. */
+sparse_array_t *init_sparse_array(void *buffer, uint16_t num_tokens, uint16_t num_features, float sparse_ratio);
+
 sparse_array_t *allocate_sparse_array(uint16_t num_tokens, uint16_t num_features, float sparse_ratio);                               
 
 void free_sparse_array(sparse_array_t *sparse_array);
@@ -35,8 +41,42 @@ sparse_array_t *load_sparse_array_from_buffer(const void *buffer, uint64_t buffe
 
 int topk_compress(const float *float_array, uint16_t num_tokens, uint16_t num_features,  float sparse_ratio, sparse_array_t **sparse_array);
 
+/* Select the top-k features of every token into an array prepared by init_sparse_array or allocate_sparse_array. */
+int topk_compress_into(const float *float_array, sparse_array_t *sparse_array);
+
+/* Working memory topk_compress_into_scratch needs per OpenMP thread. */
+size_t topk_thread_scratch_size(const sparse_array_t *sparse_array);
+
+/* topk_compress_into without allocating: thread i works in thread_scratch[i], topk_thread_scratch_size() bytes,
+ * one entry per thread of the team. NULL allocates per call like topk_compress_into. */
+int topk_compress_into_scratch(const float *float_array, sparse_array_t *sparse_array, void *const *thread_scratch);
+
+/* topk_compress_into without a parallel region, for callers that are already inside one. */
+int topk_compress_into_serial(const float *float_array, sparse_array_t *sparse_array);
+
 int topk_decompress(const sparse_array_t *sparse_array, float *float_array);
 
+/* Densify only the given token rows, packed: row r of float_array (num_features wide) receives token token_indices[r]. Works for TOPK and TOPK_IM arrays. */
+int topk_decompress_rows(const sparse_array_t *sparse_array, const uint16_t *token_indices, uint32_t num_rows, float *float_array);
+
+/* float_array += alpha * densified array, scattering only the kept entries. Works for TOPK and TOPK_IM arrays. */
+int topk_accumulate(const sparse_array_t *sparse_array, float *float_array, float alpha);
+
+/* topk_accumulate without a parallel region, for callers that are already inside one. */
+int topk_accumulate_serial(const sparse_array_t *sparse_array, float *float_array, float alpha);
+
+/* out = S W for S the sparse [num_tokens, num_features] array and W a dense row-major [num_features, out_features]
+ * matrix; out is [num_tokens, out_features]. Each kept entry adds one scaled row of W, so S is never densified. */
+int topk_spmm(const sparse_array_t *sparse_array, const float *dense, uint64_t out_features, float *out);
+
+/* out = D S^T for D a dense row-major [num_rows, num_features] matrix; out is [num_rows, num_tokens]. Each entry
+ * gathers only the kept features of its token. */
+int topk_spmm_t(const sparse_array_t *sparse_array, const float *dense, uint64_t num_rows, float *out);
+
+/* y = S x for x of num_features; y has num_tokens entries. Tokens are split across threads, which topk_spmm_t
+ * cannot do with its single row. Results are bitwise those of topk_spmm_t with num_rows = 1. */
+int topk_spmv(const sparse_array_t *sparse_array, const float *x, float *y);
+
 #ifdef __cplusplus
 }
 #endif
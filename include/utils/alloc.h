@@ -0,0 +1,16 @@
+#ifndef ALLOC_H
+#define ALLOC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bitsqueeze.h"
+
+/* Allocate size bytes through the allocator installed with bsq_set_allocator (calloc by default).
+ * alignment 0 means malloc's; flags takes BSQ_ALLOC_UNINITIALIZED. */
+void *bsq_alloc_bytes(size_t size, size_t alignment, uint32_t flags);
+
+/* Release a block from bsq_alloc_bytes; NULL is a no-op. */
+void bsq_free_bytes(void *ptr);
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef DOT_H
+#define DOT_H
+
+#include <stdint.h>
+
+/* Widest block a compressed-domain kernel decodes onto the stack at once. */
+#define BSQ_DOT_PANEL 256
+
+/* Float dot product over eight independent lanes, so -O3 vectorizes it without reassociating. */
+static inline float bsq_dot_f32(const float *a, const float *b, uint64_t n) {
+    float lanes[8] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+    const uint64_t body = n - n % 8;
+    for (uint64_t i = 0; i < body; i += 8) {
+        for (int k = 0; k < 8; ++k) lanes[k] += a[i + k] * b[i + k];
+    }
+    float sum = ((lanes[0] + lanes[4]) + (lanes[1] + lanes[5])) + ((lanes[2] + lanes[6]) + (lanes[3] + lanes[7]));
+    for (uint64_t i = body; i < n; ++i) sum += a[i] * b[i];
+    return sum;
+}
+
+#endif
@@ -0,0 +1,215 @@
+#include "bitsqueeze.h"
+#include "bitsqueeze_internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/alloc.h"
+
+/* Alignment of each chunk's packed buffer. */
+#define APPEND_ALIGN 64
+/* Rows per chunk stop doubling here, inside the uint16_t token count of a sparse payload. */
+#define APPEND_MAX_CHUNK_ROWS 32768u
+
+/* A packed buffer with room for capacity rows, of which the first rows are filled. */
+typedef struct {
+    bitsqueeze_buffer_t *buf;
+    uint64_t             first_row;
+    uint32_t             capacity;
+    uint32_t             rows;
+} chunk_t;
+
+struct bsq_append {
+    bsq_method_t  method;
+    uint16_t      num_features;
+    float         sparse_ratio;
+    uint32_t      next_capacity;
+    uint64_t      num_tokens;
+    chunk_t      *chunks;
+    uint32_t      num_chunks;
+    uint32_t      max_chunks;
+};
+
+static int _is_sparse(bsq_method_t method) {
+    return method == TOPK || method == TOPK_IM;
+}
+
+static bsq_shape_t _rows_shape(const bsq_append_t *app, uint64_t rows) {
+    bsq_shape_t shape;
+    memset(&shape, 0, sizeof(shape));
+    if (_is_sparse(app->method)) {
+        shape.num_tokens = (uint16_t)rows;
+        shape.num_features = app->num_features;
+        shape.sparse_ratio = app->sparse_ratio;
+    } else {
+        shape.num_elements = rows * app->num_features;
+    }
+    return shape;
+}
+
+static int64_t _packed_size(const bsq_append_t *app, uint64_t rows) {
+    return _is_sparse(app->method)
+        ? bsq_compute_packed_size_2d(app->method, (uint16_t)rows, app->num_features, app->sparse_ratio)
+        : bsq_compute_packed_size_1d(app->method, rows * app->num_features);
+}
+
+/* Open a chunk of the next capacity after the last one. */
+static chunk_t *_grow(bsq_append_t *app) {
+    if (app->num_chunks == app->max_chunks) {
+        const uint32_t max_chunks = app->max_chunks ? 2 * app->max_chunks : 8;
+        chunk_t *chunks = (chunk_t *)realloc(app->chunks, max_chunks * sizeof(chunk_t));
+        if (!chunks) return NULL;
+        app->chunks = chunks;
+        app->max_chunks = max_chunks;
+    }
+
+    const uint32_t capacity = app->next_capacity;
+    const bsq_shape_t shape = _rows_shape(app, capacity);
+    const int64_t size = _packed_size(app, capacity);
+    if (size <= 0) return NULL;
+    void *mem = bsq_alloc_bytes((size_t)size, APPEND_ALIGN, BSQ_ALLOC_UNINITIALIZED);
+    if (!mem) return NULL;
+    bitsqueeze_buffer_t *buf = bsq_prepare_buffer(app->method, &shape, mem, size);
+    if (!buf) {
+        bsq_free_bytes(mem);
+        return NULL;
+    }
+
+    chunk_t *chunk = &app->chunks[app->num_chunks++];
+    chunk->buf = buf;
+    chunk->first_row = app->num_tokens;
+    chunk->capacity = capacity;
+    chunk->rows = 0;
+    if (app->next_capacity < APPEND_MAX_CHUNK_ROWS) {
+        app->next_capacity = 2 * app->next_capacity < APPEND_MAX_CHUNK_ROWS ? 2 * app->next_capacity
+                                                                             : APPEND_MAX_CHUNK_ROWS;
+    }
+    return chunk;
+}
+
+bsq_append_t *bsq_append_create(bsq_method_t method,
+                                uint16_t num_features,
+                                float sparse_ratio,
+                                uint32_t initial_capacity) {
+    if (num_features == 0 || initial_capacity == 0 || bsq_payload_has_tensor_scale(method)) return NULL;
+
+    bsq_append_t *app = (bsq_append_t *)calloc(1, sizeof(bsq_append_t));
+    if (!app) return NULL;
+    app->method = method;
+    app->num_features = num_features;
+    app->sparse_ratio = sparse_ratio;
+    app->next_capacity = initial_capacity < APPEND_MAX_CHUNK_ROWS ? initial_capacity : APPEND_MAX_CHUNK_ROWS;
+
+    /* Rows must be whole blocks so every append starts a fresh one; the first chunk settles the granule. */
+    const chunk_t *chunk = _grow(app);
+    const uint64_t granule = chunk && !_is_sparse(method) ? bsq_payload_granule(chunk->buf) : 1;
+    if (!chunk || granule == 0 || num_features % granule != 0) {
+        bsq_append_free(app);
+        return NULL;
+    }
+    return app;
+}
+
+void bsq_append_free(bsq_append_t *app) {
+    if (!app) return;
+    for (uint32_t i = 0; i < app->num_chunks; ++i) bsq_free_bytes(app->chunks[i].buf);
+    free(app->chunks);
+    free(app);
+}
+
+uint64_t bsq_append_num_tokens(const bsq_append_t *app) {
+    return app ? app->num_tokens : 0;
+}
+
+int bsq_append_tokens(bsq_append_t *app, const float *src, uint64_t num_tokens, const float *im) {
+    if (!app || !src) return 1;
+    if (app->method == TOPK_IM && !im) return 1;
+
+    const uint64_t row_elements = app->num_features;
+    uint64_t done = 0;
+    while (done < num_tokens) {
+        chunk_t *chunk = &app->chunks[app->num_chunks - 1];
+        if (chunk->rows == chunk->capacity && !(chunk = _grow(app))) return 1;
+
+        const uint64_t room = chunk->capacity - chunk->rows;
+        const uint64_t count = num_tokens - done < room ? num_tokens - done : room;
+        const uint64_t offset = done * row_elements;
+        bsq_view_t slice;
+        if (bsq_slice_payload_rows(chunk->buf, row_elements, chunk->rows, count, &slice) ||
+            bsq_compress_payload(&slice.buf, src + offset, im ? im + offset : NULL)) {
+            return 1;
+        }
+        chunk->rows += (uint32_t)count;
+        app->num_tokens += count;
+        done += count;
+    }
+    return 0;
+}
+
+int bsq_append_decompress_range(const bsq_append_t *app, uint64_t first, uint64_t count, float *dst) {
+    if (!app || !dst || first > app->num_tokens || count > app->num_tokens - first) return 1;
+
+    const uint64_t row_elements = app->num_features;
+    const uint64_t end = first + count;
+    for (uint32_t i = 0; i < app->num_chunks && first < end; ++i) {
+        const chunk_t *chunk = &app->chunks[i];
+        const uint64_t chunk_end = chunk->first_row + chunk->rows;
+        if (chunk_end <= first) continue;
+
+        const uint64_t rows = (end < chunk_end ? end : chunk_end) - first;
+        bsq_view_t slice;
+        if (bsq_slice_payload_rows(chunk->buf, row_elements, first - chunk->first_row, rows, &slice) ||
+            bsq_decompress(&slice.buf, dst, rows * row_elements)) {
+            return 1;
+        }
+        dst += rows * row_elements;
+        first += rows;
+    }
+    return 0;
+}
+
+int bsq_append_decompress(const bsq_append_t *app, float *dst, uint64_t dst_num_elements) {
+    if (!app || dst_num_elements < app->num_tokens * app->num_features) return 1;
+    return bsq_append_decompress_range(app, 0, app->num_tokens, dst);
+}
+
+int bsq_append_pack(const bsq_append_t *app, bitsqueeze_buffer_t **out) {
+    if (!app || !out || *out || app->num_tokens == 0) return 1;
+    if (_is_sparse(app->method) && app->num_tokens > UINT16_MAX) return 1;
+
+    const bsq_shape_t shape = _rows_shape(app, app->num_tokens);
+    const int64_t size = _packed_size(app, app->num_tokens);
+    if (size <= 0) return 1;
+    void *mem = bsq_alloc_bytes((size_t)size, _Alignof(bitsqueeze_buffer_t), BSQ_ALLOC_UNINITIALIZED);
+    if (!mem) return 1;
+    bitsqueeze_buffer_t *buf = bsq_prepare_buffer(app->method, &shape, mem, size);
+    if (!buf) {
+        bsq_free_bytes(mem);
+        return 1;
+    }
+
+    /* Whole rows are whole blocks, so each codec array is its chunks' arrays back to back. */
+    void *dst_arrays[BSQ_MAX_PAYLOAD_ARRAYS];
+    uint64_t dst_sizes[BSQ_MAX_PAYLOAD_ARRAYS];
+    const uint32_t num_arrays = bsq_payload_arrays(buf, dst_arrays, dst_sizes);
+    uint64_t offsets[BSQ_MAX_PAYLOAD_ARRAYS] = {0};
+    for (uint32_t i = 0; i < app->num_chunks; ++i) {
+        const chunk_t *chunk = &app->chunks[i];
+        void *arrays[BSQ_MAX_PAYLOAD_ARRAYS];
+        uint64_t sizes[BSQ_MAX_PAYLOAD_ARRAYS];
+        bsq_view_t slice;
+        if (chunk->rows == 0) continue;
+        if (bsq_slice_payload_rows(chunk->buf, app->num_features, 0, chunk->rows, &slice) ||
+            bsq_payload_arrays(&slice.buf, arrays, sizes) != num_arrays) {
+            bsq_free_bytes(mem);
+            return 1;
+        }
+        for (uint32_t a = 0; a < num_arrays; ++a) {
+            memcpy((uint8_t *)dst_arrays[a] + offsets[a], arrays[a], sizes[a]);
+            offsets[a] += sizes[a];
+        }
+    }
+
+    *out = buf;
+    return 0;
+}
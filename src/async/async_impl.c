@@ -0,0 +1,325 @@
+#include "bitsqueeze.h"
+#include "bitsqueeze_internal.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+typedef enum {
+    JOB_COMPRESS_1D,
+    JOB_COMPRESS_2D,
+    JOB_DECOMPRESS
+} job_kind_t;
+
+struct bsq_job {
+    bsq_async_t                *async;
+    struct bsq_job             *next;          /* queue link while BSQ_JOB_QUEUED */
+    _Atomic int                 status;
+    job_kind_t                  kind;
+    bsq_method_t                method;
+    const float                *src;
+    const float                *im;
+    uint64_t                    num_elements;
+    uint16_t                    num_tokens;
+    uint16_t                    num_features;
+    float                       sparse_ratio;
+    void                       *dst;
+    int64_t                     dst_size;
+    const bitsqueeze_buffer_t  *buf;
+    float                      *out;
+    bsq_job_callback_fn         callback;
+    void                       *user;
+};
+
+typedef struct {
+    bsq_async_t *async;
+    bsq_ctx_t   *ctx;
+    pthread_t    thread;
+    int          started;
+} worker_t;
+
+struct bsq_async {
+    pthread_mutex_t  lock;
+    pthread_cond_t   work_ready;
+    pthread_cond_t   space_ready;
+    pthread_cond_t   job_done;
+    bsq_job_t       *head;
+    bsq_job_t       *tail;
+    uint32_t         queued;
+    uint32_t         queue_depth;
+    uint32_t         flags;
+    int              stopping;
+    uint32_t         num_workers;
+    worker_t        *workers;
+};
+
+static int _is_final(int status) {
+    return status == BSQ_JOB_DONE || status == BSQ_JOB_FAILED || status == BSQ_JOB_CANCELLED;
+}
+
+static int _run_job(const bsq_job_t *job, bsq_ctx_t *ctx) {
+    switch (job->kind) {
+        case JOB_COMPRESS_1D:
+            return bsq_ctx_compress_1d_into(ctx, job->src, job->num_elements, job->method,
+                                            job->dst, job->dst_size, job->im);
+        case JOB_COMPRESS_2D:
+            return bsq_ctx_compress_2d_into(ctx, job->src, job->num_tokens, job->num_features, job->sparse_ratio,
+                                            job->method, job->dst, job->dst_size, job->im);
+        case JOB_DECOMPRESS:
+            return bsq_ctx_decompress(ctx, job->buf, job->out, job->num_elements);
+        default:
+            return 1;
+    }
+}
+
+/* Publish a final status, then run the callback; the handle may be released as soon as the status is visible. */
+static void _finish(bsq_async_t *async, bsq_job_t *job, bsq_job_status_t status) {
+    const bsq_job_callback_fn callback = job->callback;
+    void *user = job->user;
+    pthread_mutex_lock(&async->lock);
+    atomic_store(&job->status, (int)status);
+    pthread_cond_broadcast(&async->job_done);
+    pthread_mutex_unlock(&async->lock);
+    if (callback) callback(user, status);
+}
+
+static void *_worker_main(void *arg) {
+    worker_t *worker = (worker_t *)arg;
+    bsq_async_t *async = worker->async;
+
+    pthread_mutex_lock(&async->lock);
+    for (;;) {
+        while (!async->head && !async->stopping) pthread_cond_wait(&async->work_ready, &async->lock);
+        bsq_job_t *job = async->head;
+        if (!job) break;
+
+        async->head = job->next;
+        if (!async->head) async->tail = NULL;
+        async->queued--;
+        atomic_store(&job->status, BSQ_JOB_RUNNING);
+        pthread_cond_signal(&async->space_ready);
+        pthread_mutex_unlock(&async->lock);
+
+        const int rc = _run_job(job, worker->ctx);
+        _finish(async, job, rc ? BSQ_JOB_FAILED : BSQ_JOB_DONE);
+
+        pthread_mutex_lock(&async->lock);
+    }
+    pthread_mutex_unlock(&async->lock);
+    return NULL;
+}
+
+bsq_async_t *bsq_async_create(uint32_t num_workers, int threads_per_job, uint32_t queue_depth, uint32_t flags) {
+    if (num_workers == 0 || threads_per_job < 0 || queue_depth == 0) return NULL;
+
+    bsq_async_t *async = (bsq_async_t *)calloc(1, sizeof(bsq_async_t));
+    if (!async) return NULL;
+    async->workers = (worker_t *)calloc(num_workers, sizeof(worker_t));
+    if (!async->workers) {
+        free(async);
+        return NULL;
+    }
+    async->queue_depth = queue_depth;
+    async->flags = flags;
+    async->num_workers = num_workers;
+    pthread_mutex_init(&async->lock, NULL);
+    pthread_cond_init(&async->work_ready, NULL);
+    pthread_cond_init(&async->space_ready, NULL);
+    pthread_cond_init(&async->job_done, NULL);
+
+    for (uint32_t i = 0; i < num_workers; ++i) {
+        worker_t *worker = &async->workers[i];
+        worker->async = async;
+        worker->ctx = bsq_ctx_create(threads_per_job);
+        worker->started = worker->ctx && pthread_create(&worker->thread, NULL, _worker_main, worker) == 0;
+        if (!worker->started) {
+            bsq_async_destroy(async);
+            return NULL;
+        }
+    }
+    return async;
+}
+
+void bsq_async_destroy(bsq_async_t *async) {
+    if (!async) return;
+
+    pthread_mutex_lock(&async->lock);
+    async->stopping = 1;
+    bsq_job_t *pending = async->head;
+    async->head = async->tail = NULL;
+    async->queued = 0;
+    pthread_cond_broadcast(&async->work_ready);
+    pthread_cond_broadcast(&async->space_ready);
+    pthread_mutex_unlock(&async->lock);
+
+    while (pending) {
+        bsq_job_t *next = pending->next;
+        _finish(async, pending, BSQ_JOB_CANCELLED);
+        pending = next;
+    }
+
+    for (uint32_t i = 0; i < async->num_workers; ++i) {
+        if (async->workers[i].started) pthread_join(async->workers[i].thread, NULL);
+        bsq_ctx_free(async->workers[i].ctx);
+    }
+    pthread_cond_destroy(&async->job_done);
+    pthread_cond_destroy(&async->space_ready);
+    pthread_cond_destroy(&async->work_ready);
+    pthread_mutex_destroy(&async->lock);
+    free(async->workers);
+    free(async);
+}
+
+/* Queue job, waiting for room unless BSQ_ASYNC_NO_WAIT; frees it and returns NULL when it cannot be queued. */
+static bsq_job_t *_submit(bsq_async_t *async, bsq_job_t *job) {
+    pthread_mutex_lock(&async->lock);
+    while (async->queued >= async->queue_depth && !async->stopping && !(async->flags & BSQ_ASYNC_NO_WAIT)) {
+        pthread_cond_wait(&async->space_ready, &async->lock);
+    }
+    if (async->stopping || async->queued >= async->queue_depth) {
+        pthread_mutex_unlock(&async->lock);
+        free(job);
+        return NULL;
+    }
+
+    if (job->kind != JOB_DECOMPRESS) bsq_prepare_codec_tables(job->method);
+
+    job->async = async;
+    atomic_store(&job->status, BSQ_JOB_QUEUED);
+    if (async->tail) {
+        async->tail->next = job;
+    } else {
+        async->head = job;
+    }
+    async->tail = job;
+    async->queued++;
+    pthread_cond_signal(&async->work_ready);
+    pthread_mutex_unlock(&async->lock);
+    return job;
+}
+
+static bsq_job_t *_new_job(job_kind_t kind, bsq_job_callback_fn callback, void *user) {
+    bsq_job_t *job = (bsq_job_t *)calloc(1, sizeof(bsq_job_t));
+    if (!job) return NULL;
+    job->kind = kind;
+    job->callback = callback;
+    job->user = user;
+    return job;
+}
+
+bsq_job_t *bsq_async_compress_1d_into(bsq_async_t *async,
+                                      const float *src,
+                                      uint64_t num_elements,
+                                      bsq_method_t method,
+                                      void *dst,
+                                      int64_t dst_size,
+                                      const float *im,
+                                      bsq_job_callback_fn callback,
+                                      void *user) {
+    if (!async || !src || !dst || num_elements == 0) return NULL;
+    bsq_job_t *job = _new_job(JOB_COMPRESS_1D, callback, user);
+    if (!job) return NULL;
+    job->src = src;
+    job->num_elements = num_elements;
+    job->method = method;
+    job->dst = dst;
+    job->dst_size = dst_size;
+    job->im = im;
+    return _submit(async, job);
+}
+
+bsq_job_t *bsq_async_compress_2d_into(bsq_async_t *async,
+                                      const float *src,
+                                      uint16_t num_tokens,
+                                      uint16_t num_features,
+                                      float sparse_ratio,
+                                      bsq_method_t method,
+                                      void *dst,
+                                      int64_t dst_size,
+                                      const float *im,
+                                      bsq_job_callback_fn callback,
+                                      void *user) {
+    if (!async || !src || !dst || num_tokens == 0 || num_features == 0) return NULL;
+    bsq_job_t *job = _new_job(JOB_COMPRESS_2D, callback, user);
+    if (!job) return NULL;
+    job->src = src;
+    job->num_tokens = num_tokens;
+    job->num_features = num_features;
+    job->sparse_ratio = sparse_ratio;
+    job->method = method;
+    job->dst = dst;
+    job->dst_size = dst_size;
+    job->im = im;
+    return _submit(async, job);
+}
+
+bsq_job_t *bsq_async_decompress(bsq_async_t *async,
+                                const bitsqueeze_buffer_t *buf,
+                                float *dst,
+                                uint64_t dst_num_elements,
+                                bsq_job_callback_fn callback,
+                                void *user) {
+    if (!async || !buf || !dst) return NULL;
+    bsq_job_t *job = _new_job(JOB_DECOMPRESS, callback, user);
+    if (!job) return NULL;
+    job->buf = buf;
+    job->out = dst;
+    job->num_elements = dst_num_elements;
+    return _submit(async, job);
+}
+
+bsq_job_status_t bsq_job_poll(const bsq_job_t *job) {
+    if (!job) return BSQ_JOB_FAILED;
+    return (bsq_job_status_t)atomic_load(&((bsq_job_t *)job)->status);
+}
+
+bsq_job_status_t bsq_job_wait(bsq_job_t *job) {
+    if (!job) return BSQ_JOB_FAILED;
+    int status = atomic_load(&job->status);
+    if (_is_final(status)) return (bsq_job_status_t)status;
+
+    bsq_async_t *async = job->async;
+    pthread_mutex_lock(&async->lock);
+    while (!_is_final(status = atomic_load(&job->status))) pthread_cond_wait(&async->job_done, &async->lock);
+    pthread_mutex_unlock(&async->lock);
+    return (bsq_job_status_t)status;
+}
+
+int bsq_job_cancel(bsq_job_t *job) {
+    if (!job || atomic_load(&job->status) != BSQ_JOB_QUEUED) return 1;
+
+    bsq_async_t *async = job->async;
+    pthread_mutex_lock(&async->lock);
+    bsq_job_t *prev = NULL;
+    bsq_job_t *cur = async->head;
+    while (cur && cur != job) {
+        prev = cur;
+        cur = cur->next;
+    }
+    if (!cur) {
+        /* Already taken by a worker (or by bsq_async_destroy). */
+        pthread_mutex_unlock(&async->lock);
+        return 1;
+    }
+    if (prev) {
+        prev->next = job->next;
+    } else {
+        async->head = job->next;
+    }
+    if (async->tail == job) async->tail = prev;
+    async->queued--;
+    pthread_cond_signal(&async->space_ready);
+    pthread_mutex_unlock(&async->lock);
+
+    _finish(async, job, BSQ_JOB_CANCELLED);
+    return 0;
+}
+
+void bsq_job_release(bsq_job_t *job) {
+    if (!job) return;
+    if (!_is_final(atomic_load(&job->status))) {
+        bsq_job_cancel(job);
+        bsq_job_wait(job);
+    }
+    free(job);
+}
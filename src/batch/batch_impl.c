@@ -0,0 +1,225 @@
+#include "bitsqueeze.h"
+#include "bitsqueeze_internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__) && defined(_OPENMP)
+#include <omp.h>
+#endif
+
+/* Chunks handed out per thread, so a slow tensor near the end still leaves work to steal. */
+#define CHUNKS_PER_THREAD 8
+/* Below this a chunk costs more in scheduling than it saves in balance. */
+#define MIN_CHUNK_ELEMENTS 4096
+
+/* Elements [first, first + count) of tensor desc; whole items cover the tensor through the codec's own entry point. */
+typedef struct {
+    uint32_t desc;
+    int      whole;
+    uint64_t first;
+    uint64_t count;
+} batch_item_t;
+
+static int _num_threads(void) {
+#if defined(__linux__) && defined(_OPENMP)
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+static uint64_t _chunk_size(const uint64_t *num_elements, uint32_t count) {
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < count; ++i) total += num_elements[i];
+    const uint64_t num_chunks = (uint64_t)_num_threads() * CHUNKS_PER_THREAD;
+    const uint64_t chunk = (total + num_chunks - 1) / num_chunks;
+    return chunk < MIN_CHUNK_ELEMENTS ? MIN_CHUNK_ELEMENTS : chunk;
+}
+
+/*
+ * Cut every tensor with a non-zero granule into chunks of about chunk elements, rounded up to its granule.
+ * Tensors with granule 0 become whole items and are listed first, so the dynamic schedule starts the
+ * longest indivisible work before the short chunks that fill in behind it.
+ */
+static batch_item_t *_build_work_list(const uint64_t *num_elements,
+                                      const uint64_t *granules,
+                                      const int *skip,
+                                      uint32_t count,
+                                      uint64_t chunk,
+                                      uint64_t *num_items) {
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (skip[i] || num_elements[i] == 0) continue;
+        if (granules[i] == 0) {
+            total += 1;
+        } else {
+            const uint64_t step = (chunk + granules[i] - 1) / granules[i] * granules[i];
+            total += (num_elements[i] + step - 1) / step;
+        }
+    }
+
+    *num_items = total;
+    batch_item_t *items = (batch_item_t *)malloc((total ? total : 1) * sizeof(batch_item_t));
+    if (!items) return NULL;
+
+    uint64_t k = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (skip[i] || num_elements[i] == 0 || granules[i] != 0) continue;
+        items[k++] = (batch_item_t){i, 1, 0, num_elements[i]};
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        if (skip[i] || num_elements[i] == 0 || granules[i] == 0) continue;
+        const uint64_t step = (chunk + granules[i] - 1) / granules[i] * granules[i];
+        for (uint64_t first = 0; first < num_elements[i]; first += step) {
+            const uint64_t left = num_elements[i] - first;
+            items[k++] = (batch_item_t){i, 0, first, left < step ? left : step};
+        }
+    }
+    return items;
+}
+
+/* Scratch for one batch call: per-tensor element counts, split granules and skip flags. */
+typedef struct {
+    uint64_t *num_elements;
+    uint64_t *granules;
+    int      *skip;
+} batch_plan_t;
+
+static int _alloc_plan(batch_plan_t *plan, uint32_t count) {
+    plan->num_elements = (uint64_t *)malloc(count * sizeof(uint64_t));
+    plan->granules = (uint64_t *)malloc(count * sizeof(uint64_t));
+    plan->skip = (int *)calloc(count, sizeof(int));
+    return !plan->num_elements || !plan->granules || !plan->skip;
+}
+
+static void _free_plan(batch_plan_t *plan) {
+    free(plan->num_elements);
+    free(plan->granules);
+    free(plan->skip);
+}
+
+static int _compress_batch(const bsq_compress_desc_t *descs,
+                           uint32_t count,
+                           bitsqueeze_buffer_t **bufs,
+                           batch_plan_t *plan) {
+    for (uint32_t i = 0; i < count; ++i) {
+        const bsq_compress_desc_t *d = &descs[i];
+        if (!d->src || d->method == TOPK || d->method == TOPK_IM) return 1;
+        const bsq_shape_t shape = {d->num_elements, 0, 0, 0.0f};
+        bufs[i] = bsq_prepare_buffer(d->method, &shape, d->dst, d->dst_size);
+        if (!bufs[i]) return 1;
+        plan->num_elements[i] = d->num_elements;
+        plan->granules[i] = bsq_payload_has_tensor_scale(d->method) ? 0 : bsq_payload_granule(bufs[i]);
+        bsq_prepare_codec_tables(d->method);
+    }
+
+    /* A tensor-wide scale that outweighs a whole chunk is left to the codec's own parallel loop. */
+    const uint64_t chunk = _chunk_size(plan->num_elements, count);
+    for (uint32_t i = 0; i < count; ++i) {
+        if (plan->granules[i] != 0 || plan->num_elements[i] <= chunk) continue;
+        plan->skip[i] = 1;
+        if (bsq_compress_payload(bufs[i], descs[i].src, descs[i].im)) return 1;
+    }
+
+    uint64_t num_items = 0;
+    batch_item_t *items = _build_work_list(plan->num_elements, plan->granules, plan->skip, count, chunk, &num_items);
+    if (!items) return 1;
+
+    int failed = 0;
+#if defined(__linux__) && defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic, 1) reduction(|:failed)
+#endif
+    for (uint64_t k = 0; k < num_items; ++k) {
+        const batch_item_t *item = &items[k];
+        const bsq_compress_desc_t *d = &descs[item->desc];
+        if (item->whole) {
+            failed |= bsq_compress_payload_serial(bufs[item->desc], d->src, d->im);
+            continue;
+        }
+        bsq_view_t slice;
+        if (bsq_slice_payload(bufs[item->desc], item->first, item->count, &slice)) {
+            failed |= 1;
+            continue;
+        }
+        failed |= bsq_compress_payload_serial(&slice.buf, d->src + item->first, d->im ? d->im + item->first : NULL);
+    }
+
+    free(items);
+    return failed;
+}
+
+int bsq_compress_batch(const bsq_compress_desc_t *descs, uint32_t count) {
+    if (!descs) return count != 0;
+    if (count == 0) return 0;
+
+    batch_plan_t plan;
+    bitsqueeze_buffer_t **bufs = (bitsqueeze_buffer_t **)malloc(count * sizeof(bitsqueeze_buffer_t *));
+    int failed = _alloc_plan(&plan, count) || !bufs;
+    if (!failed) failed = _compress_batch(descs, count, bufs, &plan);
+
+    free(bufs);
+    _free_plan(&plan);
+    return failed;
+}
+
+/* Decode all of d in the calling thread; sparse rows are added onto a zeroed dst. */
+static int _decompress_whole(const bsq_decompress_desc_t *d, uint64_t num_elements) {
+    if (d->src->method == TOPK || d->src->method == TOPK_IM) {
+        if (d->dst_num_elements < num_elements) return 1;
+        memset(d->dst, 0, num_elements * sizeof(float));
+        return bsq_accumulate_serial(d->src, d->dst, d->dst_num_elements, 1.0f);
+    }
+    return bsq_decompress_range_serial(d->src, 0, num_elements, d->dst);
+}
+
+static int _decompress_batch(const bsq_decompress_desc_t *descs, uint32_t count, batch_plan_t *plan) {
+    for (uint32_t i = 0; i < count; ++i) {
+        const bitsqueeze_buffer_t *buf = descs[i].src;
+        if (!buf || !buf->payload || !descs[i].dst) return 1;
+        if (buf->method == TOPK || buf->method == TOPK_IM) {
+            /* Sparse rows are scattered; _decompress_whole checks dst_num_elements itself. */
+            plan->num_elements[i] = (uint64_t)buf->shape.num_tokens * buf->shape.num_features;
+            plan->granules[i] = 0;
+            continue;
+        }
+        plan->num_elements[i] = buf->shape.num_elements;
+        if (descs[i].dst_num_elements < plan->num_elements[i]) return 1;
+        /* Decoding never needs the neighbours, so tensor-scale formats split here too. */
+        plan->granules[i] = bsq_payload_granule(buf);
+    }
+
+    uint64_t num_items = 0;
+    batch_item_t *items = _build_work_list(plan->num_elements, plan->granules, plan->skip, count,
+                                           _chunk_size(plan->num_elements, count), &num_items);
+    if (!items) return 1;
+
+    int failed = 0;
+#if defined(__linux__) && defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic, 1) reduction(|:failed)
+#endif
+    for (uint64_t k = 0; k < num_items; ++k) {
+        const batch_item_t *item = &items[k];
+        const bsq_decompress_desc_t *d = &descs[item->desc];
+        if (item->whole) {
+            failed |= _decompress_whole(d, plan->num_elements[item->desc]);
+        } else {
+            failed |= bsq_decompress_range_serial(d->src, item->first, item->count, d->dst + item->first);
+        }
+    }
+
+    free(items);
+    return failed;
+}
+
+int bsq_decompress_batch(const bsq_decompress_desc_t *descs, uint32_t count) {
+    if (!descs) return count != 0;
+    if (count == 0) return 0;
+
+    batch_plan_t plan;
+    int failed = _alloc_plan(&plan, count);
+    if (!failed) failed = _decompress_batch(descs, count, &plan);
+
+    _free_plan(&plan);
+    return failed;
+}
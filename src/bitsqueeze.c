@@ -1,5 +1,7 @@
 #include "bitsqueeze.h"
+#include "bitsqueeze_internal.h"
 
+#include <math.h>
 #include <string.h>
 #include <stdlib.h>
 
@@ -14,6 +16,7 @@
 #include "float_quantization/nf4_dq_impl.h"
 #include "int_quantization/q8_0_impl.h"
 #include "int_quantization/q4_0_impl.h"
+#include "int_quantization/q8_dot_impl.h"
 #include "int_quantization/q2_k_impl.h"
 #include "int_quantization/q2_k_fast_impl.h"
 #include "int_quantization/iq2_xxs_impl.h"
@@ -21,129 +24,131 @@
 #include "int_quantization/iq2_s_impl.h"
 #include "sparsity/topk_impl.h"
 #include "sparsity/topk_im_impl.h"
+#include "utils/alloc.h"
 
 static bitsqueeze_buffer_t *_allocate_bsq_buffer(size_t payload_size) {
     size_t total = sizeof(bitsqueeze_buffer_t) + payload_size;
-    bitsqueeze_buffer_t *buf = (bitsqueeze_buffer_t *)calloc(1, total);
+    /* Compression rewrites every byte, so skip the zero fill. */
+    bitsqueeze_buffer_t *buf = (bitsqueeze_buffer_t *)bsq_alloc_bytes(total, _Alignof(bitsqueeze_buffer_t),
+                                                                      BSQ_ALLOC_UNINITIALIZED);
     if (!buf) return NULL;
     buf->payload = ((uint8_t *)buf) + sizeof(bitsqueeze_buffer_t);
     return buf;
 }
 
-static void _fixup_payload_pointers(bitsqueeze_buffer_t *buf) {
-    if (!buf || !buf->payload) return;
-
-    switch (buf->method) {
+/* Point the arrays of a codec header at data, the bytes that follow the header in the packed layout. */
+static void _attach_payload_pointers(void *header, bsq_method_t method, uint8_t *data) {
+    switch (method) {
         case Q8_0: {
-            q8_0_array_t *arr = (q8_0_array_t *)buf->payload;
-            arr->scales = (float *)(arr + 1);
+            q8_0_array_t *arr = (q8_0_array_t *)header;
+            arr->scales = (float *)data;
             arr->data = (int8_t *)(arr->scales + arr->num_blocks);
             break;
         }
         case Q4_0: {
-            q4_0_array_t *arr = (q4_0_array_t *)buf->payload;
+            q4_0_array_t *arr = (q4_0_array_t *)header;
             const uint64_t packed_elems = (arr->num_elements + 1) / 2;
-            arr->scales = (float *)(arr + 1);
+            arr->scales = (float *)data;
             arr->data = (int8_t *)(arr->scales + arr->num_blocks);
             (void)packed_elems; /* silence unused warning in case of static analysis */
             break;
         }
         case Q2_K:
         case Q2_K_FAST: {
-            q2_k_array_t *arr = (q2_k_array_t *)buf->payload;
-            arr->super_blocks = (super_block_q2_k *)(arr + 1);
+            q2_k_array_t *arr = (q2_k_array_t *)header;
+            arr->super_blocks = (super_block_q2_k *)data;
             break;
         }
         case TOPK: {
-            sparse_array_t *arr = (sparse_array_t *)buf->payload;
+            sparse_array_t *arr = (sparse_array_t *)header;
             uint32_t sparse_elements = (uint32_t)arr->num_tokens * arr->num_sparse_features;
-            arr->sparse_indices = (uint16_t *)(arr + 1);
+            arr->sparse_indices = (uint16_t *)data;
             arr->values = (float *)(arr->sparse_indices + sparse_elements);
             break;
         }
         case TOPK_IM: {
-            sparse_array_t *arr = (sparse_array_t *)buf->payload;
+            sparse_array_t *arr = (sparse_array_t *)header;
             uint32_t sparse_elements = (uint32_t)arr->num_tokens * arr->num_sparse_features;
-            arr->sparse_indices = (uint16_t *)(arr + 1);
+            arr->sparse_indices = (uint16_t *)data;
             arr->values = (float *)(arr->sparse_indices + sparse_elements);
             break;
         }
         case BF16: {
-            bf16_array_t *arr = (bf16_array_t *)buf->payload;
-            arr->data = (uint16_t *)(arr + 1);
+            bf16_array_t *arr = (bf16_array_t *)header;
+            arr->data = (uint16_t *)data;
             break;
         }
         case FP16: {
-            fp16_array_t *arr = (fp16_array_t *)buf->payload;
-            arr->data = (uint16_t *)(arr + 1);
+            fp16_array_t *arr = (fp16_array_t *)header;
+            arr->data = (uint16_t *)data;
             break;
         }
         case FP8: {
-            fp8_array_t *arr = (fp8_array_t *)buf->payload;
-            arr->data = (uint8_t *)(arr + 1);
+            fp8_array_t *arr = (fp8_array_t *)header;
+            arr->data = (uint8_t *)data;
             break;
         }
         case FP4: {
-            fp4_array_t *arr = (fp4_array_t *)buf->payload;
+            fp4_array_t *arr = (fp4_array_t *)header;
             uint64_t packed = (arr->num_elements + 1) / 2;
-            arr->data = (uint8_t *)(arr + 1);
+            arr->data = (uint8_t *)data;
             (void)packed;
             break;
         }
         case MXFP8: {
-            mxfp8_array_t *arr = (mxfp8_array_t *)buf->payload;
-            arr->scales = (int8_t *)(arr + 1);
+            mxfp8_array_t *arr = (mxfp8_array_t *)header;
+            arr->scales = (int8_t *)data;
             arr->data = (uint8_t *)(arr->scales + arr->num_blocks);
             break;
         }
         case MXFP4: {
-            mxfp4_array_t *arr = (mxfp4_array_t *)buf->payload;
-            arr->scales = (int8_t *)(arr + 1);
+            mxfp4_array_t *arr = (mxfp4_array_t *)header;
+            arr->scales = (int8_t *)data;
             uint64_t packed = (arr->num_elements + 1) / 2;
             arr->data = (uint8_t *)(arr->scales + arr->num_blocks);
             (void)packed;
             break;
         }
         case NVFP4: {
-            nvfp4_array_t *arr = (nvfp4_array_t *)buf->payload;
-            arr->block_scales = (uint8_t *)(arr + 1);
+            nvfp4_array_t *arr = (nvfp4_array_t *)header;
+            arr->block_scales = (uint8_t *)data;
             uint64_t packed = (arr->num_elements + 1) / 2;
             arr->data = (uint8_t *)(arr->block_scales + arr->num_blocks);
             (void)packed;
             break;
         }
         case NF4: {
-            nf4_array_t *arr = (nf4_array_t *)buf->payload;
-            arr->block_scales = (float *)(arr + 1);
+            nf4_array_t *arr = (nf4_array_t *)header;
+            arr->block_scales = (float *)data;
             uint64_t packed = (arr->num_elements + 1) / 2;
             arr->data = (uint8_t *)(arr->block_scales + arr->num_blocks);
             (void)packed;
             break;
         }
         case NF4_DQ: {
-            nf4_dq_array_t *arr = (nf4_dq_array_t *)buf->payload;
-            arr->block_scales = (uint8_t *)(arr + 1);
+            nf4_dq_array_t *arr = (nf4_dq_array_t *)header;
+            arr->block_scales = (uint8_t *)data;
             uint64_t packed = (arr->num_elements + 1) / 2;
             arr->data = (uint8_t *)(arr->block_scales + arr->num_blocks);
             (void)packed;
             break;
         }
         case IQ2_XXS: {
-            iq2_xxs_array_t *arr = (iq2_xxs_array_t *)buf->payload;
-            arr->scales = (uint16_t *)(arr + 1);
+            iq2_xxs_array_t *arr = (iq2_xxs_array_t *)header;
+            arr->scales = (uint16_t *)data;
             arr->qs = (uint8_t *)(arr->scales + arr->num_super_blocks);
             break;
         }
         case IQ2_XS: {
-            iq2_xs_array_t *arr = (iq2_xs_array_t *)buf->payload;
-            arr->d = (uint16_t *)(arr + 1);
+            iq2_xs_array_t *arr = (iq2_xs_array_t *)header;
+            arr->d = (uint16_t *)data;
             arr->qs = (uint16_t *)(arr->d + arr->num_super_blocks);
             arr->scales = (uint8_t *)(arr->qs + arr->num_super_blocks * 32);
             break;
         }
         case IQ2_S: {
-            iq2_s_array_t *arr = (iq2_s_array_t *)buf->payload;
-            arr->d = (uint16_t *)(arr + 1);
+            iq2_s_array_t *arr = (iq2_s_array_t *)header;
+            arr->d = (uint16_t *)data;
             arr->qs = (uint8_t *)(arr->d + arr->num_super_blocks);
             arr->qh = arr->qs + arr->num_super_blocks * 64;
             arr->scales = arr->qh + arr->num_super_blocks * 8;
@@ -154,6 +159,113 @@ static void _fixup_payload_pointers(bitsqueeze_buffer_t *buf) {
     }
 }
 
+size_t bsq_payload_header_size(bsq_method_t method) {
+    switch (method) {
+        case Q8_0:      return sizeof(q8_0_array_t);
+        case Q4_0:      return sizeof(q4_0_array_t);
+        case Q2_K:
+        case Q2_K_FAST: return sizeof(q2_k_array_t);
+        case TOPK:
+        case TOPK_IM:   return sizeof(sparse_array_t);
+        case BF16:      return sizeof(bf16_array_t);
+        case FP16:      return sizeof(fp16_array_t);
+        case FP8:       return sizeof(fp8_array_t);
+        case FP4:       return sizeof(fp4_array_t);
+        case MXFP8:     return sizeof(mxfp8_array_t);
+        case MXFP4:     return sizeof(mxfp4_array_t);
+        case NVFP4:     return sizeof(nvfp4_array_t);
+        case NF4:       return sizeof(nf4_array_t);
+        case NF4_DQ:    return sizeof(nf4_dq_array_t);
+        case IQ2_XXS:   return sizeof(iq2_xxs_array_t);
+        case IQ2_XS:    return sizeof(iq2_xs_array_t);
+        case IQ2_S:     return sizeof(iq2_s_array_t);
+        default:        return 0;
+    }
+}
+
+static void _fixup_payload_pointers(bitsqueeze_buffer_t *buf) {
+    if (!buf || !buf->payload) return;
+    _attach_payload_pointers(buf->payload, buf->method,
+                             (uint8_t *)buf->payload + bsq_payload_header_size(buf->method));
+}
+
+static int _check_blocks(uint64_t num_elements, uint64_t num_blocks, uint64_t block_size) {
+    if (block_size == 0) return 1;
+    return num_blocks != num_elements / block_size + (num_elements % block_size != 0);
+}
+
+/* Reject codec headers whose counts disagree with each other or with buf->shape;
+ * the decoders trust these counts when indexing the payload. */
+int bsq_validate_payload_header(const bitsqueeze_buffer_t *buf) {
+    const uint64_t n = buf->shape.num_elements;
+    const void *p = buf->payload;
+
+    switch (buf->method) {
+        case Q8_0: {
+            const q8_0_array_t *arr = (const q8_0_array_t *)p;
+            return arr->num_elements != n || _check_blocks(n, arr->num_blocks, arr->block_size);
+        }
+        case Q4_0: {
+            const q4_0_array_t *arr = (const q4_0_array_t *)p;
+            return arr->num_elements != n || _check_blocks(n, arr->num_blocks, arr->block_size);
+        }
+        case Q2_K:
+        case Q2_K_FAST: {
+            const q2_k_array_t *arr = (const q2_k_array_t *)p;
+            return arr->num_elements != n ||
+                   _check_blocks(n, arr->num_super_blocks, WEIGHT_PER_SUPER_BLOCK);
+        }
+        case TOPK:
+        case TOPK_IM: {
+            const sparse_array_t *arr = (const sparse_array_t *)p;
+            return arr->num_tokens != buf->shape.num_tokens ||
+                   arr->num_features != buf->shape.num_features ||
+                   arr->num_sparse_features > arr->num_features;
+        }
+        case BF16:  return ((const bf16_array_t *)p)->num_elements != n;
+        case FP16:  return ((const fp16_array_t *)p)->num_elements != n;
+        case FP8:   return ((const fp8_array_t *)p)->num_elements != n;
+        case FP4:   return ((const fp4_array_t *)p)->num_elements != n;
+        case MXFP8: {
+            const mxfp8_array_t *arr = (const mxfp8_array_t *)p;
+            return arr->num_elements != n || _check_blocks(n, arr->num_blocks, arr->block_size);
+        }
+        case MXFP4: {
+            const mxfp4_array_t *arr = (const mxfp4_array_t *)p;
+            return arr->num_elements != n || _check_blocks(n, arr->num_blocks, arr->block_size);
+        }
+        case NVFP4: {
+            const nvfp4_array_t *arr = (const nvfp4_array_t *)p;
+            return arr->num_elements != n || _check_blocks(n, arr->num_blocks, arr->block_size);
+        }
+        case NF4: {
+            const nf4_array_t *arr = (const nf4_array_t *)p;
+            return arr->num_elements != n || _check_blocks(n, arr->num_blocks, arr->block_size);
+        }
+        case NF4_DQ: {
+            const nf4_dq_array_t *arr = (const nf4_dq_array_t *)p;
+            return arr->num_elements != n || _check_blocks(n, arr->num_blocks, arr->block_size);
+        }
+        case IQ2_XXS: {
+            const iq2_xxs_array_t *arr = (const iq2_xxs_array_t *)p;
+            return arr->num_elements != n ||
+                   _check_blocks(n, arr->num_super_blocks, IQ2_XXS_SUPER_BLOCK_SIZE);
+        }
+        case IQ2_XS: {
+            const iq2_xs_array_t *arr = (const iq2_xs_array_t *)p;
+            return arr->num_elements != n ||
+                   _check_blocks(n, arr->num_super_blocks, IQ2_XS_SUPER_BLOCK_SIZE);
+        }
+        case IQ2_S: {
+            const iq2_s_array_t *arr = (const iq2_s_array_t *)p;
+            return arr->num_elements != n ||
+                   _check_blocks(n, arr->num_super_blocks, IQ2_S_SUPER_BLOCK_SIZE);
+        }
+        default:
+            return 1;
+    }
+}
+
 static int64_t _get_payload_size(const bitsqueeze_buffer_t *buf) {
     if (!buf) return 0;
     switch (buf->method) {
@@ -198,6 +310,272 @@ static int64_t _get_payload_size(const bitsqueeze_buffer_t *buf) {
     }
 }
 
+static int64_t _compute_payload_size(bsq_method_t method, const bsq_shape_t *shape) {
+    if (!shape) return 0;
+    const uint64_t n = shape->num_elements;
+
+    switch (method) {
+        case Q8_0:      return compute_q8_0_array_size(n, DEFAULT_Q8_0_BLOCK_SIZE);
+        case Q4_0:      return compute_q4_0_array_size(n, DEFAULT_Q4_0_BLOCK_SIZE);
+        case Q2_K:
+        case Q2_K_FAST: return compute_q2_k_array_size(n);
+        case BF16:      return compute_bf16_array_size(n);
+        case FP16:      return compute_fp16_array_size(n);
+        case FP8:       return compute_fp8_array_size(n);
+        case FP4:       return compute_fp4_array_size(n);
+        case MXFP8:     return compute_mxfp8_array_size(n, DEFAULT_MXFP8_BLOCK_SIZE);
+        case MXFP4:     return compute_mxfp4_array_size(n, DEFAULT_MXFP4_BLOCK_SIZE);
+        case NVFP4:     return compute_nvfp4_array_size(n, DEFAULT_NVFP4_BLOCK_SIZE);
+        case NF4:       return compute_nf4_array_size(n, DEFAULT_NF4_BLOCK_SIZE);
+        case NF4_DQ:    return compute_nf4_dq_array_size(n, DEFAULT_NF4_DQ_BLOCK_SIZE);
+        case IQ2_XXS:   return compute_iq2_xxs_array_size(n);
+        case IQ2_XS:    return compute_iq2_xs_array_size(n);
+        case IQ2_S:     return compute_iq2_s_array_size(n);
+        case TOPK:
+        case TOPK_IM:
+            return (int64_t)compute_sparse_array_size(shape->num_tokens, shape->num_features, shape->sparse_ratio);
+        default:
+            return 0;
+    }
+}
+
+int bsq_init_payload(bitsqueeze_buffer_t *buf) {
+    const uint64_t n = buf->shape.num_elements;
+    void *p = buf->payload;
+    void *arr = NULL;
+
+    switch (buf->method) {
+        case Q8_0:      arr = init_q8_0_array(p, n, DEFAULT_Q8_0_BLOCK_SIZE); break;
+        case Q4_0:      arr = init_q4_0_array(p, n, DEFAULT_Q4_0_BLOCK_SIZE); break;
+        case Q2_K:
+        case Q2_K_FAST: arr = init_q2_k_array(p, n); break;
+        case BF16:      arr = init_bf16_array(p, n); break;
+        case FP16:      arr = init_fp16_array(p, n); break;
+        case FP8:       arr = init_fp8_array(p, n); break;
+        case FP4:       arr = init_fp4_array(p, n); break;
+        case MXFP8:     arr = init_mxfp8_array(p, n, DEFAULT_MXFP8_BLOCK_SIZE); break;
+        case MXFP4:     arr = init_mxfp4_array(p, n, DEFAULT_MXFP4_BLOCK_SIZE); break;
+        case NVFP4:     arr = init_nvfp4_array(p, n, DEFAULT_NVFP4_BLOCK_SIZE); break;
+        case NF4:       arr = init_nf4_array(p, n, DEFAULT_NF4_BLOCK_SIZE); break;
+        case NF4_DQ:    arr = init_nf4_dq_array(p, n, DEFAULT_NF4_DQ_BLOCK_SIZE); break;
+        case IQ2_XXS:   arr = init_iq2_xxs_array(p, n); break;
+        case IQ2_XS:    arr = init_iq2_xs_array(p, n); break;
+        case IQ2_S:     arr = init_iq2_s_array(p, n); break;
+        case TOPK:
+        case TOPK_IM:
+            arr = init_sparse_array(p, buf->shape.num_tokens, buf->shape.num_features, buf->shape.sparse_ratio);
+            break;
+        default:
+            break;
+    }
+    return arr ? 0 : 1;
+}
+
+size_t bsq_payload_thread_scratch_size(const bitsqueeze_buffer_t *buf) {
+    switch (buf->method) {
+        case TOPK:    return topk_thread_scratch_size((const sparse_array_t *)buf->payload);
+        case TOPK_IM: return topk_im_thread_scratch_size((const sparse_array_t *)buf->payload);
+        default:      return 0;
+    }
+}
+
+int bsq_compress_payload(bitsqueeze_buffer_t *buf, const float *src, const float *im) {
+    return bsq_compress_payload_scratch(buf, src, im, NULL);
+}
+
+/* Quantize src straight into the already laid out payload of buf. */
+int bsq_compress_payload_scratch(bitsqueeze_buffer_t *buf,
+                                 const float *src,
+                                 const float *im,
+                                 void *const *thread_scratch) {
+    void *p = buf->payload;
+
+    switch (buf->method) {
+        case Q8_0:      return q8_0_compress_into(src, (q8_0_array_t *)p);
+        case Q4_0:      return q4_0_compress_into(src, (q4_0_array_t *)p);
+        case Q2_K:
+            // Currently, only q2_k support using customized importance matrix
+            if (im) return q2_k_im_compress_into(src, im, (q2_k_array_t *)p);
+            return q2_k_compress_into(src, (q2_k_array_t *)p);
+        case Q2_K_FAST: return q2_k_fast_compress_into(src, (q2_k_array_t *)p);
+        case BF16:      return bf16_compress_into(src, (bf16_array_t *)p);
+        case FP16:      return fp16_compress_into(src, (fp16_array_t *)p);
+        case FP8:       return fp8_compress_into(src, (fp8_array_t *)p);
+        case FP4:       return fp4_compress_into(src, (fp4_array_t *)p);
+        case MXFP8:     return mxfp8_compress_into(src, (mxfp8_array_t *)p);
+        case MXFP4:     return mxfp4_compress_into(src, (mxfp4_array_t *)p);
+        case NVFP4:     return nvfp4_compress_into(src, (nvfp4_array_t *)p);
+        case NF4:       return nf4_compress_into(src, (nf4_array_t *)p);
+        case NF4_DQ:    return nf4_dq_compress_into(src, (nf4_dq_array_t *)p);
+        case IQ2_XXS:   return iq2_xxs_compress_into(src, (iq2_xxs_array_t *)p);
+        case IQ2_XS:    return iq2_xs_compress_into(src, (iq2_xs_array_t *)p);
+        case IQ2_S:     return iq2_s_compress_into(src, (iq2_s_array_t *)p);
+        case TOPK:      return topk_compress_into_scratch(src, (sparse_array_t *)p, thread_scratch);
+        case TOPK_IM:
+            if (!im) return 1;
+            return topk_im_compress_into_scratch(src, im, (sparse_array_t *)p, thread_scratch);
+        default:
+            return 1;
+    }
+}
+
+int bsq_compress_payload_serial(bitsqueeze_buffer_t *buf, const float *src, const float *im) {
+    void *p = buf->payload;
+
+    switch (buf->method) {
+        case Q8_0:      return q8_0_compress_into_serial(src, (q8_0_array_t *)p);
+        case Q4_0:      return q4_0_compress_into_serial(src, (q4_0_array_t *)p);
+        case Q2_K:
+            if (im) return q2_k_im_compress_into_serial(src, im, (q2_k_array_t *)p);
+            return q2_k_compress_into_serial(src, (q2_k_array_t *)p);
+        case Q2_K_FAST: return q2_k_fast_compress_into_serial(src, (q2_k_array_t *)p);
+        case BF16:      return bf16_compress_into_serial(src, (bf16_array_t *)p);
+        case FP16:      return fp16_compress_into_serial(src, (fp16_array_t *)p);
+        case FP8:       return fp8_compress_into_serial(src, (fp8_array_t *)p);
+        case FP4:       return fp4_compress_into_serial(src, (fp4_array_t *)p);
+        case MXFP8:     return mxfp8_compress_into_serial(src, (mxfp8_array_t *)p);
+        case MXFP4:     return mxfp4_compress_into_serial(src, (mxfp4_array_t *)p);
+        case NVFP4:     return nvfp4_compress_into_serial(src, (nvfp4_array_t *)p);
+        case NF4:       return nf4_compress_into_serial(src, (nf4_array_t *)p);
+        case NF4_DQ:    return nf4_dq_compress_into_serial(src, (nf4_dq_array_t *)p);
+        case IQ2_XXS:   return iq2_xxs_compress_into_serial(src, (iq2_xxs_array_t *)p);
+        case IQ2_XS:    return iq2_xs_compress_into_serial(src, (iq2_xs_array_t *)p);
+        case IQ2_S:     return iq2_s_compress_into_serial(src, (iq2_s_array_t *)p);
+        case TOPK:      return topk_compress_into_serial(src, (sparse_array_t *)p);
+        case TOPK_IM:
+            if (!im) return 1;
+            return topk_im_compress_into_serial(src, im, (sparse_array_t *)p);
+        default:
+            return 1;
+    }
+}
+
+bitsqueeze_buffer_t *bsq_prepare_buffer(bsq_method_t method,
+                                        const bsq_shape_t *shape,
+                                        void *dst,
+                                        int64_t dst_size) {
+    const int64_t payload_size = _compute_payload_size(method, shape);
+    if (payload_size <= 0) return NULL;
+    if (!dst || ((uintptr_t)dst % _Alignof(bitsqueeze_buffer_t)) != 0) return NULL;
+    if (dst_size < (int64_t)sizeof(bitsqueeze_buffer_t) + payload_size) return NULL;
+
+    bitsqueeze_buffer_t *buf = (bitsqueeze_buffer_t *)dst;
+    /* Clear struct padding so packed bytes never depend on what dst held. */
+    memset(buf, 0, sizeof(bitsqueeze_buffer_t) + bsq_payload_header_size(method));
+    buf->method = method;
+    buf->shape = *shape;
+    buf->payload = ((uint8_t *)buf) + sizeof(bitsqueeze_buffer_t);
+    if (bsq_init_payload(buf)) return NULL;
+    return buf;
+}
+
+/* Lay out a buffer header + payload in dst and quantize src into it, with ctx's scratch when given. */
+static int _compress_into(const float *src,
+                          bsq_method_t method,
+                          const bsq_shape_t *shape,
+                          void *dst,
+                          int64_t dst_size,
+                          const float *im,
+                          bsq_ctx_t *ctx) {
+    bitsqueeze_buffer_t *buf = bsq_prepare_buffer(method, shape, dst, dst_size);
+    if (!buf) return 1;
+
+    const size_t scratch_size = ctx ? bsq_payload_thread_scratch_size(buf) : 0;
+    if (scratch_size == 0) return bsq_compress_payload(buf, src, im);
+    void *const *thread_scratch = bsq_ctx_thread_scratch(ctx, scratch_size);
+    if (!thread_scratch) return 1;
+    return bsq_compress_payload_scratch(buf, src, im, thread_scratch);
+}
+
+static bsq_shape_t _make_shape_1d(uint64_t num_elements) {
+    bsq_shape_t shape;
+    memset(&shape, 0, sizeof(shape));
+    shape.num_elements = num_elements;
+    return shape;
+}
+
+static bsq_shape_t _make_shape_2d(uint16_t num_tokens, uint16_t num_features, float sparse_ratio) {
+    bsq_shape_t shape;
+    memset(&shape, 0, sizeof(shape));
+    shape.num_tokens = num_tokens;
+    shape.num_features = num_features;
+    shape.sparse_ratio = sparse_ratio;
+    return shape;
+}
+
+int64_t bsq_compute_packed_size_1d(bsq_method_t method, uint64_t num_elements) {
+    if (num_elements == 0 || method == TOPK || method == TOPK_IM) return 0;
+
+    const bsq_shape_t shape = _make_shape_1d(num_elements);
+    const int64_t payload = _compute_payload_size(method, &shape);
+    if (payload <= 0) return 0;
+    return (int64_t)sizeof(bitsqueeze_buffer_t) + payload;
+}
+
+int64_t bsq_compute_packed_size_2d(bsq_method_t method,
+                                   uint16_t num_tokens,
+                                   uint16_t num_features,
+                                   float sparse_ratio) {
+    if (num_tokens == 0 || num_features == 0) return 0;
+    if (method != TOPK && method != TOPK_IM) return 0;
+
+    const bsq_shape_t shape = _make_shape_2d(num_tokens, num_features, sparse_ratio);
+    const int64_t payload = _compute_payload_size(method, &shape);
+    if (payload <= 0) return 0;
+    return (int64_t)sizeof(bitsqueeze_buffer_t) + payload;
+}
+
+static int _compress_1d_into(const float *src,
+                             uint64_t num_elements,
+                             bsq_method_t method,
+                             void *dst,
+                             int64_t dst_size,
+                             const float *im,
+                             bsq_ctx_t *ctx) {
+    if (!src || num_elements == 0) return 1;
+    if (method == TOPK || method == TOPK_IM) return 1; /* invalid method for 1D compression */
+
+    const bsq_shape_t shape = _make_shape_1d(num_elements);
+    return _compress_into(src, method, &shape, dst, dst_size, im, ctx);
+}
+
+static int _compress_2d_into(const float *src,
+                             uint16_t num_tokens,
+                             uint16_t num_features,
+                             float sparse_ratio,
+                             bsq_method_t method,
+                             void *dst,
+                             int64_t dst_size,
+                             const float *im,
+                             bsq_ctx_t *ctx) {
+    if (!src || num_tokens == 0 || num_features == 0) return 1;
+    if (method != TOPK && method != TOPK_IM) return 1;
+    if (method == TOPK_IM && !im) return 1;
+
+    const bsq_shape_t shape = _make_shape_2d(num_tokens, num_features, sparse_ratio);
+    return _compress_into(src, method, &shape, dst, dst_size, im, ctx);
+}
+
+int bsq_compress_1d_into(const float *src,
+                         uint64_t num_elements,
+                         bsq_method_t method,
+                         void *dst,
+                         int64_t dst_size,
+                         const float *im) {
+    return _compress_1d_into(src, num_elements, method, dst, dst_size, im, NULL);
+}
+
+int bsq_compress_2d_into(const float *src,
+                         uint16_t num_tokens,
+                         uint16_t num_features,
+                         float sparse_ratio,
+                         bsq_method_t method,
+                         void *dst,
+                         int64_t dst_size,
+                         const float *im) {
+    return _compress_2d_into(src, num_tokens, num_features, sparse_ratio, method, dst, dst_size, im, NULL);
+}
+
 int bsq_compress_1d(const float *src,
                     uint64_t num_elements,
                     bsq_method_t method,
@@ -205,324 +583,19 @@ int bsq_compress_1d(const float *src,
                     const float *im) {
     if (!src || num_elements == 0 || !out || *out) return 1;
 
-    switch (method) {
-        case Q8_0: {
-            q8_0_array_t *arr = NULL;
-            if (q8_0_compress(src, num_elements, &arr) || !arr) return 1;
-            const size_t payload_size = (size_t)get_q8_0_array(arr);
-
-            bitsqueeze_buffer_t *buf = _allocate_bsq_buffer(payload_size);
-            if (!buf) {
-                free_q8_0_array(arr);
-                return 1;
-            }
-
-            buf->method = Q8_0;
-            buf->shape.num_elements = num_elements;
-            memcpy(buf->payload, arr, payload_size);
-            free_q8_0_array(arr);
-            _fixup_payload_pointers(buf);
-            *out = buf;
-            return 0;
-        }
-        case Q4_0: {
-            q4_0_array_t *arr = NULL;
-            if (q4_0_compress(src, num_elements, 0, &arr) || !arr) return 1;
-            const size_t payload_size = (size_t)get_q4_0_array_size(arr);
-
-            bitsqueeze_buffer_t *buf = _allocate_bsq_buffer(payload_size);
-            if (!buf) {
-                free_q4_0_array(arr);
-                return 1;
-            }
-
-            buf->method = Q4_0;
-            buf->shape.num_elements = num_elements;
-            memcpy(buf->payload, arr, payload_size);
-            free_q4_0_array(arr);
-            _fixup_payload_pointers(buf);
-            *out = buf;
-            return 0;
-        }
-        case Q2_K: {
-            q2_k_array_t *arr = NULL;
-            
-            // Currently, only q2_k support using customized importance matrix
-            if (!im) {
-                if (q2_k_compress(src, num_elements, &arr) || !arr) return 1;
-            }
-            else {
-                if (q2_k_im_compress(src, im, num_elements, &arr) || !arr) return 1;
-            }
-
-            const size_t payload_size = (size_t)get_q2_k_array_size(arr);
-
-            bitsqueeze_buffer_t *buf = _allocate_bsq_buffer(payload_size);
-            if (!buf) {
-                free_q2_k_array(arr);
-                return 1;
-            }
-
-            buf->method = Q2_K;
-            buf->shape.num_elements = num_elements;
-            memcpy(buf->payload, arr, payload_size);
-            free_q2_k_array(arr);
-            _fixup_payload_pointers(buf);
-            *out = buf;
-            return 0;
-        }
-        case Q2_K_FAST: {
-            q2_k_array_t *arr = NULL;
-            if (q2_k_fast_compress(src, num_elements, &arr) || !arr) return 1;
-            const size_t payload_size = (size_t)get_q2_k_array_size(arr);
-
-            bitsqueeze_buffer_t *buf = _allocate_bsq_buffer(payload_size);
-            if (!buf) {
-                free_q2_k_array(arr);
-                return 1;
-            }
-
-            buf->method = Q2_K_FAST;
-            buf->shape.num_elements = num_elements;
-            memcpy(buf->payload, arr, payload_size);
-            free_q2_k_array(arr);
-            _fixup_payload_pointers(buf);
-            *out = buf;
-            return 0;
-        }
-        case BF16: {
-            bf16_array_t *arr = NULL;
-            if (bf16_compress(src, num_elements, &arr) || !arr) return 1;
-            const size_t payload_size = (size_t)get_bf16_array_size(arr);
-
-            bitsqueeze_buffer_t *buf = _allocate_bsq_buffer(payload_size);
-            if (!buf) {
-                free_bf16_array(arr);
-                return 1;
-            }
-
-            buf->method = BF16;
-            buf->shape.num_elements = num_elements;
-            memcpy(buf->payload, arr, payload_size);
-            free_bf16_array(arr);
-            _fixup_payload_pointers(buf);
-            *out = buf;
-            return 0;
-        }
-        case FP16: {
-            fp16_array_t *arr = NULL;
-            if (fp16_compress(src, num_elements, &arr) || !arr) return 1;
-            const size_t payload_size = (size_t)get_fp16_array_size(arr);
-
-            bitsqueeze_buffer_t *buf = _allocate_bsq_buffer(payload_size);
-            if (!buf) {
-                free_fp16_array(arr);
-                return 1;
-            }
-
-            buf->method = FP16;
-            buf->shape.num_elements = num_elements;
-            memcpy(buf->payload, arr, payload_size);
-            free_fp16_array(arr);
-            _fixup_payload_pointers(buf);
-            *out = buf;
-            return 0;
-        }
-        case FP8: {
-            fp8_array_t *arr = NULL;
-            if (fp8_compress(src, num_elements, &arr) || !arr) return 1;
-            const size_t payload_size = (size_t)get_fp8_array_size(arr);
-
-            bitsqueeze_buffer_t *buf = _allocate_bsq_buffer(payload_size);
-            if (!buf) {
-                free_fp8_array(arr);
-                return 1;
-            }
-
-            buf->method = FP8;
-            buf->shape.num_elements = num_elements;
-            memcpy(buf->payload, arr, payload_size);
-            free_fp8_array(arr);
-            _fixup_payload_pointers(buf);
-            *out = buf;
-            return 0;
-        }
-        case FP4: {
-            fp4_array_t *arr = NULL;
-            if (fp4_compress(src, num_elements, &arr) || !arr) return 1;
-            const size_t payload_size = (size_t)get_fp4_array_size(arr);
-
-            bitsqueeze_buffer_t *buf = _allocate_bsq_buffer(payload_size);
-            if (!buf) {
-                free_fp4_array(arr);
-                return 1;
-            }
-
-            buf->method = FP4;
-            buf->shape.num_elements = num_elements;
-            memcpy(buf->payload, arr, payload_size);
-            free_fp4_array(arr);
-            _fixup_payload_pointers(buf);
-            *out = buf;
-            return 0;
-        }
-        case MXFP8: {
-            mxfp8_array_t *arr = NULL;
-            if (mxfp8_compress(src, num_elements, &arr) || !arr) return 1;
-            const size_t payload_size = (size_t)get_mxfp8_array_size(arr);
-
-            bitsqueeze_buffer_t *buf = _allocate_bsq_buffer(payload_size);
-            if (!buf) {
-                free_mxfp8_array(arr);
-                return 1;
-            }
-
-            buf->method = MXFP8;
-            buf->shape.num_elements = num_elements;
-            memcpy(buf->payload, arr, payload_size);
-            free_mxfp8_array(arr);
-            _fixup_payload_pointers(buf);
-            *out = buf;
-            return 0;
-        }
-        case MXFP4: {
-            mxfp4_array_t *arr = NULL;
-            if (mxfp4_compress(src, num_elements, &arr) || !arr) return 1;
-            const size_t payload_size = (size_t)get_mxfp4_array_size(arr);
-
-            bitsqueeze_buffer_t *buf = _allocate_bsq_buffer(payload_size);
-            if (!buf) {
-                free_mxfp4_array(arr);
-                return 1;
-            }
-
-            buf->method = MXFP4;
-            buf->shape.num_elements = num_elements;
-            memcpy(buf->payload, arr, payload_size);
-            free_mxfp4_array(arr);
-            _fixup_payload_pointers(buf);
-            *out = buf;
-            return 0;
-        }
-        case NVFP4: {
-            nvfp4_array_t *arr = NULL;
-            if (nvfp4_compress(src, num_elements, &arr) || !arr) return 1;
-            const size_t payload_size = (size_t)get_nvfp4_array_size(arr);
-
-            bitsqueeze_buffer_t *buf = _allocate_bsq_buffer(payload_size);
-            if (!buf) {
-                free_nvfp4_array(arr);
-                return 1;
-            }
-
-            buf->method = NVFP4;
-            buf->shape.num_elements = num_elements;
-            memcpy(buf->payload, arr, payload_size);
-            free_nvfp4_array(arr);
-            _fixup_payload_pointers(buf);
-            *out = buf;
-            return 0;
-        }
-        case NF4: {
-            nf4_array_t *arr = NULL;
-            if (nf4_compress(src, num_elements, &arr) || !arr) return 1;
-            const size_t payload_size = (size_t)get_nf4_array_size(arr);
-
-            bitsqueeze_buffer_t *buf = _allocate_bsq_buffer(payload_size);
-            if (!buf) {
-                free_nf4_array(arr);
-                return 1;
-            }
-
-            buf->method = NF4;
-            buf->shape.num_elements = num_elements;
-            memcpy(buf->payload, arr, payload_size);
-            free_nf4_array(arr);
-            _fixup_payload_pointers(buf);
-            *out = buf;
-            return 0;
-        }
-        case NF4_DQ: {
-            nf4_dq_array_t *arr = NULL;
-            if (nf4_dq_compress(src, num_elements, &arr) || !arr) return 1;
-            const size_t payload_size = (size_t)get_nf4_dq_array_size(arr);
-
-            bitsqueeze_buffer_t *buf = _allocate_bsq_buffer(payload_size);
-            if (!buf) {
-                free_nf4_dq_array(arr);
-                return 1;
-            }
-
-            buf->method = NF4_DQ;
-            buf->shape.num_elements = num_elements;
-            memcpy(buf->payload, arr, payload_size);
-            free_nf4_dq_array(arr);
-            _fixup_payload_pointers(buf);
-            *out = buf;
-            return 0;
-        }
-        case IQ2_XXS: {
-            iq2_xxs_array_t *arr = NULL;
-            if (iq2_xxs_compress(src, num_elements, &arr) || !arr) return 1;
-            const size_t payload_size = (size_t)get_iq2_xxs_array_size(arr);
-
-            bitsqueeze_buffer_t *buf = _allocate_bsq_buffer(payload_size);
-            if (!buf) {
-                free_iq2_xxs_array(arr);
-                return 1;
-            }
-
-            buf->method = IQ2_XXS;
-            buf->shape.num_elements = num_elements;
-            memcpy(buf->payload, arr, payload_size);
-            free_iq2_xxs_array(arr);
-            _fixup_payload_pointers(buf);
-            *out = buf;
-            return 0;
-        }
-        case IQ2_XS: {
-            iq2_xs_array_t *arr = NULL;
-            if (iq2_xs_compress(src, num_elements, &arr) || !arr) return 1;
-            const size_t payload_size = (size_t)get_iq2_xs_array_size(arr);
-
-            bitsqueeze_buffer_t *buf = _allocate_bsq_buffer(payload_size);
-            if (!buf) {
-                free_iq2_xs_array(arr);
-                return 1;
-            }
-
-            buf->method = IQ2_XS;
-            buf->shape.num_elements = num_elements;
-            memcpy(buf->payload, arr, payload_size);
-            free_iq2_xs_array(arr);
-            _fixup_payload_pointers(buf);
-            *out = buf;
-            return 0;
-        }
-        case IQ2_S: {
-            iq2_s_array_t *arr = NULL;
-            if (iq2_s_compress(src, num_elements, &arr) || !arr) return 1;
-            const size_t payload_size = (size_t)get_iq2_s_array_size(arr);
-
-            bitsqueeze_buffer_t *buf = _allocate_bsq_buffer(payload_size);
-            if (!buf) {
-                free_iq2_s_array(arr);
-                return 1;
-            }
-
-            buf->method = IQ2_S;
-            buf->shape.num_elements = num_elements;
-            memcpy(buf->payload, arr, payload_size);
-            free_iq2_s_array(arr);
-            _fixup_payload_pointers(buf);
-            *out = buf;
-            return 0;
-        }
-        case TOPK:
-        case TOPK_IM:
-        default:
-            return 1; /* invalid method for 1D compression */
+    const int64_t total = bsq_compute_packed_size_1d(method, num_elements);
+    if (total <= 0) return 1;
+
+    bitsqueeze_buffer_t *buf = _allocate_bsq_buffer((size_t)total - sizeof(bitsqueeze_buffer_t));
+    if (!buf) return 1;
+
+    if (bsq_compress_1d_into(src, num_elements, method, buf, total, im)) {
+        bsq_free(buf);
+        return 1;
     }
+
+    *out = buf;
+    return 0;
 }
 
 int bsq_compress_2d(const float *src,
@@ -533,56 +606,20 @@ int bsq_compress_2d(const float *src,
                     bitsqueeze_buffer_t **out,
                     const float *im) {
     if (!src || !out || *out || num_tokens == 0 || num_features == 0) return 1;
-    if (method != TOPK && method != TOPK_IM) return 1;
 
-    switch (method)
-    {
-        case TOPK: {
-            sparse_array_t *arr = NULL;
-            if (topk_compress(src, num_tokens, num_features, sparse_ratio, &arr) || !arr) return 1;
-
-            const size_t payload_size = (size_t)get_sparse_array_size(arr);
-            bitsqueeze_buffer_t *buf = _allocate_bsq_buffer(payload_size);
-            if (!buf) {
-                free_sparse_array(arr);
-                return 1;
-            }
-
-            buf->method = TOPK;
-            buf->shape.num_tokens = num_tokens;
-            buf->shape.num_features = num_features;
-            buf->shape.sparse_ratio = sparse_ratio;
-            memcpy(buf->payload, arr, payload_size);
-            free_sparse_array(arr);
-            _fixup_payload_pointers(buf);
-            *out = buf;
-            return 0;
-        }
-        case TOPK_IM: {
-            if (!im) return 1;
-            sparse_array_t *arr = NULL;
-            if (topk_im_compress(src, im, num_tokens, num_features, sparse_ratio, &arr) || !arr) return 1;
-
-            const size_t payload_size = (size_t)get_sparse_array_size(arr);
-            bitsqueeze_buffer_t *buf = _allocate_bsq_buffer(payload_size);
-            if (!buf) {
-                free_sparse_array(arr);
-                return 1;
-            }
-
-            buf->method = TOPK_IM;
-            buf->shape.num_tokens = num_tokens;
-            buf->shape.num_features = num_features;
-            buf->shape.sparse_ratio = sparse_ratio;
-            memcpy(buf->payload, arr, payload_size);
-            free_sparse_array(arr);
-            _fixup_payload_pointers(buf);
-            *out = buf;
-            return 0;
-        }
-        default:
-            return 1;
+    const int64_t total = bsq_compute_packed_size_2d(method, num_tokens, num_features, sparse_ratio);
+    if (total <= 0) return 1;
+
+    bitsqueeze_buffer_t *buf = _allocate_bsq_buffer((size_t)total - sizeof(bitsqueeze_buffer_t));
+    if (!buf) return 1;
+
+    if (bsq_compress_2d_into(src, num_tokens, num_features, sparse_ratio, method, buf, total, im)) {
+        bsq_free(buf);
+        return 1;
     }
+
+    *out = buf;
+    return 0;
 }
 
 int bsq_decompress(const bitsqueeze_buffer_t *buf,
@@ -688,6 +725,173 @@ int bsq_decompress(const bitsqueeze_buffer_t *buf,
     }
 }
 
+int bsq_decompress_range(const bitsqueeze_buffer_t *buf,
+                         uint64_t offset,
+                         uint64_t count,
+                         float *dst) {
+    if (!buf || !dst || !buf->payload) return 1;
+
+    const void *p = buf->payload;
+    switch (buf->method) {
+        case Q8_0:      return q8_0_decompress_range((const q8_0_array_t *)p, offset, count, dst);
+        case Q4_0:      return q4_0_decompress_range((const q4_0_array_t *)p, offset, count, dst);
+        case Q2_K:
+        case Q2_K_FAST: return q2_k_decompress_range((const q2_k_array_t *)p, offset, count, dst);
+        case BF16:      return bf16_decompress_range((const bf16_array_t *)p, offset, count, dst);
+        case FP16:      return fp16_decompress_range((const fp16_array_t *)p, offset, count, dst);
+        case FP8:       return fp8_decompress_range((const fp8_array_t *)p, offset, count, dst);
+        case FP4:       return fp4_decompress_range((const fp4_array_t *)p, offset, count, dst);
+        case MXFP8:     return mxfp8_decompress_range((const mxfp8_array_t *)p, offset, count, dst);
+        case MXFP4:     return mxfp4_decompress_range((const mxfp4_array_t *)p, offset, count, dst);
+        case NVFP4:     return nvfp4_decompress_range((const nvfp4_array_t *)p, offset, count, dst);
+        case NF4:       return nf4_decompress_range((const nf4_array_t *)p, offset, count, dst);
+        case NF4_DQ:    return nf4_dq_decompress_range((const nf4_dq_array_t *)p, offset, count, dst);
+        case IQ2_XXS:   return iq2_xxs_decompress_range((const iq2_xxs_array_t *)p, offset, count, dst);
+        case IQ2_XS:    return iq2_xs_decompress_range((const iq2_xs_array_t *)p, offset, count, dst);
+        case IQ2_S:     return iq2_s_decompress_range((const iq2_s_array_t *)p, offset, count, dst);
+        default:
+            return 1;
+    }
+}
+
+int bsq_decompress_range_serial(const bitsqueeze_buffer_t *buf,
+                                uint64_t offset,
+                                uint64_t count,
+                                float *dst) {
+    if (!buf || !dst || !buf->payload) return 1;
+
+    const void *p = buf->payload;
+    switch (buf->method) {
+        case Q8_0:      return q8_0_decompress_range_serial((const q8_0_array_t *)p, offset, count, dst);
+        case Q4_0:      return q4_0_decompress_range_serial((const q4_0_array_t *)p, offset, count, dst);
+        case Q2_K:
+        case Q2_K_FAST: return q2_k_decompress_range_serial((const q2_k_array_t *)p, offset, count, dst);
+        case BF16:      return bf16_decompress_range_serial((const bf16_array_t *)p, offset, count, dst);
+        case FP16:      return fp16_decompress_range_serial((const fp16_array_t *)p, offset, count, dst);
+        case FP8:       return fp8_decompress_range_serial((const fp8_array_t *)p, offset, count, dst);
+        case FP4:       return fp4_decompress_range_serial((const fp4_array_t *)p, offset, count, dst);
+        case MXFP8:     return mxfp8_decompress_range_serial((const mxfp8_array_t *)p, offset, count, dst);
+        case MXFP4:     return mxfp4_decompress_range_serial((const mxfp4_array_t *)p, offset, count, dst);
+        case NVFP4:     return nvfp4_decompress_range_serial((const nvfp4_array_t *)p, offset, count, dst);
+        case NF4:       return nf4_decompress_range_serial((const nf4_array_t *)p, offset, count, dst);
+        case NF4_DQ:    return nf4_dq_decompress_range_serial((const nf4_dq_array_t *)p, offset, count, dst);
+        case IQ2_XXS:   return iq2_xxs_decompress_range_serial((const iq2_xxs_array_t *)p, offset, count, dst);
+        case IQ2_XS:    return iq2_xs_decompress_range_serial((const iq2_xs_array_t *)p, offset, count, dst);
+        case IQ2_S:     return iq2_s_decompress_range_serial((const iq2_s_array_t *)p, offset, count, dst);
+        default:
+            return 1;
+    }
+}
+
+int bsq_decompress_rows(const bitsqueeze_buffer_t *buf,
+                        const uint16_t *token_indices,
+                        uint32_t num_rows,
+                        float *dst,
+                        uint64_t dst_num_elements) {
+    if (!buf || !dst || !buf->payload) return 1;
+
+    switch (buf->method) {
+        case TOPK:
+        case TOPK_IM: {
+            const sparse_array_t *arr = (const sparse_array_t *)buf->payload;
+            uint64_t expected = (uint64_t)num_rows * arr->num_features;
+            if (dst_num_elements < expected) return 1;
+            return topk_decompress_rows(arr, token_indices, num_rows, dst);
+        }
+        default:
+            return 1;
+    }
+}
+
+
+int bsq_gemv(const bitsqueeze_buffer_t *buf,
+             uint64_t rows,
+             uint64_t cols,
+             const float *x,
+             float *y) {
+    if (!buf || !x || !y || !buf->payload) return 1;
+
+    const void *p = buf->payload;
+    switch (buf->method) {
+        case Q8_0:      return q8_0_gemv((const q8_0_array_t *)p, rows, cols, x, y);
+        case Q4_0:      return q4_0_gemv((const q4_0_array_t *)p, rows, cols, x, y);
+        case Q2_K:
+        case Q2_K_FAST: return q2_k_gemv((const q2_k_array_t *)p, rows, cols, x, y);
+        case NF4:       return nf4_gemv((const nf4_array_t *)p, rows, cols, x, y);
+        case MXFP4:     return mxfp4_gemv((const mxfp4_array_t *)p, rows, cols, x, y);
+        case NVFP4:     return nvfp4_gemv((const nvfp4_array_t *)p, rows, cols, x, y);
+        default:
+            return 1;
+    }
+}
+
+
+int bsq_quantize_q8(const float *x,
+                    uint64_t num_tokens,
+                    uint64_t cols,
+                    int8_t *codes,
+                    float *scales) {
+    if (!x || !codes || !scales || cols == 0 || cols % DEFAULT_Q8_0_BLOCK_SIZE != 0) return 1;
+    return q8_0_quantize_blocks(x, num_tokens * cols, codes, scales);
+}
+
+int bsq_gemv_q8(const bitsqueeze_buffer_t *buf,
+                uint64_t rows,
+                uint64_t cols,
+                const int8_t *x_codes,
+                const float *x_scales,
+                float *y) {
+    if (!buf || !buf->payload) return 1;
+
+    const void *p = buf->payload;
+    switch (buf->method) {
+        case Q8_0: return q8_0_gemv_q8((const q8_0_array_t *)p, rows, cols, x_codes, x_scales, y);
+        case Q4_0: return q4_0_gemv_q8((const q4_0_array_t *)p, rows, cols, x_codes, x_scales, y);
+        default:
+            return 1;
+    }
+}
+
+
+int bsq_spmm(const bitsqueeze_buffer_t *buf,
+             const float *dense,
+             uint64_t out_features,
+             float *out) {
+    if (!buf || !buf->payload) return 1;
+
+    switch (buf->method) {
+        case TOPK:
+        case TOPK_IM: return topk_spmm((const sparse_array_t *)buf->payload, dense, out_features, out);
+        default:
+            return 1;
+    }
+}
+
+int bsq_spmm_t(const bitsqueeze_buffer_t *buf,
+               const float *dense,
+               uint64_t num_rows,
+               float *out) {
+    if (!buf || !buf->payload) return 1;
+
+    switch (buf->method) {
+        case TOPK:
+        case TOPK_IM: return topk_spmm_t((const sparse_array_t *)buf->payload, dense, num_rows, out);
+        default:
+            return 1;
+    }
+}
+
+int bsq_spmv(const bitsqueeze_buffer_t *buf, const float *x, float *y) {
+    if (!buf || !buf->payload) return 1;
+
+    switch (buf->method) {
+        case TOPK:
+        case TOPK_IM: return topk_spmv((const sparse_array_t *)buf->payload, x, y);
+        default:
+            return 1;
+    }
+}
+
 
 int bsq_apply(const bitsqueeze_buffer_t *buf,
                    float *dst,
@@ -707,6 +911,145 @@ int bsq_apply(const bitsqueeze_buffer_t *buf,
 }
 
 
+/* Elements bsq_accumulate decodes per step onto the stack; a multiple of every granule. */
+#define ACCUMULATE_CHUNK 4096
+
+/* dst[start, start + count) += alpha * the same elements of buf, decoded into an on-stack panel. */
+static int _accumulate_chunk(const bitsqueeze_buffer_t *buf, uint64_t start, uint64_t count, float *dst, float alpha) {
+    float panel[ACCUMULATE_CHUNK];
+    if (bsq_decompress_range_serial(buf, start, count, panel)) return 1;
+    float *out = dst + start;
+    for (uint64_t i = 0; i < count; ++i) out[i] += alpha * panel[i];
+    return 0;
+}
+
+static int _accumulate(const bitsqueeze_buffer_t *buf, float *dst, uint64_t dst_num_elements, float alpha,
+                       int parallel) {
+    if (!buf || !dst || !buf->payload) return 1;
+
+    if (buf->method == TOPK || buf->method == TOPK_IM) {
+        const sparse_array_t *arr = (const sparse_array_t *)buf->payload;
+        if (dst_num_elements < (uint64_t)arr->num_tokens * arr->num_features) return 1;
+        return parallel ? topk_accumulate(arr, dst, alpha) : topk_accumulate_serial(arr, dst, alpha);
+    }
+
+    /* Each chunk is decoded into an L1-resident panel and added to dst straight away, so dst is read and
+     * written once and no tensor-sized temporary exists. */
+    const uint64_t num_elements = buf->shape.num_elements;
+    if (bsq_payload_granule(buf) == 0 || dst_num_elements < num_elements) return 1;
+    const uint64_t num_chunks = (num_elements + ACCUMULATE_CHUNK - 1) / ACCUMULATE_CHUNK;
+    int failed = 0;
+
+#if defined(__linux__) && defined(_OPENMP)
+    if (parallel) {
+#pragma omp parallel for reduction(|:failed)
+        for (uint64_t c = 0; c < num_chunks; ++c) {
+            const uint64_t start = c * ACCUMULATE_CHUNK;
+            const uint64_t count = num_elements - start < ACCUMULATE_CHUNK ? num_elements - start : ACCUMULATE_CHUNK;
+            if (_accumulate_chunk(buf, start, count, dst, alpha)) failed = 1;
+        }
+        return failed;
+    }
+#else
+    (void)parallel;
+#endif
+    for (uint64_t c = 0; c < num_chunks && !failed; ++c) {
+        const uint64_t start = c * ACCUMULATE_CHUNK;
+        const uint64_t count = num_elements - start < ACCUMULATE_CHUNK ? num_elements - start : ACCUMULATE_CHUNK;
+        failed = _accumulate_chunk(buf, start, count, dst, alpha);
+    }
+    return failed;
+}
+
+int bsq_accumulate(const bitsqueeze_buffer_t *buf,
+                   float *dst,
+                   uint64_t dst_num_elements,
+                   float alpha) {
+    return _accumulate(buf, dst, dst_num_elements, alpha, 1);
+}
+
+int bsq_accumulate_serial(const bitsqueeze_buffer_t *buf, float *dst, uint64_t dst_num_elements, float alpha) {
+    return _accumulate(buf, dst, dst_num_elements, alpha, 0);
+}
+
+
+int bsq_ctx_compress_1d_into(bsq_ctx_t *ctx,
+                             const float *src,
+                             uint64_t num_elements,
+                             bsq_method_t method,
+                             void *dst,
+                             int64_t dst_size,
+                             const float *im) {
+    if (!ctx) return 1;
+    const int saved = bsq_ctx_enter(ctx);
+    const int rc = _compress_1d_into(src, num_elements, method, dst, dst_size, im, ctx);
+    bsq_ctx_leave(ctx, saved);
+    return rc;
+}
+
+int bsq_ctx_compress_2d_into(bsq_ctx_t *ctx,
+                             const float *src,
+                             uint16_t num_tokens,
+                             uint16_t num_features,
+                             float sparse_ratio,
+                             bsq_method_t method,
+                             void *dst,
+                             int64_t dst_size,
+                             const float *im) {
+    if (!ctx) return 1;
+    const int saved = bsq_ctx_enter(ctx);
+    const int rc = _compress_2d_into(src, num_tokens, num_features, sparse_ratio, method, dst, dst_size, im, ctx);
+    bsq_ctx_leave(ctx, saved);
+    return rc;
+}
+
+int bsq_ctx_decompress(bsq_ctx_t *ctx,
+                       const bitsqueeze_buffer_t *buf,
+                       float *dst,
+                       uint64_t dst_num_elements) {
+    if (!ctx) return 1;
+    const int saved = bsq_ctx_enter(ctx);
+    const int rc = bsq_decompress(buf, dst, dst_num_elements);
+    bsq_ctx_leave(ctx, saved);
+    return rc;
+}
+
+int bsq_ctx_decompress_range(bsq_ctx_t *ctx,
+                             const bitsqueeze_buffer_t *buf,
+                             uint64_t offset,
+                             uint64_t count,
+                             float *dst) {
+    if (!ctx) return 1;
+    const int saved = bsq_ctx_enter(ctx);
+    const int rc = bsq_decompress_range(buf, offset, count, dst);
+    bsq_ctx_leave(ctx, saved);
+    return rc;
+}
+
+int bsq_ctx_decompress_rows(bsq_ctx_t *ctx,
+                            const bitsqueeze_buffer_t *buf,
+                            const uint16_t *token_indices,
+                            uint32_t num_rows,
+                            float *dst,
+                            uint64_t dst_num_elements) {
+    if (!ctx) return 1;
+    const int saved = bsq_ctx_enter(ctx);
+    const int rc = bsq_decompress_rows(buf, token_indices, num_rows, dst, dst_num_elements);
+    bsq_ctx_leave(ctx, saved);
+    return rc;
+}
+
+int bsq_ctx_apply(bsq_ctx_t *ctx,
+                  const bitsqueeze_buffer_t *buf,
+                  float *dst,
+                  uint64_t dst_num_elements) {
+    if (!ctx) return 1;
+    const int saved = bsq_ctx_enter(ctx);
+    const int rc = bsq_apply(buf, dst, dst_num_elements);
+    bsq_ctx_leave(ctx, saved);
+    return rc;
+}
+
 int64_t bsq_get_packed_size(const bitsqueeze_buffer_t *buf) {
     if (!buf) return 0;
     int64_t payload = _get_payload_size(buf);
@@ -717,15 +1060,22 @@ int64_t bsq_get_packed_size(const bitsqueeze_buffer_t *buf) {
 bitsqueeze_buffer_t *load_bsq_from_buffer(const void *buffer, int64_t buffer_size) {
     if (!buffer || buffer_size < (int64_t)sizeof(bitsqueeze_buffer_t)) return NULL;
 
-    bitsqueeze_buffer_t *buf = (bitsqueeze_buffer_t *)calloc(1, buffer_size);
+    bitsqueeze_buffer_t *buf = (bitsqueeze_buffer_t *)bsq_alloc_bytes((size_t)buffer_size, _Alignof(bitsqueeze_buffer_t),
+                                                                      BSQ_ALLOC_UNINITIALIZED);
     if (!buf) return NULL;
 
     memcpy(buf, buffer, buffer_size);
     buf->payload = ((uint8_t *)buf) + sizeof(bitsqueeze_buffer_t);
 
+    const int64_t header_size = (int64_t)(sizeof(bitsqueeze_buffer_t) + bsq_payload_header_size(buf->method));
+    if (buffer_size < header_size || bsq_validate_payload_header(buf)) {
+        bsq_free_bytes(buf);
+        return NULL;
+    }
+
     const int64_t expected_size = bsq_get_packed_size(buf);
     if (expected_size == 0 || buffer_size < expected_size) {
-        free(buf);
+        bsq_free_bytes(buf);
         return NULL;
     }
 
@@ -733,7 +1083,488 @@ bitsqueeze_buffer_t *load_bsq_from_buffer(const void *buffer, int64_t buffer_siz
     return buf;
 }
 
+int bsq_view_from_buffer(const void *buffer, int64_t buffer_size, bsq_view_t *view) {
+    if (!buffer || !view || buffer_size < (int64_t)sizeof(bitsqueeze_buffer_t)) return 1;
+    if ((uintptr_t)buffer % _Alignof(bitsqueeze_buffer_t) != 0) return 1;
+
+    memcpy(&view->buf, buffer, sizeof(bitsqueeze_buffer_t));
+    const size_t payload_header_size = bsq_payload_header_size(view->buf.method);
+    if (payload_header_size == 0 || payload_header_size > sizeof(view->payload_header)) return 1;
+    if (buffer_size < (int64_t)(sizeof(bitsqueeze_buffer_t) + payload_header_size)) return 1;
+
+    /* Only the codec header is copied; its arrays keep pointing into the caller's bytes. */
+    const uint8_t *payload = (const uint8_t *)buffer + sizeof(bitsqueeze_buffer_t);
+    memcpy(view->payload_header, payload, payload_header_size);
+    view->buf.payload = view->payload_header;
+    if (bsq_validate_payload_header(&view->buf)) return 1;
+
+    const int64_t expected_size = bsq_get_packed_size(&view->buf);
+    if (expected_size == 0 || buffer_size < expected_size) return 1;
+
+    _attach_payload_pointers(view->payload_header, view->buf.method,
+                             (uint8_t *)(uintptr_t)(payload + payload_header_size));
+    return 0;
+}
+
+void bsq_prepare_codec_tables(bsq_method_t method) {
+    switch (method) {
+        case IQ2_XXS: iq2_xxs_init(); break;
+        case IQ2_XS:  iq2_xs_init(); break;
+        case IQ2_S:   iq2_s_init(); break;
+        default:      break;
+    }
+}
+
+int bsq_payload_has_tensor_scale(bsq_method_t method) {
+    return method == FP8 || method == FP4 || method == NVFP4 || method == NF4_DQ;
+}
+
+float bsq_payload_tensor_scale(const bitsqueeze_buffer_t *buf) {
+    const void *p = buf->payload;
+    switch (buf->method) {
+        case FP8:    return ((const fp8_array_t *)p)->scale;
+        case FP4:    return ((const fp4_array_t *)p)->scale;
+        case NVFP4:  return ((const nvfp4_array_t *)p)->tensor_scale;
+        case NF4_DQ: return ((const nf4_dq_array_t *)p)->dq_scale;
+        default:     return 0.0f;
+    }
+}
+
+void bsq_set_payload_tensor_scale(bitsqueeze_buffer_t *buf, float scale) {
+    void *p = buf->payload;
+    switch (buf->method) {
+        case FP8:    ((fp8_array_t *)p)->scale = scale; break;
+        case FP4:    ((fp4_array_t *)p)->scale = scale; break;
+        case NVFP4:  ((nvfp4_array_t *)p)->tensor_scale = scale; break;
+        case NF4_DQ: ((nf4_dq_array_t *)p)->dq_scale = scale; break;
+        default:     break;
+    }
+}
+
+float bsq_tensor_scale_for_absmax(bsq_method_t method, float abs_max) {
+    switch (method) {
+        case FP8:    return fp8_scale_for_absmax(abs_max);
+        case FP4:    return fp4_scale_for_absmax(abs_max);
+        case NVFP4:  return nvfp4_tensor_scale_for_absmax(abs_max);
+        case NF4_DQ: return nf4_dq_scale_for_absmax(abs_max);
+        default:     return 0.0f;
+    }
+}
+
+float bsq_tensor_scale_statistic(bsq_method_t method, uint64_t block_size, const float *panel, uint64_t count) {
+    float stat = 0.0f;
+    if (method == NF4_DQ) {
+        for (uint64_t b = 0; b < count; b += block_size) {
+            const uint64_t len = count - b < block_size ? count - b : block_size;
+            const float block_scale = nf4_dq_block_scale(panel + b, len);
+            if (block_scale > stat) stat = block_scale;
+        }
+        return stat;
+    }
+    for (uint64_t i = 0; i < count; ++i) {
+        if (isfinite(panel[i]) && fabsf(panel[i]) > stat) stat = fabsf(panel[i]);
+    }
+    return stat;
+}
+
+int bsq_compress_payload_scaled(bitsqueeze_buffer_t *buf, const float *src, float scale) {
+    void *p = buf->payload;
+    switch (buf->method) {
+        case FP8:    return fp8_compress_into_scaled(src, scale, (fp8_array_t *)p);
+        case FP4:    return fp4_compress_into_scaled(src, scale, (fp4_array_t *)p);
+        case NVFP4:  return nvfp4_compress_into_scaled(src, scale, (nvfp4_array_t *)p);
+        case NF4_DQ: return nf4_dq_compress_into_scaled(src, scale, (nf4_dq_array_t *)p);
+        default:     return 1;
+    }
+}
+
+int bsq_compress_payload_scaled_serial(bitsqueeze_buffer_t *buf, const float *src, float scale) {
+    void *p = buf->payload;
+    switch (buf->method) {
+        case FP8:    return fp8_compress_into_scaled_serial(src, scale, (fp8_array_t *)p);
+        case FP4:    return fp4_compress_into_scaled_serial(src, scale, (fp4_array_t *)p);
+        case NVFP4:  return nvfp4_compress_into_scaled_serial(src, scale, (nvfp4_array_t *)p);
+        case NF4_DQ: return nf4_dq_compress_into_scaled_serial(src, scale, (nf4_dq_array_t *)p);
+        default:     return 1;
+    }
+}
+
+uint64_t bsq_payload_granule(const bitsqueeze_buffer_t *buf) {
+    const void *p = buf->payload;
+    uint64_t block_size = 0;
+
+    switch (buf->method) {
+        case Q8_0:      return ((const q8_0_array_t *)p)->block_size;
+        case MXFP8:     return ((const mxfp8_array_t *)p)->block_size;
+        case Q2_K:
+        case Q2_K_FAST: return WEIGHT_PER_SUPER_BLOCK;
+        case IQ2_XXS:   return IQ2_XXS_SUPER_BLOCK_SIZE;
+        case IQ2_XS:    return IQ2_XS_SUPER_BLOCK_SIZE;
+        case IQ2_S:     return IQ2_S_SUPER_BLOCK_SIZE;
+        case BF16:
+        case FP16:
+        case FP8:       return 1;
+        case FP4:       return 2;
+        case Q4_0:      block_size = ((const q4_0_array_t *)p)->block_size; break;
+        case MXFP4:     block_size = ((const mxfp4_array_t *)p)->block_size; break;
+        case NVFP4:     block_size = ((const nvfp4_array_t *)p)->block_size; break;
+        case NF4:       block_size = ((const nf4_array_t *)p)->block_size; break;
+        case NF4_DQ:    block_size = ((const nf4_dq_array_t *)p)->block_size; break;
+        default:        return 0;
+    }
+    /* Packed nibbles: a split has to fall on a whole byte. */
+    return block_size % 2 ? 0 : block_size;
+}
+
+int bsq_resize_payload(bitsqueeze_buffer_t *buf, uint64_t count) {
+    void *p = buf->payload;
+
+    switch (buf->method) {
+        case Q8_0: {
+            q8_0_array_t *arr = (q8_0_array_t *)p;
+            if (arr->block_size == 0) return 1;
+            arr->num_blocks = count / arr->block_size + (count % arr->block_size != 0);
+            arr->num_elements = count;
+            break;
+        }
+        case Q4_0: {
+            q4_0_array_t *arr = (q4_0_array_t *)p;
+            if (arr->block_size == 0) return 1;
+            arr->num_blocks = count / arr->block_size + (count % arr->block_size != 0);
+            arr->num_elements = count;
+            break;
+        }
+        case MXFP8: {
+            mxfp8_array_t *arr = (mxfp8_array_t *)p;
+            if (arr->block_size == 0) return 1;
+            arr->num_blocks = count / arr->block_size + (count % arr->block_size != 0);
+            arr->num_elements = count;
+            break;
+        }
+        case MXFP4: {
+            mxfp4_array_t *arr = (mxfp4_array_t *)p;
+            if (arr->block_size == 0) return 1;
+            arr->num_blocks = count / arr->block_size + (count % arr->block_size != 0);
+            arr->num_elements = count;
+            break;
+        }
+        case NVFP4: {
+            nvfp4_array_t *arr = (nvfp4_array_t *)p;
+            if (arr->block_size == 0) return 1;
+            arr->num_blocks = count / arr->block_size + (count % arr->block_size != 0);
+            arr->num_elements = count;
+            break;
+        }
+        case NF4: {
+            nf4_array_t *arr = (nf4_array_t *)p;
+            if (arr->block_size == 0) return 1;
+            arr->num_blocks = count / arr->block_size + (count % arr->block_size != 0);
+            arr->num_elements = count;
+            break;
+        }
+        case NF4_DQ: {
+            nf4_dq_array_t *arr = (nf4_dq_array_t *)p;
+            if (arr->block_size == 0) return 1;
+            arr->num_blocks = count / arr->block_size + (count % arr->block_size != 0);
+            arr->num_elements = count;
+            break;
+        }
+        case Q2_K:
+        case Q2_K_FAST: {
+            q2_k_array_t *arr = (q2_k_array_t *)p;
+            const uint64_t num_super_blocks = count / WEIGHT_PER_SUPER_BLOCK + (count % WEIGHT_PER_SUPER_BLOCK != 0);
+            if (num_super_blocks > UINT32_MAX) return 1;
+            arr->num_elements = count;
+            arr->num_elements_aligned = num_super_blocks * WEIGHT_PER_SUPER_BLOCK;
+            arr->num_super_blocks = (uint32_t)num_super_blocks;
+            break;
+        }
+        case IQ2_XXS: {
+            iq2_xxs_array_t *arr = (iq2_xxs_array_t *)p;
+            arr->num_elements = count;
+            arr->num_super_blocks = count / IQ2_XXS_SUPER_BLOCK_SIZE + (count % IQ2_XXS_SUPER_BLOCK_SIZE != 0);
+            break;
+        }
+        case IQ2_XS: {
+            iq2_xs_array_t *arr = (iq2_xs_array_t *)p;
+            arr->num_elements = count;
+            arr->num_super_blocks = count / IQ2_XS_SUPER_BLOCK_SIZE + (count % IQ2_XS_SUPER_BLOCK_SIZE != 0);
+            break;
+        }
+        case IQ2_S: {
+            iq2_s_array_t *arr = (iq2_s_array_t *)p;
+            arr->num_elements = count;
+            arr->num_super_blocks = count / IQ2_S_SUPER_BLOCK_SIZE + (count % IQ2_S_SUPER_BLOCK_SIZE != 0);
+            break;
+        }
+        case BF16: ((bf16_array_t *)p)->num_elements = count; break;
+        case FP16: ((fp16_array_t *)p)->num_elements = count; break;
+        case FP8:  ((fp8_array_t *)p)->num_elements = count; break;
+        case FP4:  ((fp4_array_t *)p)->num_elements = count; break;
+        default:
+            return 1;
+    }
+    buf->shape.num_elements = count;
+    return 0;
+}
+
+uint32_t bsq_payload_arrays(const bitsqueeze_buffer_t *buf, void **arrays, uint64_t *sizes) {
+    const void *p = buf->payload;
+
+#define BSQ_ARRAY(i, ptr, size) (arrays[i] = (void *)(ptr), sizes[i] = (size))
+    switch (buf->method) {
+        case Q8_0: {
+            const q8_0_array_t *arr = (const q8_0_array_t *)p;
+            BSQ_ARRAY(0, arr->scales, arr->num_blocks * sizeof(float));
+            BSQ_ARRAY(1, arr->data, arr->num_elements);
+            return 2;
+        }
+        case Q4_0: {
+            const q4_0_array_t *arr = (const q4_0_array_t *)p;
+            BSQ_ARRAY(0, arr->scales, arr->num_blocks * sizeof(float));
+            BSQ_ARRAY(1, arr->data, (arr->num_elements + 1) / 2);
+            return 2;
+        }
+        case Q2_K:
+        case Q2_K_FAST: {
+            const q2_k_array_t *arr = (const q2_k_array_t *)p;
+            BSQ_ARRAY(0, arr->super_blocks, (uint64_t)arr->num_super_blocks * sizeof(super_block_q2_k));
+            return 1;
+        }
+        case TOPK:
+        case TOPK_IM: {
+            const sparse_array_t *arr = (const sparse_array_t *)p;
+            const uint64_t sparse_elements = (uint64_t)arr->num_tokens * arr->num_sparse_features;
+            BSQ_ARRAY(0, arr->sparse_indices, sparse_elements * sizeof(uint16_t));
+            BSQ_ARRAY(1, arr->values, sparse_elements * sizeof(float));
+            return 2;
+        }
+        case BF16: {
+            const bf16_array_t *arr = (const bf16_array_t *)p;
+            BSQ_ARRAY(0, arr->data, arr->num_elements * sizeof(uint16_t));
+            return 1;
+        }
+        case FP16: {
+            const fp16_array_t *arr = (const fp16_array_t *)p;
+            BSQ_ARRAY(0, arr->data, arr->num_elements * sizeof(uint16_t));
+            return 1;
+        }
+        case FP8: {
+            const fp8_array_t *arr = (const fp8_array_t *)p;
+            BSQ_ARRAY(0, arr->data, arr->num_elements);
+            return 1;
+        }
+        case FP4: {
+            const fp4_array_t *arr = (const fp4_array_t *)p;
+            BSQ_ARRAY(0, arr->data, (arr->num_elements + 1) / 2);
+            return 1;
+        }
+        case MXFP8: {
+            const mxfp8_array_t *arr = (const mxfp8_array_t *)p;
+            BSQ_ARRAY(0, arr->scales, arr->num_blocks);
+            BSQ_ARRAY(1, arr->data, arr->num_elements);
+            return 2;
+        }
+        case MXFP4: {
+            const mxfp4_array_t *arr = (const mxfp4_array_t *)p;
+            BSQ_ARRAY(0, arr->scales, arr->num_blocks);
+            BSQ_ARRAY(1, arr->data, (arr->num_elements + 1) / 2);
+            return 2;
+        }
+        case NVFP4: {
+            const nvfp4_array_t *arr = (const nvfp4_array_t *)p;
+            BSQ_ARRAY(0, arr->block_scales, arr->num_blocks);
+            BSQ_ARRAY(1, arr->data, (arr->num_elements + 1) / 2);
+            return 2;
+        }
+        case NF4: {
+            const nf4_array_t *arr = (const nf4_array_t *)p;
+            BSQ_ARRAY(0, arr->block_scales, arr->num_blocks * sizeof(float));
+            BSQ_ARRAY(1, arr->data, (arr->num_elements + 1) / 2);
+            return 2;
+        }
+        case NF4_DQ: {
+            const nf4_dq_array_t *arr = (const nf4_dq_array_t *)p;
+            BSQ_ARRAY(0, arr->block_scales, arr->num_blocks);
+            BSQ_ARRAY(1, arr->data, (arr->num_elements + 1) / 2);
+            return 2;
+        }
+        case IQ2_XXS: {
+            const iq2_xxs_array_t *arr = (const iq2_xxs_array_t *)p;
+            BSQ_ARRAY(0, arr->scales, arr->num_super_blocks * sizeof(uint16_t));
+            BSQ_ARRAY(1, arr->qs, arr->num_super_blocks * 64);
+            return 2;
+        }
+        case IQ2_XS: {
+            const iq2_xs_array_t *arr = (const iq2_xs_array_t *)p;
+            BSQ_ARRAY(0, arr->d, arr->num_super_blocks * sizeof(uint16_t));
+            BSQ_ARRAY(1, arr->qs, arr->num_super_blocks * 32 * sizeof(uint16_t));
+            BSQ_ARRAY(2, arr->scales, arr->num_super_blocks * 8);
+            return 3;
+        }
+        case IQ2_S: {
+            const iq2_s_array_t *arr = (const iq2_s_array_t *)p;
+            BSQ_ARRAY(0, arr->d, arr->num_super_blocks * sizeof(uint16_t));
+            BSQ_ARRAY(1, arr->qs, arr->num_super_blocks * 64);
+            BSQ_ARRAY(2, arr->qh, arr->num_super_blocks * 8);
+            BSQ_ARRAY(3, arr->scales, arr->num_super_blocks * 8);
+            return 4;
+        }
+        default:
+            return 0;
+    }
+#undef BSQ_ARRAY
+}
+
+void bsq_attach_payload_arrays(bitsqueeze_buffer_t *buf, void *const *arrays) {
+    void *p = buf->payload;
+
+    switch (buf->method) {
+        case Q8_0: {
+            q8_0_array_t *arr = (q8_0_array_t *)p;
+            arr->scales = (float *)arrays[0];
+            arr->data = (int8_t *)arrays[1];
+            break;
+        }
+        case Q4_0: {
+            q4_0_array_t *arr = (q4_0_array_t *)p;
+            arr->scales = (float *)arrays[0];
+            arr->data = (int8_t *)arrays[1];
+            break;
+        }
+        case Q2_K:
+        case Q2_K_FAST:
+            ((q2_k_array_t *)p)->super_blocks = (super_block_q2_k *)arrays[0];
+            break;
+        case TOPK:
+        case TOPK_IM: {
+            sparse_array_t *arr = (sparse_array_t *)p;
+            arr->sparse_indices = (uint16_t *)arrays[0];
+            arr->values = (float *)arrays[1];
+            break;
+        }
+        case BF16:
+            ((bf16_array_t *)p)->data = (uint16_t *)arrays[0];
+            break;
+        case FP16:
+            ((fp16_array_t *)p)->data = (uint16_t *)arrays[0];
+            break;
+        case FP8:
+            ((fp8_array_t *)p)->data = arrays[0];
+            break;
+        case FP4:
+            ((fp4_array_t *)p)->data = arrays[0];
+            break;
+        case MXFP8: {
+            mxfp8_array_t *arr = (mxfp8_array_t *)p;
+            arr->scales = (int8_t *)arrays[0];
+            arr->data = arrays[1];
+            break;
+        }
+        case MXFP4: {
+            mxfp4_array_t *arr = (mxfp4_array_t *)p;
+            arr->scales = (int8_t *)arrays[0];
+            arr->data = arrays[1];
+            break;
+        }
+        case NVFP4: {
+            nvfp4_array_t *arr = (nvfp4_array_t *)p;
+            arr->block_scales = arrays[0];
+            arr->data = arrays[1];
+            break;
+        }
+        case NF4: {
+            nf4_array_t *arr = (nf4_array_t *)p;
+            arr->block_scales = (float *)arrays[0];
+            arr->data = arrays[1];
+            break;
+        }
+        case NF4_DQ: {
+            nf4_dq_array_t *arr = (nf4_dq_array_t *)p;
+            arr->block_scales = arrays[0];
+            arr->data = arrays[1];
+            break;
+        }
+        case IQ2_XXS: {
+            iq2_xxs_array_t *arr = (iq2_xxs_array_t *)p;
+            arr->scales = (uint16_t *)arrays[0];
+            arr->qs = arrays[1];
+            break;
+        }
+        case IQ2_XS: {
+            iq2_xs_array_t *arr = (iq2_xs_array_t *)p;
+            arr->d = (uint16_t *)arrays[0];
+            arr->qs = (uint16_t *)arrays[1];
+            arr->scales = arrays[2];
+            break;
+        }
+        case IQ2_S: {
+            iq2_s_array_t *arr = (iq2_s_array_t *)p;
+            arr->d = (uint16_t *)arrays[0];
+            arr->qs = arrays[1];
+            arr->qh = arrays[2];
+            arr->scales = arrays[3];
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+int bsq_slice_payload(const bitsqueeze_buffer_t *buf, uint64_t first, uint64_t count, bsq_view_t *slice) {
+    const uint64_t granule = bsq_payload_granule(buf);
+    const uint64_t n = buf->shape.num_elements;
+    if (granule == 0 || first % granule != 0 || first > n || count > n - first) return 1;
+
+    const size_t payload_header_size = bsq_payload_header_size(buf->method);
+    if (payload_header_size > sizeof(slice->payload_header)) return 1;
+
+    /* The first `first` elements occupy exactly this many bytes of every array, since first is granule-aligned. */
+    bsq_view_t head;
+    void *arrays[BSQ_MAX_PAYLOAD_ARRAYS];
+    uint64_t skip[BSQ_MAX_PAYLOAD_ARRAYS];
+    head.buf = *buf;
+    memcpy(head.payload_header, buf->payload, payload_header_size);
+    head.buf.payload = head.payload_header;
+    if (bsq_resize_payload(&head.buf, first)) return 1;
+    const uint32_t num_arrays = bsq_payload_arrays(&head.buf, arrays, skip);
+
+    slice->buf = *buf;
+    memcpy(slice->payload_header, buf->payload, payload_header_size);
+    slice->buf.payload = slice->payload_header;
+    if (bsq_resize_payload(&slice->buf, count)) return 1;
+
+    for (uint32_t i = 0; i < num_arrays; ++i) arrays[i] = (uint8_t *)arrays[i] + skip[i];
+    bsq_attach_payload_arrays(&slice->buf, arrays);
+    return 0;
+}
+
+int bsq_slice_payload_rows(const bitsqueeze_buffer_t *buf,
+                           uint64_t row_elements,
+                           uint64_t first,
+                           uint64_t count,
+                           bsq_view_t *slice) {
+    if (buf->method != TOPK && buf->method != TOPK_IM) {
+        return bsq_slice_payload(buf, first * row_elements, count * row_elements, slice);
+    }
+
+    /* Every row keeps the same number of entries, so a row range is a contiguous run of both arrays. */
+    const sparse_array_t *full = (const sparse_array_t *)buf->payload;
+    if (first > full->num_tokens || count > (uint64_t)full->num_tokens - first) return 1;
+    const uint64_t offset = first * full->num_sparse_features;
+    sparse_array_t *rows = (sparse_array_t *)slice->payload_header;
+    *rows = *full;
+    rows->num_tokens = (uint16_t)count;
+    rows->sparse_indices = full->sparse_indices + offset;
+    rows->values = full->values + offset;
+
+    slice->buf = *buf;
+    slice->buf.shape.num_tokens = (uint16_t)count;
+    slice->buf.payload = rows;
+    return 0;
+}
+
 void bsq_free(bitsqueeze_buffer_t *buf) {
     if (!buf) return;
-    free(buf);
+    bsq_free_bytes(buf);
 }
@@ -0,0 +1,518 @@
+#include "bitsqueeze.h"
+#include "collective/transport_impl.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "serialization/portable_impl.h"
+#include "utils/alloc.h"
+
+/* Elements per all-reduce chunk, the unit that is decoded while the next one is in flight. */
+#define COLLECTIVE_CHUNK 65536
+/* Ring segments start on a multiple of this, so every block of a chunk is whole. */
+#define COLLECTIVE_SEGMENT_ALIGN 256
+/* Alignment of message buffers, enough for bsq_view_from_buffer and bsq_view_portable. */
+#define COLLECTIVE_ALIGN 64
+/* Message header on the wire: u32 tag, u32 reserved, u64 payload size, all little-endian. */
+#define COLLECTIVE_HEADER_SIZE 16
+/* Children per node of the reduction tree. */
+#define COLLECTIVE_FANOUT 2
+
+/* A payload queued for the sender thread, going to one or more peers. */
+typedef struct collective_msg {
+    struct collective_msg *next;
+    uint8_t               *data;
+    uint64_t               size;
+    uint32_t               tag;
+    uint32_t               peers[COLLECTIVE_FANOUT];
+    uint32_t               num_peers;
+    int                    owned;          /* free data once sent; otherwise the collective frees it */
+} collective_msg_t;
+
+struct bsq_comm {
+    bsq_transport_t   *transport;
+    uint32_t           rank;
+    uint32_t           world_size;
+    pthread_t          sender;
+    int                sender_started;
+    pthread_mutex_t    lock;
+    pthread_cond_t     work_ready;
+    pthread_cond_t     drained;
+    collective_msg_t  *head;
+    collective_msg_t  *tail;
+    uint32_t           pending;         /* queued or being sent */
+    int                send_failed;
+    int                stopping;
+};
+
+/* Sends run on their own thread so the caller receives and decodes chunk i while chunk i + 1 is in flight. */
+static void *_sender_main(void *arg) {
+    bsq_comm_t *comm = (bsq_comm_t *)arg;
+
+    pthread_mutex_lock(&comm->lock);
+    for (;;) {
+        while (!comm->head && !comm->stopping) pthread_cond_wait(&comm->work_ready, &comm->lock);
+        collective_msg_t *msg = comm->head;
+        if (!msg) break;
+        comm->head = msg->next;
+        if (!comm->head) comm->tail = NULL;
+        const int skip = comm->send_failed;
+        pthread_mutex_unlock(&comm->lock);
+
+        uint8_t header[COLLECTIVE_HEADER_SIZE];
+        bsq_store_le32(header, msg->tag);
+        bsq_store_le32(header + 4, 0);
+        bsq_store_le64(header + 8, msg->size);
+        int failed = skip;
+        for (uint32_t i = 0; i < msg->num_peers && !failed; ++i) {
+            failed = bsq_transport_send(comm->transport, msg->peers[i], header, sizeof(header)) ||
+                     bsq_transport_send(comm->transport, msg->peers[i], msg->data, msg->size);
+        }
+        if (msg->owned) bsq_free_bytes(msg->data);
+        free(msg);
+
+        pthread_mutex_lock(&comm->lock);
+        comm->send_failed |= failed;
+        if (--comm->pending == 0) pthread_cond_broadcast(&comm->drained);
+    }
+    pthread_mutex_unlock(&comm->lock);
+    return NULL;
+}
+
+bsq_comm_t *bsq_comm_create(bsq_transport_kind_t transport,
+                            const char *address,
+                            uint32_t rank,
+                            uint32_t world_size) {
+    if (!address || world_size == 0 || rank >= world_size) return NULL;
+
+    bsq_comm_t *comm = (bsq_comm_t *)calloc(1, sizeof(bsq_comm_t));
+    if (!comm) return NULL;
+    comm->rank = rank;
+    comm->world_size = world_size;
+    pthread_mutex_init(&comm->lock, NULL);
+    pthread_cond_init(&comm->work_ready, NULL);
+    pthread_cond_init(&comm->drained, NULL);
+
+    comm->transport = world_size > 1 ? bsq_transport_open(transport, address, rank, world_size) : NULL;
+    comm->sender_started = (world_size == 1 || comm->transport) &&
+                           pthread_create(&comm->sender, NULL, _sender_main, comm) == 0;
+    if (!comm->sender_started) {
+        bsq_comm_free(comm);
+        return NULL;
+    }
+    return comm;
+}
+
+void bsq_comm_free(bsq_comm_t *comm) {
+    if (!comm) return;
+    if (comm->sender_started) {
+        pthread_mutex_lock(&comm->lock);
+        comm->stopping = 1;
+        pthread_cond_broadcast(&comm->work_ready);
+        pthread_mutex_unlock(&comm->lock);
+        pthread_join(comm->sender, NULL);
+    }
+    bsq_transport_close(comm->transport);
+    pthread_cond_destroy(&comm->drained);
+    pthread_cond_destroy(&comm->work_ready);
+    pthread_mutex_destroy(&comm->lock);
+    free(comm);
+}
+
+uint32_t bsq_comm_rank(const bsq_comm_t *comm) {
+    return comm ? comm->rank : 0;
+}
+
+uint32_t bsq_comm_size(const bsq_comm_t *comm) {
+    return comm ? comm->world_size : 0;
+}
+
+/* Queue data for peers; with owned set the sender frees it (also when queueing fails). */
+static int _post(bsq_comm_t *comm, const uint32_t *peers, uint32_t num_peers, uint32_t tag, uint8_t *data,
+                 uint64_t size, int owned) {
+    collective_msg_t *msg = num_peers > 0 ? (collective_msg_t *)calloc(1, sizeof(collective_msg_t)) : NULL;
+    if (!msg) {
+        if (owned) bsq_free_bytes(data);
+        return num_peers > 0;
+    }
+    msg->data = data;
+    msg->size = size;
+    msg->tag = tag;
+    msg->num_peers = num_peers;
+    memcpy(msg->peers, peers, num_peers * sizeof(uint32_t));
+    msg->owned = owned;
+
+    pthread_mutex_lock(&comm->lock);
+    if (comm->tail) comm->tail->next = msg;
+    else comm->head = msg;
+    comm->tail = msg;
+    comm->pending++;
+    pthread_cond_signal(&comm->work_ready);
+    pthread_mutex_unlock(&comm->lock);
+    return 0;
+}
+
+static int _post_one(bsq_comm_t *comm, uint32_t peer, uint32_t tag, uint8_t *data, uint64_t size, int owned) {
+    return _post(comm, &peer, 1, tag, data, size, owned);
+}
+
+/* Wait until every queued send is out; returns (and clears) whether any of them failed. */
+static int _drain(bsq_comm_t *comm) {
+    pthread_mutex_lock(&comm->lock);
+    while (comm->pending > 0) pthread_cond_wait(&comm->drained, &comm->lock);
+    const int failed = comm->send_failed;
+    comm->send_failed = 0;
+    pthread_mutex_unlock(&comm->lock);
+    return failed;
+}
+
+/* Receive the next message from peer into a fresh aligned buffer; *tag receives its tag. */
+static uint8_t *_recv(bsq_comm_t *comm, uint32_t peer, uint32_t *tag, uint64_t *size) {
+    uint8_t header[COLLECTIVE_HEADER_SIZE];
+    if (bsq_transport_recv(comm->transport, peer, header, sizeof(header))) return NULL;
+    *tag = bsq_load_le32(header);
+    *size = bsq_load_le64(header + 8);
+    uint8_t *data = *size > 0 ? (uint8_t *)bsq_alloc_bytes(*size, COLLECTIVE_ALIGN, BSQ_ALLOC_UNINITIALIZED) : NULL;
+    if (!data || bsq_transport_recv(comm->transport, peer, data, *size)) {
+        bsq_free_bytes(data);
+        return NULL;
+    }
+    return data;
+}
+
+/* _recv for a message whose tag is known in advance. */
+static uint8_t *_recv_tagged(bsq_comm_t *comm, uint32_t peer, uint32_t tag, uint64_t *size) {
+    uint32_t got = 0;
+    uint8_t *data = _recv(comm, peer, &got, size);
+    if (data && got != tag) {
+        bsq_free_bytes(data);
+        return NULL;
+    }
+    return data;
+}
+
+/* ---------------------------------------------------------------------------------------------------------- */
+/* All-reduce                                                                                                 */
+/* ---------------------------------------------------------------------------------------------------------- */
+
+/* count floats of src as a packed buffer ready for bsq_view_from_buffer on the receiving side. */
+static uint8_t *_compress_chunk(const float *src, uint64_t count, bsq_method_t method, uint64_t *size) {
+    const int64_t packed = bsq_compute_packed_size_1d(method, count);
+    if (packed <= 0) return NULL;
+    uint8_t *data = (uint8_t *)bsq_alloc_bytes((size_t)packed, COLLECTIVE_ALIGN, BSQ_ALLOC_UNINITIALIZED);
+    if (!data || bsq_compress_1d_into(src, count, method, data, packed, NULL)) {
+        bsq_free_bytes(data);
+        return NULL;
+    }
+    *size = (uint64_t)packed;
+    return data;
+}
+
+/* Decode a packed chunk of count elements into dst, adding to it when accumulate is set. */
+static int _apply_chunk(const uint8_t *data, uint64_t size, float *dst, uint64_t count, int accumulate) {
+    bsq_view_t view;
+    if (bsq_view_from_buffer(data, (int64_t)size, &view) || view.buf.shape.num_elements != count) return 1;
+    return accumulate ? bsq_accumulate(&view.buf, dst, count, 1.0f) : bsq_decompress(&view.buf, dst, count);
+}
+
+/* Replace dst with the decoded chunk, so the rank that produced it holds what its peers will decode. */
+static int _round_trip(const uint8_t *data, uint64_t size, float *dst, uint64_t count) {
+    return _apply_chunk(data, size, dst, count, 0);
+}
+
+static uint64_t _segment_start(uint64_t n, uint32_t world_size, uint32_t segment) {
+    const uint64_t per = ((n + world_size - 1) / world_size + COLLECTIVE_SEGMENT_ALIGN - 1) /
+                         COLLECTIVE_SEGMENT_ALIGN * COLLECTIVE_SEGMENT_ALIGN;
+    const uint64_t start = per * segment;
+    return start < n ? start : n;
+}
+
+static uint64_t _num_chunks(uint64_t count) {
+    return (count + COLLECTIVE_CHUNK - 1) / COLLECTIVE_CHUNK;
+}
+
+static uint64_t _chunk_count(uint64_t count, uint64_t chunk) {
+    const uint64_t start = chunk * COLLECTIVE_CHUNK;
+    return count - start < COLLECTIVE_CHUNK ? count - start : COLLECTIVE_CHUNK;
+}
+
+/*
+ * Reduce-scatter then all-gather around the ring. In step k of the first phase rank r receives segment
+ * r - k - 1 from its predecessor, adds it to its own values and passes the partial sum on, one chunk at a
+ * time. The segment complete after the last step is encoded once and circulated unchanged.
+ */
+static int _ring_allreduce(bsq_comm_t *comm, float *data, uint64_t n, bsq_method_t method) {
+    const uint32_t w = comm->world_size;
+    const uint32_t r = comm->rank;
+    const uint32_t next = (r + 1) % w;
+    const uint32_t prev = (r + w - 1) % w;
+    int failed = 0;
+
+    const uint64_t own_start = _segment_start(n, w, r);
+    const uint64_t own_count = _segment_start(n, w, r + 1) - own_start;
+    for (uint64_t c = 0; c < _num_chunks(own_count) && !failed; ++c) {
+        uint64_t size = 0;
+        uint8_t *out = _compress_chunk(data + own_start + c * COLLECTIVE_CHUNK, _chunk_count(own_count, c),
+                                       method, &size);
+        failed = !out || _post_one(comm, next, r, out, size, 1);
+    }
+
+    for (uint32_t k = 0; k + 1 < w && !failed; ++k) {
+        const uint32_t segment = (r + 2 * w - k - 1) % w;
+        const uint64_t start = _segment_start(n, w, segment);
+        const uint64_t count = _segment_start(n, w, segment + 1) - start;
+        for (uint64_t c = 0; c < _num_chunks(count) && !failed; ++c) {
+            float *dst = data + start + c * COLLECTIVE_CHUNK;
+            const uint64_t chunk = _chunk_count(count, c);
+            uint64_t size = 0;
+            uint8_t *in = _recv_tagged(comm, prev, segment, &size);
+            failed = !in || _apply_chunk(in, size, dst, chunk, 1);
+            bsq_free_bytes(in);
+            uint8_t *out = failed ? NULL : _compress_chunk(dst, chunk, method, &size);
+            if (!out) {
+                failed = 1;
+            } else if (k + 2 == w && _round_trip(out, size, dst, chunk)) {
+                bsq_free_bytes(out);
+                failed = 1;
+            } else {
+                failed = _post_one(comm, next, segment, out, size, 1);
+            }
+        }
+    }
+
+    for (uint32_t k = 0; k + 1 < w && !failed; ++k) {
+        const uint32_t segment = (r + w - k) % w;
+        const uint64_t start = _segment_start(n, w, segment);
+        const uint64_t count = _segment_start(n, w, segment + 1) - start;
+        for (uint64_t c = 0; c < _num_chunks(count) && !failed; ++c) {
+            uint64_t size = 0;
+            uint8_t *in = _recv_tagged(comm, prev, segment, &size);
+            failed = !in || _apply_chunk(in, size, data + start + c * COLLECTIVE_CHUNK, _chunk_count(count, c), 0);
+            if (failed || k + 2 == w) bsq_free_bytes(in);
+            else failed = _post_one(comm, next, segment, in, size, 1);
+        }
+    }
+    return _drain(comm) || failed;
+}
+
+/* Children of rank in the binary heap tree rooted at rank 0; returns how many there are. */
+static uint32_t _children(uint32_t rank, uint32_t world_size, uint32_t *children) {
+    uint32_t count = 0;
+    for (uint32_t i = 1; i <= COLLECTIVE_FANOUT; ++i) {
+        const uint64_t child = (uint64_t)rank * COLLECTIVE_FANOUT + i;
+        if (child < world_size) children[count++] = (uint32_t)child;
+    }
+    return count;
+}
+
+static uint32_t _parent(uint32_t rank) {
+    return (rank - 1) / COLLECTIVE_FANOUT;
+}
+
+/*
+ * Reduce up the tree, then broadcast down. Each chunk is summed from the children and passed up as soon as it
+ * is complete; the root encodes the final chunk once and every rank forwards those bytes unchanged.
+ */
+static int _tree_allreduce(bsq_comm_t *comm, float *data, uint64_t n, bsq_method_t method) {
+    const uint32_t r = comm->rank;
+    uint32_t children[COLLECTIVE_FANOUT];
+    const uint32_t num_children = _children(r, comm->world_size, children);
+    int failed = 0;
+
+    for (uint64_t c = 0; c < _num_chunks(n) && !failed; ++c) {
+        float *dst = data + c * COLLECTIVE_CHUNK;
+        const uint64_t chunk = _chunk_count(n, c);
+        uint64_t size = 0;
+        for (uint32_t i = 0; i < num_children && !failed; ++i) {
+            uint8_t *in = _recv_tagged(comm, children[i], (uint32_t)c, &size);
+            failed = !in || _apply_chunk(in, size, dst, chunk, 1);
+            bsq_free_bytes(in);
+        }
+        uint8_t *out = failed ? NULL : _compress_chunk(dst, chunk, method, &size);
+        if (!out) {
+            failed = 1;
+        } else if (r != 0) {
+            failed = _post_one(comm, _parent(r), (uint32_t)c, out, size, 1);
+        } else if (_round_trip(out, size, dst, chunk)) {
+            bsq_free_bytes(out);
+            failed = 1;
+        } else {
+            failed = _post(comm, children, num_children, (uint32_t)c, out, size, 1);
+        }
+    }
+
+    for (uint64_t c = 0; c < _num_chunks(n) && r != 0 && !failed; ++c) {
+        uint64_t size = 0;
+        uint8_t *in = _recv_tagged(comm, _parent(r), (uint32_t)c, &size);
+        failed = !in || _apply_chunk(in, size, data + c * COLLECTIVE_CHUNK, _chunk_count(n, c), 0);
+        if (failed) bsq_free_bytes(in);
+        else failed = _post(comm, children, num_children, (uint32_t)c, in, size, 1);
+    }
+    return _drain(comm) || failed;
+}
+
+int bsq_allreduce(bsq_comm_t *comm,
+                  float *data,
+                  uint64_t num_elements,
+                  bsq_method_t method,
+                  bsq_collective_algo_t algo) {
+    if (!comm || !data || num_elements == 0 || method == TOPK || method == TOPK_IM) return 1;
+    if (bsq_compute_packed_size_1d(method, COLLECTIVE_CHUNK) <= 0) return 1;
+    if (comm->world_size == 1) return 0;
+
+    switch (algo) {
+        case BSQ_COLLECTIVE_RING: return _ring_allreduce(comm, data, num_elements, method);
+        case BSQ_COLLECTIVE_TREE: return _tree_allreduce(comm, data, num_elements, method);
+        default:                  return 1;
+    }
+}
+
+/* ---------------------------------------------------------------------------------------------------------- */
+/* All-gather                                                                                                 */
+/* ---------------------------------------------------------------------------------------------------------- */
+
+static uint64_t _num_elements(const bitsqueeze_buffer_t *buf) {
+    return buf->method == TOPK || buf->method == TOPK_IM
+        ? (uint64_t)buf->shape.num_tokens * buf->shape.num_features : buf->shape.num_elements;
+}
+
+/* Decode portable bytes holding n elements into dst; copies them out first on big-endian hosts. */
+static int _decode_portable(const uint8_t *data, uint64_t size, float *dst, uint64_t n) {
+    bsq_view_t view;
+    if (bsq_view_portable(data, (int64_t)size, &view) == 0) {
+        return _num_elements(&view.buf) != n || bsq_decompress(&view.buf, dst, n);
+    }
+    bitsqueeze_buffer_t *loaded = bsq_load_portable(data, (int64_t)size);
+    const int failed = !loaded || _num_elements(loaded) != n || bsq_decompress(loaded, dst, n);
+    bsq_free(loaded);
+    return failed;
+}
+
+/* Each rank passes on what it received from its predecessor until every buffer has gone around the ring. */
+static int _ring_allgather(bsq_comm_t *comm, uint8_t *own, uint64_t own_size, float *dst, uint64_t n) {
+    const uint32_t w = comm->world_size;
+    const uint32_t r = comm->rank;
+    const uint32_t next = (r + 1) % w;
+    const uint32_t prev = (r + w - 1) % w;
+    int failed = _post_one(comm, next, r, own, own_size, 1);
+
+    for (uint32_t k = 0; k + 1 < w && !failed; ++k) {
+        const uint32_t origin = (r + 2 * w - k - 1) % w;
+        uint64_t size = 0;
+        uint8_t *in = _recv_tagged(comm, prev, origin, &size);
+        failed = !in || _decode_portable(in, size, dst + (uint64_t)origin * n, n);
+        if (failed || k + 2 == w) bsq_free_bytes(in);
+        else failed = _post_one(comm, next, origin, in, size, 1);
+    }
+    return _drain(comm) || failed;
+}
+
+/* Whether rank lies in the subtree rooted at root. */
+static int _in_subtree(uint32_t rank, uint32_t root) {
+    while (rank > root) rank = _parent(rank);
+    return rank == root;
+}
+
+static uint32_t _subtree_size(uint32_t root, uint32_t world_size) {
+    uint32_t count = 0;
+    for (uint32_t rank = root; rank < world_size; ++rank) count += (uint32_t)_in_subtree(rank, root);
+    return count;
+}
+
+/* Receive a buffer from peer whose origin satisfies the caller's check, then decode and keep it in blobs. */
+static int _gather_one(bsq_comm_t *comm, uint32_t peer, uint32_t subtree, int inside, uint8_t **blobs,
+                       uint64_t *sizes, float *dst, uint64_t n, uint32_t *origin) {
+    uint64_t size = 0;
+    uint8_t *in = _recv(comm, peer, origin, &size);
+    if (!in) return 1;
+    if (*origin >= comm->world_size || blobs[*origin] || _in_subtree(*origin, subtree) != inside) {
+        bsq_free_bytes(in);
+        return 1;
+    }
+    blobs[*origin] = in;
+    sizes[*origin] = size;
+    return _decode_portable(in, size, dst + (uint64_t)*origin * n, n);
+}
+
+/*
+ * Gather up the tree, then scatter down: a node forwards every buffer of its subtree to its parent as it
+ * arrives, and sends each child every buffer from outside that child's subtree.
+ */
+static int _tree_allgather(bsq_comm_t *comm, uint8_t *own, uint64_t own_size, float *dst, uint64_t n) {
+    const uint32_t w = comm->world_size;
+    const uint32_t r = comm->rank;
+    uint32_t children[COLLECTIVE_FANOUT];
+    const uint32_t num_children = _children(r, w, children);
+    uint8_t **blobs = (uint8_t **)calloc(w, sizeof(uint8_t *));
+    uint64_t *sizes = (uint64_t *)calloc(w, sizeof(uint64_t));
+    int failed = !blobs || !sizes;
+    if (failed) {
+        bsq_free_bytes(own);
+    } else {
+        blobs[r] = own;
+        sizes[r] = own_size;
+    }
+
+    if (!failed && r != 0) failed = _post_one(comm, _parent(r), r, own, own_size, 0);
+    for (uint32_t i = 0; i < num_children && !failed; ++i) {
+        const uint32_t expected = _subtree_size(children[i], w);
+        for (uint32_t j = 0; j < expected && !failed; ++j) {
+            uint32_t origin = 0;
+            failed = _gather_one(comm, children[i], children[i], 1, blobs, sizes, dst, n, &origin) ||
+                     (r != 0 && _post_one(comm, _parent(r), origin, blobs[origin], sizes[origin], 0));
+        }
+    }
+
+    for (uint32_t i = 0; i < num_children && !failed; ++i) {
+        for (uint32_t origin = 0; origin < w && !failed; ++origin) {
+            if (blobs[origin] && !_in_subtree(origin, children[i])) {
+                failed = _post_one(comm, children[i], origin, blobs[origin], sizes[origin], 0);
+            }
+        }
+    }
+    const uint32_t from_parent = r != 0 ? w - _subtree_size(r, w) : 0;
+    for (uint32_t j = 0; j < from_parent && !failed; ++j) {
+        uint32_t origin = 0;
+        failed = _gather_one(comm, _parent(r), r, 0, blobs, sizes, dst, n, &origin) ||
+                 _post(comm, children, num_children, origin, blobs[origin], sizes[origin], 0);
+    }
+
+    failed = _drain(comm) || failed;
+    for (uint32_t i = 0; blobs && i < w; ++i) bsq_free_bytes(blobs[i]);
+    free(blobs);
+    free(sizes);
+    return failed;
+}
+
+int bsq_allgather(bsq_comm_t *comm,
+                  const bitsqueeze_buffer_t *buf,
+                  float *dst,
+                  uint64_t dst_num_elements,
+                  bsq_collective_algo_t algo) {
+    if (!comm || !buf || !buf->payload || !dst) return 1;
+    const uint64_t n = _num_elements(buf);
+    if (n == 0 || dst_num_elements / comm->world_size < n) return 1;
+
+    /* buf may be a view whose arrays are scattered, so it travels in portable form. */
+    const int64_t size = bsq_get_portable_size(buf);
+    uint8_t *own = size > 0 ? (uint8_t *)bsq_alloc_bytes((size_t)size, COLLECTIVE_ALIGN, BSQ_ALLOC_UNINITIALIZED)
+                            : NULL;
+    if (!own || bsq_write_portable(buf, own, size) ||
+        bsq_decompress(buf, dst + (uint64_t)comm->rank * n, n)) {
+        bsq_free_bytes(own);
+        return 1;
+    }
+    if (comm->world_size == 1) {
+        bsq_free_bytes(own);
+        return 0;
+    }
+
+    switch (algo) {
+        case BSQ_COLLECTIVE_RING: return _ring_allgather(comm, own, (uint64_t)size, dst, n);
+        case BSQ_COLLECTIVE_TREE: return _tree_allgather(comm, own, (uint64_t)size, dst, n);
+        default:
+            bsq_free_bytes(own);
+            return 1;
+    }
+}
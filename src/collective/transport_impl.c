@@ -0,0 +1,437 @@
+/* Sockets, shm_open and getaddrinfo need POSIX.1-2008; the library builds with 199309L by default. */
+#ifdef _POSIX_C_SOURCE
+#undef _POSIX_C_SOURCE
+#endif
+#define _POSIX_C_SOURCE 200809L
+
+#include "bitsqueeze.h"
+#include "collective/transport_impl.h"
+#include "serialization/portable_impl.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Spins on a shared-memory ring before yielding the CPU to the peer. */
+#define SHM_SPINS 256
+
+/* One directed ring; head and tail live on their own cache lines since different processes write them. */
+typedef struct {
+    _Alignas(64) atomic_uint_fast64_t head;    /* bytes written, advanced by the sender */
+    _Alignas(64) atomic_uint_fast64_t tail;    /* bytes read, advanced by the receiver */
+    _Alignas(64) uint8_t data[BSQ_SHM_RING_BYTES];
+} shm_ring_t;
+
+/*
+ * Start of the shared object, followed by one presence flag per rank (padded to a ring boundary) and then
+ * world_size * world_size rings indexed sender * world_size + receiver.
+ */
+typedef struct {
+    _Alignas(64) atomic_uint started;    /* set by rank 0 once every rank has claimed its flag */
+} shm_header_t;
+
+struct bsq_transport {
+    bsq_transport_kind_t  kind;
+    uint32_t              rank;
+    uint32_t              world_size;
+    int                  *sockets;        /* TCP: per peer, -1 for self */
+    uint8_t              *shm;            /* SHM: the mapped object */
+    size_t                shm_size;
+    size_t                shm_rings;      /* SHM: offset of the first ring */
+};
+
+static double _now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + 1e-9 * (double)ts.tv_nsec;
+}
+
+static void _sleep_ms(long ms) {
+    struct timespec ts = {ms / 1000, (ms % 1000) * 1000000L};
+    nanosleep(&ts, NULL);
+}
+
+/* ---------------------------------------------------------------------------------------------------------- */
+/* Shared memory                                                                                              */
+/* ---------------------------------------------------------------------------------------------------------- */
+
+static shm_ring_t *_ring(const bsq_transport_t *t, uint32_t sender, uint32_t receiver) {
+    shm_ring_t *rings = (shm_ring_t *)(t->shm + t->shm_rings);
+    return &rings[(uint64_t)sender * t->world_size + receiver];
+}
+
+/* Wait out one empty or full ring poll; fails once the peer has been silent for the timeout. */
+static int _shm_backoff(uint32_t *spins, double *deadline) {
+    if (++*spins < SHM_SPINS) return 0;
+    *spins = 0;
+    if (*deadline == 0.0) *deadline = _now_sec() + BSQ_TRANSPORT_TIMEOUT_SEC;
+    if (_now_sec() > *deadline) return 1;
+    sched_yield();
+    return 0;
+}
+
+static atomic_uint *_shm_present(const bsq_transport_t *t, uint32_t rank) {
+    return (atomic_uint *)(t->shm + sizeof(shm_header_t)) + rank;
+}
+
+/* Map an open object of exactly t->shm_size bytes; 0 on success. */
+static int _shm_map(bsq_transport_t *t, int fd) {
+    void *addr = mmap(NULL, t->shm_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) return 1;
+    t->shm = (uint8_t *)addr;
+    return 0;
+}
+
+static void _shm_unmap(bsq_transport_t *t) {
+    munmap(t->shm, t->shm_size);
+    t->shm = NULL;
+}
+
+/* Non-zero while address still names the object with inode ino. */
+static int _shm_is_current(const char *address, ino_t ino) {
+    const int fd = shm_open(address, O_RDWR, 0600);
+    if (fd < 0) return 0;
+    struct stat st;
+    const int same = fstat(fd, &st) == 0 && st.st_ino == ino;
+    close(fd);
+    return same;
+}
+
+/*
+ * Rank 0 replaces whatever the name refers to (a crashed group can leave an object behind) with a fresh,
+ * zero-filled one and waits for every rank to claim its presence flag in it. Other ranks open the name without
+ * creating it and retry until they hold a flag in rank 0's object: a flag already taken means a stale object,
+ * and so does the name moving to another inode while they wait for the start.
+ */
+static int _shm_create(bsq_transport_t *t, const char *address, double deadline) {
+    shm_unlink(address);
+    const int fd = shm_open(address, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) return 1;
+    const int failed = ftruncate(fd, (off_t)t->shm_size) != 0 || _shm_map(t, fd);
+    close(fd);
+    if (failed) {
+        shm_unlink(address);
+        return 1;
+    }
+
+    atomic_store(_shm_present(t, 0), 1u);
+    for (uint32_t r = 1; r < t->world_size; ++r) {
+        while (atomic_load(_shm_present(t, r)) == 0) {
+            if (_now_sec() > deadline) {
+                shm_unlink(address);
+                return 1;
+            }
+            _sleep_ms(1);
+        }
+    }
+    atomic_store(&((shm_header_t *)t->shm)->started, 1u);
+    /* Every rank has the object mapped; drop the name so nothing outlives the group. */
+    shm_unlink(address);
+    return 0;
+}
+
+static int _shm_join(bsq_transport_t *t, const char *address, double deadline) {
+    while (_now_sec() <= deadline) {
+        const int fd = shm_open(address, O_RDWR, 0600);
+        struct stat st;
+        int mapped = 0;
+        if (fd >= 0) {
+            mapped = fstat(fd, &st) == 0 && (uint64_t)st.st_size == t->shm_size && _shm_map(t, fd) == 0;
+            close(fd);
+        }
+        unsigned int free_flag = 0;
+        if (mapped && atomic_compare_exchange_strong(_shm_present(t, t->rank), &free_flag, 1u)) {
+            shm_header_t *header = (shm_header_t *)t->shm;
+            while (atomic_load(&header->started) == 0 && _now_sec() <= deadline &&
+                   _shm_is_current(address, st.st_ino)) {
+                _sleep_ms(1);
+            }
+            if (atomic_load(&header->started)) return 0;
+        }
+        if (mapped) _shm_unmap(t);
+        _sleep_ms(1);
+    }
+    return 1;
+}
+
+static int _shm_open(bsq_transport_t *t, const char *address) {
+    const size_t flags = (size_t)t->world_size * sizeof(atomic_uint);
+    t->shm_rings = (sizeof(shm_header_t) + flags + 63) / 64 * 64;
+    t->shm_size = t->shm_rings + (size_t)t->world_size * t->world_size * sizeof(shm_ring_t);
+    const double deadline = _now_sec() + BSQ_TRANSPORT_TIMEOUT_SEC;
+    return t->rank == 0 ? _shm_create(t, address, deadline) : _shm_join(t, address, deadline);
+}
+
+static int _shm_send(bsq_transport_t *t, uint32_t peer, const uint8_t *data, uint64_t size) {
+    shm_ring_t *ring = _ring(t, t->rank, peer);
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t spins = 0;
+    double deadline = 0.0;
+    while (size > 0) {
+        const uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        const uint64_t room = BSQ_SHM_RING_BYTES - (head - tail);
+        if (room == 0) {
+            if (_shm_backoff(&spins, &deadline)) return 1;
+            continue;
+        }
+        const uint64_t at = head % BSQ_SHM_RING_BYTES;
+        uint64_t count = size < room ? size : room;
+        if (count > BSQ_SHM_RING_BYTES - at) count = BSQ_SHM_RING_BYTES - at;
+        memcpy(ring->data + at, data, count);
+        head += count;
+        data += count;
+        size -= count;
+        atomic_store_explicit(&ring->head, head, memory_order_release);
+        spins = 0;
+        deadline = 0.0;
+    }
+    return 0;
+}
+
+static int _shm_recv(bsq_transport_t *t, uint32_t peer, uint8_t *data, uint64_t size) {
+    shm_ring_t *ring = _ring(t, peer, t->rank);
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t spins = 0;
+    double deadline = 0.0;
+    while (size > 0) {
+        const uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        const uint64_t ready = head - tail;
+        if (ready == 0) {
+            if (_shm_backoff(&spins, &deadline)) return 1;
+            continue;
+        }
+        const uint64_t at = tail % BSQ_SHM_RING_BYTES;
+        uint64_t count = size < ready ? size : ready;
+        if (count > BSQ_SHM_RING_BYTES - at) count = BSQ_SHM_RING_BYTES - at;
+        memcpy(data, ring->data + at, count);
+        tail += count;
+        data += count;
+        size -= count;
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+        spins = 0;
+        deadline = 0.0;
+    }
+    return 0;
+}
+
+/* ---------------------------------------------------------------------------------------------------------- */
+/* TCP                                                                                                        */
+/* ---------------------------------------------------------------------------------------------------------- */
+
+/* Resolve "host:port" with the port advanced by offset. */
+static struct addrinfo *_resolve(const char *address, uint32_t offset, int passive) {
+    const char *colon = strrchr(address, ':');
+    if (!colon || colon == address || (size_t)(colon - address) >= 256) return NULL;
+    char host[256];
+    memcpy(host, address, (size_t)(colon - address));
+    host[colon - address] = '\0';
+    char *end = NULL;
+    const unsigned long port = strtoul(colon + 1, &end, 10);
+    if (*end != '\0' || port == 0 || port + offset > 65535) return NULL;
+    char service[16];
+    snprintf(service, sizeof(service), "%lu", port + offset);
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = passive ? AI_PASSIVE : 0;
+    struct addrinfo *info = NULL;
+    return getaddrinfo(host, service, &hints, &info) == 0 ? info : NULL;
+}
+
+/* Disable Nagle (chunks are latency-bound) and bound every blocking call by the transport timeout. */
+static void _configure_socket(int fd) {
+    const int one = 1;
+    const struct timeval timeout = {BSQ_TRANSPORT_TIMEOUT_SEC, 0};
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+static int _tcp_send(int fd, const uint8_t *data, uint64_t size) {
+    while (size > 0) {
+        const ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return 1;
+        data += sent;
+        size -= (uint64_t)sent;
+    }
+    return 0;
+}
+
+static int _tcp_recv(int fd, uint8_t *data, uint64_t size) {
+    while (size > 0) {
+        const ssize_t got = recv(fd, data, size, 0);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return 1;
+        data += got;
+        size -= (uint64_t)got;
+    }
+    return 0;
+}
+
+/* Rank r listens on port + r, connects to every lower rank and accepts every higher one. */
+static int _tcp_open(bsq_transport_t *t, const char *address) {
+    t->sockets = (int *)malloc(t->world_size * sizeof(int));
+    if (!t->sockets) return 1;
+    for (uint32_t i = 0; i < t->world_size; ++i) t->sockets[i] = -1;
+
+    struct addrinfo *own = _resolve(address, t->rank, 1);
+    if (!own) return 1;
+    const int one = 1;
+    const int listener = socket(own->ai_family, own->ai_socktype, own->ai_protocol);
+    int failed = listener < 0 || setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0 ||
+                 bind(listener, own->ai_addr, own->ai_addrlen) != 0 || listen(listener, (int)t->world_size) != 0;
+    freeaddrinfo(own);
+
+    const double deadline = _now_sec() + BSQ_TRANSPORT_TIMEOUT_SEC;
+    for (uint32_t peer = 0; peer < t->rank && !failed; ++peer) {
+        struct addrinfo *info = _resolve(address, peer, 0);
+        int fd = -1;
+        /* The peer may not be listening yet. */
+        while (info && fd < 0 && _now_sec() < deadline) {
+            fd = socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+            if (fd >= 0 && connect(fd, info->ai_addr, info->ai_addrlen) != 0) {
+                close(fd);
+                fd = -1;
+                _sleep_ms(10);
+            }
+        }
+        if (info) freeaddrinfo(info);
+        if (fd < 0) {
+            failed = 1;
+            break;
+        }
+        _configure_socket(fd);
+        t->sockets[peer] = fd;
+        uint8_t hello[4];
+        bsq_store_le32(hello, t->rank);
+        failed = _tcp_send(fd, hello, sizeof(hello));
+    }
+
+    for (uint32_t accepted = t->rank + 1; accepted < t->world_size && !failed; ++accepted) {
+        const struct timeval timeout = {BSQ_TRANSPORT_TIMEOUT_SEC, 0};
+        setsockopt(listener, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        const int fd = accept(listener, NULL, NULL);
+        uint8_t hello[4];
+        if (fd < 0) {
+            failed = 1;
+            break;
+        }
+        _configure_socket(fd);
+        const uint32_t peer = _tcp_recv(fd, hello, sizeof(hello)) == 0 ? bsq_load_le32(hello) : 0;
+        if (peer <= t->rank || peer >= t->world_size || t->sockets[peer] >= 0) {
+            close(fd);
+            failed = 1;
+            break;
+        }
+        t->sockets[peer] = fd;
+    }
+    if (listener >= 0) close(listener);
+    return failed;
+}
+
+bsq_transport_t *bsq_transport_open(bsq_transport_kind_t kind,
+                                    const char *address,
+                                    uint32_t rank,
+                                    uint32_t world_size) {
+    if (!address || world_size == 0 || rank >= world_size) return NULL;
+    bsq_transport_t *t = (bsq_transport_t *)calloc(1, sizeof(bsq_transport_t));
+    if (!t) return NULL;
+    t->kind = kind;
+    t->rank = rank;
+    t->world_size = world_size;
+
+    int failed;
+    switch (kind) {
+        case BSQ_TRANSPORT_SHM: failed = _shm_open(t, address); break;
+        case BSQ_TRANSPORT_TCP: failed = _tcp_open(t, address); break;
+        default:                failed = 1; break;
+    }
+    if (failed) {
+        bsq_transport_close(t);
+        return NULL;
+    }
+    return t;
+}
+
+void bsq_transport_close(bsq_transport_t *t) {
+    if (!t) return;
+    if (t->sockets) {
+        for (uint32_t i = 0; i < t->world_size; ++i) {
+            if (t->sockets[i] >= 0) close(t->sockets[i]);
+        }
+        free(t->sockets);
+    }
+    if (t->shm) munmap(t->shm, t->shm_size);
+    free(t);
+}
+
+int bsq_transport_send(bsq_transport_t *t, uint32_t peer, const void *data, uint64_t size) {
+    if (!t || peer >= t->world_size || peer == t->rank) return 1;
+    switch (t->kind) {
+        case BSQ_TRANSPORT_SHM: return _shm_send(t, peer, (const uint8_t *)data, size);
+        case BSQ_TRANSPORT_TCP: return _tcp_send(t->sockets[peer], (const uint8_t *)data, size);
+        default:                return 1;
+    }
+}
+
+int bsq_transport_recv(bsq_transport_t *t, uint32_t peer, void *data, uint64_t size) {
+    if (!t || peer >= t->world_size || peer == t->rank) return 1;
+    switch (t->kind) {
+        case BSQ_TRANSPORT_SHM: return _shm_recv(t, peer, (uint8_t *)data, size);
+        case BSQ_TRANSPORT_TCP: return _tcp_recv(t->sockets[peer], (uint8_t *)data, size);
+        default:                return 1;
+    }
+}
+
+#else
+
+bsq_transport_t *bsq_transport_open(bsq_transport_kind_t kind,
+                                    const char *address,
+                                    uint32_t rank,
+                                    uint32_t world_size) {
+    (void)kind;
+    (void)address;
+    (void)rank;
+    (void)world_size;
+    return NULL;
+}
+
+void bsq_transport_close(bsq_transport_t *transport) {
+    (void)transport;
+}
+
+int bsq_transport_send(bsq_transport_t *transport, uint32_t peer, const void *data, uint64_t size) {
+    (void)transport;
+    (void)peer;
+    (void)data;
+    (void)size;
+    return 1;
+}
+
+int bsq_transport_recv(bsq_transport_t *transport, uint32_t peer, void *data, uint64_t size) {
+    (void)transport;
+    (void)peer;
+    (void)data;
+    (void)size;
+    return 1;
+}
+
+#endif
@@ -0,0 +1,146 @@
+#if defined(__linux__)
+#define _GNU_SOURCE
+#include <sched.h>
+#endif
+
+#include "bitsqueeze.h"
+#include "bitsqueeze_internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__) && defined(_OPENMP)
+#include <omp.h>
+#endif
+
+/* Slots are padded to a cache line so threads never share one. */
+#define SCRATCH_ALIGN 64
+
+struct bsq_ctx {
+    int       num_threads;      /* 0: leave the OpenMP setting alone */
+    int      *cpus;
+    uint32_t  num_cpus;
+    int       affinity_pending;
+    void    **slots;            /* num_slots pointers into arena */
+    uint32_t  num_slots;
+    size_t    slot_size;
+    void     *arena;
+};
+
+static int _team_size(void) {
+#if defined(__linux__) && defined(_OPENMP)
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+static void _apply_affinity(const bsq_ctx_t *ctx) {
+#if defined(__linux__) && defined(_OPENMP)
+    #pragma omp parallel
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(ctx->cpus[(uint32_t)omp_get_thread_num() % ctx->num_cpus], &set);
+        sched_setaffinity(0, sizeof(set), &set);
+    }
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(ctx->cpus[0], &set);
+    sched_setaffinity(0, sizeof(set), &set);
+#else
+    (void)ctx;
+#endif
+}
+
+bsq_ctx_t *bsq_ctx_create(int num_threads) {
+    if (num_threads < 0) return NULL;
+    bsq_ctx_t *ctx = (bsq_ctx_t *)calloc(1, sizeof(bsq_ctx_t));
+    if (!ctx) return NULL;
+    ctx->num_threads = num_threads;
+    return ctx;
+}
+
+void bsq_ctx_free(bsq_ctx_t *ctx) {
+    if (!ctx) return;
+    free(ctx->cpus);
+    free(ctx->slots);
+    free(ctx->arena);
+    free(ctx);
+}
+
+int bsq_ctx_set_affinity(bsq_ctx_t *ctx, const int *cpus, uint32_t num_cpus) {
+#if defined(__linux__)
+    if (!ctx || !cpus || num_cpus == 0) return 1;
+    for (uint32_t i = 0; i < num_cpus; ++i) {
+        if (cpus[i] < 0 || cpus[i] >= CPU_SETSIZE) return 1;
+    }
+    int *copy = (int *)malloc(num_cpus * sizeof(int));
+    if (!copy) return 1;
+    memcpy(copy, cpus, num_cpus * sizeof(int));
+    free(ctx->cpus);
+    ctx->cpus = copy;
+    ctx->num_cpus = num_cpus;
+    ctx->affinity_pending = 1;
+    return 0;
+#else
+    (void)ctx;
+    (void)cpus;
+    (void)num_cpus;
+    return 1;
+#endif
+}
+
+uint64_t bsq_ctx_scratch_bytes(const bsq_ctx_t *ctx) {
+    if (!ctx) return 0;
+    return (uint64_t)ctx->num_slots * ctx->slot_size;
+}
+
+int bsq_ctx_enter(bsq_ctx_t *ctx) {
+    const int saved = _team_size();
+#if defined(__linux__) && defined(_OPENMP)
+    if (ctx->num_threads > 0) omp_set_num_threads(ctx->num_threads);
+#endif
+    if (ctx->affinity_pending) {
+        _apply_affinity(ctx);
+        ctx->affinity_pending = 0;
+    }
+    return saved;
+}
+
+void bsq_ctx_leave(bsq_ctx_t *ctx, int saved) {
+#if defined(__linux__) && defined(_OPENMP)
+    if (ctx->num_threads > 0) omp_set_num_threads(saved);
+#else
+    (void)ctx;
+    (void)saved;
+#endif
+}
+
+void *const *bsq_ctx_thread_scratch(bsq_ctx_t *ctx, size_t size) {
+    const uint32_t team = (uint32_t)_team_size();
+    if (team <= ctx->num_slots && size <= ctx->slot_size) return ctx->slots;
+
+    /* Grow to cover both the old and the new request so alternating shapes settle on one arena. */
+    const uint32_t num_slots = team > ctx->num_slots ? team : ctx->num_slots;
+    size_t slot_size = size > ctx->slot_size ? size : ctx->slot_size;
+    slot_size = (slot_size + SCRATCH_ALIGN - 1) / SCRATCH_ALIGN * SCRATCH_ALIGN;
+
+    void **slots = (void **)malloc(num_slots * sizeof(void *));
+    uint8_t *arena = (uint8_t *)malloc((size_t)num_slots * slot_size);
+    if (!slots || !arena) {
+        free(slots);
+        free(arena);
+        return NULL;
+    }
+    for (uint32_t i = 0; i < num_slots; ++i) slots[i] = arena + (size_t)i * slot_size;
+
+    free(ctx->slots);
+    free(ctx->arena);
+    ctx->slots = slots;
+    ctx->arena = arena;
+    ctx->num_slots = num_slots;
+    ctx->slot_size = slot_size;
+    return ctx->slots;
+}
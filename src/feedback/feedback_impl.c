@@ -0,0 +1,147 @@
+#include "bitsqueeze.h"
+#include "bitsqueeze_internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/alloc.h"
+
+/* Alignment of the residual and the packed buffer. */
+#define FEEDBACK_ALIGN 64
+/* Elements per fused step: a multiple of every granule, small enough that a step's residual stays in L2. */
+#define FEEDBACK_CHUNK 4096
+
+struct bsq_feedback {
+    bitsqueeze_buffer_t *buf;
+    float               *residual;
+    uint64_t             num_elements;
+    uint64_t             row_elements;    /* elements per slicing row: num_features for TOPK/TOPK_IM, else 1 */
+    uint64_t             num_rows;
+};
+
+static int _is_sparse(bsq_method_t method) {
+    return method == TOPK || method == TOPK_IM;
+}
+
+static bsq_feedback_t *_create(bsq_method_t method, const bsq_shape_t *shape, int64_t size) {
+    if (size <= 0) return NULL;
+
+    bsq_feedback_t *fb = (bsq_feedback_t *)calloc(1, sizeof(bsq_feedback_t));
+    if (!fb) return NULL;
+    if (_is_sparse(method)) {
+        fb->row_elements = shape->num_features;
+        fb->num_rows = shape->num_tokens;
+    } else {
+        fb->row_elements = 1;
+        fb->num_rows = shape->num_elements;
+    }
+    fb->num_elements = fb->row_elements * fb->num_rows;
+
+    void *mem = bsq_alloc_bytes((size_t)size, FEEDBACK_ALIGN, BSQ_ALLOC_UNINITIALIZED);
+    fb->residual = (float *)bsq_alloc_bytes(fb->num_elements * sizeof(float), FEEDBACK_ALIGN, 0);
+    fb->buf = mem ? bsq_prepare_buffer(method, shape, mem, size) : NULL;
+    if (!fb->buf || !fb->residual) {
+        if (!fb->buf) bsq_free_bytes(mem);
+        bsq_feedback_free(fb);
+        return NULL;
+    }
+    return fb;
+}
+
+bsq_feedback_t *bsq_feedback_create_1d(bsq_method_t method, uint64_t num_elements) {
+    if (num_elements == 0 || _is_sparse(method)) return NULL;
+
+    bsq_shape_t shape;
+    memset(&shape, 0, sizeof(shape));
+    shape.num_elements = num_elements;
+    return _create(method, &shape, bsq_compute_packed_size_1d(method, num_elements));
+}
+
+bsq_feedback_t *bsq_feedback_create_2d(bsq_method_t method,
+                                       uint16_t num_tokens,
+                                       uint16_t num_features,
+                                       float sparse_ratio) {
+    if (num_tokens == 0 || num_features == 0 || !_is_sparse(method)) return NULL;
+
+    bsq_shape_t shape;
+    memset(&shape, 0, sizeof(shape));
+    shape.num_tokens = num_tokens;
+    shape.num_features = num_features;
+    shape.sparse_ratio = sparse_ratio;
+    return _create(method, &shape,
+                   bsq_compute_packed_size_2d(method, num_tokens, num_features, sparse_ratio));
+}
+
+void bsq_feedback_free(bsq_feedback_t *fb) {
+    if (!fb) return;
+    bsq_free_bytes(fb->buf);
+    bsq_free_bytes(fb->residual);
+    free(fb);
+}
+
+void bsq_feedback_reset(bsq_feedback_t *fb) {
+    if (fb) memset(fb->residual, 0, fb->num_elements * sizeof(float));
+}
+
+const float *bsq_feedback_residual(const bsq_feedback_t *fb) {
+    return fb ? fb->residual : NULL;
+}
+
+/* Tensor-scale formats need every corrected element before any block can be encoded: three passes. */
+static int _compress_whole(bsq_feedback_t *fb, const float *grad, const float *im) {
+    float *residual = fb->residual;
+
+#if defined(__linux__) && defined(_OPENMP)
+#pragma omp parallel for
+#endif
+    for (uint64_t i = 0; i < fb->num_elements; ++i) residual[i] += grad[i];
+
+    if (bsq_compress_payload(fb->buf, residual, im)) return 1;
+    return bsq_accumulate(fb->buf, residual, fb->num_elements, -1.0f);
+}
+
+int bsq_feedback_compress(bsq_feedback_t *fb,
+                          const float *grad,
+                          const float *im,
+                          const bitsqueeze_buffer_t **out) {
+    if (!fb || !grad || !out) return 1;
+    if (fb->buf->method == TOPK_IM && !im) return 1;
+
+    *out = NULL;
+    if (bsq_payload_has_tensor_scale(fb->buf->method)) {
+        if (_compress_whole(fb, grad, im)) return 1;
+        *out = fb->buf;
+        return 0;
+    }
+
+    bsq_prepare_codec_tables(fb->buf->method);
+
+    /* Each step corrects, encodes and subtracts back one slice while it is in cache, so the residual is read
+     * and written once per call and the decoded tensor never exists. */
+    const uint64_t rows_per_chunk = fb->row_elements < FEEDBACK_CHUNK ? FEEDBACK_CHUNK / fb->row_elements : 1;
+    const uint64_t num_chunks = (fb->num_rows + rows_per_chunk - 1) / rows_per_chunk;
+    float *residual = fb->residual;
+    int failed = 0;
+
+#if defined(__linux__) && defined(_OPENMP)
+#pragma omp parallel for reduction(|:failed)
+#endif
+    for (uint64_t c = 0; c < num_chunks; ++c) {
+        const uint64_t first = c * rows_per_chunk;
+        const uint64_t rows = fb->num_rows - first < rows_per_chunk ? fb->num_rows - first : rows_per_chunk;
+        const uint64_t offset = first * fb->row_elements;
+        const uint64_t count = rows * fb->row_elements;
+        float *e = residual + offset;
+        for (uint64_t i = 0; i < count; ++i) e[i] += grad[offset + i];
+
+        bsq_view_t slice;
+        if (bsq_slice_payload_rows(fb->buf, fb->row_elements, first, rows, &slice) ||
+            bsq_compress_payload_serial(&slice.buf, e, im ? im + offset : NULL) ||
+            bsq_accumulate_serial(&slice.buf, e, count, -1.0f)) {
+            failed = 1;
+        }
+    }
+    if (failed) return 1;
+    *out = fb->buf;
+    return 0;
+}
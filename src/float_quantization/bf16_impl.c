@@ -1,25 +1,39 @@
 #include "float_quantization/bf16_impl.h"
+#include "utils/alloc.h"
 
 static int64_t _get_bf16_array_size(const bf16_array_t *bf16_array) {
     if (!bf16_array) return 0;
     return (int64_t)(sizeof(bf16_array_t) + bf16_array->num_elements * sizeof(uint16_t));
 }
 
-bf16_array_t *allocate_bf16_array(uint64_t num_elements) {
-    if (!num_elements) return NULL;
+int64_t compute_bf16_array_size(uint64_t num_elements) {
+    if (!num_elements) return 0;
 
-    size_t total = sizeof(bf16_array_t) + num_elements * sizeof(uint16_t);
-    bf16_array_t *arr = (bf16_array_t *)calloc(1, total);
-    if (!arr) return NULL;
+    return sizeof(bf16_array_t)
+         + num_elements * sizeof(uint16_t);
+}
 
+bf16_array_t *init_bf16_array(void *buffer, uint64_t num_elements) {
+    if (!buffer || !num_elements) return NULL;
+
+    bf16_array_t *arr = (bf16_array_t *)buffer;
     arr->num_elements = num_elements;
-    arr->data = (uint16_t *)(arr + 1);
+    arr->data         = (uint16_t *)(arr + 1);
     return arr;
 }
 
+bf16_array_t *allocate_bf16_array(uint64_t num_elements) {
+    const int64_t total = compute_bf16_array_size(num_elements);
+    if (total <= 0) return NULL;
+
+    void *buffer = bsq_alloc_bytes((size_t)total, 0, 0);
+    if (!buffer) return NULL;
+    return init_bf16_array(buffer, num_elements);
+}
+
 void free_bf16_array(bf16_array_t *bf16_array) {
     if (!bf16_array) return;
-    free(bf16_array);
+    bsq_free_bytes(bf16_array);
 }
 
 int64_t get_bf16_array_size(const bf16_array_t *bf16_array) {
@@ -29,13 +43,13 @@ int64_t get_bf16_array_size(const bf16_array_t *bf16_array) {
 bf16_array_t *load_bf16_array_from_buffer(const void *buffer, int64_t buffer_size) {
     if (!buffer || buffer_size < (int64_t)sizeof(bf16_array_t)) return NULL;
 
-    bf16_array_t *arr = (bf16_array_t *)calloc(1, buffer_size);
+    bf16_array_t *arr = (bf16_array_t *)bsq_alloc_bytes((size_t)buffer_size, 0, BSQ_ALLOC_UNINITIALIZED);
     if (!arr) return NULL;
 
     memcpy(arr, buffer, buffer_size);
     const int64_t expected = _get_bf16_array_size(arr);
     if (expected == 0 || buffer_size < expected) {
-        free(arr);
+        bsq_free_bytes(arr);
         return NULL;
     }
 
@@ -43,6 +57,43 @@ bf16_array_t *load_bf16_array_from_buffer(const void *buffer, int64_t buffer_siz
     return arr;
 }
 
+/* Convert element i of float_array into arr. */
+static void _compress_step(const float *float_array, bf16_array_t *arr, uint64_t i) {
+    arr->data[i] = bf16_from_fp32_value(float_array[i]);
+}
+
+static int _compress_into(const float *float_array, bf16_array_t *arr, int parallel) {
+    if (!float_array || !arr) return 1;
+
+    const uint64_t num_elements = arr->num_elements;
+
+#if defined(__linux__) && defined(_OPENMP)
+    if (parallel) {
+#pragma omp parallel for
+        for (uint64_t i = 0; i < num_elements; ++i) {
+            _compress_step(float_array, arr, i);
+        }
+        return 0;
+    }
+#else
+    (void)parallel;
+#endif
+    for (uint64_t i = 0; i < num_elements; ++i) {
+        _compress_step(float_array, arr, i);
+    }
+    return 0;
+}
+
+int bf16_compress_into(const float *float_array,
+                       bf16_array_t *arr) {
+    return _compress_into(float_array, arr, 1);
+}
+
+int bf16_compress_into_serial(const float *float_array,
+                              bf16_array_t *arr) {
+    return _compress_into(float_array, arr, 0);
+}
+
 int bf16_compress(const float *float_array,
                   uint64_t num_elements,
                   bf16_array_t **bf16_array) {
@@ -51,26 +102,60 @@ int bf16_compress(const float *float_array,
     bf16_array_t *arr = allocate_bf16_array(num_elements);
     if (!arr) return 1;
 
-#if defined(__linux__) && defined(_OPENMP)
-#pragma omp parallel for
-#endif
-    for (uint64_t i = 0; i < num_elements; ++i) {
-        arr->data[i] = bf16_from_fp32_value(float_array[i]);
+    if (bf16_compress_into(float_array, arr)) {
+        free_bf16_array(arr);
+        return 1;
     }
 
     *bf16_array = arr;
     return 0;
 }
 
-int bf16_decompress(const bf16_array_t *bf16_array,
-                    float *float_array) {
+/* Decode element i into float_array, indexed from offset. */
+static void _decode_range_step(const bf16_array_t *bf16_array, uint64_t i, uint64_t offset, float *float_array) {
+    float_array[i - offset] = fp32_from_bf16_value(bf16_array->data[i]);
+}
+
+static int _decompress_range(const bf16_array_t *bf16_array, uint64_t offset, uint64_t count, float *float_array,
+                             int parallel) {
     if (!bf16_array || !float_array) return 1;
+    if (offset > bf16_array->num_elements || count > bf16_array->num_elements - offset) return 1;
+
+    const uint64_t end = offset + count;
 
 #if defined(__linux__) && defined(_OPENMP)
+    if (parallel) {
 #pragma omp parallel for
+        for (uint64_t i = offset; i < end; ++i) {
+            _decode_range_step(bf16_array, i, offset, float_array);
+        }
+        return 0;
+    }
+#else
+    (void)parallel;
 #endif
-    for (uint64_t i = 0; i < bf16_array->num_elements; ++i) {
-        float_array[i] = fp32_from_bf16_value(bf16_array->data[i]);
+    for (uint64_t i = offset; i < end; ++i) {
+        _decode_range_step(bf16_array, i, offset, float_array);
     }
     return 0;
 }
+
+int bf16_decompress_range(const bf16_array_t *bf16_array,
+                          uint64_t offset,
+                          uint64_t count,
+                          float *float_array) {
+    return _decompress_range(bf16_array, offset, count, float_array, 1);
+}
+
+int bf16_decompress_range_serial(const bf16_array_t *bf16_array,
+                                 uint64_t offset,
+                                 uint64_t count,
+                                 float *float_array) {
+    return _decompress_range(bf16_array, offset, count, float_array, 0);
+}
+
+int bf16_decompress(const bf16_array_t *bf16_array,
+                    float *float_array) {
+    if (!bf16_array) return 1;
+    return bf16_decompress_range(bf16_array, 0, bf16_array->num_elements, float_array);
+}
@@ -1,25 +1,39 @@
 #include "float_quantization/fp16_impl.h"
+#include "utils/alloc.h"
 
 static int64_t _get_fp16_array_size(const fp16_array_t *fp16_array) {
     if (!fp16_array) return 0;
     return (int64_t)(sizeof(fp16_array_t) + fp16_array->num_elements * sizeof(uint16_t));
 }
 
-fp16_array_t *allocate_fp16_array(uint64_t num_elements) {
-    if (!num_elements) return NULL;
+int64_t compute_fp16_array_size(uint64_t num_elements) {
+    if (!num_elements) return 0;
 
-    size_t total = sizeof(fp16_array_t) + num_elements * sizeof(uint16_t);
-    fp16_array_t *arr = (fp16_array_t *)calloc(1, total);
-    if (!arr) return NULL;
+    return sizeof(fp16_array_t)
+         + num_elements * sizeof(uint16_t);
+}
 
+fp16_array_t *init_fp16_array(void *buffer, uint64_t num_elements) {
+    if (!buffer || !num_elements) return NULL;
+
+    fp16_array_t *arr = (fp16_array_t *)buffer;
     arr->num_elements = num_elements;
-    arr->data = (uint16_t *)(arr + 1);
+    arr->data         = (uint16_t *)(arr + 1);
     return arr;
 }
 
+fp16_array_t *allocate_fp16_array(uint64_t num_elements) {
+    const int64_t total = compute_fp16_array_size(num_elements);
+    if (total <= 0) return NULL;
+
+    void *buffer = bsq_alloc_bytes((size_t)total, 0, 0);
+    if (!buffer) return NULL;
+    return init_fp16_array(buffer, num_elements);
+}
+
 void free_fp16_array(fp16_array_t *fp16_array) {
     if (!fp16_array) return;
-    free(fp16_array);
+    bsq_free_bytes(fp16_array);
 }
 
 int64_t get_fp16_array_size(const fp16_array_t *fp16_array) {
@@ -29,13 +43,13 @@ int64_t get_fp16_array_size(const fp16_array_t *fp16_array) {
 fp16_array_t *load_fp16_array_from_buffer(const void *buffer, int64_t buffer_size) {
     if (!buffer || buffer_size < (int64_t)sizeof(fp16_array_t)) return NULL;
 
-    fp16_array_t *arr = (fp16_array_t *)calloc(1, buffer_size);
+    fp16_array_t *arr = (fp16_array_t *)bsq_alloc_bytes((size_t)buffer_size, 0, BSQ_ALLOC_UNINITIALIZED);
     if (!arr) return NULL;
 
     memcpy(arr, buffer, buffer_size);
     const int64_t expected = _get_fp16_array_size(arr);
     if (expected == 0 || buffer_size < expected) {
-        free(arr);
+        bsq_free_bytes(arr);
         return NULL;
     }
 
@@ -43,6 +57,43 @@ fp16_array_t *load_fp16_array_from_buffer(const void *buffer, int64_t buffer_siz
     return arr;
 }
 
+/* Convert element i of float_array into arr. */
+static void _compress_step(const float *float_array, fp16_array_t *arr, uint64_t i) {
+    arr->data[i] = fp16_ieee_from_fp32_value(float_array[i]);
+}
+
+static int _compress_into(const float *float_array, fp16_array_t *arr, int parallel) {
+    if (!float_array || !arr) return 1;
+
+    const uint64_t num_elements = arr->num_elements;
+
+#if defined(__linux__) && defined(_OPENMP)
+    if (parallel) {
+#pragma omp parallel for
+        for (uint64_t i = 0; i < num_elements; ++i) {
+            _compress_step(float_array, arr, i);
+        }
+        return 0;
+    }
+#else
+    (void)parallel;
+#endif
+    for (uint64_t i = 0; i < num_elements; ++i) {
+        _compress_step(float_array, arr, i);
+    }
+    return 0;
+}
+
+int fp16_compress_into(const float *float_array,
+                       fp16_array_t *arr) {
+    return _compress_into(float_array, arr, 1);
+}
+
+int fp16_compress_into_serial(const float *float_array,
+                              fp16_array_t *arr) {
+    return _compress_into(float_array, arr, 0);
+}
+
 int fp16_compress(const float *float_array,
                   uint64_t num_elements,
                   fp16_array_t **fp16_array) {
@@ -51,26 +102,60 @@ int fp16_compress(const float *float_array,
     fp16_array_t *arr = allocate_fp16_array(num_elements);
     if (!arr) return 1;
 
-#if defined(__linux__) && defined(_OPENMP)
-#pragma omp parallel for
-#endif
-    for (uint64_t i = 0; i < num_elements; ++i) {
-        arr->data[i] = fp16_ieee_from_fp32_value(float_array[i]);
+    if (fp16_compress_into(float_array, arr)) {
+        free_fp16_array(arr);
+        return 1;
     }
 
     *fp16_array = arr;
     return 0;
 }
 
-int fp16_decompress(const fp16_array_t *fp16_array,
-                    float *float_array) {
+/* Decode element i into float_array, indexed from offset. */
+static void _decode_range_step(const fp16_array_t *fp16_array, uint64_t i, uint64_t offset, float *float_array) {
+    float_array[i - offset] = fp16_ieee_to_fp32_value(fp16_array->data[i]);
+}
+
+static int _decompress_range(const fp16_array_t *fp16_array, uint64_t offset, uint64_t count, float *float_array,
+                             int parallel) {
     if (!fp16_array || !float_array) return 1;
+    if (offset > fp16_array->num_elements || count > fp16_array->num_elements - offset) return 1;
+
+    const uint64_t end = offset + count;
 
 #if defined(__linux__) && defined(_OPENMP)
+    if (parallel) {
 #pragma omp parallel for
+        for (uint64_t i = offset; i < end; ++i) {
+            _decode_range_step(fp16_array, i, offset, float_array);
+        }
+        return 0;
+    }
+#else
+    (void)parallel;
 #endif
-    for (uint64_t i = 0; i < fp16_array->num_elements; ++i) {
-        float_array[i] = fp16_ieee_to_fp32_value(fp16_array->data[i]);
+    for (uint64_t i = offset; i < end; ++i) {
+        _decode_range_step(fp16_array, i, offset, float_array);
     }
     return 0;
 }
+
+int fp16_decompress_range(const fp16_array_t *fp16_array,
+                          uint64_t offset,
+                          uint64_t count,
+                          float *float_array) {
+    return _decompress_range(fp16_array, offset, count, float_array, 1);
+}
+
+int fp16_decompress_range_serial(const fp16_array_t *fp16_array,
+                                 uint64_t offset,
+                                 uint64_t count,
+                                 float *float_array) {
+    return _decompress_range(fp16_array, offset, count, float_array, 0);
+}
+
+int fp16_decompress(const fp16_array_t *fp16_array,
+                    float *float_array) {
+    if (!fp16_array) return 1;
+    return fp16_decompress_range(fp16_array, 0, fp16_array->num_elements, float_array);
+}
@@ -1,4 +1,5 @@
 #include "float_quantization/fp4_impl.h"
+#include "utils/alloc.h"
 
 #define FP4_EXPONENT_BIAS 1
 #define FP4_EXP_BITS      2
@@ -11,24 +12,37 @@ static int64_t _get_fp4_array_size(const fp4_array_t *fp4_array) {
          + packed_elems * sizeof(uint8_t);
 }
 
-fp4_array_t *allocate_fp4_array(uint64_t num_elements) {
-    if (!num_elements) return NULL;
+int64_t compute_fp4_array_size(uint64_t num_elements) {
+    if (!num_elements) return 0;
 
     uint64_t packed_elems = (num_elements + 1) / 2;
-    size_t total = sizeof(fp4_array_t) + packed_elems * sizeof(uint8_t);
+    return sizeof(fp4_array_t)
+         + packed_elems * sizeof(uint8_t);
+}
 
-    fp4_array_t *arr = (fp4_array_t *)calloc(1, total);
-    if (!arr) return NULL;
+fp4_array_t *init_fp4_array(void *buffer,
+                            uint64_t num_elements) {
+    if (!buffer || !num_elements) return NULL;
 
+    fp4_array_t *arr = (fp4_array_t *)buffer;
     arr->num_elements = num_elements;
     arr->data         = (uint8_t *)(arr + 1);
     arr->scale        = 1.0f;
     return arr;
 }
 
+fp4_array_t *allocate_fp4_array(uint64_t num_elements) {
+    const int64_t total = compute_fp4_array_size(num_elements);
+    if (total <= 0) return NULL;
+
+    void *buffer = bsq_alloc_bytes((size_t)total, 0, 0);
+    if (!buffer) return NULL;
+    return init_fp4_array(buffer, num_elements);
+}
+
 void free_fp4_array(fp4_array_t *fp4_array) {
     if (!fp4_array) return;
-    free(fp4_array);
+    bsq_free_bytes(fp4_array);
 }
 
 int64_t get_fp4_array_size(const fp4_array_t *fp4_array) {
@@ -38,13 +52,13 @@ int64_t get_fp4_array_size(const fp4_array_t *fp4_array) {
 fp4_array_t *load_fp4_array_from_buffer(const void *buffer, int64_t buffer_size) {
     if (!buffer || buffer_size < (int64_t)sizeof(fp4_array_t)) return NULL;
 
-    fp4_array_t *arr = (fp4_array_t *)calloc(1, buffer_size);
+    fp4_array_t *arr = (fp4_array_t *)bsq_alloc_bytes((size_t)buffer_size, 0, BSQ_ALLOC_UNINITIALIZED);
     if (!arr) return NULL;
 
     memcpy(arr, buffer, buffer_size);
     const int64_t expected = _get_fp4_array_size(arr);
     if (expected == 0 || buffer_size < expected) {
-        free(arr);
+        bsq_free_bytes(arr);
         return NULL;
     }
 
@@ -120,57 +134,144 @@ static float choose_scale(const float *arr, uint64_t n) {
         float av = fabsf(v);
         if (av > abs_max) abs_max = av;
     }
+    return fp4_scale_for_absmax(abs_max);
+}
+
+float fp4_scale_for_absmax(float abs_max) {
     if (abs_max == 0.0f) return 1.0f;
     return abs_max / FP4_MAX_NORM_VALUE;
 }
 
-int fp4_compress(const float *float_array,
-                 uint64_t num_elements,
-                 fp4_array_t **fp4_array) {
-    if (!float_array || num_elements == 0 || !fp4_array || *fp4_array) return 1;
+int fp4_compress_into(const float *float_array,
+                      fp4_array_t *arr) {
+    if (!float_array || !arr) return 1;
+    return fp4_compress_into_scaled(float_array, choose_scale(float_array, arr->num_elements), arr);
+}
 
-    fp4_array_t *arr = allocate_fp4_array(num_elements);
-    if (!arr) return 1;
+int fp4_compress_into_serial(const float *float_array,
+                             fp4_array_t *arr) {
+    if (!float_array || !arr) return 1;
+    return fp4_compress_into_scaled_serial(float_array, choose_scale(float_array, arr->num_elements), arr);
+}
+
+/* Encode the two elements packed in byte packed_idx of arr, pre-multiplied by inv_scale. */
+static void _compress_step(const float *float_array, fp4_array_t *arr, float inv_scale, uint64_t packed_idx) {
+    const uint64_t num_elements = arr->num_elements;
+
+    const uint64_t i = packed_idx * 2;
+    uint8_t hi = fp32_to_e2m1(float_array[i] * inv_scale) & 0xF;
+    uint8_t lo = (i + 1 < num_elements) ? (fp32_to_e2m1(float_array[i + 1] * inv_scale) & 0xF) : 0;
+    arr->data[packed_idx] = (uint8_t)((hi << 4) | lo);
+}
+
+static int _compress_into_scaled(const float *float_array, float scale, fp4_array_t *arr, int parallel) {
+    if (!float_array || !arr) return 1;
+
+    const uint64_t num_elements = arr->num_elements;
+    const uint64_t packed_elems = (num_elements + 1) / 2;
 
-    float scale = choose_scale(float_array, num_elements);
     if (scale == 0.0f) scale = 1.0f;
     arr->scale = scale;
     float inv_scale = 1.0f / scale;
 
+    /* One byte per iteration so both nibbles are written by the same thread. */
 #if defined(__linux__) && defined(_OPENMP)
+    if (parallel) {
 #pragma omp parallel for
-#endif
-    for (uint64_t i = 0; i < num_elements; ++i) {
-        float v = float_array[i] * inv_scale;
-        uint8_t code = fp32_to_e2m1(v) & 0xF;
-        const uint64_t packed_idx = i / 2;
-        if ((i % 2) == 0) {
-            arr->data[packed_idx] = (uint8_t)(code << 4);
-        } else {
-            arr->data[packed_idx] |= code;
+        for (uint64_t packed_idx = 0; packed_idx < packed_elems; ++packed_idx) {
+            _compress_step(float_array, arr, inv_scale, packed_idx);
         }
+        return 0;
+    }
+#else
+    (void)parallel;
+#endif
+    for (uint64_t packed_idx = 0; packed_idx < packed_elems; ++packed_idx) {
+        _compress_step(float_array, arr, inv_scale, packed_idx);
+    }
+    return 0;
+}
+
+int fp4_compress_into_scaled(const float *float_array,
+                             float scale,
+                             fp4_array_t *arr) {
+    return _compress_into_scaled(float_array, scale, arr, 1);
+}
+
+int fp4_compress_into_scaled_serial(const float *float_array,
+                                    float scale,
+                                    fp4_array_t *arr) {
+    return _compress_into_scaled(float_array, scale, arr, 0);
+}
+
+int fp4_compress(const float *float_array,
+                 uint64_t num_elements,
+                 fp4_array_t **fp4_array) {
+    if (!float_array || num_elements == 0 || !fp4_array || *fp4_array) return 1;
+
+    fp4_array_t *arr = allocate_fp4_array(num_elements);
+    if (!arr) return 1;
+
+    if (fp4_compress_into(float_array, arr)) {
+        free_fp4_array(arr);
+        return 1;
     }
 
     *fp4_array = arr;
     return 0;
 }
 
-int fp4_decompress(const fp4_array_t *fp4_array,
-                   float *float_array) {
-    if (!fp4_array || !float_array) return 1;
-
+/* Decode element i into float_array, indexed from offset. */
+static void _decode_range_step(const fp4_array_t *fp4_array, uint64_t i, uint64_t offset, float *float_array) {
     const float scale = fp4_array->scale;
     const uint8_t *src = fp4_array->data;
 
+    uint8_t packed = src[i / 2];
+    uint8_t code = (i % 2 == 0) ? (packed >> 4) : (packed & 0xF);
+    float v = e2m1_to_fp32(code);
+    float_array[i - offset] = scale * v;
+}
+
+static int _decompress_range(const fp4_array_t *fp4_array, uint64_t offset, uint64_t count, float *float_array,
+                             int parallel) {
+    if (!fp4_array || !float_array) return 1;
+    if (offset > fp4_array->num_elements || count > fp4_array->num_elements - offset) return 1;
+
+    const uint64_t end = offset + count;
+
 #if defined(__linux__) && defined(_OPENMP)
+    if (parallel) {
 #pragma omp parallel for
+        for (uint64_t i = offset; i < end; ++i) {
+            _decode_range_step(fp4_array, i, offset, float_array);
+        }
+        return 0;
+    }
+#else
+    (void)parallel;
 #endif
-    for (uint64_t i = 0; i < fp4_array->num_elements; ++i) {
-        const uint64_t packed_idx = i / 2;
-        uint8_t packed = src[packed_idx];
-        uint8_t code = (i % 2 == 0) ? (packed >> 4) : (packed & 0xF);
-        float v = e2m1_to_fp32(code);
-        float_array[i] = scale * v;
+    for (uint64_t i = offset; i < end; ++i) {
+        _decode_range_step(fp4_array, i, offset, float_array);
     }
     return 0;
 }
+
+int fp4_decompress_range(const fp4_array_t *fp4_array,
+                         uint64_t offset,
+                         uint64_t count,
+                         float *float_array) {
+    return _decompress_range(fp4_array, offset, count, float_array, 1);
+}
+
+int fp4_decompress_range_serial(const fp4_array_t *fp4_array,
+                                uint64_t offset,
+                                uint64_t count,
+                                float *float_array) {
+    return _decompress_range(fp4_array, offset, count, float_array, 0);
+}
+
+int fp4_decompress(const fp4_array_t *fp4_array,
+                   float *float_array) {
+    if (!fp4_array) return 1;
+    return fp4_decompress_range(fp4_array, 0, fp4_array->num_elements, float_array);
+}
@@ -1,4 +1,5 @@
 #include "float_quantization/fp8_impl.h"
+#include "utils/alloc.h"
 
 #define FP8_EXPONENT_BIAS 7
 #define FP8_EXP_BITS      4
@@ -10,22 +11,36 @@ static int64_t _get_fp8_array_size(const fp8_array_t *fp8_array) {
          + fp8_array->num_elements * sizeof(uint8_t);
 }
 
-fp8_array_t *allocate_fp8_array(uint64_t num_elements) {
-    if (!num_elements) return NULL;
+int64_t compute_fp8_array_size(uint64_t num_elements) {
+    if (!num_elements) return 0;
 
-    size_t total = sizeof(fp8_array_t) + num_elements * sizeof(uint8_t);
-    fp8_array_t *arr = (fp8_array_t *)calloc(1, total);
-    if (!arr) return NULL;
+    return sizeof(fp8_array_t)
+         + num_elements * sizeof(uint8_t);
+}
 
+fp8_array_t *init_fp8_array(void *buffer,
+                            uint64_t num_elements) {
+    if (!buffer || !num_elements) return NULL;
+
+    fp8_array_t *arr = (fp8_array_t *)buffer;
     arr->num_elements = num_elements;
-    arr->data = (uint8_t *)(arr + 1);
-    arr->scale = 1.0f;
+    arr->data         = (uint8_t *)(arr + 1);
+    arr->scale        = 1.0f;
     return arr;
 }
 
+fp8_array_t *allocate_fp8_array(uint64_t num_elements) {
+    const int64_t total = compute_fp8_array_size(num_elements);
+    if (total <= 0) return NULL;
+
+    void *buffer = bsq_alloc_bytes((size_t)total, 0, 0);
+    if (!buffer) return NULL;
+    return init_fp8_array(buffer, num_elements);
+}
+
 void free_fp8_array(fp8_array_t *fp8_array) {
     if (!fp8_array) return;
-    free(fp8_array);
+    bsq_free_bytes(fp8_array);
 }
 
 int64_t get_fp8_array_size(const fp8_array_t *fp8_array) {
@@ -35,13 +50,13 @@ int64_t get_fp8_array_size(const fp8_array_t *fp8_array) {
 fp8_array_t *load_fp8_array_from_buffer(const void *buffer, int64_t buffer_size) {
     if (!buffer || buffer_size < (int64_t)sizeof(fp8_array_t)) return NULL;
 
-    fp8_array_t *arr = (fp8_array_t *)calloc(1, buffer_size);
+    fp8_array_t *arr = (fp8_array_t *)bsq_alloc_bytes((size_t)buffer_size, 0, BSQ_ALLOC_UNINITIALIZED);
     if (!arr) return NULL;
 
     memcpy(arr, buffer, buffer_size);
     const int64_t expected = _get_fp8_array_size(arr);
     if (expected == 0 || buffer_size < expected) {
-        free(arr);
+        bsq_free_bytes(arr);
         return NULL;
     }
 
@@ -80,7 +95,7 @@ static uint8_t fp32_to_e4m3(float x) {
     return (uint8_t)((sign << 7) | ((exponent_field & 0xF) << 3) | (mant_field & 0x7));
 }
 
-static float e4m3_to_fp32(uint8_t v) {
+float fp8_e4m3_to_fp32(uint8_t v) {
     const int sign = (v >> 7) & 0x1;
     const int exponent_field = (v >> 3) & 0xF;
     const int mant_field = v & 0x7;
@@ -105,46 +120,135 @@ static float choose_scale(const float *arr, uint64_t n) {
         float av = fabsf(v);
         if (av > abs_max) abs_max = av;
     }
+    return fp8_scale_for_absmax(abs_max);
+}
+
+float fp8_scale_for_absmax(float abs_max) {
     if (abs_max == 0.0f) return 1.0f;
     return abs_max / FP8_MAX_NORM_VALUE;
 }
 
-int fp8_compress(const float *float_array,
-                 uint64_t num_elements,
-                 fp8_array_t **fp8_array) {
-    if (!float_array || num_elements == 0 || !fp8_array || *fp8_array) return 1;
+int fp8_compress_into(const float *float_array,
+                      fp8_array_t *arr) {
+    if (!float_array || !arr) return 1;
+    return fp8_compress_into_scaled(float_array, choose_scale(float_array, arr->num_elements), arr);
+}
 
-    fp8_array_t *arr = allocate_fp8_array(num_elements);
-    if (!arr) return 1;
+int fp8_compress_into_serial(const float *float_array,
+                             fp8_array_t *arr) {
+    if (!float_array || !arr) return 1;
+    return fp8_compress_into_scaled_serial(float_array, choose_scale(float_array, arr->num_elements), arr);
+}
+
+/* Encode element i of float_array into arr, pre-multiplied by inv_scale. */
+static void _compress_step(const float *float_array, fp8_array_t *arr, float inv_scale, uint64_t i) {
+    float v = float_array[i] * inv_scale;
+    arr->data[i] = fp32_to_e4m3(v);
+}
+
+static int _compress_into_scaled(const float *float_array, float scale, fp8_array_t *arr, int parallel) {
+    if (!float_array || !arr) return 1;
+
+    const uint64_t num_elements = arr->num_elements;
 
-    float scale = choose_scale(float_array, num_elements);
     if (scale == 0.0f) scale = 1.0f;
     arr->scale = scale;
     float inv_scale = 1.0f / scale;
 
 #if defined(__linux__) && defined(_OPENMP)
+    if (parallel) {
 #pragma omp parallel for
+        for (uint64_t i = 0; i < num_elements; ++i) {
+            _compress_step(float_array, arr, inv_scale, i);
+        }
+        return 0;
+    }
+#else
+    (void)parallel;
 #endif
     for (uint64_t i = 0; i < num_elements; ++i) {
-        float v = float_array[i] * inv_scale;
-        arr->data[i] = fp32_to_e4m3(v);
+        _compress_step(float_array, arr, inv_scale, i);
+    }
+    return 0;
+}
+
+int fp8_compress_into_scaled(const float *float_array,
+                             float scale,
+                             fp8_array_t *arr) {
+    return _compress_into_scaled(float_array, scale, arr, 1);
+}
+
+int fp8_compress_into_scaled_serial(const float *float_array,
+                                    float scale,
+                                    fp8_array_t *arr) {
+    return _compress_into_scaled(float_array, scale, arr, 0);
+}
+
+int fp8_compress(const float *float_array,
+                 uint64_t num_elements,
+                 fp8_array_t **fp8_array) {
+    if (!float_array || num_elements == 0 || !fp8_array || *fp8_array) return 1;
+
+    fp8_array_t *arr = allocate_fp8_array(num_elements);
+    if (!arr) return 1;
+
+    if (fp8_compress_into(float_array, arr)) {
+        free_fp8_array(arr);
+        return 1;
     }
 
     *fp8_array = arr;
     return 0;
 }
 
-int fp8_decompress(const fp8_array_t *fp8_array,
-                   float *float_array) {
+/* Decode element i into float_array, indexed from offset. */
+static void _decode_range_step(const fp8_array_t *fp8_array, uint64_t i, uint64_t offset, float *float_array) {
+    const float scale = fp8_array->scale;
+
+    float v = fp8_e4m3_to_fp32(fp8_array->data[i]);
+    float_array[i - offset] = scale * v;
+}
+
+static int _decompress_range(const fp8_array_t *fp8_array, uint64_t offset, uint64_t count, float *float_array,
+                             int parallel) {
     if (!fp8_array || !float_array) return 1;
+    if (offset > fp8_array->num_elements || count > fp8_array->num_elements - offset) return 1;
+
+    const uint64_t end = offset + count;
 
-    const float scale = fp8_array->scale;
 #if defined(__linux__) && defined(_OPENMP)
+    if (parallel) {
 #pragma omp parallel for
+        for (uint64_t i = offset; i < end; ++i) {
+            _decode_range_step(fp8_array, i, offset, float_array);
+        }
+        return 0;
+    }
+#else
+    (void)parallel;
 #endif
-    for (uint64_t i = 0; i < fp8_array->num_elements; ++i) {
-        float v = e4m3_to_fp32(fp8_array->data[i]);
-        float_array[i] = scale * v;
+    for (uint64_t i = offset; i < end; ++i) {
+        _decode_range_step(fp8_array, i, offset, float_array);
     }
     return 0;
 }
+
+int fp8_decompress_range(const fp8_array_t *fp8_array,
+                         uint64_t offset,
+                         uint64_t count,
+                         float *float_array) {
+    return _decompress_range(fp8_array, offset, count, float_array, 1);
+}
+
+int fp8_decompress_range_serial(const fp8_array_t *fp8_array,
+                                uint64_t offset,
+                                uint64_t count,
+                                float *float_array) {
+    return _decompress_range(fp8_array, offset, count, float_array, 0);
+}
+
+int fp8_decompress(const fp8_array_t *fp8_array,
+                   float *float_array) {
+    if (!fp8_array) return 1;
+    return fp8_decompress_range(fp8_array, 0, fp8_array->num_elements, float_array);
+}
@@ -1,4 +1,6 @@
 #include "float_quantization/mxfp4_impl.h"
+#include "utils/alloc.h"
+#include "utils/dot.h"
 
 #define FP4_EXPONENT_BIAS 1
 #define FP4_EXP_BITS      2
@@ -12,30 +14,44 @@ static int64_t _get_mxfp4_array_size(const mxfp4_array_t *mxfp4_array) {
          + packed_elems * sizeof(uint8_t);
 }
 
-mxfp4_array_t *allocate_mxfp4_array(uint64_t num_elements,
-                                    uint64_t block_size) {
-    if (!num_elements || !block_size) return NULL;
+int64_t compute_mxfp4_array_size(uint64_t num_elements,
+                                 uint64_t block_size) {
+    if (!num_elements || !block_size) return 0;
 
     uint64_t num_blocks = (num_elements + block_size - 1) / block_size;
     uint64_t packed_elems = (num_elements + 1) / 2;
-    size_t total = sizeof(mxfp4_array_t)
-                 + num_blocks * sizeof(int8_t)
-                 + packed_elems * sizeof(uint8_t);
+    return sizeof(mxfp4_array_t)
+         + num_blocks * sizeof(int8_t)
+         + packed_elems * sizeof(uint8_t);
+}
 
-    mxfp4_array_t *arr = (mxfp4_array_t *)calloc(1, total);
-    if (!arr) return NULL;
+mxfp4_array_t *init_mxfp4_array(void *buffer,
+                                uint64_t num_elements,
+                                uint64_t block_size) {
+    if (!buffer || !num_elements || !block_size) return NULL;
 
+    mxfp4_array_t *arr = (mxfp4_array_t *)buffer;
     arr->num_elements = num_elements;
-    arr->num_blocks   = num_blocks;
+    arr->num_blocks   = (num_elements + block_size - 1) / block_size;
     arr->block_size   = block_size;
     arr->scales       = (int8_t *)(arr + 1);
-    arr->data         = (uint8_t *)(arr->scales + num_blocks);
+    arr->data         = (uint8_t *)(arr->scales + arr->num_blocks);
     return arr;
 }
 
+mxfp4_array_t *allocate_mxfp4_array(uint64_t num_elements,
+                                    uint64_t block_size) {
+    const int64_t total = compute_mxfp4_array_size(num_elements, block_size);
+    if (total <= 0) return NULL;
+
+    void *buffer = bsq_alloc_bytes((size_t)total, 0, 0);
+    if (!buffer) return NULL;
+    return init_mxfp4_array(buffer, num_elements, block_size);
+}
+
 void free_mxfp4_array(mxfp4_array_t *mxfp4_array) {
     if (!mxfp4_array) return;
-    free(mxfp4_array);
+    bsq_free_bytes(mxfp4_array);
 }
 
 int64_t get_mxfp4_array_size(const mxfp4_array_t *mxfp4_array) {
@@ -45,13 +61,13 @@ int64_t get_mxfp4_array_size(const mxfp4_array_t *mxfp4_array) {
 mxfp4_array_t *load_mxfp4_array_from_buffer(const void *buffer, int64_t buffer_size) {
     if (!buffer || buffer_size < (int64_t)sizeof(mxfp4_array_t)) return NULL;
 
-    mxfp4_array_t *arr = (mxfp4_array_t *)calloc(1, buffer_size);
+    mxfp4_array_t *arr = (mxfp4_array_t *)bsq_alloc_bytes((size_t)buffer_size, 0, BSQ_ALLOC_UNINITIALIZED);
     if (!arr) return NULL;
 
     memcpy(arr, buffer, buffer_size);
     const int64_t expected = _get_mxfp4_array_size(arr);
     if (expected == 0 || buffer_size < expected) {
-        free(arr);
+        bsq_free_bytes(arr);
         return NULL;
     }
 
@@ -136,49 +152,72 @@ static int8_t choose_scale_exponent(float abs_max) {
     return (int8_t)ceilf(log2f(target));
 }
 
-static int _quantize_mxfp4(const float *float_array, mxfp4_array_t *arr) {
-    if (!float_array || !arr) return 1;
+void mxfp4_quantize_block(const float *float_array, uint64_t count, int8_t *scale_exp_out, uint8_t *packed) {
+    float abs_max = 0.0f;
+    for (uint64_t i = 0; i < count; ++i) {
+        float v = float_array[i];
+        if (!isfinite(v)) v = 0.0f;
+        float av = fabsf(v);
+        if (av > abs_max) abs_max = av;
+    }
 
+    int8_t scale_exp = choose_scale_exponent(abs_max);
+    *scale_exp_out = scale_exp;
+    float inv_scale = ldexpf(1.0f, -scale_exp);
+
+    for (uint64_t i = 0; i < count; ++i) {
+        float v = float_array[i] * inv_scale;
+        uint8_t code = fp32_to_e2m1(v) & 0xF;
+        if ((i % 2) == 0) {
+            packed[i / 2] = (uint8_t)(code << 4);
+        } else {
+            packed[i / 2] |= code;
+        }
+    }
+}
+
+/* Quantize block b of float_array into arr. */
+static void _compress_step(const float *float_array, mxfp4_array_t *arr, uint64_t b) {
     const uint64_t block_size   = arr->block_size;
-    const uint64_t num_blocks   = arr->num_blocks;
     const uint64_t num_elements = arr->num_elements;
-    uint8_t *dst = arr->data;
+
+    const uint64_t start = b * block_size;
+    const uint64_t remain = (start + block_size <= num_elements)
+                              ? block_size
+                              : (num_elements - start);
+    mxfp4_quantize_block(float_array + start, remain, &arr->scales[b], arr->data + start / 2);
+}
+
+static int _compress_into(const float *float_array, mxfp4_array_t *arr, int parallel) {
+    if (!float_array || !arr) return 1;
+
+    const uint64_t num_blocks = arr->num_blocks;
 
 #if defined(__linux__) && defined(_OPENMP)
+    if (parallel) {
 #pragma omp parallel for
+        for (uint64_t b = 0; b < num_blocks; ++b) {
+            _compress_step(float_array, arr, b);
+        }
+        return 0;
+    }
+#else
+    (void)parallel;
 #endif
     for (uint64_t b = 0; b < num_blocks; ++b) {
-        const uint64_t start = b * block_size;
-        const uint64_t remain = (start + block_size <= num_elements)
-                                  ? block_size
-                                  : (num_elements - start);
-
-        float abs_max = 0.0f;
-        for (uint64_t i = 0; i < remain; ++i) {
-            float v = float_array[start + i];
-            if (!isfinite(v)) v = 0.0f;
-            float av = fabsf(v);
-            if (av > abs_max) abs_max = av;
-        }
-
-        int8_t scale_exp = choose_scale_exponent(abs_max);
-        arr->scales[b] = scale_exp;
-        float inv_scale = ldexpf(1.0f, -scale_exp);
-
-        for (uint64_t i = 0; i < remain; ++i) {
-            float v = float_array[start + i] * inv_scale;
-            uint8_t code = fp32_to_e2m1(v) & 0xF;
-            const uint64_t packed_idx = (start + i) / 2;
-            if (((start + i) % 2) == 0) {
-                dst[packed_idx] = (uint8_t)(code << 4);
-            } else {
-                dst[packed_idx] |= code;
-            }
-        }
+        _compress_step(float_array, arr, b);
     }
     return 0;
 }
 
+int mxfp4_compress_into(const float *float_array, mxfp4_array_t *arr) {
+    return _compress_into(float_array, arr, 1);
+}
+
+int mxfp4_compress_into_serial(const float *float_array, mxfp4_array_t *arr) {
+    return _compress_into(float_array, arr, 0);
+}
+
 int mxfp4_compress(const float *float_array,
                    uint64_t num_elements,
                    mxfp4_array_t **mxfp4_array) {
@@ -187,7 +226,7 @@ int mxfp4_compress(const float *float_array,
     mxfp4_array_t *arr = allocate_mxfp4_array(num_elements, DEFAULT_MXFP4_BLOCK_SIZE);
     if (!arr) return 1;
 
-    if (_quantize_mxfp4(float_array, arr)) {
+    if (mxfp4_compress_into(float_array, arr)) {
         free_mxfp4_array(arr);
         return 1;
     }
@@ -196,32 +235,105 @@ int mxfp4_compress(const float *float_array,
     return 0;
 }
 
+/* Decode the share of block b in [offset, end) into float_array, indexed from offset. */
+static void _decode_range_step(const mxfp4_array_t *mxfp4_array, uint64_t b, uint64_t offset, uint64_t end,
+                               float *float_array) {
+    const uint64_t block_size = mxfp4_array->block_size;
+    const uint8_t *src = mxfp4_array->data;
+    const uint64_t start = (b * block_size > offset) ? b * block_size : offset;
+    const uint64_t stop  = ((b + 1) * block_size < end) ? (b + 1) * block_size : end;
+    float scale = ldexpf(1.0f, mxfp4_array->scales[b]);
+
+    for (uint64_t i = start; i < stop; ++i) {
+        uint8_t packed = src[i / 2];
+        uint8_t code = (i % 2 == 0) ? (packed >> 4) : (packed & 0xF);
+        float val = e2m1_to_fp32(code);
+        float_array[i - offset] = scale * val;
+    }
+}
+
+static int _decompress_range(const mxfp4_array_t *mxfp4_array, uint64_t offset, uint64_t count, float *float_array,
+                             int parallel) {
+    if (!mxfp4_array || !float_array) return 1;
+    if (offset > mxfp4_array->num_elements || count > mxfp4_array->num_elements - offset) return 1;
+    if (count == 0) return 0;
+
+    const uint64_t block_size  = mxfp4_array->block_size;
+    const uint64_t end         = offset + count;
+    const uint64_t first_block = offset / block_size;
+    const uint64_t last_block  = (end - 1) / block_size;
+
+#if defined(__linux__) && defined(_OPENMP)
+    if (parallel) {
+#pragma omp parallel for
+        for (uint64_t b = first_block; b <= last_block; ++b) {
+            _decode_range_step(mxfp4_array, b, offset, end, float_array);
+        }
+        return 0;
+    }
+#else
+    (void)parallel;
+#endif
+    for (uint64_t b = first_block; b <= last_block; ++b) {
+        _decode_range_step(mxfp4_array, b, offset, end, float_array);
+    }
+    return 0;
+}
+
+int mxfp4_decompress_range(const mxfp4_array_t *mxfp4_array,
+                           uint64_t offset,
+                           uint64_t count,
+                           float *float_array) {
+    return _decompress_range(mxfp4_array, offset, count, float_array, 1);
+}
+
+int mxfp4_decompress_range_serial(const mxfp4_array_t *mxfp4_array,
+                                  uint64_t offset,
+                                  uint64_t count,
+                                  float *float_array) {
+    return _decompress_range(mxfp4_array, offset, count, float_array, 0);
+}
+
 int mxfp4_decompress(const mxfp4_array_t *mxfp4_array,
                      float *float_array) {
-    if (!mxfp4_array || !float_array) return 1;
+    if (!mxfp4_array) return 1;
+    return mxfp4_decompress_range(mxfp4_array, 0, mxfp4_array->num_elements, float_array);
+}
 
-    const uint64_t block_size   = mxfp4_array->block_size;
-    const uint64_t num_blocks   = mxfp4_array->num_blocks;
-    const uint64_t num_elements = mxfp4_array->num_elements;
-    const uint8_t *src = mxfp4_array->data;
+int mxfp4_gemv(const mxfp4_array_t *mxfp4_array,
+               uint64_t rows,
+               uint64_t cols,
+               const float *x,
+               float *y) {
+    if (!mxfp4_array || !x || !y) return 1;
+    const uint64_t block_size = mxfp4_array->block_size;
+    if (block_size == 0 || block_size % 2 != 0 || block_size > BSQ_DOT_PANEL || cols % block_size != 0 ||
+        rows * cols != mxfp4_array->num_elements) {
+        return 1;
+    }
+    const uint64_t blocks_per_row = cols / block_size;
+    float levels[16];
+    float block_levels[256];
+    for (uint8_t code = 0; code < 16; ++code) levels[code] = e2m1_to_fp32(code);
+    for (int exponent = -128; exponent < 128; ++exponent) block_levels[(uint8_t)exponent] = ldexpf(1.0f, exponent);
 
 #if defined(__linux__) && defined(_OPENMP)
 #pragma omp parallel for
 #endif
-    for (uint64_t b = 0; b < num_blocks; ++b) {
-        const uint64_t start = b * block_size;
-        const uint64_t remain = (start + block_size <= num_elements)
-                                  ? block_size
-                                  : (num_elements - start);
-        float scale = ldexpf(1.0f, mxfp4_array->scales[b]);
-
-        for (uint64_t i = 0; i < remain; ++i) {
-            const uint64_t packed_idx = (start + i) / 2;
-            uint8_t packed = src[packed_idx];
-            uint8_t code = ((start + i) % 2 == 0) ? (packed >> 4) : (packed & 0xF);
-            float val = e2m1_to_fp32(code);
-            float_array[start + i] = scale * val;
+    for (uint64_t r = 0; r < rows; ++r) {
+        const uint8_t *q = mxfp4_array->data + r * cols / 2;
+        const int8_t *scales = mxfp4_array->scales + r * blocks_per_row;
+        float w[BSQ_DOT_PANEL];
+        float acc = 0.0f;
+        for (uint64_t b = 0; b < blocks_per_row; ++b) {
+            const uint8_t *qb = q + b * block_size / 2;
+            for (uint64_t j = 0; j < block_size / 2; ++j) {
+                w[2 * j]     = levels[qb[j] >> 4];
+                w[2 * j + 1] = levels[qb[j] & 0xF];
+            }
+            acc += block_levels[(uint8_t)scales[b]] * bsq_dot_f32(w, x + b * block_size, block_size);
         }
+        y[r] = acc;
     }
     return 0;
 }
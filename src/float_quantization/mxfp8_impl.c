@@ -1,4 +1,5 @@
 #include "float_quantization/mxfp8_impl.h"
+#include "utils/alloc.h"
 
 /* FP8 E4M3 parameters */
 #define FP8_EXPONENT_BIAS 7
@@ -12,29 +13,43 @@ static int64_t _get_mxfp8_array_size(const mxfp8_array_t *mxfp8_array) {
          + mxfp8_array->num_elements * sizeof(uint8_t);
 }
 
-mxfp8_array_t *allocate_mxfp8_array(uint64_t num_elements,
-                                    uint64_t block_size) {
-    if (!num_elements || !block_size) return NULL;
+int64_t compute_mxfp8_array_size(uint64_t num_elements,
+                                 uint64_t block_size) {
+    if (!num_elements || !block_size) return 0;
 
     uint64_t num_blocks = (num_elements + block_size - 1) / block_size;
-    size_t total = sizeof(mxfp8_array_t)
-                 + num_blocks * sizeof(int8_t)
-                 + num_elements * sizeof(uint8_t);
+    return sizeof(mxfp8_array_t)
+         + num_blocks * sizeof(int8_t)
+         + num_elements * sizeof(uint8_t);
+}
 
-    mxfp8_array_t *arr = (mxfp8_array_t *)calloc(1, total);
-    if (!arr) return NULL;
+mxfp8_array_t *init_mxfp8_array(void *buffer,
+                                uint64_t num_elements,
+                                uint64_t block_size) {
+    if (!buffer || !num_elements || !block_size) return NULL;
 
+    mxfp8_array_t *arr = (mxfp8_array_t *)buffer;
     arr->num_elements = num_elements;
-    arr->num_blocks   = num_blocks;
+    arr->num_blocks   = (num_elements + block_size - 1) / block_size;
     arr->block_size   = block_size;
     arr->scales       = (int8_t *)(arr + 1);
-    arr->data         = (uint8_t *)(arr->scales + num_blocks);
+    arr->data         = (uint8_t *)(arr->scales + arr->num_blocks);
     return arr;
 }
 
+mxfp8_array_t *allocate_mxfp8_array(uint64_t num_elements,
+                                    uint64_t block_size) {
+    const int64_t total = compute_mxfp8_array_size(num_elements, block_size);
+    if (total <= 0) return NULL;
+
+    void *buffer = bsq_alloc_bytes((size_t)total, 0, 0);
+    if (!buffer) return NULL;
+    return init_mxfp8_array(buffer, num_elements, block_size);
+}
+
 void free_mxfp8_array(mxfp8_array_t *mxfp8_array) {
     if (!mxfp8_array) return;
-    free(mxfp8_array);
+    bsq_free_bytes(mxfp8_array);
 }
 
 int64_t get_mxfp8_array_size(const mxfp8_array_t *mxfp8_array) {
@@ -44,13 +59,13 @@ int64_t get_mxfp8_array_size(const mxfp8_array_t *mxfp8_array) {
 mxfp8_array_t *load_mxfp8_array_from_buffer(const void *buffer, int64_t buffer_size) {
     if (!buffer || buffer_size < (int64_t)sizeof(mxfp8_array_t)) return NULL;
 
-    mxfp8_array_t *arr = (mxfp8_array_t *)calloc(1, buffer_size);
+    mxfp8_array_t *arr = (mxfp8_array_t *)bsq_alloc_bytes((size_t)buffer_size, 0, BSQ_ALLOC_UNINITIALIZED);
     if (!arr) return NULL;
 
     memcpy(arr, buffer, buffer_size);
     const int64_t expected = _get_mxfp8_array_size(arr);
     if (expected == 0 || buffer_size < expected) {
-        free(arr);
+        bsq_free_bytes(arr);
         return NULL;
     }
 
@@ -120,42 +135,64 @@ static int8_t choose_scale_exponent(float abs_max) {
     return exp2;
 }
 
-static int _quantize_mxfp8(const float *float_array, mxfp8_array_t *arr) {
-    if (!float_array || !arr) return 1;
-
+/* Quantize block b of float_array into arr. */
+static void _compress_step(const float *float_array, mxfp8_array_t *arr, uint64_t b) {
     const uint64_t block_size   = arr->block_size;
-    const uint64_t num_blocks   = arr->num_blocks;
     const uint64_t num_elements = arr->num_elements;
 
+    const uint64_t start = b * block_size;
+    const uint64_t remain = (start + block_size <= num_elements)
+                              ? block_size
+                              : (num_elements - start);
+
+    float abs_max = 0.0f;
+    for (uint64_t i = 0; i < remain; ++i) {
+        float v = float_array[start + i];
+        if (!isfinite(v)) v = 0.0f;
+        float av = fabsf(v);
+        if (av > abs_max) abs_max = av;
+    }
+
+    int8_t scale_exp = choose_scale_exponent(abs_max);
+    arr->scales[b] = scale_exp;
+    float scale = ldexpf(1.0f, scale_exp);
+
+    for (uint64_t i = 0; i < remain; ++i) {
+        float v = float_array[start + i] / scale;
+        arr->data[start + i] = fp32_to_e4m3(v);
+    }
+}
+
+static int _compress_into(const float *float_array, mxfp8_array_t *arr, int parallel) {
+    if (!float_array || !arr) return 1;
+
+    const uint64_t num_blocks = arr->num_blocks;
+
 #if defined(__linux__) && defined(_OPENMP)
+    if (parallel) {
 #pragma omp parallel for
+        for (uint64_t b = 0; b < num_blocks; ++b) {
+            _compress_step(float_array, arr, b);
+        }
+        return 0;
+    }
+#else
+    (void)parallel;
 #endif
     for (uint64_t b = 0; b < num_blocks; ++b) {
-        const uint64_t start = b * block_size;
-        const uint64_t remain = (start + block_size <= num_elements)
-                                  ? block_size
-                                  : (num_elements - start);
-
-        float abs_max = 0.0f;
-        for (uint64_t i = 0; i < remain; ++i) {
-            float v = float_array[start + i];
-            if (!isfinite(v)) v = 0.0f;
-            float av = fabsf(v);
-            if (av > abs_max) abs_max = av;
-        }
-
-        int8_t scale_exp = choose_scale_exponent(abs_max);
-        arr->scales[b] = scale_exp;
-        float scale = ldexpf(1.0f, scale_exp);
-
-        for (uint64_t i = 0; i < remain; ++i) {
-            float v = float_array[start + i] / scale;
-            arr->data[start + i] = fp32_to_e4m3(v);
-        }
+        _compress_step(float_array, arr, b);
     }
     return 0;
 }
 
+int mxfp8_compress_into(const float *float_array, mxfp8_array_t *arr) {
+    return _compress_into(float_array, arr, 1);
+}
+
+int mxfp8_compress_into_serial(const float *float_array, mxfp8_array_t *arr) {
+    return _compress_into(float_array, arr, 0);
+}
+
 int mxfp8_compress(const float *float_array,
                    uint64_t num_elements,
                    mxfp8_array_t **mxfp8_array) {
@@ -164,7 +201,7 @@ int mxfp8_compress(const float *float_array,
     mxfp8_array_t *arr = allocate_mxfp8_array(num_elements, DEFAULT_MXFP8_BLOCK_SIZE);
     if (!arr) return 1;
 
-    if (_quantize_mxfp8(float_array, arr)) {
+    if (mxfp8_compress_into(float_array, arr)) {
         free_mxfp8_array(arr);
         return 1;
     }
@@ -173,28 +210,64 @@ int mxfp8_compress(const float *float_array,
     return 0;
 }
 
-int mxfp8_decompress(const mxfp8_array_t *mxfp8_array,
-                     float *float_array) {
+/* Decode the share of block b in [offset, end) into float_array, indexed from offset. */
+static void _decode_range_step(const mxfp8_array_t *mxfp8_array, uint64_t b, uint64_t offset, uint64_t end,
+                               float *float_array) {
+    const uint64_t block_size = mxfp8_array->block_size;
+    const uint64_t start = (b * block_size > offset) ? b * block_size : offset;
+    const uint64_t stop  = ((b + 1) * block_size < end) ? (b + 1) * block_size : end;
+    float scale = ldexpf(1.0f, mxfp8_array->scales[b]);
+
+    for (uint64_t i = start; i < stop; ++i) {
+        float val = e4m3_to_fp32(mxfp8_array->data[i]);
+        float_array[i - offset] = scale * val;
+    }
+}
+
+static int _decompress_range(const mxfp8_array_t *mxfp8_array, uint64_t offset, uint64_t count, float *float_array,
+                             int parallel) {
     if (!mxfp8_array || !float_array) return 1;
+    if (offset > mxfp8_array->num_elements || count > mxfp8_array->num_elements - offset) return 1;
+    if (count == 0) return 0;
 
-    const uint64_t block_size   = mxfp8_array->block_size;
-    const uint64_t num_blocks   = mxfp8_array->num_blocks;
-    const uint64_t num_elements = mxfp8_array->num_elements;
+    const uint64_t block_size  = mxfp8_array->block_size;
+    const uint64_t end         = offset + count;
+    const uint64_t first_block = offset / block_size;
+    const uint64_t last_block  = (end - 1) / block_size;
 
 #if defined(__linux__) && defined(_OPENMP)
+    if (parallel) {
 #pragma omp parallel for
-#endif
-    for (uint64_t b = 0; b < num_blocks; ++b) {
-        const uint64_t start = b * block_size;
-        const uint64_t remain = (start + block_size <= num_elements)
-                                  ? block_size
-                                  : (num_elements - start);
-        float scale = ldexpf(1.0f, mxfp8_array->scales[b]);
-
-        for (uint64_t i = 0; i < remain; ++i) {
-            float val = e4m3_to_fp32(mxfp8_array->data[start + i]);
-            float_array[start + i] = scale * val;
+        for (uint64_t b = first_block; b <= last_block; ++b) {
+            _decode_range_step(mxfp8_array, b, offset, end, float_array);
         }
+        return 0;
+    }
+#else
+    (void)parallel;
+#endif
+    for (uint64_t b = first_block; b <= last_block; ++b) {
+        _decode_range_step(mxfp8_array, b, offset, end, float_array);
     }
     return 0;
 }
+
+int mxfp8_decompress_range(const mxfp8_array_t *mxfp8_array,
+                           uint64_t offset,
+                           uint64_t count,
+                           float *float_array) {
+    return _decompress_range(mxfp8_array, offset, count, float_array, 1);
+}
+
+int mxfp8_decompress_range_serial(const mxfp8_array_t *mxfp8_array,
+                                  uint64_t offset,
+                                  uint64_t count,
+                                  float *float_array) {
+    return _decompress_range(mxfp8_array, offset, count, float_array, 0);
+}
+
+int mxfp8_decompress(const mxfp8_array_t *mxfp8_array,
+                     float *float_array) {
+    if (!mxfp8_array) return 1;
+    return mxfp8_decompress_range(mxfp8_array, 0, mxfp8_array->num_elements, float_array);
+}
@@ -1,4 +1,5 @@
 #include "float_quantization/nf4_dq_impl.h"
+#include "utils/alloc.h"
 
 #define FP8_EXPONENT_BIAS 7
 #define FP8_EXP_BITS      4
@@ -31,31 +32,45 @@ static int64_t _get_nf4_dq_array_size(const nf4_dq_array_t *nf4_dq_array) {
          + packed_elems * sizeof(uint8_t);
 }
 
-nf4_dq_array_t *allocate_nf4_dq_array(uint64_t num_elements,
-                                      uint64_t block_size) {
-    if (!num_elements || !block_size) return NULL;
+int64_t compute_nf4_dq_array_size(uint64_t num_elements,
+                                  uint64_t block_size) {
+    if (!num_elements || !block_size) return 0;
 
     uint64_t num_blocks = (num_elements + block_size - 1) / block_size;
     uint64_t packed_elems = (num_elements + 1) / 2;
-    size_t total = sizeof(nf4_dq_array_t)
-                 + num_blocks * sizeof(uint8_t)
-                 + packed_elems * sizeof(uint8_t);
+    return sizeof(nf4_dq_array_t)
+         + num_blocks * sizeof(uint8_t)
+         + packed_elems * sizeof(uint8_t);
+}
 
-    nf4_dq_array_t *arr = (nf4_dq_array_t *)calloc(1, total);
-    if (!arr) return NULL;
+nf4_dq_array_t *init_nf4_dq_array(void *buffer,
+                                  uint64_t num_elements,
+                                  uint64_t block_size) {
+    if (!buffer || !num_elements || !block_size) return NULL;
 
+    nf4_dq_array_t *arr = (nf4_dq_array_t *)buffer;
     arr->num_elements = num_elements;
-    arr->num_blocks   = num_blocks;
+    arr->num_blocks   = (num_elements + block_size - 1) / block_size;
     arr->block_size   = block_size;
-    arr->dq_scale     = 1.0f;
     arr->block_scales = (uint8_t *)(arr + 1);
-    arr->data         = (uint8_t *)(arr->block_scales + num_blocks);
+    arr->data         = (uint8_t *)(arr->block_scales + arr->num_blocks);
+    arr->dq_scale     = 1.0f;
     return arr;
 }
 
+nf4_dq_array_t *allocate_nf4_dq_array(uint64_t num_elements,
+                                      uint64_t block_size) {
+    const int64_t total = compute_nf4_dq_array_size(num_elements, block_size);
+    if (total <= 0) return NULL;
+
+    void *buffer = bsq_alloc_bytes((size_t)total, 0, 0);
+    if (!buffer) return NULL;
+    return init_nf4_dq_array(buffer, num_elements, block_size);
+}
+
 void free_nf4_dq_array(nf4_dq_array_t *nf4_dq_array) {
     if (!nf4_dq_array) return;
-    free(nf4_dq_array);
+    bsq_free_bytes(nf4_dq_array);
 }
 
 int64_t get_nf4_dq_array_size(const nf4_dq_array_t *nf4_dq_array) {
@@ -65,13 +80,13 @@ int64_t get_nf4_dq_array_size(const nf4_dq_array_t *nf4_dq_array) {
 nf4_dq_array_t *load_nf4_dq_array_from_buffer(const void *buffer, int64_t buffer_size) {
     if (!buffer || buffer_size < (int64_t)sizeof(nf4_dq_array_t)) return NULL;
 
-    nf4_dq_array_t *arr = (nf4_dq_array_t *)calloc(1, buffer_size);
+    nf4_dq_array_t *arr = (nf4_dq_array_t *)bsq_alloc_bytes((size_t)buffer_size, 0, BSQ_ALLOC_UNINITIALIZED);
     if (!arr) return NULL;
 
     memcpy(arr, buffer, buffer_size);
     const int64_t expected = _get_nf4_dq_array_size(arr);
     if (expected == 0 || buffer_size < expected) {
-        free(arr);
+        bsq_free_bytes(arr);
         return NULL;
     }
 
@@ -147,83 +162,129 @@ static float nf4_dq_code_to_fp32(uint8_t code) {
     return NF4_DQ_LEVELS[code & 0xF];
 }
 
-static float choose_dq_scale(const float *block_scales, uint64_t num_blocks) {
+float nf4_dq_block_scale(const float *block, uint64_t len) {
     float abs_max = 0.0f;
-    for (uint64_t i = 0; i < num_blocks; ++i) {
-        float v = block_scales[i];
-        if (!isfinite(v)) continue;
+    for (uint64_t i = 0; i < len; ++i) {
+        float v = block[i];
+        if (!isfinite(v)) v = 0.0f;
         float av = fabsf(v);
         if (av > abs_max) abs_max = av;
     }
+    return (abs_max > 0.0f) ? abs_max : 1.0f;
+}
+
+float nf4_dq_scale_for_absmax(float abs_max) {
     if (abs_max == 0.0f) return 1.0f;
     return abs_max / NF4_DQ_FP8_MAX_NORM_VALUE;
 }
 
-static int _quantize_nf4_dq(const float *float_array, nf4_dq_array_t *arr) {
-    if (!float_array || !arr) return 1;
-
+/* nf4_dq_block_scale of block b of float_array. */
+static float _block_scale_step(const float *float_array, const nf4_dq_array_t *arr, uint64_t b) {
     const uint64_t block_size   = arr->block_size;
-    const uint64_t num_blocks   = arr->num_blocks;
     const uint64_t num_elements = arr->num_elements;
-    uint8_t *dst = arr->data;
 
-    float *block_scales = (float *)malloc(num_blocks * sizeof(float));
-    if (!block_scales) return 1;
+    const uint64_t start = b * block_size;
+    const uint64_t remain = (start + block_size <= num_elements)
+                              ? block_size
+                              : (num_elements - start);
+    return nf4_dq_block_scale(float_array + start, remain);
+}
+
+static int _compress_into(const float *float_array, nf4_dq_array_t *arr, int parallel) {
+    if (!float_array || !arr) return 1;
+
+    const uint64_t num_blocks = arr->num_blocks;
 
+    float max_block_scale = 0.0f;
 #if defined(__linux__) && defined(_OPENMP)
-#pragma omp parallel for
+    if (parallel) {
+#pragma omp parallel for reduction(max:max_block_scale)
+        for (uint64_t b = 0; b < num_blocks; ++b) {
+            const float block_scale = _block_scale_step(float_array, arr, b);
+            if (block_scale > max_block_scale) max_block_scale = block_scale;
+        }
+        return nf4_dq_compress_into_scaled(float_array, nf4_dq_scale_for_absmax(max_block_scale), arr);
+    }
+#else
+    (void)parallel;
 #endif
     for (uint64_t b = 0; b < num_blocks; ++b) {
-        const uint64_t start = b * block_size;
-        const uint64_t remain = (start + block_size <= num_elements)
-                                  ? block_size
-                                  : (num_elements - start);
-
-        float abs_max = 0.0f;
-        for (uint64_t i = 0; i < remain; ++i) {
-            float v = float_array[start + i];
-            if (!isfinite(v)) v = 0.0f;
-            float av = fabsf(v);
-            if (av > abs_max) abs_max = av;
+        const float block_scale = _block_scale_step(float_array, arr, b);
+        if (block_scale > max_block_scale) max_block_scale = block_scale;
+    }
+    return nf4_dq_compress_into_scaled_serial(float_array, nf4_dq_scale_for_absmax(max_block_scale), arr);
+}
+
+int nf4_dq_compress_into(const float *float_array, nf4_dq_array_t *arr) {
+    return _compress_into(float_array, arr, 1);
+}
+
+int nf4_dq_compress_into_serial(const float *float_array, nf4_dq_array_t *arr) {
+    return _compress_into(float_array, arr, 0);
+}
+
+/* Quantize block b of float_array into arr under dq_scale. */
+static void _compress_step(const float *float_array, float dq_scale, nf4_dq_array_t *arr, uint8_t *dst, uint64_t b) {
+    const uint64_t block_size   = arr->block_size;
+    const uint64_t num_elements = arr->num_elements;
+
+    const uint64_t start = b * block_size;
+    const uint64_t remain = (start + block_size <= num_elements)
+                              ? block_size
+                              : (num_elements - start);
+
+    uint8_t block_scale_code = fp32_to_e4m3(nf4_dq_block_scale(float_array + start, remain) / dq_scale);
+    arr->block_scales[b] = block_scale_code;
+    float block_scale = dq_scale * e4m3_to_fp32(block_scale_code);
+    if (block_scale == 0.0f || !isfinite(block_scale)) block_scale = 1.0f;
+    float inv_block_scale = 1.0f / block_scale;
+
+    for (uint64_t i = 0; i < remain; ++i) {
+        float v = float_array[start + i] * inv_block_scale;
+        uint8_t code = float_to_nf4_dq_code(v) & 0xF;
+        const uint64_t packed_idx = (start + i) / 2;
+        if (((start + i) % 2) == 0) {
+            dst[packed_idx] = (uint8_t)(code << 4);
+        } else {
+            dst[packed_idx] |= code;
         }
-        block_scales[b] = (abs_max > 0.0f) ? abs_max : 1.0f;
     }
+}
+
+static int _compress_into_scaled(const float *float_array, float dq_scale, nf4_dq_array_t *arr, int parallel) {
+    if (!float_array || !arr) return 1;
+
+    const uint64_t num_blocks = arr->num_blocks;
+    uint8_t *dst = arr->data;
 
-    float dq_scale = choose_dq_scale(block_scales, num_blocks);
     if (dq_scale == 0.0f) dq_scale = 1.0f;
     arr->dq_scale = dq_scale;
 
 #if defined(__linux__) && defined(_OPENMP)
+    if (parallel) {
 #pragma omp parallel for
+        for (uint64_t b = 0; b < num_blocks; ++b) {
+            _compress_step(float_array, dq_scale, arr, dst, b);
+        }
+        return 0;
+    }
+#else
+    (void)parallel;
 #endif
     for (uint64_t b = 0; b < num_blocks; ++b) {
-        const uint64_t start = b * block_size;
-        const uint64_t remain = (start + block_size <= num_elements)
-                                  ? block_size
-                                  : (num_elements - start);
-
-        uint8_t block_scale_code = fp32_to_e4m3(block_scales[b] / dq_scale);
-        arr->block_scales[b] = block_scale_code;
-        float block_scale = dq_scale * e4m3_to_fp32(block_scale_code);
-        if (block_scale == 0.0f || !isfinite(block_scale)) block_scale = 1.0f;
-        float inv_block_scale = 1.0f / block_scale;
-
-        for (uint64_t i = 0; i < remain; ++i) {
-            float v = float_array[start + i] * inv_block_scale;
-            uint8_t code = float_to_nf4_dq_code(v) & 0xF;
-            const uint64_t packed_idx = (start + i) / 2;
-            if (((start + i) % 2) == 0) {
-                dst[packed_idx] = (uint8_t)(code << 4);
-            } else {
-                dst[packed_idx] |= code;
-            }
-        }
+        _compress_step(float_array, dq_scale, arr, dst, b);
     }
-
-    free(block_scales);
     return 0;
 }
 
+int nf4_dq_compress_into_scaled(const float *float_array, float dq_scale, nf4_dq_array_t *arr) {
+    return _compress_into_scaled(float_array, dq_scale, arr, 1);
+}
+
+int nf4_dq_compress_into_scaled_serial(const float *float_array, float dq_scale, nf4_dq_array_t *arr) {
+    return _compress_into_scaled(float_array, dq_scale, arr, 0);
+}
+
 int nf4_dq_compress(const float *float_array,
                     uint64_t num_elements,
                     nf4_dq_array_t **nf4_dq_array) {
@@ -232,7 +293,7 @@ int nf4_dq_compress(const float *float_array,
     nf4_dq_array_t *arr = allocate_nf4_dq_array(num_elements, DEFAULT_NF4_DQ_BLOCK_SIZE);
     if (!arr) return 1;
 
-    if (_quantize_nf4_dq(float_array, arr)) {
+    if (nf4_dq_compress_into(float_array, arr)) {
         free_nf4_dq_array(arr);
         return 1;
     }
@@ -241,35 +302,69 @@ int nf4_dq_compress(const float *float_array,
     return 0;
 }
 
-int nf4_dq_decompress(const nf4_dq_array_t *nf4_dq_array,
-                      float *float_array) {
-    if (!nf4_dq_array || !float_array) return 1;
-
-    const uint64_t block_size   = nf4_dq_array->block_size;
-    const uint64_t num_blocks   = nf4_dq_array->num_blocks;
-    const uint64_t num_elements = nf4_dq_array->num_elements;
+/* Decode the share of block b in [offset, end) into float_array, indexed from offset. */
+static void _decode_range_step(const nf4_dq_array_t *nf4_dq_array, uint64_t b, uint64_t offset, uint64_t end,
+                               float *float_array) {
+    const uint64_t block_size = nf4_dq_array->block_size;
     const uint8_t *src = nf4_dq_array->data;
     const float dq_scale = nf4_dq_array->dq_scale;
+    const uint64_t start = (b * block_size > offset) ? b * block_size : offset;
+    const uint64_t stop  = ((b + 1) * block_size < end) ? (b + 1) * block_size : end;
+    float block_scale = dq_scale * e4m3_to_fp32(nf4_dq_array->block_scales[b]);
+    if (block_scale == 0.0f || !isfinite(block_scale)) block_scale = 1.0f;
+
+    for (uint64_t i = start; i < stop; ++i) {
+        uint8_t packed = src[i / 2];
+        uint8_t code = (i % 2 == 0) ? (packed >> 4) : (packed & 0xF);
+        float val = nf4_dq_code_to_fp32(code);
+        float_array[i - offset] = block_scale * val;
+    }
+}
+
+static int _decompress_range(const nf4_dq_array_t *nf4_dq_array, uint64_t offset, uint64_t count, float *float_array,
+                             int parallel) {
+    if (!nf4_dq_array || !float_array) return 1;
+    if (offset > nf4_dq_array->num_elements || count > nf4_dq_array->num_elements - offset) return 1;
+    if (count == 0) return 0;
+
+    const uint64_t block_size  = nf4_dq_array->block_size;
+    const uint64_t end         = offset + count;
+    const uint64_t first_block = offset / block_size;
+    const uint64_t last_block  = (end - 1) / block_size;
 
 #if defined(__linux__) && defined(_OPENMP)
+    if (parallel) {
 #pragma omp parallel for
-#endif
-    for (uint64_t b = 0; b < num_blocks; ++b) {
-        const uint64_t start = b * block_size;
-        const uint64_t remain = (start + block_size <= num_elements)
-                                  ? block_size
-                                  : (num_elements - start);
-
-        float block_scale = dq_scale * e4m3_to_fp32(nf4_dq_array->block_scales[b]);
-        if (block_scale == 0.0f || !isfinite(block_scale)) block_scale = 1.0f;
-
-        for (uint64_t i = 0; i < remain; ++i) {
-            const uint64_t packed_idx = (start + i) / 2;
-            uint8_t packed = src[packed_idx];
-            uint8_t code = ((start + i) % 2 == 0) ? (packed >> 4) : (packed & 0xF);
-            float val = nf4_dq_code_to_fp32(code);
-            float_array[start + i] = block_scale * val;
+        for (uint64_t b = first_block; b <= last_block; ++b) {
+            _decode_range_step(nf4_dq_array, b, offset, end, float_array);
         }
+        return 0;
+    }
+#else
+    (void)parallel;
+#endif
+    for (uint64_t b = first_block; b <= last_block; ++b) {
+        _decode_range_step(nf4_dq_array, b, offset, end, float_array);
     }
     return 0;
 }
+
+int nf4_dq_decompress_range(const nf4_dq_array_t *nf4_dq_array,
+                            uint64_t offset,
+                            uint64_t count,
+                            float *float_array) {
+    return _decompress_range(nf4_dq_array, offset, count, float_array, 1);
+}
+
+int nf4_dq_decompress_range_serial(const nf4_dq_array_t *nf4_dq_array,
+                                   uint64_t offset,
+                                   uint64_t count,
+                                   float *float_array) {
+    return _decompress_range(nf4_dq_array, offset, count, float_array, 0);
+}
+
+int nf4_dq_decompress(const nf4_dq_array_t *nf4_dq_array,
+                      float *float_array) {
+    if (!nf4_dq_array) return 1;
+    return nf4_dq_decompress_range(nf4_dq_array, 0, nf4_dq_array->num_elements, float_array);
+}
@@ -1,4 +1,6 @@
 #include "float_quantization/nf4_impl.h"
+#include "utils/alloc.h"
+#include "utils/dot.h"
 
 static const float NF4_LEVELS[16] = {
     -1.0f,
@@ -27,30 +29,44 @@ static int64_t _get_nf4_array_size(const nf4_array_t *nf4_array) {
          + packed_elems * sizeof(uint8_t);
 }
 
-nf4_array_t *allocate_nf4_array(uint64_t num_elements,
-                                uint64_t block_size) {
-    if (!num_elements || !block_size) return NULL;
+int64_t compute_nf4_array_size(uint64_t num_elements,
+                               uint64_t block_size) {
+    if (!num_elements || !block_size) return 0;
 
     uint64_t num_blocks = (num_elements + block_size - 1) / block_size;
     uint64_t packed_elems = (num_elements + 1) / 2;
-    size_t total = sizeof(nf4_array_t)
-                 + num_blocks * sizeof(float)
-                 + packed_elems * sizeof(uint8_t);
+    return sizeof(nf4_array_t)
+         + num_blocks * sizeof(float)
+         + packed_elems * sizeof(uint8_t);
+}
 
-    nf4_array_t *arr = (nf4_array_t *)calloc(1, total);
-    if (!arr) return NULL;
+nf4_array_t *init_nf4_array(void *buffer,
+                            uint64_t num_elements,
+                            uint64_t block_size) {
+    if (!buffer || !num_elements || !block_size) return NULL;
 
+    nf4_array_t *arr = (nf4_array_t *)buffer;
     arr->num_elements = num_elements;
-    arr->num_blocks   = num_blocks;
+    arr->num_blocks   = (num_elements + block_size - 1) / block_size;
     arr->block_size   = block_size;
     arr->block_scales = (float *)(arr + 1);
-    arr->data         = (uint8_t *)(arr->block_scales + num_blocks);
+    arr->data         = (uint8_t *)(arr->block_scales + arr->num_blocks);
     return arr;
 }
 
+nf4_array_t *allocate_nf4_array(uint64_t num_elements,
+                                uint64_t block_size) {
+    const int64_t total = compute_nf4_array_size(num_elements, block_size);
+    if (total <= 0) return NULL;
+
+    void *buffer = bsq_alloc_bytes((size_t)total, 0, 0);
+    if (!buffer) return NULL;
+    return init_nf4_array(buffer, num_elements, block_size);
+}
+
 void free_nf4_array(nf4_array_t *nf4_array) {
     if (!nf4_array) return;
-    free(nf4_array);
+    bsq_free_bytes(nf4_array);
 }
 
 int64_t get_nf4_array_size(const nf4_array_t *nf4_array) {
@@ -60,13 +76,13 @@ int64_t get_nf4_array_size(const nf4_array_t *nf4_array) {
 nf4_array_t *load_nf4_array_from_buffer(const void *buffer, int64_t buffer_size) {
     if (!buffer || buffer_size < (int64_t)sizeof(nf4_array_t)) return NULL;
 
-    nf4_array_t *arr = (nf4_array_t *)calloc(1, buffer_size);
+    nf4_array_t *arr = (nf4_array_t *)bsq_alloc_bytes((size_t)buffer_size, 0, BSQ_ALLOC_UNINITIALIZED);
     if (!arr) return NULL;
 
     memcpy(arr, buffer, buffer_size);
     const int64_t expected = _get_nf4_array_size(arr);
     if (expected == 0 || buffer_size < expected) {
-        free(arr);
+        bsq_free_bytes(arr);
         return NULL;
     }
 
@@ -94,6 +110,72 @@ static float nf4_code_to_fp32(uint8_t code) {
     return NF4_LEVELS[code & 0xF];
 }
 
+/* Quantize block b of float_array into arr. */
+static void _compress_step(const float *float_array, nf4_array_t *arr, uint8_t *dst, uint64_t b) {
+    const uint64_t block_size = arr->block_size;
+    const uint64_t total = arr->num_elements;
+
+    const uint64_t start = b * block_size;
+    const uint64_t remain = (start + block_size <= total)
+                              ? block_size
+                              : (total - start);
+
+    float abs_max = 0.0f;
+    for (uint64_t i = 0; i < remain; ++i) {
+        float v = float_array[start + i];
+        if (!isfinite(v)) v = 0.0f;
+        float av = fabsf(v);
+        if (av > abs_max) abs_max = av;
+    }
+    float block_scale = (abs_max > 0.0f) ? abs_max : 1.0f;
+    arr->block_scales[b] = block_scale;
+    float inv_block_scale = 1.0f / block_scale;
+
+    for (uint64_t i = 0; i < remain; ++i) {
+        float v = float_array[start + i] * inv_block_scale;
+        uint8_t code = float_to_nf4_code(v) & 0xF;
+        const uint64_t packed_idx = (start + i) / 2;
+        if (((start + i) % 2) == 0) {
+            dst[packed_idx] = (uint8_t)(code << 4);
+        } else {
+            dst[packed_idx] |= code;
+        }
+    }
+}
+
+static int _compress_into(const float *float_array, nf4_array_t *arr, int parallel) {
+    if (!float_array || !arr) return 1;
+
+    const uint64_t num_blocks = arr->num_blocks;
+    uint8_t *dst = arr->data;
+
+#if defined(__linux__) && defined(_OPENMP)
+    if (parallel) {
+#pragma omp parallel for
+        for (uint64_t b = 0; b < num_blocks; ++b) {
+            _compress_step(float_array, arr, dst, b);
+        }
+        return 0;
+    }
+#else
+    (void)parallel;
+#endif
+    for (uint64_t b = 0; b < num_blocks; ++b) {
+        _compress_step(float_array, arr, dst, b);
+    }
+    return 0;
+}
+
+int nf4_compress_into(const float *float_array,
+                      nf4_array_t *arr) {
+    return _compress_into(float_array, arr, 1);
+}
+
+int nf4_compress_into_serial(const float *float_array,
+                             nf4_array_t *arr) {
+    return _compress_into(float_array, arr, 0);
+}
+
 int nf4_compress(const float *float_array,
                  uint64_t num_elements,
                  nf4_array_t **nf4_array) {
@@ -102,75 +184,113 @@ int nf4_compress(const float *float_array,
     nf4_array_t *arr = allocate_nf4_array(num_elements, DEFAULT_NF4_BLOCK_SIZE);
     if (!arr) return 1;
 
-    const uint64_t block_size = arr->block_size;
-    const uint64_t num_blocks = arr->num_blocks;
-    const uint64_t total = arr->num_elements;
-    uint8_t *dst = arr->data;
+    if (nf4_compress_into(float_array, arr)) {
+        free_nf4_array(arr);
+        return 1;
+    }
+
+    *nf4_array = arr;
+    return 0;
+}
+
+/* Decode the share of block b in [offset, end) into float_array, indexed from offset. */
+static void _decode_range_step(const nf4_array_t *nf4_array, uint64_t b, uint64_t offset, uint64_t end,
+                               float *float_array) {
+    const uint64_t block_size = nf4_array->block_size;
+    const uint8_t *src = nf4_array->data;
+    const uint64_t start = (b * block_size > offset) ? b * block_size : offset;
+    const uint64_t stop  = ((b + 1) * block_size < end) ? (b + 1) * block_size : end;
+    float block_scale = nf4_array->block_scales[b];
+    if (block_scale == 0.0f || !isfinite(block_scale)) block_scale = 1.0f;
+
+    for (uint64_t i = start; i < stop; ++i) {
+        uint8_t packed = src[i / 2];
+        uint8_t code = (i % 2 == 0) ? (packed >> 4) : (packed & 0xF);
+        float val = nf4_code_to_fp32(code);
+        float_array[i - offset] = block_scale * val;
+    }
+}
+
+static int _decompress_range(const nf4_array_t *nf4_array, uint64_t offset, uint64_t count, float *float_array,
+                             int parallel) {
+    if (!nf4_array || !float_array) return 1;
+    if (offset > nf4_array->num_elements || count > nf4_array->num_elements - offset) return 1;
+    if (count == 0) return 0;
+
+    const uint64_t block_size  = nf4_array->block_size;
+    const uint64_t end         = offset + count;
+    const uint64_t first_block = offset / block_size;
+    const uint64_t last_block  = (end - 1) / block_size;
 
 #if defined(__linux__) && defined(_OPENMP)
+    if (parallel) {
 #pragma omp parallel for
-#endif
-    for (uint64_t b = 0; b < num_blocks; ++b) {
-        const uint64_t start = b * block_size;
-        const uint64_t remain = (start + block_size <= total)
-                                  ? block_size
-                                  : (total - start);
-
-        float abs_max = 0.0f;
-        for (uint64_t i = 0; i < remain; ++i) {
-            float v = float_array[start + i];
-            if (!isfinite(v)) v = 0.0f;
-            float av = fabsf(v);
-            if (av > abs_max) abs_max = av;
-        }
-        float block_scale = (abs_max > 0.0f) ? abs_max : 1.0f;
-        arr->block_scales[b] = block_scale;
-        float inv_block_scale = 1.0f / block_scale;
-
-        for (uint64_t i = 0; i < remain; ++i) {
-            float v = float_array[start + i] * inv_block_scale;
-            uint8_t code = float_to_nf4_code(v) & 0xF;
-            const uint64_t packed_idx = (start + i) / 2;
-            if (((start + i) % 2) == 0) {
-                dst[packed_idx] = (uint8_t)(code << 4);
-            } else {
-                dst[packed_idx] |= code;
-            }
+        for (uint64_t b = first_block; b <= last_block; ++b) {
+            _decode_range_step(nf4_array, b, offset, end, float_array);
         }
+        return 0;
+    }
+#else
+    (void)parallel;
+#endif
+    for (uint64_t b = first_block; b <= last_block; ++b) {
+        _decode_range_step(nf4_array, b, offset, end, float_array);
     }
-
-    *nf4_array = arr;
     return 0;
 }
 
+int nf4_decompress_range(const nf4_array_t *nf4_array,
+                         uint64_t offset,
+                         uint64_t count,
+                         float *float_array) {
+    return _decompress_range(nf4_array, offset, count, float_array, 1);
+}
+
+int nf4_decompress_range_serial(const nf4_array_t *nf4_array,
+                                uint64_t offset,
+                                uint64_t count,
+                                float *float_array) {
+    return _decompress_range(nf4_array, offset, count, float_array, 0);
+}
+
 int nf4_decompress(const nf4_array_t *nf4_array,
                    float *float_array) {
-    if (!nf4_array || !float_array) return 1;
+    if (!nf4_array) return 1;
+    return nf4_decompress_range(nf4_array, 0, nf4_array->num_elements, float_array);
+}
 
-    const uint64_t block_size   = nf4_array->block_size;
-    const uint64_t num_blocks   = nf4_array->num_blocks;
-    const uint64_t num_elements = nf4_array->num_elements;
-    const uint8_t *src = nf4_array->data;
+int nf4_gemv(const nf4_array_t *nf4_array,
+             uint64_t rows,
+             uint64_t cols,
+             const float *x,
+             float *y) {
+    if (!nf4_array || !x || !y) return 1;
+    const uint64_t block_size = nf4_array->block_size;
+    if (block_size == 0 || block_size % 2 != 0 || block_size > BSQ_DOT_PANEL || cols % block_size != 0 ||
+        rows * cols != nf4_array->num_elements) {
+        return 1;
+    }
+    const uint64_t blocks_per_row = cols / block_size;
 
 #if defined(__linux__) && defined(_OPENMP)
 #pragma omp parallel for
 #endif
-    for (uint64_t b = 0; b < num_blocks; ++b) {
-        const uint64_t start = b * block_size;
-        const uint64_t remain = (start + block_size <= num_elements)
-                                  ? block_size
-                                  : (num_elements - start);
-
-        float block_scale = nf4_array->block_scales[b];
-        if (block_scale == 0.0f || !isfinite(block_scale)) block_scale = 1.0f;
-
-        for (uint64_t i = 0; i < remain; ++i) {
-            const uint64_t packed_idx = (start + i) / 2;
-            uint8_t packed = src[packed_idx];
-            uint8_t code = ((start + i) % 2 == 0) ? (packed >> 4) : (packed & 0xF);
-            float val = nf4_code_to_fp32(code);
-            float_array[start + i] = block_scale * val;
+    for (uint64_t r = 0; r < rows; ++r) {
+        const uint8_t *q = nf4_array->data + r * cols / 2;
+        const float *scales = nf4_array->block_scales + r * blocks_per_row;
+        float w[BSQ_DOT_PANEL];
+        float acc = 0.0f;
+        for (uint64_t b = 0; b < blocks_per_row; ++b) {
+            const uint8_t *qb = q + b * block_size / 2;
+            for (uint64_t j = 0; j < block_size / 2; ++j) {
+                w[2 * j]     = NF4_LEVELS[qb[j] >> 4];
+                w[2 * j + 1] = NF4_LEVELS[qb[j] & 0xF];
+            }
+            float block_scale = scales[b];
+            if (block_scale == 0.0f || !isfinite(block_scale)) block_scale = 1.0f;
+            acc += block_scale * bsq_dot_f32(w, x + b * block_size, block_size);
         }
+        y[r] = acc;
     }
     return 0;
 }
@@ -1,4 +1,6 @@
 #include "float_quantization/nvfp4_impl.h"
+#include "utils/alloc.h"
+#include "utils/dot.h"
 
 #define FP8_EXPONENT_BIAS 7
 #define FP8_EXP_BITS      4
@@ -16,31 +18,45 @@ static int64_t _get_nvfp4_array_size(const nvfp4_array_t *nvfp4_array) {
          + packed_elems * sizeof(uint8_t);
 }
 
-nvfp4_array_t *allocate_nvfp4_array(uint64_t num_elements,
-                                    uint64_t block_size) {
-    if (!num_elements || !block_size) return NULL;
+int64_t compute_nvfp4_array_size(uint64_t num_elements,
+                                 uint64_t block_size) {
+    if (!num_elements || !block_size) return 0;
 
     uint64_t num_blocks = (num_elements + block_size - 1) / block_size;
     uint64_t packed_elems = (num_elements + 1) / 2;
-    size_t total = sizeof(nvfp4_array_t)
-                 + num_blocks * sizeof(uint8_t)
-                 + packed_elems * sizeof(uint8_t);
+    return sizeof(nvfp4_array_t)
+         + num_blocks * sizeof(uint8_t)
+         + packed_elems * sizeof(uint8_t);
+}
 
-    nvfp4_array_t *arr = (nvfp4_array_t *)calloc(1, total);
-    if (!arr) return NULL;
+nvfp4_array_t *init_nvfp4_array(void *buffer,
+                                uint64_t num_elements,
+                                uint64_t block_size) {
+    if (!buffer || !num_elements || !block_size) return NULL;
 
+    nvfp4_array_t *arr = (nvfp4_array_t *)buffer;
     arr->num_elements = num_elements;
-    arr->num_blocks   = num_blocks;
+    arr->num_blocks   = (num_elements + block_size - 1) / block_size;
     arr->block_size   = block_size;
     arr->block_scales = (uint8_t *)(arr + 1);
-    arr->data         = (uint8_t *)(arr->block_scales + num_blocks);
+    arr->data         = (uint8_t *)(arr->block_scales + arr->num_blocks);
     arr->tensor_scale = 1.0f;
     return arr;
 }
 
+nvfp4_array_t *allocate_nvfp4_array(uint64_t num_elements,
+                                    uint64_t block_size) {
+    const int64_t total = compute_nvfp4_array_size(num_elements, block_size);
+    if (total <= 0) return NULL;
+
+    void *buffer = bsq_alloc_bytes((size_t)total, 0, 0);
+    if (!buffer) return NULL;
+    return init_nvfp4_array(buffer, num_elements, block_size);
+}
+
 void free_nvfp4_array(nvfp4_array_t *nvfp4_array) {
     if (!nvfp4_array) return;
-    free(nvfp4_array);
+    bsq_free_bytes(nvfp4_array);
 }
 
 int64_t get_nvfp4_array_size(const nvfp4_array_t *nvfp4_array) {
@@ -50,13 +66,13 @@ int64_t get_nvfp4_array_size(const nvfp4_array_t *nvfp4_array) {
 nvfp4_array_t *load_nvfp4_array_from_buffer(const void *buffer, int64_t buffer_size) {
     if (!buffer || buffer_size < (int64_t)sizeof(nvfp4_array_t)) return NULL;
 
-    nvfp4_array_t *arr = (nvfp4_array_t *)calloc(1, buffer_size);
+    nvfp4_array_t *arr = (nvfp4_array_t *)bsq_alloc_bytes((size_t)buffer_size, 0, BSQ_ALLOC_UNINITIALIZED);
     if (!arr) return NULL;
 
     memcpy(arr, buffer, buffer_size);
     const int64_t expected = _get_nvfp4_array_size(arr);
     if (expected == 0 || buffer_size < expected) {
-        free(arr);
+        bsq_free_bytes(arr);
         return NULL;
     }
 
@@ -181,6 +197,10 @@ static float choose_tensor_scale(const float *arr, uint64_t n) {
         float av = fabsf(v);
         if (av > abs_max) abs_max = av;
     }
+    return nvfp4_tensor_scale_for_absmax(abs_max);
+}
+
+float nvfp4_tensor_scale_for_absmax(float abs_max) {
     if (abs_max == 0.0f) return 1.0f;
     return abs_max / NVFP4_MAX_NORM_VALUE;
 }
@@ -198,45 +218,82 @@ static uint8_t choose_block_scale_fp8(const float *arr, uint64_t start, uint64_t
     return fp32_to_e4m3(scale);
 }
 
-static int _quantize_nvfp4(const float *float_array, nvfp4_array_t *arr) {
+int nvfp4_compress_into(const float *float_array, nvfp4_array_t *arr) {
+    if (!float_array || !arr) return 1;
+    return nvfp4_compress_into_scaled(float_array, choose_tensor_scale(float_array, arr->num_elements), arr);
+}
+
+int nvfp4_compress_into_serial(const float *float_array, nvfp4_array_t *arr) {
     if (!float_array || !arr) return 1;
+    return nvfp4_compress_into_scaled_serial(float_array, choose_tensor_scale(float_array, arr->num_elements), arr);
+}
+
+void nvfp4_quantize_block(const float *float_array,
+                          uint64_t count,
+                          float tensor_scale,
+                          uint8_t *block_scale_out,
+                          uint8_t *packed) {
+    const float inv_tensor_scale = 1.0f / tensor_scale;
+    uint8_t block_scale_code = choose_block_scale_fp8(float_array, 0, count, tensor_scale);
+    *block_scale_out = block_scale_code;
+    float block_scale = e4m3_to_fp32(block_scale_code);
+    float inv_block_scale = 1.0f / block_scale;
+
+    for (uint64_t i = 0; i < count; ++i) {
+        float v = float_array[i] * inv_tensor_scale * inv_block_scale;
+        uint8_t code = fp32_to_e2m1(v) & 0xF;
+        if ((i % 2) == 0) {
+            packed[i / 2] = (uint8_t)(code << 4);
+        } else {
+            packed[i / 2] |= code;
+        }
+    }
+}
 
+/* Quantize block b of float_array into arr under tensor_scale. */
+static void _compress_step(const float *float_array, float tensor_scale, nvfp4_array_t *arr, uint64_t b) {
     const uint64_t block_size   = arr->block_size;
-    const uint64_t num_blocks   = arr->num_blocks;
     const uint64_t num_elements = arr->num_elements;
-    uint8_t *dst = arr->data;
 
-    arr->tensor_scale = choose_tensor_scale(float_array, num_elements);
-    float inv_tensor_scale = 1.0f / arr->tensor_scale;
+    const uint64_t start = b * block_size;
+    const uint64_t remain = (start + block_size <= num_elements)
+                              ? block_size
+                              : (num_elements - start);
+    nvfp4_quantize_block(float_array + start, remain, tensor_scale, &arr->block_scales[b], arr->data + start / 2);
+}
+
+static int _compress_into_scaled(const float *float_array, float tensor_scale, nvfp4_array_t *arr, int parallel) {
+    if (!float_array || !arr) return 1;
+
+    const uint64_t num_blocks = arr->num_blocks;
+
+    arr->tensor_scale = tensor_scale;
 
 #if defined(__linux__) && defined(_OPENMP)
+    if (parallel) {
 #pragma omp parallel for
+        for (uint64_t b = 0; b < num_blocks; ++b) {
+            _compress_step(float_array, tensor_scale, arr, b);
+        }
+        return 0;
+    }
+#else
+    (void)parallel;
 #endif
     for (uint64_t b = 0; b < num_blocks; ++b) {
-        const uint64_t start = b * block_size;
-        const uint64_t remain = (start + block_size <= num_elements)
-                                  ? block_size
-                                  : (num_elements - start);
-
-        uint8_t block_scale_code = choose_block_scale_fp8(float_array, start, remain, arr->tensor_scale);
-        arr->block_scales[b] = block_scale_code;
-        float block_scale = e4m3_to_fp32(block_scale_code);
-        float inv_block_scale = 1.0f / block_scale;
-
-        for (uint64_t i = 0; i < remain; ++i) {
-            float v = float_array[start + i] * inv_tensor_scale * inv_block_scale;
-            uint8_t code = fp32_to_e2m1(v) & 0xF;
-            const uint64_t packed_idx = (start + i) / 2;
-            if (((start + i) % 2) == 0) {
-                dst[packed_idx] = (uint8_t)(code << 4);
-            } else {
-                dst[packed_idx] |= code;
-            }
-        }
+        _compress_step(float_array, tensor_scale, arr, b);
     }
     return 0;
 }
 
+int nvfp4_compress_into_scaled(const float *float_array, float tensor_scale, nvfp4_array_t *arr) {
+    return _compress_into_scaled(float_array, tensor_scale, arr, 1);
+}
+
+int nvfp4_compress_into_scaled_serial(const float *float_array, float tensor_scale, nvfp4_array_t *arr) {
+    return _compress_into_scaled(float_array, tensor_scale, arr, 0);
+}
+
 int nvfp4_compress(const float *float_array,
                    uint64_t num_elements,
                    nvfp4_array_t **nvfp4_array) {
@@ -245,7 +302,7 @@ int nvfp4_compress(const float *float_array,
     nvfp4_array_t *arr = allocate_nvfp4_array(num_elements, DEFAULT_NVFP4_BLOCK_SIZE);
     if (!arr) return 1;
 
-    if (_quantize_nvfp4(float_array, arr)) {
+    if (nvfp4_compress_into(float_array, arr)) {
         free_nvfp4_array(arr);
         return 1;
     }
@@ -254,34 +311,108 @@ int nvfp4_compress(const float *float_array,
     return 0;
 }
 
+/* Decode the share of block b in [offset, end) into float_array, indexed from offset. */
+static void _decode_range_step(const nvfp4_array_t *nvfp4_array, uint64_t b, uint64_t offset, uint64_t end,
+                               float *float_array) {
+    const uint64_t block_size = nvfp4_array->block_size;
+    const uint8_t *src = nvfp4_array->data;
+    const float tensor_scale = nvfp4_array->tensor_scale;
+    const uint64_t start = (b * block_size > offset) ? b * block_size : offset;
+    const uint64_t stop  = ((b + 1) * block_size < end) ? (b + 1) * block_size : end;
+    float block_scale = e4m3_to_fp32(nvfp4_array->block_scales[b]);
+    float scale = tensor_scale * block_scale;
+
+    for (uint64_t i = start; i < stop; ++i) {
+        uint8_t packed = src[i / 2];
+        uint8_t code = (i % 2 == 0) ? (packed >> 4) : (packed & 0xF);
+        float val = e2m1_to_fp32(code);
+        float_array[i - offset] = scale * val;
+    }
+}
+
+static int _decompress_range(const nvfp4_array_t *nvfp4_array, uint64_t offset, uint64_t count, float *float_array,
+                             int parallel) {
+    if (!nvfp4_array || !float_array) return 1;
+    if (offset > nvfp4_array->num_elements || count > nvfp4_array->num_elements - offset) return 1;
+    if (count == 0) return 0;
+
+    const uint64_t block_size  = nvfp4_array->block_size;
+    const uint64_t end         = offset + count;
+    const uint64_t first_block = offset / block_size;
+    const uint64_t last_block  = (end - 1) / block_size;
+
+#if defined(__linux__) && defined(_OPENMP)
+    if (parallel) {
+#pragma omp parallel for
+        for (uint64_t b = first_block; b <= last_block; ++b) {
+            _decode_range_step(nvfp4_array, b, offset, end, float_array);
+        }
+        return 0;
+    }
+#else
+    (void)parallel;
+#endif
+    for (uint64_t b = first_block; b <= last_block; ++b) {
+        _decode_range_step(nvfp4_array, b, offset, end, float_array);
+    }
+    return 0;
+}
+
+int nvfp4_decompress_range(const nvfp4_array_t *nvfp4_array,
+                           uint64_t offset,
+                           uint64_t count,
+                           float *float_array) {
+    return _decompress_range(nvfp4_array, offset, count, float_array, 1);
+}
+
+int nvfp4_decompress_range_serial(const nvfp4_array_t *nvfp4_array,
+                                  uint64_t offset,
+                                  uint64_t count,
+                                  float *float_array) {
+    return _decompress_range(nvfp4_array, offset, count, float_array, 0);
+}
+
 int nvfp4_decompress(const nvfp4_array_t *nvfp4_array,
                      float *float_array) {
-    if (!nvfp4_array || !float_array) return 1;
+    if (!nvfp4_array) return 1;
+    return nvfp4_decompress_range(nvfp4_array, 0, nvfp4_array->num_elements, float_array);
+}
 
-    const uint64_t block_size   = nvfp4_array->block_size;
-    const uint64_t num_blocks   = nvfp4_array->num_blocks;
-    const uint64_t num_elements = nvfp4_array->num_elements;
-    const uint8_t *src = nvfp4_array->data;
+int nvfp4_gemv(const nvfp4_array_t *nvfp4_array,
+               uint64_t rows,
+               uint64_t cols,
+               const float *x,
+               float *y) {
+    if (!nvfp4_array || !x || !y) return 1;
+    const uint64_t block_size = nvfp4_array->block_size;
+    if (block_size == 0 || block_size % 2 != 0 || block_size > BSQ_DOT_PANEL || cols % block_size != 0 ||
+        rows * cols != nvfp4_array->num_elements) {
+        return 1;
+    }
+    const uint64_t blocks_per_row = cols / block_size;
     const float tensor_scale = nvfp4_array->tensor_scale;
+    float levels[16];
+    float block_levels[256];
+    for (uint8_t code = 0; code < 16; ++code) levels[code] = e2m1_to_fp32(code);
+    for (int code = 0; code < 256; ++code) block_levels[code] = tensor_scale * e4m3_to_fp32((uint8_t)code);
 
 #if defined(__linux__) && defined(_OPENMP)
 #pragma omp parallel for
 #endif
-    for (uint64_t b = 0; b < num_blocks; ++b) {
-        const uint64_t start = b * block_size;
-        const uint64_t remain = (start + block_size <= num_elements)
-                                  ? block_size
-                                  : (num_elements - start);
-        float block_scale = e4m3_to_fp32(nvfp4_array->block_scales[b]);
-        float scale = tensor_scale * block_scale;
-
-        for (uint64_t i = 0; i < remain; ++i) {
-            const uint64_t packed_idx = (start + i) / 2;
-            uint8_t packed = src[packed_idx];
-            uint8_t code = ((start + i) % 2 == 0) ? (packed >> 4) : (packed & 0xF);
-            float val = e2m1_to_fp32(code);
-            float_array[start + i] = scale * val;
+    for (uint64_t r = 0; r < rows; ++r) {
+        const uint8_t *q = nvfp4_array->data + r * cols / 2;
+        const uint8_t *scales = nvfp4_array->block_scales + r * blocks_per_row;
+        float w[BSQ_DOT_PANEL];
+        float acc = 0.0f;
+        for (uint64_t b = 0; b < blocks_per_row; ++b) {
+            const uint8_t *qb = q + b * block_size / 2;
+            for (uint64_t j = 0; j < block_size / 2; ++j) {
+                w[2 * j]     = levels[qb[j] >> 4];
+                w[2 * j + 1] = levels[qb[j] & 0xF];
+            }
+            acc += block_levels[scales[b]] * bsq_dot_f32(w, x + b * block_size, block_size);
         }
+        y[r] = acc;
     }
     return 0;
 }
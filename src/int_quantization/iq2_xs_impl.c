@@ -1,4 +1,5 @@
 #include "int_quantization/iq2_xs_impl.h"
+#include "utils/alloc.h"
 #include "datatype/fp16/fp16.h"
 
 /* ============================================================================
@@ -330,19 +331,23 @@ static int64_t _get_iq2_xs_array_size(const iq2_xs_array_t *arr) {
                    + arr->num_super_blocks * 8);                   /* scales */
 }
 
-iq2_xs_array_t *allocate_iq2_xs_array(uint64_t num_elements) {
-    if (!num_elements) return NULL;
+int64_t compute_iq2_xs_array_size(uint64_t num_elements) {
+    if (!num_elements) return 0;
     
     uint64_t num_super_blocks = (num_elements + IQ2_XS_SUPER_BLOCK_SIZE - 1) / IQ2_XS_SUPER_BLOCK_SIZE;
     
-    size_t total = sizeof(iq2_xs_array_t)
-                 + num_super_blocks * sizeof(uint16_t)      /* d */
-                 + num_super_blocks * 32 * sizeof(uint16_t) /* qs */
-                 + num_super_blocks * 8;                    /* scales */
+    return (int64_t)(sizeof(iq2_xs_array_t)
+         + num_super_blocks * sizeof(uint16_t)      /* d */
+         + num_super_blocks * 32 * sizeof(uint16_t) /* qs */
+         + num_super_blocks * 8);                   /* scales */
+}
+
+iq2_xs_array_t *init_iq2_xs_array(void *buffer, uint64_t num_elements) {
+    if (!buffer || !num_elements) return NULL;
     
-    iq2_xs_array_t *arr = (iq2_xs_array_t *)calloc(1, total);
-    if (!arr) return NULL;
+    uint64_t num_super_blocks = (num_elements + IQ2_XS_SUPER_BLOCK_SIZE - 1) / IQ2_XS_SUPER_BLOCK_SIZE;
     
+    iq2_xs_array_t *arr = (iq2_xs_array_t *)buffer;
     arr->num_elements = num_elements;
     arr->num_super_blocks = num_super_blocks;
     arr->d = (uint16_t *)(arr + 1);
@@ -352,8 +357,17 @@ iq2_xs_array_t *allocate_iq2_xs_array(uint64_t num_elements) {
     return arr;
 }
 
+iq2_xs_array_t *allocate_iq2_xs_array(uint64_t num_elements) {
+    const int64_t total = compute_iq2_xs_array_size(num_elements);
+    if (total <= 0) return NULL;
+    
+    void *buffer = bsq_alloc_bytes((size_t)total, 0, 0);
+    if (!buffer) return NULL;
+    return init_iq2_xs_array(buffer, num_elements);
+}
+
 void free_iq2_xs_array(iq2_xs_array_t *arr) {
-    if (arr) free(arr);
+    if (arr) bsq_free_bytes(arr);
 }
 
 int64_t get_iq2_xs_array_size(const iq2_xs_array_t *arr) {
@@ -363,14 +377,14 @@ int64_t get_iq2_xs_array_size(const iq2_xs_array_t *arr) {
 iq2_xs_array_t *load_iq2_xs_array_from_buffer(const void *buffer, int64_t buffer_size) {
     if (!buffer || buffer_size < (int64_t)sizeof(iq2_xs_array_t)) return NULL;
     
-    iq2_xs_array_t *arr = (iq2_xs_array_t *)calloc(1, buffer_size);
+    iq2_xs_array_t *arr = (iq2_xs_array_t *)bsq_alloc_bytes((size_t)buffer_size, 0, BSQ_ALLOC_UNINITIALIZED);
     if (!arr) return NULL;
     
     memcpy(arr, buffer, buffer_size);
     
     const int64_t expected = _get_iq2_xs_array_size(arr);
     if (expected == 0 || buffer_size < expected) {
-        free(arr);
+        bsq_free_bytes(arr);
         return NULL;
     }
     
@@ -385,57 +399,102 @@ iq2_xs_array_t *load_iq2_xs_array_from_buffer(const void *buffer, int64_t buffer
  * Dequantization
  * ============================================================================ */
 
-int iq2_xs_decompress(const iq2_xs_array_t *arr, float *float_array) {
+/* Dequantize all IQ2_XS_SUPER_BLOCK_SIZE values of super block sb, padding included. */
+static void _decode_super_block(const iq2_xs_array_t *arr, uint64_t sb, float *out) {
+    const float d = fp16_ieee_to_fp32_value(arr->d[sb]);
+    const uint16_t *qs_block = arr->qs + sb * 32;
+    const uint8_t *scales_block = arr->scales + sb * 8;
+
+    /* Process 8 groups of 32 values */
+    for (int ib32 = 0; ib32 < 8; ++ib32) {
+        /* Two 4-bit scales per group (for 16 values each) */
+        float db[2];
+        db[0] = d * (0.5f + (float)(scales_block[ib32] & 0xf)) * 0.25f;
+        db[1] = d * (0.5f + (float)(scales_block[ib32] >> 4)) * 0.25f;
+
+        /* Process 4 sub-groups of 8 values */
+        for (int l = 0; l < 4; ++l) {
+            uint16_t qs_val = qs_block[4 * ib32 + l];
+            uint16_t grid_idx = qs_val & 511;  /* 9 bits */
+            uint8_t sign_idx = qs_val >> 9;    /* 7 bits */
+
+            const uint8_t *grid = (const uint8_t *)(iq2xs_grid + grid_idx);
+            const uint8_t signs = ksigns_iq2xs[sign_idx];
+
+            const float dl = db[l / 2];
+            float *dst = out + ib32 * 32 + l * 8;
+
+            for (int j = 0; j < 8; ++j) {
+                float val = dl * (float)grid[j];
+                dst[j] = (signs & kmask_iq2xs[j]) ? -val : val;
+            }
+        }
+    }
+}
+
+/* Decode the share of super block sb in [offset, end) into float_array, indexed from offset. */
+static void _decode_range_step(const iq2_xs_array_t *arr, uint64_t sb, uint64_t offset, uint64_t end,
+                               float *float_array) {
+    const uint64_t block_start = sb * IQ2_XS_SUPER_BLOCK_SIZE;
+    const uint64_t start = (block_start > offset) ? block_start : offset;
+    const uint64_t stop  = (block_start + IQ2_XS_SUPER_BLOCK_SIZE < end) ? block_start + IQ2_XS_SUPER_BLOCK_SIZE : end;
+
+    if (stop - start == IQ2_XS_SUPER_BLOCK_SIZE) {
+        _decode_super_block(arr, sb, float_array + (block_start - offset));
+    } else {
+        /* Partial head/tail super block: decode aside and keep the requested slice. */
+        float tmp[IQ2_XS_SUPER_BLOCK_SIZE];
+        _decode_super_block(arr, sb, tmp);
+        memcpy(float_array + (start - offset), tmp + (start - block_start), (stop - start) * sizeof(float));
+    }
+}
+
+static int _decompress_range(const iq2_xs_array_t *arr, uint64_t offset, uint64_t count, float *float_array,
+                             int parallel) {
     if (!arr || !float_array) return 1;
-    
-    const uint64_t num_super_blocks = arr->num_super_blocks;
-    const uint64_t num_elements = arr->num_elements;
-    
+    if (offset > arr->num_elements || count > arr->num_elements - offset) return 1;
+    if (count == 0) return 0;
+
+    const uint64_t end         = offset + count;
+    const uint64_t first_block = offset / IQ2_XS_SUPER_BLOCK_SIZE;
+    const uint64_t last_block  = (end - 1) / IQ2_XS_SUPER_BLOCK_SIZE;
+
 #if defined(__linux__) && defined(_OPENMP)
+    if (parallel) {
 #pragma omp parallel for
-#endif
-    for (uint64_t sb = 0; sb < num_super_blocks; ++sb) {
-        const uint64_t block_start = sb * IQ2_XS_SUPER_BLOCK_SIZE;
-        uint64_t block_end = block_start + IQ2_XS_SUPER_BLOCK_SIZE;
-        if (block_end > num_elements) block_end = num_elements;
-        
-        const float d = fp16_ieee_to_fp32_value(arr->d[sb]);
-        const uint16_t *qs_block = arr->qs + sb * 32;
-        const uint8_t *scales_block = arr->scales + sb * 8;
-        
-        /* Process 8 groups of 32 values */
-        for (int ib32 = 0; ib32 < 8; ++ib32) {
-            /* Two 4-bit scales per group (for 16 values each) */
-            float db[2];
-            db[0] = d * (0.5f + (float)(scales_block[ib32] & 0xf)) * 0.25f;
-            db[1] = d * (0.5f + (float)(scales_block[ib32] >> 4)) * 0.25f;
-            
-            /* Process 4 sub-groups of 8 values */
-            for (int l = 0; l < 4; ++l) {
-                uint16_t qs_val = qs_block[4 * ib32 + l];
-                uint16_t grid_idx = qs_val & 511;  /* 9 bits */
-                uint8_t sign_idx = qs_val >> 9;    /* 7 bits */
-                
-                const uint8_t *grid = (const uint8_t *)(iq2xs_grid + grid_idx);
-                const uint8_t signs = ksigns_iq2xs[sign_idx];
-                
-                const float dl = db[l / 2];
-                const uint64_t out_base = block_start + ib32 * 32 + l * 8;
-                
-                for (int j = 0; j < 8; ++j) {
-                    const uint64_t out_idx = out_base + j;
-                    if (out_idx < block_end) {
-                        float val = dl * (float)grid[j];
-                        float_array[out_idx] = (signs & kmask_iq2xs[j]) ? -val : val;
-                    }
-                }
-            }
+        for (uint64_t sb = first_block; sb <= last_block; ++sb) {
+            _decode_range_step(arr, sb, offset, end, float_array);
         }
+        return 0;
+    }
+#else
+    (void)parallel;
+#endif
+    for (uint64_t sb = first_block; sb <= last_block; ++sb) {
+        _decode_range_step(arr, sb, offset, end, float_array);
     }
-    
     return 0;
 }
 
+int iq2_xs_decompress_range(const iq2_xs_array_t *arr,
+                            uint64_t offset,
+                            uint64_t count,
+                            float *float_array) {
+    return _decompress_range(arr, offset, count, float_array, 1);
+}
+
+int iq2_xs_decompress_range_serial(const iq2_xs_array_t *arr,
+                                   uint64_t offset,
+                                   uint64_t count,
+                                   float *float_array) {
+    return _decompress_range(arr, offset, count, float_array, 0);
+}
+
+int iq2_xs_decompress(const iq2_xs_array_t *arr, float *float_array) {
+    if (!arr) return 1;
+    return iq2_xs_decompress_range(arr, 0, arr->num_elements, float_array);
+}
+
 /* ============================================================================
  * Quantization helpers
  * ============================================================================ */
@@ -481,229 +540,262 @@ static int iq2_find_best_neighbour(const uint16_t *neighbours, const uint64_t *g
  * Quantization
  * ============================================================================ */
 
-int iq2_xs_compress(const float *float_array, uint64_t num_elements, iq2_xs_array_t **out) {
-    if (!float_array || num_elements == 0 || !out || *out) return 1;
-    
-    if (!iq2_xs_initialized) {
-        iq2_xs_init();
-        if (!iq2_xs_initialized) return 1;
-    }
-    
-    iq2_xs_array_t *arr = allocate_iq2_xs_array(num_elements);
-    if (!arr) return 1;
-    
+/* Quantize super block sb of float_array into arr. */
+static void _compress_step(const float *float_array, iq2_xs_array_t *arr, uint64_t sb) {
+    const uint64_t num_elements = arr->num_elements;
     const int kMaxQ = 3;
     const float GROUP_MAX_EPS = 1e-8f;
+
+    float weight[16];
+    float xval[16];
+    float waux[16];
+    int8_t L[16];
+    int8_t Laux[16];
+    uint8_t block_signs[2];
+    uint16_t q2[32];
+    float scales[16];  /* 16 sub-group scales per super block */
+    
+    memset(q2, 0, sizeof(q2));
+    
+    uint64_t block_start = sb * IQ2_XS_SUPER_BLOCK_SIZE;
+    uint64_t block_end = block_start + IQ2_XS_SUPER_BLOCK_SIZE;
+    if (block_end > num_elements) block_end = num_elements;
+    
+    float sumx2 = 0;
+    for (uint64_t i = block_start; i < block_end; ++i) {
+        sumx2 += float_array[i] * float_array[i];
+    }
+    float sigma2 = sumx2 / (float)IQ2_XS_SUPER_BLOCK_SIZE;
     
-    const uint64_t num_super_blocks = arr->num_super_blocks;
+    float max_scale = 0;
     
-#if defined(__linux__) && defined(_OPENMP)
-#pragma omp parallel for
-#endif
-    for (uint64_t sb = 0; sb < num_super_blocks; ++sb) {
-        float weight[16];
-        float xval[16];
-        float waux[16];
-        int8_t L[16];
-        int8_t Laux[16];
-        uint8_t block_signs[2];
-        uint16_t q2[32];
-        float scales[16];  /* 16 sub-group scales per super block */
-        
-        memset(q2, 0, sizeof(q2));
+    /* Process 16 sub-groups of 16 values (8 groups × 2 halves) */
+    for (int ib = 0; ib < 16; ++ib) {
+        uint64_t group_start = block_start + ib * 16;
         
-        uint64_t block_start = sb * IQ2_XS_SUPER_BLOCK_SIZE;
-        uint64_t block_end = block_start + IQ2_XS_SUPER_BLOCK_SIZE;
-        if (block_end > num_elements) block_end = num_elements;
-        
-        float sumx2 = 0;
-        for (uint64_t i = block_start; i < block_end; ++i) {
-            sumx2 += float_array[i] * float_array[i];
+        for (int i = 0; i < 16; ++i) {
+            uint64_t idx = group_start + i;
+            float v = (idx < num_elements) ? float_array[idx] : 0.0f;
+            weight[i] = sqrtf(sigma2 + v * v);
+            waux[i] = sqrtf(weight[i]);
         }
-        float sigma2 = sumx2 / (float)IQ2_XS_SUPER_BLOCK_SIZE;
-        
-        float max_scale = 0;
         
-        /* Process 16 sub-groups of 16 values (8 groups × 2 halves) */
-        for (int ib = 0; ib < 16; ++ib) {
-            uint64_t group_start = block_start + ib * 16;
+        /* Handle signs with parity constraint for 2 sub-groups of 8 */
+        for (int k = 0; k < 2; ++k) {
+            int nflip = 0;
+            uint8_t s = 0;
             
-            for (int i = 0; i < 16; ++i) {
-                uint64_t idx = group_start + i;
+            for (int i = 0; i < 8; ++i) {
+                uint64_t idx = group_start + 8 * k + i;
                 float v = (idx < num_elements) ? float_array[idx] : 0.0f;
-                weight[i] = sqrtf(sigma2 + v * v);
-                waux[i] = sqrtf(weight[i]);
-            }
-            
-            /* Handle signs with parity constraint for 2 sub-groups of 8 */
-            for (int k = 0; k < 2; ++k) {
-                int nflip = 0;
-                uint8_t s = 0;
-                
-                for (int i = 0; i < 8; ++i) {
-                    uint64_t idx = group_start + 8 * k + i;
-                    float v = (idx < num_elements) ? float_array[idx] : 0.0f;
-                    
-                    if (v >= 0) {
-                        xval[8*k + i] = v;
-                    } else {
-                        xval[8*k + i] = -v;
-                        ++nflip;
-                        s |= (1 << i);
-                    }
-                }
                 
-                if (nflip % 2) {
-                    int imin = 0;
-                    float min = weight[8*k] * xval[8*k] * xval[8*k];
-                    for (int i = 1; i < 8; ++i) {
-                        float ax = weight[8*k+i] * xval[8*k+i] * xval[8*k+i];
-                        if (ax < min) { min = ax; imin = i; }
-                    }
-                    xval[8*k + imin] = -xval[8*k + imin];
-                    s ^= (1 << imin);
+                if (v >= 0) {
+                    xval[8*k + i] = v;
+                } else {
+                    xval[8*k + i] = -v;
+                    ++nflip;
+                    s |= (1 << i);
                 }
-                block_signs[k] = s & 127;
             }
             
-            float max = xval[0];
-            for (int i = 1; i < 16; ++i) {
-                if (xval[i] > max) max = xval[i];
+            if (nflip % 2) {
+                int imin = 0;
+                float min = weight[8*k] * xval[8*k] * xval[8*k];
+                for (int i = 1; i < 8; ++i) {
+                    float ax = weight[8*k+i] * xval[8*k+i] * xval[8*k+i];
+                    if (ax < min) { min = ax; imin = i; }
+                }
+                xval[8*k + imin] = -xval[8*k + imin];
+                s ^= (1 << imin);
             }
+            block_signs[k] = s & 127;
+        }
+        
+        float max = xval[0];
+        for (int i = 1; i < 16; ++i) {
+            if (xval[i] > max) max = xval[i];
+        }
+        
+        if (max < GROUP_MAX_EPS) {
+            scales[ib] = 0;
+            memset(L, 0, 16);
+        } else {
+            float best = 0;
+            float scale = max / (2 * kMaxQ - 1);
+            int is_on_grid[2] = {1, 1};
             
-            if (max < GROUP_MAX_EPS) {
-                scales[ib] = 0;
-                memset(L, 0, 16);
-            } else {
-                float best = 0;
-                float scale = max / (2 * kMaxQ - 1);
-                int is_on_grid[2] = {1, 1};
+            for (int is = -9; is <= 9; ++is) {
+                float id = (2 * kMaxQ - 1 + is * 0.1f) / max;
+                float this_scale = 1.0f / id;
+                int is_on_grid_aux[2] = {1, 1};
                 
-                for (int is = -9; is <= 9; ++is) {
-                    float id = (2 * kMaxQ - 1 + is * 0.1f) / max;
-                    float this_scale = 1.0f / id;
-                    int is_on_grid_aux[2] = {1, 1};
-                    
-                    for (int k = 0; k < 2; ++k) {
-                        for (int i = 0; i < 8; ++i) {
-                            int l = nearest_int(0.5f * (id * xval[8*k+i] - 1));
-                            if (l < 0) l = 0;
-                            if (l > kMaxQ - 1) l = kMaxQ - 1;
-                            Laux[8*k + i] = (int8_t)l;
-                        }
-                        
-                        uint16_t u = 0;
-                        for (int i = 0; i < 8; ++i) {
-                            u |= (Laux[8*k+i] << (2*i));
-                        }
-                        
-                        int grid_index = kmap_q2xs[u];
-                        if (grid_index < 0) {
-                            is_on_grid_aux[k] = 0;
-                            const uint16_t *neighbours = kneighbors_q2xs - kmap_q2xs[u] - 1;
-                            iq2_find_best_neighbour(neighbours, kgrid_q2xs, 
-                                                   xval + 8*k, waux + 8*k, 
-                                                   this_scale, Laux + 8*k);
-                        }
+                for (int k = 0; k < 2; ++k) {
+                    for (int i = 0; i < 8; ++i) {
+                        int l = nearest_int(0.5f * (id * xval[8*k+i] - 1));
+                        if (l < 0) l = 0;
+                        if (l > kMaxQ - 1) l = kMaxQ - 1;
+                        Laux[8*k + i] = (int8_t)l;
                     }
                     
-                    float sumqx = 0, sumq2 = 0;
-                    for (int i = 0; i < 16; ++i) {
-                        float w = weight[i];
-                        float q = 2 * Laux[i] + 1;
-                        sumqx += w * xval[i] * q;
-                        sumq2 += w * q * q;
+                    uint16_t u = 0;
+                    for (int i = 0; i < 8; ++i) {
+                        u |= (Laux[8*k+i] << (2*i));
                     }
                     
-                    if (sumq2 > 0 && sumqx * sumqx > best * sumq2) {
-                        scale = sumqx / sumq2;
-                        best = scale * sumqx;
-                        memcpy(L, Laux, 16);
-                        is_on_grid[0] = is_on_grid_aux[0];
-                        is_on_grid[1] = is_on_grid_aux[1];
+                    int grid_index = kmap_q2xs[u];
+                    if (grid_index < 0) {
+                        is_on_grid_aux[k] = 0;
+                        const uint16_t *neighbours = kneighbors_q2xs - kmap_q2xs[u] - 1;
+                        iq2_find_best_neighbour(neighbours, kgrid_q2xs, 
+                                               xval + 8*k, waux + 8*k, 
+                                               this_scale, Laux + 8*k);
                     }
                 }
                 
-                /* Refinement for off-grid points */
-                int n_not_ongrid = (is_on_grid[0] ? 0 : 1) + (is_on_grid[1] ? 0 : 1);
-                if (n_not_ongrid > 0 && scale > 0) {
-                    float id = 1.0f / scale;
-                    for (int k = 0; k < 2; ++k) {
-                        if (is_on_grid[k]) continue;
-                        uint16_t u = 0;
-                        for (int i = 0; i < 8; ++i) {
-                            int l = nearest_int(0.5f * (id * xval[8*k+i] - 1));
-                            if (l < 0) l = 0;
-                            if (l > kMaxQ - 1) l = kMaxQ - 1;
-                            u |= (l << (2*i));
-                            L[8*k + i] = l;
-                        }
-                        int grid_index = kmap_q2xs[u];
-                        if (grid_index < 0) {
-                            const uint16_t *neighbours = kneighbors_q2xs - kmap_q2xs[u] - 1;
-                            iq2_find_best_neighbour(neighbours, kgrid_q2xs, 
-                                                   xval + 8*k, waux + 8*k, 
-                                                   scale, L + 8*k);
-                        }
-                    }
-                    
-                    float sumqx = 0, sumq2 = 0;
-                    for (int i = 0; i < 16; ++i) {
-                        float w = weight[i];
-                        float q = 2 * L[i] + 1;
-                        sumqx += w * xval[i] * q;
-                        sumq2 += w * q * q;
-                    }
-                    if (sumq2 > 0) scale = sumqx / sumq2;
+                float sumqx = 0, sumq2 = 0;
+                for (int i = 0; i < 16; ++i) {
+                    float w = weight[i];
+                    float q = 2 * Laux[i] + 1;
+                    sumqx += w * xval[i] * q;
+                    sumq2 += w * q * q;
                 }
                 
-                if (scale < 0) {
-                    scale = -scale;
-                    for (int k = 0; k < 2; ++k) {
-                        block_signs[k] = (~block_signs[k]) & 127;
+                if (sumq2 > 0 && sumqx * sumqx > best * sumq2) {
+                    scale = sumqx / sumq2;
+                    best = scale * sumqx;
+                    memcpy(L, Laux, 16);
+                    is_on_grid[0] = is_on_grid_aux[0];
+                    is_on_grid[1] = is_on_grid_aux[1];
+                }
+            }
+            
+            /* Refinement for off-grid points */
+            int n_not_ongrid = (is_on_grid[0] ? 0 : 1) + (is_on_grid[1] ? 0 : 1);
+            if (n_not_ongrid > 0 && scale > 0) {
+                float id = 1.0f / scale;
+                for (int k = 0; k < 2; ++k) {
+                    if (is_on_grid[k]) continue;
+                    uint16_t u = 0;
+                    for (int i = 0; i < 8; ++i) {
+                        int l = nearest_int(0.5f * (id * xval[8*k+i] - 1));
+                        if (l < 0) l = 0;
+                        if (l > kMaxQ - 1) l = kMaxQ - 1;
+                        u |= (l << (2*i));
+                        L[8*k + i] = l;
+                    }
+                    int grid_index = kmap_q2xs[u];
+                    if (grid_index < 0) {
+                        const uint16_t *neighbours = kneighbors_q2xs - kmap_q2xs[u] - 1;
+                        iq2_find_best_neighbour(neighbours, kgrid_q2xs, 
+                                               xval + 8*k, waux + 8*k, 
+                                               scale, L + 8*k);
                     }
                 }
                 
-                scales[ib] = scale;
-                if (scale > max_scale) max_scale = scale;
+                float sumqx = 0, sumq2 = 0;
+                for (int i = 0; i < 16; ++i) {
+                    float w = weight[i];
+                    float q = 2 * L[i] + 1;
+                    sumqx += w * xval[i] * q;
+                    sumq2 += w * q * q;
+                }
+                if (sumq2 > 0) scale = sumqx / sumq2;
             }
             
-            /* Pack into q2: grid index (9 bits) | sign pattern (7 bits) */
-            for (int k = 0; k < 2; ++k) {
-                uint16_t u = 0;
-                for (int i = 0; i < 8; ++i) {
-                    u |= (L[8*k+i] << (2*i));
+            if (scale < 0) {
+                scale = -scale;
+                for (int k = 0; k < 2; ++k) {
+                    block_signs[k] = (~block_signs[k]) & 127;
                 }
-                int grid_index = kmap_q2xs[u];
-                if (grid_index < 0) grid_index = 0;
-                
-                q2[2 * ib + k] = (uint16_t)grid_index | ((uint16_t)block_signs[k] << 9);
             }
+            
+            scales[ib] = scale;
+            if (scale > max_scale) max_scale = scale;
         }
         
-        /* Encode block scale */
-        if (max_scale == 0) {
-            arr->d[sb] = 0;
-            memset(arr->qs + sb * 32, 0, 64);
-            memset(arr->scales + sb * 8, 0, 8);
-        } else {
-            float d = max_scale / 31.0f;
-            arr->d[sb] = fp16_ieee_from_fp32_value(d);
-            float id = 1.0f / d;
-            
-            /* Encode group scales: 2 × 4-bit scales per byte */
-            for (int ib32 = 0; ib32 < 8; ++ib32) {
-                int l0 = nearest_int(0.5f * (id * scales[2*ib32 + 0] - 1));
-                int l1 = nearest_int(0.5f * (id * scales[2*ib32 + 1] - 1));
-                if (l0 < 0) l0 = 0; if (l0 > 15) l0 = 15;
-                if (l1 < 0) l1 = 0; if (l1 > 15) l1 = 15;
-                arr->scales[sb * 8 + ib32] = (uint8_t)(l0 | (l1 << 4));
+        /* Pack into q2: grid index (9 bits) | sign pattern (7 bits) */
+        for (int k = 0; k < 2; ++k) {
+            uint16_t u = 0;
+            for (int i = 0; i < 8; ++i) {
+                u |= (L[8*k+i] << (2*i));
             }
+            int grid_index = kmap_q2xs[u];
+            if (grid_index < 0) grid_index = 0;
             
-            memcpy(arr->qs + sb * 32, q2, 64);
+            q2[2 * ib + k] = (uint16_t)grid_index | ((uint16_t)block_signs[k] << 9);
         }
     }
     
+    /* Encode block scale */
+    if (max_scale == 0) {
+        arr->d[sb] = 0;
+        memset(arr->qs + sb * 32, 0, 64);
+        memset(arr->scales + sb * 8, 0, 8);
+    } else {
+        float d = max_scale / 31.0f;
+        arr->d[sb] = fp16_ieee_from_fp32_value(d);
+        float id = 1.0f / d;
+        
+        /* Encode group scales: 2 × 4-bit scales per byte */
+        for (int ib32 = 0; ib32 < 8; ++ib32) {
+            int l0 = nearest_int(0.5f * (id * scales[2*ib32 + 0] - 1));
+            int l1 = nearest_int(0.5f * (id * scales[2*ib32 + 1] - 1));
+            if (l0 < 0) l0 = 0; if (l0 > 15) l0 = 15;
+            if (l1 < 0) l1 = 0; if (l1 > 15) l1 = 15;
+            arr->scales[sb * 8 + ib32] = (uint8_t)(l0 | (l1 << 4));
+        }
+        
+        memcpy(arr->qs + sb * 32, q2, 64);
+    }
+}
+
+static int _compress_into(const float *float_array, iq2_xs_array_t *arr, int parallel) {
+    if (!float_array || !arr) return 1;
+    
+    if (!iq2_xs_initialized) {
+        iq2_xs_init();
+        if (!iq2_xs_initialized) return 1;
+    }
+
+    const uint64_t num_super_blocks = arr->num_super_blocks;
+    
+#if defined(__linux__) && defined(_OPENMP)
+    if (parallel) {
+#pragma omp parallel for
+        for (uint64_t sb = 0; sb < num_super_blocks; ++sb) {
+            _compress_step(float_array, arr, sb);
+        }
+        return 0;
+    }
+#else
+    (void)parallel;
+#endif
+    for (uint64_t sb = 0; sb < num_super_blocks; ++sb) {
+        _compress_step(float_array, arr, sb);
+    }
+    
+    return 0;
+}
+
+int iq2_xs_compress_into(const float *float_array, iq2_xs_array_t *arr) {
+    return _compress_into(float_array, arr, 1);
+}
+
+int iq2_xs_compress_into_serial(const float *float_array, iq2_xs_array_t *arr) {
+    return _compress_into(float_array, arr, 0);
+}
+
+int iq2_xs_compress(const float *float_array, uint64_t num_elements, iq2_xs_array_t **out) {
+    if (!float_array || num_elements == 0 || !out || *out) return 1;
+    
+    iq2_xs_array_t *arr = allocate_iq2_xs_array(num_elements);
+    if (!arr) return 1;
+    
+    if (iq2_xs_compress_into(float_array, arr)) {
+        free_iq2_xs_array(arr);
+        return 1;
+    }
+    
     *out = arr;
     return 0;
 }
@@ -1,4 +1,5 @@
 #include "int_quantization/iq2_xxs_impl.h"
+#include "utils/alloc.h"
 
 /* ============================================================================
  * Lookup Tables
@@ -274,18 +275,22 @@ static int64_t _get_iq2_xxs_array_size(const iq2_xxs_array_t *arr) {
                    + arr->num_super_blocks * 64);
 }
 
-iq2_xxs_array_t *allocate_iq2_xxs_array(uint64_t num_elements) {
-    if (!num_elements) return NULL;
+int64_t compute_iq2_xxs_array_size(uint64_t num_elements) {
+    if (!num_elements) return 0;
     
     uint64_t num_super_blocks = (num_elements + IQ2_XXS_SUPER_BLOCK_SIZE - 1) / IQ2_XXS_SUPER_BLOCK_SIZE;
     
-    size_t total = sizeof(iq2_xxs_array_t)
-                 + num_super_blocks * sizeof(uint16_t)   /* scales */
-                 + num_super_blocks * 64;                /* qs data */
+    return (int64_t)(sizeof(iq2_xxs_array_t)
+         + num_super_blocks * sizeof(uint16_t)   /* scales */
+         + num_super_blocks * 64);               /* qs data */
+}
+
+iq2_xxs_array_t *init_iq2_xxs_array(void *buffer, uint64_t num_elements) {
+    if (!buffer || !num_elements) return NULL;
     
-    iq2_xxs_array_t *arr = (iq2_xxs_array_t *)calloc(1, total);
-    if (!arr) return NULL;
+    uint64_t num_super_blocks = (num_elements + IQ2_XXS_SUPER_BLOCK_SIZE - 1) / IQ2_XXS_SUPER_BLOCK_SIZE;
     
+    iq2_xxs_array_t *arr = (iq2_xxs_array_t *)buffer;
     arr->num_elements = num_elements;
     arr->num_super_blocks = num_super_blocks;
     arr->scales = (uint16_t *)(arr + 1);
@@ -294,8 +299,17 @@ iq2_xxs_array_t *allocate_iq2_xxs_array(uint64_t num_elements) {
     return arr;
 }
 
+iq2_xxs_array_t *allocate_iq2_xxs_array(uint64_t num_elements) {
+    const int64_t total = compute_iq2_xxs_array_size(num_elements);
+    if (total <= 0) return NULL;
+    
+    void *buffer = bsq_alloc_bytes((size_t)total, 0, 0);
+    if (!buffer) return NULL;
+    return init_iq2_xxs_array(buffer, num_elements);
+}
+
 void free_iq2_xxs_array(iq2_xxs_array_t *arr) {
-    if (arr) free(arr);
+    if (arr) bsq_free_bytes(arr);
 }
 
 int64_t get_iq2_xxs_array_size(const iq2_xxs_array_t *arr) {
@@ -305,14 +319,14 @@ int64_t get_iq2_xxs_array_size(const iq2_xxs_array_t *arr) {
 iq2_xxs_array_t *load_iq2_xxs_array_from_buffer(const void *buffer, int64_t buffer_size) {
     if (!buffer || buffer_size < (int64_t)sizeof(iq2_xxs_array_t)) return NULL;
     
-    iq2_xxs_array_t *arr = (iq2_xxs_array_t *)calloc(1, buffer_size);
+    iq2_xxs_array_t *arr = (iq2_xxs_array_t *)bsq_alloc_bytes((size_t)buffer_size, 0, BSQ_ALLOC_UNINITIALIZED);
     if (!arr) return NULL;
     
     memcpy(arr, buffer, buffer_size);
     
     const int64_t expected = _get_iq2_xxs_array_size(arr);
     if (expected == 0 || buffer_size < expected) {
-        free(arr);
+        bsq_free_bytes(arr);
         return NULL;
     }
     
@@ -326,54 +340,99 @@ iq2_xxs_array_t *load_iq2_xxs_array_from_buffer(const void *buffer, int64_t buff
  * Dequantization (the simpler direction)
  * ============================================================================ */
 
-int iq2_xxs_decompress(const iq2_xxs_array_t *arr, float *float_array) {
+/* Dequantize all IQ2_XXS_SUPER_BLOCK_SIZE values of super block sb, padding included. */
+static void _decode_super_block(const iq2_xxs_array_t *arr, uint64_t sb, float *out) {
+    const float d = fp16_ieee_to_fp32_value(arr->scales[sb]);
+    const uint8_t *qs_block = arr->qs + sb * 64;
+
+    /* Process 8 groups of 32 values each */
+    for (int ib32 = 0; ib32 < 8; ++ib32) {
+        uint32_t aux32[2];
+        memcpy(aux32, qs_block + ib32 * 8, 8);
+
+        const uint8_t *aux8 = (const uint8_t *)aux32;
+
+        /* Group scale: upper 4 bits of aux32[1] give value 0-15 */
+        const float db = d * (0.5f + (float)(aux32[1] >> 28)) * 0.25f;
+
+        /* Process 4 sub-groups of 8 values each */
+        for (int l = 0; l < 4; ++l) {
+            const uint8_t grid_idx = aux8[l];
+            const uint8_t *grid = (const uint8_t *)(iq2xxs_grid + grid_idx);
+            const uint8_t signs = ksigns_iq2xs[(aux32[1] >> (7 * l)) & 127];
+            float *dst = out + ib32 * 32 + l * 8;
+
+            for (int j = 0; j < 8; ++j) {
+                float val = db * (float)grid[j];
+                dst[j] = (signs & kmask_iq2xs[j]) ? -val : val;
+            }
+        }
+    }
+}
+
+/* Decode the share of super block sb in [offset, end) into float_array, indexed from offset. */
+static void _decode_range_step(const iq2_xxs_array_t *arr, uint64_t sb, uint64_t offset, uint64_t end,
+                               float *float_array) {
+    const uint64_t block_start = sb * IQ2_XXS_SUPER_BLOCK_SIZE;
+    const uint64_t start = (block_start > offset) ? block_start : offset;
+    const uint64_t stop  = (block_start + IQ2_XXS_SUPER_BLOCK_SIZE < end) ? block_start + IQ2_XXS_SUPER_BLOCK_SIZE : end;
+
+    if (stop - start == IQ2_XXS_SUPER_BLOCK_SIZE) {
+        _decode_super_block(arr, sb, float_array + (block_start - offset));
+    } else {
+        /* Partial head/tail super block: decode aside and keep the requested slice. */
+        float tmp[IQ2_XXS_SUPER_BLOCK_SIZE];
+        _decode_super_block(arr, sb, tmp);
+        memcpy(float_array + (start - offset), tmp + (start - block_start), (stop - start) * sizeof(float));
+    }
+}
+
+static int _decompress_range(const iq2_xxs_array_t *arr, uint64_t offset, uint64_t count, float *float_array,
+                             int parallel) {
     if (!arr || !float_array) return 1;
-    
-    const uint64_t num_super_blocks = arr->num_super_blocks;
-    const uint64_t num_elements = arr->num_elements;
-    
+    if (offset > arr->num_elements || count > arr->num_elements - offset) return 1;
+    if (count == 0) return 0;
+
+    const uint64_t end         = offset + count;
+    const uint64_t first_block = offset / IQ2_XXS_SUPER_BLOCK_SIZE;
+    const uint64_t last_block  = (end - 1) / IQ2_XXS_SUPER_BLOCK_SIZE;
+
 #if defined(__linux__) && defined(_OPENMP)
+    if (parallel) {
 #pragma omp parallel for
-#endif
-    for (uint64_t sb = 0; sb < num_super_blocks; ++sb) {
-        const uint64_t block_start = sb * IQ2_XXS_SUPER_BLOCK_SIZE;
-        uint64_t block_end = block_start + IQ2_XXS_SUPER_BLOCK_SIZE;
-        if (block_end > num_elements) block_end = num_elements;
-        
-        const float d = fp16_ieee_to_fp32_value(arr->scales[sb]);
-        const uint8_t *qs_block = arr->qs + sb * 64;
-        
-        /* Process 8 groups of 32 values each */
-        for (int ib32 = 0; ib32 < 8; ++ib32) {
-            uint32_t aux32[2];
-            memcpy(aux32, qs_block + ib32 * 8, 8);
-            
-            const uint8_t *aux8 = (const uint8_t *)aux32;
-            
-            /* Group scale: upper 4 bits of aux32[1] give value 0-15 */
-            const float db = d * (0.5f + (float)(aux32[1] >> 28)) * 0.25f;
-            
-            /* Process 4 sub-groups of 8 values each */
-            for (int l = 0; l < 4; ++l) {
-                const uint8_t grid_idx = aux8[l];
-                const uint8_t *grid = (const uint8_t *)(iq2xxs_grid + grid_idx);
-                const uint8_t signs = ksigns_iq2xs[(aux32[1] >> (7 * l)) & 127];
-                const uint64_t out_base = block_start + ib32 * 32 + l * 8;
-                
-                for (int j = 0; j < 8; ++j) {
-                    const uint64_t out_idx = out_base + j;
-                    if (out_idx < block_end) {
-                        float val = db * (float)grid[j];
-                        float_array[out_idx] = (signs & kmask_iq2xs[j]) ? -val : val;
-                    }
-                }
-            }
+        for (uint64_t sb = first_block; sb <= last_block; ++sb) {
+            _decode_range_step(arr, sb, offset, end, float_array);
         }
+        return 0;
+    }
+#else
+    (void)parallel;
+#endif
+    for (uint64_t sb = first_block; sb <= last_block; ++sb) {
+        _decode_range_step(arr, sb, offset, end, float_array);
     }
-    
     return 0;
 }
 
+int iq2_xxs_decompress_range(const iq2_xxs_array_t *arr,
+                             uint64_t offset,
+                             uint64_t count,
+                             float *float_array) {
+    return _decompress_range(arr, offset, count, float_array, 1);
+}
+
+int iq2_xxs_decompress_range_serial(const iq2_xxs_array_t *arr,
+                                    uint64_t offset,
+                                    uint64_t count,
+                                    float *float_array) {
+    return _decompress_range(arr, offset, count, float_array, 0);
+}
+
+int iq2_xxs_decompress(const iq2_xxs_array_t *arr, float *float_array) {
+    if (!arr) return 1;
+    return iq2_xxs_decompress_range(arr, 0, arr->num_elements, float_array);
+}
+
 /* ============================================================================
  * Quantization helpers
  * ============================================================================ */
@@ -420,245 +479,278 @@ static int iq2_find_best_neighbour(const uint16_t *neighbours, const uint64_t *g
  * Quantization (the complex direction)
  * ============================================================================ */
 
-int iq2_xxs_compress(const float *float_array, uint64_t num_elements, iq2_xxs_array_t **out) {
-    if (!float_array || num_elements == 0 || !out || *out) return 1;
-    
-    /* Ensure tables are initialized */
-    if (!iq2_xxs_initialized) {
-        iq2_xxs_init();
-        if (!iq2_xxs_initialized) return 1;
-    }
-    
-    iq2_xxs_array_t *arr = allocate_iq2_xxs_array(num_elements);
-    if (!arr) return 1;
-    
+/* Quantize super block sb of float_array into arr. */
+static void _compress_step(const float *float_array, iq2_xxs_array_t *arr, uint64_t sb) {
+    const uint64_t num_elements = arr->num_elements;
     const int kMaxQ = 3;  /* Max quantization level (0-3 maps to 1,3,5,7) */
     const float GROUP_MAX_EPS = 1e-8f;
+
+    float weight[32];
+    float xval[32];
+    float waux[32];
+    int8_t L[32];
+    int8_t Laux[32];
+    uint8_t block_signs[4];
+    uint32_t q2[16];  /* 2 uint32 per group × 8 groups = 16 */
+    float scales[8];
+    
+    memset(q2, 0, sizeof(q2));
+    
+    /* Compute variance for importance weighting */
+    float sumx2 = 0;
+    uint64_t block_start = sb * IQ2_XXS_SUPER_BLOCK_SIZE;
+    uint64_t block_end = block_start + IQ2_XXS_SUPER_BLOCK_SIZE;
+    if (block_end > num_elements) block_end = num_elements;
+    // uint64_t block_len = block_end - block_start;
+    
+    for (uint64_t i = block_start; i < block_end; ++i) {
+        sumx2 += float_array[i] * float_array[i];
+    }
+    float sigma2 = sumx2 / (float)IQ2_XXS_SUPER_BLOCK_SIZE;
     
-    const uint64_t num_super_blocks = arr->num_super_blocks;
+    float max_scale = 0;
     
-#if defined(__linux__) && defined(_OPENMP)
-#pragma omp parallel for
-#endif
-    for (uint64_t sb = 0; sb < num_super_blocks; ++sb) {
-        float weight[32];
-        float xval[32];
-        float waux[32];
-        int8_t L[32];
-        int8_t Laux[32];
-        uint8_t block_signs[4];
-        uint32_t q2[16];  /* 2 uint32 per group × 8 groups = 16 */
-        float scales[8];
-        
-        memset(q2, 0, sizeof(q2));
-        
-        /* Compute variance for importance weighting */
-        float sumx2 = 0;
-        uint64_t block_start = sb * IQ2_XXS_SUPER_BLOCK_SIZE;
-        uint64_t block_end = block_start + IQ2_XXS_SUPER_BLOCK_SIZE;
-        if (block_end > num_elements) block_end = num_elements;
-        // uint64_t block_len = block_end - block_start;
+    /* Process 8 groups of 32 values */
+    for (int ib = 0; ib < 8; ++ib) {
+        uint64_t group_start = block_start + ib * 32;
+        uint64_t group_end = group_start + 32;
+        if (group_end > num_elements) group_end = num_elements;
         
-        for (uint64_t i = block_start; i < block_end; ++i) {
-            sumx2 += float_array[i] * float_array[i];
+        /* Build weight and absolute values with sign handling */
+        for (int i = 0; i < 32; ++i) {
+            uint64_t idx = group_start + i;
+            float v = (idx < num_elements) ? float_array[idx] : 0.0f;
+            weight[i] = sqrtf(sigma2 + v * v);
+            waux[i] = sqrtf(weight[i]);
         }
-        float sigma2 = sumx2 / (float)IQ2_XXS_SUPER_BLOCK_SIZE;
         
-        float max_scale = 0;
-        
-        /* Process 8 groups of 32 values */
-        for (int ib = 0; ib < 8; ++ib) {
-            uint64_t group_start = block_start + ib * 32;
-            uint64_t group_end = group_start + 32;
-            if (group_end > num_elements) group_end = num_elements;
+        /* Handle signs with parity constraint */
+        for (int k = 0; k < 4; ++k) {
+            int nflip = 0;
+            uint8_t s = 0;
             
-            /* Build weight and absolute values with sign handling */
-            for (int i = 0; i < 32; ++i) {
-                uint64_t idx = group_start + i;
+            for (int i = 0; i < 8; ++i) {
+                uint64_t idx = group_start + 8 * k + i;
                 float v = (idx < num_elements) ? float_array[idx] : 0.0f;
-                weight[i] = sqrtf(sigma2 + v * v);
-                waux[i] = sqrtf(weight[i]);
-            }
-            
-            /* Handle signs with parity constraint */
-            for (int k = 0; k < 4; ++k) {
-                int nflip = 0;
-                uint8_t s = 0;
                 
-                for (int i = 0; i < 8; ++i) {
-                    uint64_t idx = group_start + 8 * k + i;
-                    float v = (idx < num_elements) ? float_array[idx] : 0.0f;
-                    
-                    if (v >= 0) {
-                        xval[8*k + i] = v;
-                    } else {
-                        xval[8*k + i] = -v;
-                        ++nflip;
-                        s |= (1 << i);
-                    }
-                }
-                
-                /* Enforce even parity by flipping least important sign */
-                if (nflip % 2) {
-                    int imin = 0;
-                    float min = weight[8*k] * xval[8*k] * xval[8*k];
-                    for (int i = 1; i < 8; ++i) {
-                        float ax = weight[8*k+i] * xval[8*k+i] * xval[8*k+i];
-                        if (ax < min) {
-                            min = ax;
-                            imin = i;
-                        }
-                    }
-                    xval[8*k + imin] = -xval[8*k + imin];
-                    s ^= (1 << imin);
+                if (v >= 0) {
+                    xval[8*k + i] = v;
+                } else {
+                    xval[8*k + i] = -v;
+                    ++nflip;
+                    s |= (1 << i);
                 }
-                block_signs[k] = s & 127;
             }
             
-            /* Find max for initial scale estimate */
-            float max = xval[0];
-            for (int i = 1; i < 32; ++i) {
-                if (xval[i] > max) max = xval[i];
+            /* Enforce even parity by flipping least important sign */
+            if (nflip % 2) {
+                int imin = 0;
+                float min = weight[8*k] * xval[8*k] * xval[8*k];
+                for (int i = 1; i < 8; ++i) {
+                    float ax = weight[8*k+i] * xval[8*k+i] * xval[8*k+i];
+                    if (ax < min) {
+                        min = ax;
+                        imin = i;
+                    }
+                }
+                xval[8*k + imin] = -xval[8*k + imin];
+                s ^= (1 << imin);
             }
+            block_signs[k] = s & 127;
+        }
+        
+        /* Find max for initial scale estimate */
+        float max = xval[0];
+        for (int i = 1; i < 32; ++i) {
+            if (xval[i] > max) max = xval[i];
+        }
+        
+        if (max < GROUP_MAX_EPS) {
+            scales[ib] = 0;
+            memset(L, 0, 32);
+        } else {
+            /* Search for optimal scale */
+            float best = 0;
+            float scale = max / (2 * kMaxQ - 1);
             
-            if (max < GROUP_MAX_EPS) {
-                scales[ib] = 0;
-                memset(L, 0, 32);
-            } else {
-                /* Search for optimal scale */
-                float best = 0;
-                float scale = max / (2 * kMaxQ - 1);
+            for (int is = -6; is <= 6; ++is) {
+                float id = (2 * kMaxQ - 1 + is * 0.1f) / max;
+                float this_scale = 1.0f / id;
                 
-                for (int is = -6; is <= 6; ++is) {
-                    float id = (2 * kMaxQ - 1 + is * 0.1f) / max;
-                    float this_scale = 1.0f / id;
-                    
-                    /* Quantize each sub-group */
-                    for (int k = 0; k < 4; ++k) {
-                        for (int i = 0; i < 8; ++i) {
-                            int l = nearest_int(0.5f * (id * xval[8*k+i] - 1));
-                            if (l < 0) l = 0;
-                            if (l > kMaxQ - 1) l = kMaxQ - 1;
-                            Laux[8*k + i] = (int8_t)l;
-                        }
-                        
-                        /* Check if on grid, find neighbors if not */
-                        uint16_t u = 0;
-                        for (int i = 0; i < 8; ++i) {
-                            u |= (Laux[8*k+i] << (2*i));
-                        }
-                        
-                        int grid_index = kmap_q2xs[u];
-                        if (grid_index < 0) {
-                            const uint16_t *neighbours = kneighbors_q2xs - kmap_q2xs[u] - 1;
-                            iq2_find_best_neighbour(neighbours, kgrid_q2xs, 
-                                                   xval + 8*k, waux + 8*k, 
-                                                   this_scale, Laux + 8*k);
-                        }
+                /* Quantize each sub-group */
+                for (int k = 0; k < 4; ++k) {
+                    for (int i = 0; i < 8; ++i) {
+                        int l = nearest_int(0.5f * (id * xval[8*k+i] - 1));
+                        if (l < 0) l = 0;
+                        if (l > kMaxQ - 1) l = kMaxQ - 1;
+                        Laux[8*k + i] = (int8_t)l;
                     }
                     
-                    /* Compute weighted error and optimal scale */
-                    float sumqx = 0, sumq2 = 0;
-                    for (int i = 0; i < 32; ++i) {
-                        float w = weight[i];
-                        float q = 2 * Laux[i] + 1;
-                        sumqx += w * xval[i] * q;
-                        sumq2 += w * q * q;
+                    /* Check if on grid, find neighbors if not */
+                    uint16_t u = 0;
+                    for (int i = 0; i < 8; ++i) {
+                        u |= (Laux[8*k+i] << (2*i));
                     }
                     
-                    if (sumq2 > 0 && sumqx * sumqx > best * sumq2) {
-                        scale = sumqx / sumq2;
-                        best = scale * sumqx;
-                        memcpy(L, Laux, 32);
+                    int grid_index = kmap_q2xs[u];
+                    if (grid_index < 0) {
+                        const uint16_t *neighbours = kneighbors_q2xs - kmap_q2xs[u] - 1;
+                        iq2_find_best_neighbour(neighbours, kgrid_q2xs, 
+                                               xval + 8*k, waux + 8*k, 
+                                               this_scale, Laux + 8*k);
                     }
                 }
                 
-                /* Final refinement */
-                if (scale > 0) {
-                    float id = 1.0f / scale;
-                    for (int k = 0; k < 4; ++k) {
-                        uint16_t u = 0;
-                        for (int i = 0; i < 8; ++i) {
-                            int l = nearest_int(0.5f * (id * xval[8*k+i] - 1));
-                            if (l < 0) l = 0;
-                            if (l > kMaxQ - 1) l = kMaxQ - 1;
-                            u |= (l << (2*i));
-                        }
-                        
-                        int grid_index = kmap_q2xs[u];
-                        if (grid_index < 0) {
-                            const uint16_t *neighbours = kneighbors_q2xs - kmap_q2xs[u] - 1;
-                            iq2_find_best_neighbour(neighbours, kgrid_q2xs, 
-                                                   xval + 8*k, waux + 8*k, 
-                                                   scale, L + 8*k);
-                        } else {
-                            const int8_t *pg = (const int8_t *)(kgrid_q2xs + grid_index);
-                            for (int i = 0; i < 8; ++i) {
-                                L[8*k+i] = (pg[i] - 1) / 2;
-                            }
-                        }
+                /* Compute weighted error and optimal scale */
+                float sumqx = 0, sumq2 = 0;
+                for (int i = 0; i < 32; ++i) {
+                    float w = weight[i];
+                    float q = 2 * Laux[i] + 1;
+                    sumqx += w * xval[i] * q;
+                    sumq2 += w * q * q;
+                }
+                
+                if (sumq2 > 0 && sumqx * sumqx > best * sumq2) {
+                    scale = sumqx / sumq2;
+                    best = scale * sumqx;
+                    memcpy(L, Laux, 32);
+                }
+            }
+            
+            /* Final refinement */
+            if (scale > 0) {
+                float id = 1.0f / scale;
+                for (int k = 0; k < 4; ++k) {
+                    uint16_t u = 0;
+                    for (int i = 0; i < 8; ++i) {
+                        int l = nearest_int(0.5f * (id * xval[8*k+i] - 1));
+                        if (l < 0) l = 0;
+                        if (l > kMaxQ - 1) l = kMaxQ - 1;
+                        u |= (l << (2*i));
                     }
                     
-                    /* Recompute optimal scale */
-                    float sumqx = 0, sumq2 = 0;
-                    for (int i = 0; i < 32; ++i) {
-                        float w = weight[i];
-                        float q = 2 * L[i] + 1;
-                        sumqx += w * xval[i] * q;
-                        sumq2 += w * q * q;
+                    int grid_index = kmap_q2xs[u];
+                    if (grid_index < 0) {
+                        const uint16_t *neighbours = kneighbors_q2xs - kmap_q2xs[u] - 1;
+                        iq2_find_best_neighbour(neighbours, kgrid_q2xs, 
+                                               xval + 8*k, waux + 8*k, 
+                                               scale, L + 8*k);
+                    } else {
+                        const int8_t *pg = (const int8_t *)(kgrid_q2xs + grid_index);
+                        for (int i = 0; i < 8; ++i) {
+                            L[8*k+i] = (pg[i] - 1) / 2;
+                        }
                     }
-                    if (sumq2 > 0) scale = sumqx / sumq2;
                 }
                 
-                /* Handle negative scale (shouldn't happen but just in case) */
-                if (scale < 0) {
-                    scale = -scale;
-                    for (int k = 0; k < 4; ++k) {
-                        block_signs[k] = (~block_signs[k]) & 127;
-                    }
+                /* Recompute optimal scale */
+                float sumqx = 0, sumq2 = 0;
+                for (int i = 0; i < 32; ++i) {
+                    float w = weight[i];
+                    float q = 2 * L[i] + 1;
+                    sumqx += w * xval[i] * q;
+                    sumq2 += w * q * q;
                 }
-                
-                scales[ib] = scale;
-                if (scale > max_scale) max_scale = scale;
+                if (sumq2 > 0) scale = sumqx / sumq2;
             }
             
-            /* Pack grid indices and signs into q2 */
-            for (int k = 0; k < 4; ++k) {
-                uint16_t u = 0;
-                for (int i = 0; i < 8; ++i) {
-                    u |= (L[8*k+i] << (2*i));
+            /* Handle negative scale (shouldn't happen but just in case) */
+            if (scale < 0) {
+                scale = -scale;
+                for (int k = 0; k < 4; ++k) {
+                    block_signs[k] = (~block_signs[k]) & 127;
                 }
-                int grid_index = kmap_q2xs[u];
-                if (grid_index < 0) {
-                    /* This shouldn't happen after optimization, but handle gracefully */
-                    grid_index = 0;
-                }
-                q2[2*ib + 0] |= ((uint32_t)grid_index << (8*k));
-                q2[2*ib + 1] |= ((uint32_t)block_signs[k] << (7*k));
             }
+            
+            scales[ib] = scale;
+            if (scale > max_scale) max_scale = scale;
         }
         
-        /* Encode block scale */
-        if (max_scale == 0) {
-            arr->scales[sb] = 0;
-            memset(arr->qs + sb * 64, 0, 64);
-        } else {
-            float d = max_scale / 31.0f;
-            arr->scales[sb] = fp16_ieee_from_fp32_value(d);
-            float id = 1.0f / d;
-            
-            /* Encode group scales into upper 4 bits */
-            for (int ib = 0; ib < 8; ++ib) {
-                int l = nearest_int(0.5f * (id * scales[ib] - 1));
-                if (l < 0) l = 0;
-                if (l > 15) l = 15;
-                q2[2*ib + 1] |= ((uint32_t)l << 28);
+        /* Pack grid indices and signs into q2 */
+        for (int k = 0; k < 4; ++k) {
+            uint16_t u = 0;
+            for (int i = 0; i < 8; ++i) {
+                u |= (L[8*k+i] << (2*i));
             }
-            
-            memcpy(arr->qs + sb * 64, q2, 64);
+            int grid_index = kmap_q2xs[u];
+            if (grid_index < 0) {
+                /* This shouldn't happen after optimization, but handle gracefully */
+                grid_index = 0;
+            }
+            q2[2*ib + 0] |= ((uint32_t)grid_index << (8*k));
+            q2[2*ib + 1] |= ((uint32_t)block_signs[k] << (7*k));
         }
     }
     
+    /* Encode block scale */
+    if (max_scale == 0) {
+        arr->scales[sb] = 0;
+        memset(arr->qs + sb * 64, 0, 64);
+    } else {
+        float d = max_scale / 31.0f;
+        arr->scales[sb] = fp16_ieee_from_fp32_value(d);
+        float id = 1.0f / d;
+        
+        /* Encode group scales into upper 4 bits */
+        for (int ib = 0; ib < 8; ++ib) {
+            int l = nearest_int(0.5f * (id * scales[ib] - 1));
+            if (l < 0) l = 0;
+            if (l > 15) l = 15;
+            q2[2*ib + 1] |= ((uint32_t)l << 28);
+        }
+        
+        memcpy(arr->qs + sb * 64, q2, 64);
+    }
+}
+
+static int _compress_into(const float *float_array, iq2_xxs_array_t *arr, int parallel) {
+    if (!float_array || !arr) return 1;
+    
+    /* Ensure tables are initialized */
+    if (!iq2_xxs_initialized) {
+        iq2_xxs_init();
+        if (!iq2_xxs_initialized) return 1;
+    }
+
+    const uint64_t num_super_blocks = arr->num_super_blocks;
+    
+#if defined(__linux__) && defined(_OPENMP)
+    if (parallel) {
+#pragma omp parallel for
+        for (uint64_t sb = 0; sb < num_super_blocks; ++sb) {
+            _compress_step(float_array, arr, sb);
+        }
+        return 0;
+    }
+#else
+    (void)parallel;
+#endif
+    for (uint64_t sb = 0; sb < num_super_blocks; ++sb) {
+        _compress_step(float_array, arr, sb);
+    }
+    
+    return 0;
+}
+
+int iq2_xxs_compress_into(const float *float_array, iq2_xxs_array_t *arr) {
+    return _compress_into(float_array, arr, 1);
+}
+
+int iq2_xxs_compress_into_serial(const float *float_array, iq2_xxs_array_t *arr) {
+    return _compress_into(float_array, arr, 0);
+}
+
+int iq2_xxs_compress(const float *float_array, uint64_t num_elements, iq2_xxs_array_t **out) {
+    if (!float_array || num_elements == 0 || !out || *out) return 1;
+    
+    iq2_xxs_array_t *arr = allocate_iq2_xxs_array(num_elements);
+    if (!arr) return 1;
+    
+    if (iq2_xxs_compress_into(float_array, arr)) {
+        free_iq2_xxs_array(arr);
+        return 1;
+    }
+    
     *out = arr;
     return 0;
 }
@@ -22,106 +22,143 @@ static void find_fast_scale_and_min(const float *weights, float *scale, float *m
     *min_val = local_min;
 }
 
-int q2_k_fast_compress(const float *float_array, uint64_t num_elements, q2_k_array_t **q2_k_array) {
+void q2_k_fast_quantize_super_block(const float *float_array, uint64_t count, super_block_q2_k *sb) {
     const float q4_scale = 15.f;
+    uint8_t L[WEIGHT_PER_SUPER_BLOCK];
+    float weights[Q2_K_BLOCK_SIZE];
+    float mins[Q2_K_SUPER_BLOCK_SIZE];
+    float scales[Q2_K_SUPER_BLOCK_SIZE];
+
+    float sb_tail[WEIGHT_PER_SUPER_BLOCK];
+    const float *sb_base = float_array;
+
+    if (count < WEIGHT_PER_SUPER_BLOCK) {
+        memset(sb_tail, 0, sizeof(sb_tail));
+        memcpy(sb_tail, sb_base, count * sizeof(float));
+        sb_base = sb_tail;
+    }
 
-    if (!float_array || num_elements == 0 || !q2_k_array || *q2_k_array) {
-        return 1;
+    float max_scale = -INFINITY;
+    float max_abs_min = 0.f;
+
+    for (int j = 0; j < Q2_K_SUPER_BLOCK_SIZE; j++) {
+        memcpy(weights, sb_base + j * Q2_K_BLOCK_SIZE, Q2_K_BLOCK_SIZE * sizeof(float));
+        find_fast_scale_and_min(weights, &scales[j], &mins[j]);
+        if (scales[j] > max_scale) {
+            max_scale = scales[j];
+        }
+        if (fabsf(mins[j]) > max_abs_min) {
+            max_abs_min = fabsf(mins[j]);
+        }
     }
+
+    if (max_scale > 0) {
+        float iscale = q4_scale / max_scale;
+        for (int j = 0; j < Q2_K_SUPER_BLOCK_SIZE; j++) {
+            int l = (int)lrintf(iscale * scales[j]);
+            sb->scales[j] = l;
+        }
+        sb->super_scale = fp16_ieee_from_fp32_value(max_scale / q4_scale);
+    } else {
+        memset(sb->scales, 0, sizeof(sb->scales));
+        sb->super_scale = fp16_ieee_from_fp32_value(0.f);
+    }
+
+    if (max_abs_min > 0) {
+        const float iscale = 7.f / max_abs_min;
+        for (int j = 0; j < Q2_K_SUPER_BLOCK_SIZE; j++) {
+            int l = (int)lrintf(iscale * mins[j]);
+            l = MAX_VAL(-8, MIN_VAL(7, l));
+            sb->scales[j] |= ((l & 0xF) << 4);
+        }
+        sb->super_min = fp16_ieee_from_fp32_value(max_abs_min / 7.f);
+    } else {
+        sb->super_min = fp16_ieee_from_fp32_value(0.f);
+    }
+
+    for (int j = 0; j < Q2_K_SUPER_BLOCK_SIZE; j++) {
+        const float temp_scale = fp16_ieee_to_fp32_value(sb->super_scale) * (sb->scales[j] & 0xF);
+        const float m = fp16_ieee_to_fp32_value(sb->super_min);
+        const int8_t min_q = (sb->scales[j] >> 4);
+        const float temp_min = m * ((int8_t)(min_q << 4) >> 4);
     
-    *q2_k_array = allocate_q2_k_array(num_elements);
-    if (!*q2_k_array) {
-        return 1;
+        for (int ii = 0; ii < Q2_K_BLOCK_SIZE; ii++) {
+            float val = (temp_scale > 0.f) ? (sb_base[j * Q2_K_BLOCK_SIZE + ii] - temp_min) / temp_scale : 0.f;
+            int l = (int)lrintf(val);
+            l = MAX_VAL(0, MIN_VAL(3, l));
+            L[j * Q2_K_BLOCK_SIZE + ii] = (uint8_t)l;
+        }
     }
-    q2_k_array_t *qa = *q2_k_array;
 
-    float *float_array_aligned = (float *)calloc(qa->num_elements_aligned, sizeof(float));
-    if (!float_array_aligned) {
-        free_q2_k_array(qa);
-        *q2_k_array = NULL;
+    uint32_t packed_run = WEIGHT_PER_SUPER_BLOCK / 2; // 128
+    for (int j = 0; j < WEIGHT_PER_SUPER_BLOCK; j += packed_run) {
+        for (int l = 0; l < Q2_K_BLOCK_SIZE * 2; l++) { // l = 0..31
+            uint8_t b0 = L[j + l + 0];
+            uint8_t b1 = L[j + l + 32];
+            uint8_t b2 = L[j + l + 64];
+            uint8_t b3 = L[j + l + 96];
+            sb->data[j / 4 + l] = b0 | (b1 << 2) | (b2 << 4) | (b3 << 6);
+        }
+    }
+}
+
+/* Quantize super block curr_super_block_index of float_array into qa. */
+static void _compress_step(const float *float_array, q2_k_array_t *qa, uint32_t curr_super_block_index) {
+    const uint64_t sb_start = (uint64_t)curr_super_block_index * WEIGHT_PER_SUPER_BLOCK;
+    const uint64_t remain = (sb_start + WEIGHT_PER_SUPER_BLOCK <= qa->num_elements)
+                              ? WEIGHT_PER_SUPER_BLOCK
+                              : (qa->num_elements - sb_start);
+    q2_k_fast_quantize_super_block(float_array + sb_start, remain, &qa->super_blocks[curr_super_block_index]);
+}
+
+static int _compress_into(const float *float_array, q2_k_array_t *qa, int parallel) {
+    if (!float_array || !qa) {
         return 1;
     }
-    memcpy(float_array_aligned, float_array, qa->num_elements * sizeof(float));
 
     const uint32_t num_super_blocks = qa->num_super_blocks;
 
 #if defined(__linux__) && defined(_OPENMP)
+    if (parallel) {
 #pragma omp parallel for
+        for (uint32_t curr_super_block_index = 0; curr_super_block_index < num_super_blocks; curr_super_block_index++) {
+            _compress_step(float_array, qa, curr_super_block_index);
+        }
+        return 0;
+    }
+#else
+    (void)parallel;
 #endif
     for (uint32_t curr_super_block_index = 0; curr_super_block_index < num_super_blocks; curr_super_block_index++) {
-        uint8_t L[WEIGHT_PER_SUPER_BLOCK];
-        float weights[Q2_K_BLOCK_SIZE];
-        float mins[Q2_K_SUPER_BLOCK_SIZE];
-        float scales[Q2_K_SUPER_BLOCK_SIZE];
-        
-        super_block_q2_k *curr_super_block = &qa->super_blocks[curr_super_block_index];
-        const float *sb_base = float_array_aligned + (uint64_t)curr_super_block_index * WEIGHT_PER_SUPER_BLOCK;
-        
-        float max_scale = -INFINITY;
-        float max_abs_min = 0.f;
-
-        for (int j = 0; j < Q2_K_SUPER_BLOCK_SIZE; j++) {
-            memcpy(weights, sb_base + j * Q2_K_BLOCK_SIZE, Q2_K_BLOCK_SIZE * sizeof(float));
-            find_fast_scale_and_min(weights, &scales[j], &mins[j]);
-            if (scales[j] > max_scale) {
-                max_scale = scales[j];
-            }
-            if (fabsf(mins[j]) > max_abs_min) {
-                max_abs_min = fabsf(mins[j]);
-            }
-        }
+        _compress_step(float_array, qa, curr_super_block_index);
+    }
 
-        if (max_scale > 0) {
-            float iscale = q4_scale / max_scale;
-            for (int j = 0; j < Q2_K_SUPER_BLOCK_SIZE; j++) {
-                int l = (int)lrintf(iscale * scales[j]);
-                curr_super_block->scales[j] = l;
-            }
-            curr_super_block->super_scale = fp16_ieee_from_fp32_value(max_scale / q4_scale);
-        } else {
-            memset(curr_super_block->scales, 0, sizeof(curr_super_block->scales));
-            curr_super_block->super_scale = fp16_ieee_from_fp32_value(0.f);
-        }
+    return 0;
+}
 
-        if (max_abs_min > 0) {
-            const float iscale = 7.f / max_abs_min;
-            for (int j = 0; j < Q2_K_SUPER_BLOCK_SIZE; j++) {
-                int l = (int)lrintf(iscale * mins[j]);
-                l = MAX_VAL(-8, MIN_VAL(7, l));
-                curr_super_block->scales[j] |= ((l & 0xF) << 4);
-            }
-            curr_super_block->super_min = fp16_ieee_from_fp32_value(max_abs_min / 7.f);
-        } else {
-            curr_super_block->super_min = fp16_ieee_from_fp32_value(0.f);
-        }
+int q2_k_fast_compress_into(const float *float_array, q2_k_array_t *qa) {
+    return _compress_into(float_array, qa, 1);
+}
 
-        for (int j = 0; j < Q2_K_SUPER_BLOCK_SIZE; j++) {
-            const float temp_scale = fp16_ieee_to_fp32_value(curr_super_block->super_scale) * (curr_super_block->scales[j] & 0xF);
-            const float m = fp16_ieee_to_fp32_value(curr_super_block->super_min);
-            const int8_t min_q = (curr_super_block->scales[j] >> 4);
-            const float temp_min = m * ((int8_t)(min_q << 4) >> 4);
-        
-            for (int ii = 0; ii < Q2_K_BLOCK_SIZE; ii++) {
-                float val = (temp_scale > 0.f) ? (sb_base[j * Q2_K_BLOCK_SIZE + ii] - temp_min) / temp_scale : 0.f;
-                int l = (int)lrintf(val);
-                l = MAX_VAL(0, MIN_VAL(3, l));
-                L[j * Q2_K_BLOCK_SIZE + ii] = (uint8_t)l;
-            }
-        }
+int q2_k_fast_compress_into_serial(const float *float_array, q2_k_array_t *qa) {
+    return _compress_into(float_array, qa, 0);
+}
 
-        uint32_t packed_run = WEIGHT_PER_SUPER_BLOCK / 2; // 128
-        for (int j = 0; j < WEIGHT_PER_SUPER_BLOCK; j += packed_run) {
-            for (int l = 0; l < Q2_K_BLOCK_SIZE * 2; l++) { // l = 0..31
-                uint8_t b0 = L[j + l + 0];
-                uint8_t b1 = L[j + l + 32];
-                uint8_t b2 = L[j + l + 64];
-                uint8_t b3 = L[j + l + 96];
-                curr_super_block->data[j / 4 + l] = b0 | (b1 << 2) | (b2 << 4) | (b3 << 6);
-            }
-        }
+int q2_k_fast_compress(const float *float_array, uint64_t num_elements, q2_k_array_t **q2_k_array) {
+    if (!float_array || num_elements == 0 || !q2_k_array || *q2_k_array) {
+        return 1;
+    }
+    
+    *q2_k_array = allocate_q2_k_array(num_elements);
+    if (!*q2_k_array) {
+        return 1;
     }
 
-    free(float_array_aligned);
+    if (q2_k_fast_compress_into(float_array, *q2_k_array)) {
+        free_q2_k_array(*q2_k_array);
+        *q2_k_array = NULL;
+        return 1;
+    }
     return 0;
 }
 
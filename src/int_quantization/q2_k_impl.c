@@ -1,33 +1,46 @@
 #include "int_quantization/q2_k_impl.h"
+#include "utils/alloc.h"
+#include "utils/dot.h"
 
 #define MAX_VAL(a, b) ((a) > (b) ? (a) : (b))
 #define MIN_VAL(a, b) ((a) < (b) ? (a) : (b))
 /* The implementation is refer to https://github.com/ggml-org/llama.cpp/blob/master/ggml/src/ggml-quants.c#L622 */
 
-q2_k_array_t *allocate_q2_k_array(uint64_t num_elements) {
-    if (!num_elements) return NULL;
+int64_t compute_q2_k_array_size(uint64_t num_elements) {
+    if (!num_elements) return 0;
+
+    uint64_t num_super_blocks = (num_elements + WEIGHT_PER_SUPER_BLOCK - 1) / WEIGHT_PER_SUPER_BLOCK;
+    return sizeof(q2_k_array_t) + num_super_blocks * sizeof(super_block_q2_k);
+}
+
+q2_k_array_t *init_q2_k_array(void *buffer, uint64_t num_elements) {
+    if (!buffer || !num_elements) return NULL;
 
     uint64_t num_elements_aligned = (num_elements % WEIGHT_PER_SUPER_BLOCK == 0)
                                         ? num_elements
                                         : num_elements + (WEIGHT_PER_SUPER_BLOCK - (num_elements % WEIGHT_PER_SUPER_BLOCK));
 
-    uint64_t num_super_blocks = num_elements_aligned / WEIGHT_PER_SUPER_BLOCK;
-    
-    size_t total = sizeof(q2_k_array_t) + num_super_blocks * sizeof(super_block_q2_k);
-    q2_k_array_t *qa = (q2_k_array_t *)calloc(1, total);
-    if (!qa) return NULL;
-    
+    q2_k_array_t *qa = (q2_k_array_t *)buffer;
     qa->num_elements = num_elements;
     qa->num_elements_aligned = num_elements_aligned;
-    qa->num_super_blocks = num_super_blocks;
+    qa->num_super_blocks = num_elements_aligned / WEIGHT_PER_SUPER_BLOCK;
     qa->super_blocks = (super_block_q2_k *)(qa + 1);
 
     return qa;
 }
 
+q2_k_array_t *allocate_q2_k_array(uint64_t num_elements) {
+    const int64_t total = compute_q2_k_array_size(num_elements);
+    if (total <= 0) return NULL;
+
+    void *buffer = bsq_alloc_bytes((size_t)total, 0, 0);
+    if (!buffer) return NULL;
+    return init_q2_k_array(buffer, num_elements);
+}
+
 void free_q2_k_array(q2_k_array_t *q2_k_array) {
     if (!q2_k_array) return;
-    free(q2_k_array);
+    bsq_free_bytes(q2_k_array);
 }
 
 int64_t get_q2_k_array_size(const q2_k_array_t *q2_k_array) {
@@ -38,13 +51,13 @@ int64_t get_q2_k_array_size(const q2_k_array_t *q2_k_array) {
 q2_k_array_t *load_q2_k_array_from_buffer(const void *buffer, int64_t buffer_size) {
     if (!buffer || buffer_size < (int64_t)sizeof(q2_k_array_t)) return NULL;
 
-    q2_k_array_t *q2_k_array = (q2_k_array_t *)calloc(1, buffer_size);
+    q2_k_array_t *q2_k_array = (q2_k_array_t *)bsq_alloc_bytes((size_t)buffer_size, 0, BSQ_ALLOC_UNINITIALIZED);
     if (!q2_k_array) return NULL;
     
     memcpy(q2_k_array, buffer, buffer_size);
     const int64_t expected = get_q2_k_array_size(q2_k_array);
     if (buffer_size < expected) {
-        free(q2_k_array);
+        bsq_free_bytes(q2_k_array);
         return NULL;
     }
 
@@ -133,9 +146,130 @@ static void find_optimal_scale_and_min(const float *weights, const float *abs_we
     *min_val = min;
 }
 
-int q2_k_compress(const float *float_array, uint64_t num_elements, q2_k_array_t **q2_k_array) {
+/* Quantize super block curr_super_block_index of float_array into qa. */
+static void _compress_step(const float *float_array, q2_k_array_t *qa, uint32_t curr_super_block_index) {
     const float q4_scale = 15.f;
 
+    uint8_t L[WEIGHT_PER_SUPER_BLOCK];
+    float weights[Q2_K_BLOCK_SIZE];
+    float abs_weights[Q2_K_BLOCK_SIZE];
+    float mins[Q2_K_SUPER_BLOCK_SIZE];
+    float scales[Q2_K_SUPER_BLOCK_SIZE];
+    
+    float sb_tail[WEIGHT_PER_SUPER_BLOCK];
+
+    super_block_q2_k *curr_super_block = &qa->super_blocks[curr_super_block_index];
+    const uint64_t sb_start = (uint64_t)curr_super_block_index * WEIGHT_PER_SUPER_BLOCK;
+    const float *sb_base = float_array + sb_start;
+
+    /* Zero-pad the trailing partial super block on the stack instead of copying the whole input. */
+    if (sb_start + WEIGHT_PER_SUPER_BLOCK > qa->num_elements) {
+        memset(sb_tail, 0, sizeof(sb_tail));
+        memcpy(sb_tail, sb_base, (qa->num_elements - sb_start) * sizeof(float));
+        sb_base = sb_tail;
+    }
+    
+    float max_scale = -INFINITY;
+    float max_abs_min = 0.f;
+
+    for (int j = 0; j < Q2_K_SUPER_BLOCK_SIZE; j++) {
+        memcpy(weights, sb_base + j * Q2_K_BLOCK_SIZE, Q2_K_BLOCK_SIZE * sizeof(float));
+        for (int i = 0; i < Q2_K_BLOCK_SIZE; ++i) {
+            abs_weights[i] = fabsf(weights[i]);
+        }
+        find_optimal_scale_and_min(weights, abs_weights, &scales[j], &mins[j]);
+        if (scales[j] > max_scale) {
+            max_scale = scales[j];
+        }
+        if (fabsf(mins[j]) > max_abs_min) {
+            max_abs_min = fabsf(mins[j]);
+        }
+    }
+
+    if (max_scale > 0) {
+        float iscale = q4_scale / max_scale;
+        for (int j = 0; j < Q2_K_SUPER_BLOCK_SIZE; j++) {
+            int l = (int)lrintf(iscale * scales[j]);
+            curr_super_block->scales[j] = l;
+        }
+        curr_super_block->super_scale = fp16_ieee_from_fp32_value(max_scale / q4_scale);
+    } else {
+        memset(curr_super_block->scales, 0, sizeof(curr_super_block->scales));
+        curr_super_block->super_scale = fp16_ieee_from_fp32_value(0.f);
+    }
+
+    if (max_abs_min > 0) {
+        const float iscale = 7.f / max_abs_min;
+        for (int j = 0; j < Q2_K_SUPER_BLOCK_SIZE; j++) {
+            int l = (int)lrintf(iscale * mins[j]);
+            l = MAX_VAL(-8, MIN_VAL(7, l));
+            curr_super_block->scales[j] |= ((l & 0xF) << 4);
+        }
+        curr_super_block->super_min = fp16_ieee_from_fp32_value(max_abs_min / 7.f);
+    } else {
+        curr_super_block->super_min = fp16_ieee_from_fp32_value(0.f);
+    }
+
+    for (int j = 0; j < Q2_K_SUPER_BLOCK_SIZE; j++) {
+        const float temp_scale = fp16_ieee_to_fp32_value(curr_super_block->super_scale) * (curr_super_block->scales[j] & 0xF);
+        const float m = fp16_ieee_to_fp32_value(curr_super_block->super_min);
+        const int8_t min_q = (curr_super_block->scales[j] >> 4);
+        const float temp_min = m * ((int8_t)(min_q << 4) >> 4);
+    
+        for (int ii = 0; ii < Q2_K_BLOCK_SIZE; ii++) {
+            float val = (temp_scale > 0.f) ? (sb_base[j * Q2_K_BLOCK_SIZE + ii] - temp_min) / temp_scale : 0.f;
+            int l = (int)lrintf(val);
+            l = MAX_VAL(0, MIN_VAL(3, l));
+            L[j * Q2_K_BLOCK_SIZE + ii] = (uint8_t)l;
+        }
+    }
+
+    uint32_t packed_run = WEIGHT_PER_SUPER_BLOCK / 2; // 128
+    for (int j = 0; j < WEIGHT_PER_SUPER_BLOCK; j += packed_run) {
+        for (int l = 0; l < Q2_K_BLOCK_SIZE * 2; l++) { // l = 0..31
+            uint8_t b0 = L[j + l + 0];
+            uint8_t b1 = L[j + l + 32];
+            uint8_t b2 = L[j + l + 64];
+            uint8_t b3 = L[j + l + 96];
+            curr_super_block->data[j / 4 + l] = b0 | (b1 << 2) | (b2 << 4) | (b3 << 6);
+        }
+    }
+}
+
+static int _compress_into(const float *float_array, q2_k_array_t *qa, int parallel) {
+    if (!float_array || !qa) {
+        return 1;
+    }
+
+    const uint32_t num_super_blocks = qa->num_super_blocks;
+
+#if defined(__linux__) && defined(_OPENMP)
+    if (parallel) {
+#pragma omp parallel for
+        for (uint32_t curr_super_block_index = 0; curr_super_block_index < num_super_blocks; curr_super_block_index++) {
+            _compress_step(float_array, qa, curr_super_block_index);
+        }
+        return 0;
+    }
+#else
+    (void)parallel;
+#endif
+    for (uint32_t curr_super_block_index = 0; curr_super_block_index < num_super_blocks; curr_super_block_index++) {
+        _compress_step(float_array, qa, curr_super_block_index);
+    }
+
+    return 0;
+}
+
+int q2_k_compress_into(const float *float_array, q2_k_array_t *qa) {
+    return _compress_into(float_array, qa, 1);
+}
+
+int q2_k_compress_into_serial(const float *float_array, q2_k_array_t *qa) {
+    return _compress_into(float_array, qa, 0);
+}
+
+int q2_k_compress(const float *float_array, uint64_t num_elements, q2_k_array_t **q2_k_array) {
     if (!float_array || num_elements == 0 || !q2_k_array || *q2_k_array) {
         return 1;
     }
@@ -144,105 +278,144 @@ int q2_k_compress(const float *float_array, uint64_t num_elements, q2_k_array_t
     if (!*q2_k_array) {
         return 1;
     }
-    q2_k_array_t *qa = *q2_k_array;
 
-    float *float_array_aligned = (float *)calloc(qa->num_elements_aligned, sizeof(float));
-    if (!float_array_aligned) {
-        free_q2_k_array(qa);
+    if (q2_k_compress_into(float_array, *q2_k_array)) {
+        free_q2_k_array(*q2_k_array);
         *q2_k_array = NULL;
         return 1;
     }
-    memcpy(float_array_aligned, float_array, qa->num_elements * sizeof(float));
+    return 0;
+}
 
-    const uint32_t num_super_blocks = qa->num_super_blocks;
+/* Quantize super block curr_super_block_index of float_array into qa, weighted by importance_array. */
+static void _im_compress_step(const float *float_array, const float *importance_array, q2_k_array_t *qa,
+                              uint32_t curr_super_block_index) {
+    const float q4_scale = 15.f;
 
-#if defined(__linux__) && defined(_OPENMP)
-#pragma omp parallel for
-#endif
-    for (uint32_t curr_super_block_index = 0; curr_super_block_index < num_super_blocks; curr_super_block_index++) {
-        uint8_t L[WEIGHT_PER_SUPER_BLOCK];
-        float weights[Q2_K_BLOCK_SIZE];
-        float abs_weights[Q2_K_BLOCK_SIZE];
-        float mins[Q2_K_SUPER_BLOCK_SIZE];
-        float scales[Q2_K_SUPER_BLOCK_SIZE];
-        
-        super_block_q2_k *curr_super_block = &qa->super_blocks[curr_super_block_index];
-        const float *sb_base = float_array_aligned + (uint64_t)curr_super_block_index * WEIGHT_PER_SUPER_BLOCK;
+    uint8_t L[WEIGHT_PER_SUPER_BLOCK];
+    float weights[Q2_K_BLOCK_SIZE];
+    float abs_weights[Q2_K_BLOCK_SIZE];
+    float mins[Q2_K_SUPER_BLOCK_SIZE];
+    float scales[Q2_K_SUPER_BLOCK_SIZE];
+    
+    float sb_tail[WEIGHT_PER_SUPER_BLOCK];
+    float im_sb_tail[WEIGHT_PER_SUPER_BLOCK];
+
+    super_block_q2_k *curr_super_block = &qa->super_blocks[curr_super_block_index];
+    const uint64_t sb_start = (uint64_t)curr_super_block_index * WEIGHT_PER_SUPER_BLOCK;
+    const float *sb_base = float_array + sb_start;
+    const float *im_sb_base = importance_array + sb_start;
+
+    if (sb_start + WEIGHT_PER_SUPER_BLOCK > qa->num_elements) {
+        const uint64_t remain = qa->num_elements - sb_start;
+        memset(sb_tail, 0, sizeof(sb_tail));
+        memset(im_sb_tail, 0, sizeof(im_sb_tail));
+        memcpy(sb_tail, sb_base, remain * sizeof(float));
+        memcpy(im_sb_tail, im_sb_base, remain * sizeof(float));
+        sb_base = sb_tail;
+        im_sb_base = im_sb_tail;
+    }
+    
+    float max_scale = -INFINITY;
+    float max_abs_min = 0.f;
+
+    for (int j = 0; j < Q2_K_SUPER_BLOCK_SIZE; j++) {
+        memcpy(weights, sb_base + j * Q2_K_BLOCK_SIZE, Q2_K_BLOCK_SIZE * sizeof(float));
+        memcpy(abs_weights, im_sb_base + j * Q2_K_BLOCK_SIZE, Q2_K_BLOCK_SIZE * sizeof(float));
         
-        float max_scale = -INFINITY;
-        float max_abs_min = 0.f;
+        find_optimal_scale_and_min(weights, abs_weights, &scales[j], &mins[j]);
+        if (scales[j] > max_scale) {
+            max_scale = scales[j];
+        }
+        if (fabsf(mins[j]) > max_abs_min) {
+            max_abs_min = fabsf(mins[j]);
+        }
+    }
 
+    if (max_scale > 0) {
+        float iscale = q4_scale / max_scale;
         for (int j = 0; j < Q2_K_SUPER_BLOCK_SIZE; j++) {
-            memcpy(weights, sb_base + j * Q2_K_BLOCK_SIZE, Q2_K_BLOCK_SIZE * sizeof(float));
-            for (int i = 0; i < Q2_K_BLOCK_SIZE; ++i) {
-                abs_weights[i] = fabsf(weights[i]);
-            }
-            find_optimal_scale_and_min(weights, abs_weights, &scales[j], &mins[j]);
-            if (scales[j] > max_scale) {
-                max_scale = scales[j];
-            }
-            if (fabsf(mins[j]) > max_abs_min) {
-                max_abs_min = fabsf(mins[j]);
-            }
+            int l = (int)lrintf(iscale * scales[j]);
+            curr_super_block->scales[j] = l;
         }
+        curr_super_block->super_scale = fp16_ieee_from_fp32_value(max_scale / q4_scale);
+    } else {
+        memset(curr_super_block->scales, 0, sizeof(curr_super_block->scales));
+        curr_super_block->super_scale = fp16_ieee_from_fp32_value(0.f);
+    }
 
-        if (max_scale > 0) {
-            float iscale = q4_scale / max_scale;
-            for (int j = 0; j < Q2_K_SUPER_BLOCK_SIZE; j++) {
-                int l = (int)lrintf(iscale * scales[j]);
-                curr_super_block->scales[j] = l;
-            }
-            curr_super_block->super_scale = fp16_ieee_from_fp32_value(max_scale / q4_scale);
-        } else {
-            memset(curr_super_block->scales, 0, sizeof(curr_super_block->scales));
-            curr_super_block->super_scale = fp16_ieee_from_fp32_value(0.f);
+    if (max_abs_min > 0) {
+        const float iscale = 7.f / max_abs_min;
+        for (int j = 0; j < Q2_K_SUPER_BLOCK_SIZE; j++) {
+            int l = (int)lrintf(iscale * mins[j]);
+            l = MAX_VAL(-8, MIN_VAL(7, l));
+            curr_super_block->scales[j] |= ((l & 0xF) << 4);
         }
+        curr_super_block->super_min = fp16_ieee_from_fp32_value(max_abs_min / 7.f);
+    } else {
+        curr_super_block->super_min = fp16_ieee_from_fp32_value(0.f);
+    }
 
-        if (max_abs_min > 0) {
-            const float iscale = 7.f / max_abs_min;
-            for (int j = 0; j < Q2_K_SUPER_BLOCK_SIZE; j++) {
-                int l = (int)lrintf(iscale * mins[j]);
-                l = MAX_VAL(-8, MIN_VAL(7, l));
-                curr_super_block->scales[j] |= ((l & 0xF) << 4);
-            }
-            curr_super_block->super_min = fp16_ieee_from_fp32_value(max_abs_min / 7.f);
-        } else {
-            curr_super_block->super_min = fp16_ieee_from_fp32_value(0.f);
+    for (int j = 0; j < Q2_K_SUPER_BLOCK_SIZE; j++) {
+        const float temp_scale = fp16_ieee_to_fp32_value(curr_super_block->super_scale) * (curr_super_block->scales[j] & 0xF);
+        const float m = fp16_ieee_to_fp32_value(curr_super_block->super_min);
+        const int8_t min_q = (curr_super_block->scales[j] >> 4);
+        const float temp_min = m * ((int8_t)(min_q << 4) >> 4);
+    
+        for (int ii = 0; ii < Q2_K_BLOCK_SIZE; ii++) {
+            float val = (temp_scale > 0.f) ? (sb_base[j * Q2_K_BLOCK_SIZE + ii] - temp_min) / temp_scale : 0.f;
+            int l = (int)lrintf(val);
+            l = MAX_VAL(0, MIN_VAL(3, l));
+            L[j * Q2_K_BLOCK_SIZE + ii] = (uint8_t)l;
         }
+    }
 
-        for (int j = 0; j < Q2_K_SUPER_BLOCK_SIZE; j++) {
-            const float temp_scale = fp16_ieee_to_fp32_value(curr_super_block->super_scale) * (curr_super_block->scales[j] & 0xF);
-            const float m = fp16_ieee_to_fp32_value(curr_super_block->super_min);
-            const int8_t min_q = (curr_super_block->scales[j] >> 4);
-            const float temp_min = m * ((int8_t)(min_q << 4) >> 4);
-        
-            for (int ii = 0; ii < Q2_K_BLOCK_SIZE; ii++) {
-                float val = (temp_scale > 0.f) ? (sb_base[j * Q2_K_BLOCK_SIZE + ii] - temp_min) / temp_scale : 0.f;
-                int l = (int)lrintf(val);
-                l = MAX_VAL(0, MIN_VAL(3, l));
-                L[j * Q2_K_BLOCK_SIZE + ii] = (uint8_t)l;
-            }
+    uint32_t packed_run = WEIGHT_PER_SUPER_BLOCK / 2; // 128
+    for (int j = 0; j < WEIGHT_PER_SUPER_BLOCK; j += packed_run) {
+        for (int l = 0; l < Q2_K_BLOCK_SIZE * 2; l++) { // l = 0..31
+            uint8_t b0 = L[j + l + 0];
+            uint8_t b1 = L[j + l + 32];
+            uint8_t b2 = L[j + l + 64];
+            uint8_t b3 = L[j + l + 96];
+            curr_super_block->data[j / 4 + l] = b0 | (b1 << 2) | (b2 << 4) | (b3 << 6);
         }
+    }
+}
 
-        uint32_t packed_run = WEIGHT_PER_SUPER_BLOCK / 2; // 128
-        for (int j = 0; j < WEIGHT_PER_SUPER_BLOCK; j += packed_run) {
-            for (int l = 0; l < Q2_K_BLOCK_SIZE * 2; l++) { // l = 0..31
-                uint8_t b0 = L[j + l + 0];
-                uint8_t b1 = L[j + l + 32];
-                uint8_t b2 = L[j + l + 64];
-                uint8_t b3 = L[j + l + 96];
-                curr_super_block->data[j / 4 + l] = b0 | (b1 << 2) | (b2 << 4) | (b3 << 6);
-            }
+static int _im_compress_into(const float *float_array, const float *importance_array, q2_k_array_t *qa, int parallel) {
+    if (!float_array || !importance_array || !qa) {
+        return 1;
+    }
+
+    const uint32_t num_super_blocks = qa->num_super_blocks;
+
+#if defined(__linux__) && defined(_OPENMP)
+    if (parallel) {
+#pragma omp parallel for
+        for (uint32_t curr_super_block_index = 0; curr_super_block_index < num_super_blocks; curr_super_block_index++) {
+            _im_compress_step(float_array, importance_array, qa, curr_super_block_index);
         }
+        return 0;
+    }
+#else
+    (void)parallel;
+#endif
+    for (uint32_t curr_super_block_index = 0; curr_super_block_index < num_super_blocks; curr_super_block_index++) {
+        _im_compress_step(float_array, importance_array, qa, curr_super_block_index);
     }
 
-    free(float_array_aligned);
     return 0;
 }
 
-int q2_k_im_compress(const float *float_array, const float *importance_array, uint64_t num_elements, q2_k_array_t **q2_k_array) {
-    const float q4_scale = 15.f;
+int q2_k_im_compress_into(const float *float_array, const float *importance_array, q2_k_array_t *qa) {
+    return _im_compress_into(float_array, importance_array, qa, 1);
+}
 
+int q2_k_im_compress_into_serial(const float *float_array, const float *importance_array, q2_k_array_t *qa) {
+    return _im_compress_into(float_array, importance_array, qa, 0);
+}
+
+int q2_k_im_compress(const float *float_array, const float *importance_array, uint64_t num_elements, q2_k_array_t **q2_k_array) {
     if (!float_array || !importance_array || num_elements == 0 || !q2_k_array || *q2_k_array) {
         return 1;
     }
@@ -251,173 +424,136 @@ int q2_k_im_compress(const float *float_array, const float *importance_array, ui
     if (!*q2_k_array) {
         return 1;
     }
-    q2_k_array_t *qa = *q2_k_array;
 
-    float *float_array_aligned = (float *)calloc(qa->num_elements_aligned, sizeof(float));
-    if (!float_array_aligned) {
-        free_q2_k_array(qa);
+    if (q2_k_im_compress_into(float_array, importance_array, *q2_k_array)) {
+        free_q2_k_array(*q2_k_array);
         *q2_k_array = NULL;
         return 1;
     }
-    float *importance_array_aligned = (float *)calloc(qa->num_elements_aligned, sizeof(float));
-    if (!importance_array_aligned) {
-        free(float_array_aligned);
-        free_q2_k_array(qa);
-        *q2_k_array = NULL;
-        return 1;
-    }
-
-    memcpy(float_array_aligned, float_array, qa->num_elements * sizeof(float));
-    memcpy(importance_array_aligned, importance_array, qa->num_elements * sizeof(float));
+    return 0;
+}
 
-    const uint32_t num_super_blocks = qa->num_super_blocks;
+/* Dequantize all WEIGHT_PER_SUPER_BLOCK values of one super block, padding included. */
+static void _decode_super_block(const super_block_q2_k *curr_super_block, float *out) {
+    const float super_scale = fp16_ieee_to_fp32_value(curr_super_block->super_scale);
+    const float super_min   = fp16_ieee_to_fp32_value(curr_super_block->super_min);
 
-#if defined(__linux__) && defined(_OPENMP)
-#pragma omp parallel for
-#endif
-    for (uint32_t curr_super_block_index = 0; curr_super_block_index < num_super_blocks; curr_super_block_index++) {
-        uint8_t L[WEIGHT_PER_SUPER_BLOCK];
-        float weights[Q2_K_BLOCK_SIZE];
-        float abs_weights[Q2_K_BLOCK_SIZE];
-        float mins[Q2_K_SUPER_BLOCK_SIZE];
-        float scales[Q2_K_SUPER_BLOCK_SIZE];
-        
-        super_block_q2_k *curr_super_block = &qa->super_blocks[curr_super_block_index];
-        const float *sb_base = float_array_aligned + (uint64_t)curr_super_block_index * WEIGHT_PER_SUPER_BLOCK;
-        const float *im_sb_base = importance_array_aligned + (uint64_t)curr_super_block_index * WEIGHT_PER_SUPER_BLOCK;
-        
-        float max_scale = -INFINITY;
-        float max_abs_min = 0.f;
+    float scales[Q2_K_SUPER_BLOCK_SIZE];
+    float mins[Q2_K_SUPER_BLOCK_SIZE];
 
-        for (int j = 0; j < Q2_K_SUPER_BLOCK_SIZE; j++) {
-            memcpy(weights, sb_base + j * Q2_K_BLOCK_SIZE, Q2_K_BLOCK_SIZE * sizeof(float));
-            memcpy(abs_weights, im_sb_base + j * Q2_K_BLOCK_SIZE, Q2_K_BLOCK_SIZE * sizeof(float));
-            
-            find_optimal_scale_and_min(weights, abs_weights, &scales[j], &mins[j]);
-            if (scales[j] > max_scale) {
-                max_scale = scales[j];
-            }
-            if (fabsf(mins[j]) > max_abs_min) {
-                max_abs_min = fabsf(mins[j]);
-            }
-        }
+    for (int i = 0; i < Q2_K_SUPER_BLOCK_SIZE; ++i) {
+        uint8_t packed_val = curr_super_block->scales[i];
+        scales[i] = super_scale * (packed_val & 0x0F);
 
-        if (max_scale > 0) {
-            float iscale = q4_scale / max_scale;
-            for (int j = 0; j < Q2_K_SUPER_BLOCK_SIZE; j++) {
-                int l = (int)lrintf(iscale * scales[j]);
-                curr_super_block->scales[j] = l;
-            }
-            curr_super_block->super_scale = fp16_ieee_from_fp32_value(max_scale / q4_scale);
-        } else {
-            memset(curr_super_block->scales, 0, sizeof(curr_super_block->scales));
-            curr_super_block->super_scale = fp16_ieee_from_fp32_value(0.f);
-        }
+        int8_t min_q = (packed_val >> 4);
+        mins[i] = super_min * ((int8_t)(min_q << 4) >> 4);
+    }
 
-        if (max_abs_min > 0) {
-            const float iscale = 7.f / max_abs_min;
-            for (int j = 0; j < Q2_K_SUPER_BLOCK_SIZE; j++) {
-                int l = (int)lrintf(iscale * mins[j]);
-                l = MAX_VAL(-8, MIN_VAL(7, l));
-                curr_super_block->scales[j] |= ((l & 0xF) << 4);
-            }
-            curr_super_block->super_min = fp16_ieee_from_fp32_value(max_abs_min / 7.f);
-        } else {
-            curr_super_block->super_min = fp16_ieee_from_fp32_value(0.f);
-        }
+    const uint8_t *q = curr_super_block->data;
 
-        for (int j = 0; j < Q2_K_SUPER_BLOCK_SIZE; j++) {
-            const float temp_scale = fp16_ieee_to_fp32_value(curr_super_block->super_scale) * (curr_super_block->scales[j] & 0xF);
-            const float m = fp16_ieee_to_fp32_value(curr_super_block->super_min);
-            const int8_t min_q = (curr_super_block->scales[j] >> 4);
-            const float temp_min = m * ((int8_t)(min_q << 4) >> 4);
-        
-            for (int ii = 0; ii < Q2_K_BLOCK_SIZE; ii++) {
-                float val = (temp_scale > 0.f) ? (sb_base[j * Q2_K_BLOCK_SIZE + ii] - temp_min) / temp_scale : 0.f;
-                int l = (int)lrintf(val);
-                l = MAX_VAL(0, MIN_VAL(3, l));
-                L[j * Q2_K_BLOCK_SIZE + ii] = (uint8_t)l;
-            }
-        }
+    for (int l = 0; l < 32; ++l) {
+        uint8_t packed_byte = q[l];
+        out[l]      = mins[l/16]        + scales[l/16]        * ((packed_byte >> 0) & 3);
+        out[l + 32] = mins[(l + 32)/16] + scales[(l + 32)/16] * ((packed_byte >> 2) & 3);
+        out[l + 64] = mins[(l + 64)/16] + scales[(l + 64)/16] * ((packed_byte >> 4) & 3);
+        out[l + 96] = mins[(l + 96)/16] + scales[(l + 96)/16] * ((packed_byte >> 6) & 3);
+    }
 
-        uint32_t packed_run = WEIGHT_PER_SUPER_BLOCK / 2; // 128
-        for (int j = 0; j < WEIGHT_PER_SUPER_BLOCK; j += packed_run) {
-            for (int l = 0; l < Q2_K_BLOCK_SIZE * 2; l++) { // l = 0..31
-                uint8_t b0 = L[j + l + 0];
-                uint8_t b1 = L[j + l + 32];
-                uint8_t b2 = L[j + l + 64];
-                uint8_t b3 = L[j + l + 96];
-                curr_super_block->data[j / 4 + l] = b0 | (b1 << 2) | (b2 << 4) | (b3 << 6);
-            }
-        }
+    for (int l = 0; l < 32; ++l) {
+        uint8_t packed_byte = q[32 + l];
+        out[l + 128] = mins[(l + 128)/16] + scales[(l + 128)/16] * ((packed_byte >> 0) & 3);
+        out[l + 160] = mins[(l + 160)/16] + scales[(l + 160)/16] * ((packed_byte >> 2) & 3);
+        out[l + 192] = mins[(l + 192)/16] + scales[(l + 192)/16] * ((packed_byte >> 4) & 3);
+        out[l + 224] = mins[(l + 224)/16] + scales[(l + 224)/16] * ((packed_byte >> 6) & 3);
     }
+}
 
-    free(float_array_aligned);
-    free(importance_array_aligned);
-    return 0;
+/* Decode the share of super block s in [offset, end) into float_array, indexed from offset. */
+static void _decode_range_step(const q2_k_array_t *q2_k_array, uint64_t s, uint64_t offset, uint64_t end,
+                               float *float_array) {
+    const uint64_t base_idx = s * WEIGHT_PER_SUPER_BLOCK;
+    const uint64_t start = (base_idx > offset) ? base_idx : offset;
+    const uint64_t stop  = (base_idx + WEIGHT_PER_SUPER_BLOCK < end) ? base_idx + WEIGHT_PER_SUPER_BLOCK : end;
+
+    if (stop - start == WEIGHT_PER_SUPER_BLOCK) {
+        _decode_super_block(&q2_k_array->super_blocks[s], float_array + (base_idx - offset));
+    } else {
+        /* Partial head/tail super block: decode aside and keep the requested slice. */
+        float tmp[WEIGHT_PER_SUPER_BLOCK];
+        _decode_super_block(&q2_k_array->super_blocks[s], tmp);
+        memcpy(float_array + (start - offset), tmp + (start - base_idx), (stop - start) * sizeof(float));
+    }
 }
 
-int q2_k_decompress(const q2_k_array_t *q2_k_array, float *float_array) {
+static int _decompress_range(const q2_k_array_t *q2_k_array, uint64_t offset, uint64_t count, float *float_array,
+                             int parallel) {
     if (!q2_k_array || !float_array || q2_k_array->num_super_blocks == 0) {
         return 1;
     }
+    if (offset > q2_k_array->num_elements || count > q2_k_array->num_elements - offset) return 1;
+    if (count == 0) return 0;
 
-    const uint64_t total_elements = q2_k_array->num_elements;
+    const uint64_t end         = offset + count;
+    const uint64_t first_block = offset / WEIGHT_PER_SUPER_BLOCK;
+    const uint64_t last_block  = (end - 1) / WEIGHT_PER_SUPER_BLOCK;
 
 #if defined(__linux__) && defined(_OPENMP)
+    if (parallel) {
 #pragma omp parallel for
-#endif
-    for (uint32_t s = 0; s < q2_k_array->num_super_blocks; ++s) {
-        const super_block_q2_k *curr_super_block = &q2_k_array->super_blocks[s];
-        const float super_scale = fp16_ieee_to_fp32_value(curr_super_block->super_scale);
-        const float super_min   = fp16_ieee_to_fp32_value(curr_super_block->super_min);
-
-        float scales[Q2_K_SUPER_BLOCK_SIZE];
-        float mins[Q2_K_SUPER_BLOCK_SIZE];
-
-        for (int i = 0; i < Q2_K_SUPER_BLOCK_SIZE; ++i) {
-            uint8_t packed_val = curr_super_block->scales[i];
-            scales[i] = super_scale * (packed_val & 0x0F);
-            
-            int8_t min_q = (packed_val >> 4);
-            mins[i] = super_min * ((int8_t)(min_q << 4) >> 4);
+        for (uint64_t s = first_block; s <= last_block; ++s) {
+            _decode_range_step(q2_k_array, s, offset, end, float_array);
         }
+        return 0;
+    }
+#else
+    (void)parallel;
+#endif
+    for (uint64_t s = first_block; s <= last_block; ++s) {
+        _decode_range_step(q2_k_array, s, offset, end, float_array);
+    }
+    return 0;
+}
 
-        const uint8_t *q = curr_super_block->data;
-        const uint64_t base_idx = (uint64_t)s * WEIGHT_PER_SUPER_BLOCK;
-
-        for (int l = 0; l < 32; ++l) {
-            uint8_t packed_byte = q[l];
-            
-            uint64_t idx0 = base_idx + (uint64_t)l;
-            uint64_t idx1 = base_idx + (uint64_t)l + 32;
-            uint64_t idx2 = base_idx + (uint64_t)l + 64;
-            uint64_t idx3 = base_idx + (uint64_t)l + 96;
-
-            const int local0 = l;
-            const int local1 = l + 32;
-            const int local2 = l + 64;
-            const int local3 = l + 96;
-
-            if (idx0 < total_elements) float_array[idx0] = mins[local0/16] + scales[local0/16] * ((packed_byte >> 0) & 3);
-            if (idx1 < total_elements) float_array[idx1] = mins[local1/16] + scales[local1/16] * ((packed_byte >> 2) & 3);
-            if (idx2 < total_elements) float_array[idx2] = mins[local2/16] + scales[local2/16] * ((packed_byte >> 4) & 3);
-            if (idx3 < total_elements) float_array[idx3] = mins[local3/16] + scales[local3/16] * ((packed_byte >> 6) & 3);
-        }
+int q2_k_decompress_range(const q2_k_array_t *q2_k_array,
+                          uint64_t offset,
+                          uint64_t count,
+                          float *float_array) {
+    return _decompress_range(q2_k_array, offset, count, float_array, 1);
+}
+
+int q2_k_decompress_range_serial(const q2_k_array_t *q2_k_array,
+                                 uint64_t offset,
+                                 uint64_t count,
+                                 float *float_array) {
+    return _decompress_range(q2_k_array, offset, count, float_array, 0);
+}
+
+int q2_k_decompress(const q2_k_array_t *q2_k_array, float *float_array) {
+    if (!q2_k_array) return 1;
+    return q2_k_decompress_range(q2_k_array, 0, q2_k_array->num_elements, float_array);
+}
+
+int q2_k_gemv(const q2_k_array_t *q2_k_array,
+              uint64_t rows,
+              uint64_t cols,
+              const float *x,
+              float *y) {
+    if (!q2_k_array || !x || !y) return 1;
+    if (cols % WEIGHT_PER_SUPER_BLOCK != 0 || rows * cols != q2_k_array->num_elements) return 1;
+    const uint64_t blocks_per_row = cols / WEIGHT_PER_SUPER_BLOCK;
 
-        for (int l = 0; l < 32; ++l) {
-            uint8_t packed_byte = q[32 + l];
-            
-            uint64_t idx0 = base_idx + 128 + (uint64_t)l;
-            uint64_t idx1 = base_idx + 160 + (uint64_t)l;
-            uint64_t idx2 = base_idx + 192 + (uint64_t)l;
-            uint64_t idx3 = base_idx + 224 + (uint64_t)l;
-
-            if (idx0 < total_elements) float_array[idx0] = mins[(idx0 - base_idx)/16] + scales[(idx0 - base_idx)/16] * ((packed_byte >> 0) & 3);
-            if (idx1 < total_elements) float_array[idx1] = mins[(idx1 - base_idx)/16] + scales[(idx1 - base_idx)/16] * ((packed_byte >> 2) & 3);
-            if (idx2 < total_elements) float_array[idx2] = mins[(idx2 - base_idx)/16] + scales[(idx2 - base_idx)/16] * ((packed_byte >> 4) & 3);
-            if (idx3 < total_elements) float_array[idx3] = mins[(idx3 - base_idx)/16] + scales[(idx3 - base_idx)/16] * ((packed_byte >> 6) & 3);
+#if defined(__linux__) && defined(_OPENMP)
+#pragma omp parallel for
+#endif
+    for (uint64_t r = 0; r < rows; ++r) {
+        const super_block_q2_k *blocks = q2_k_array->super_blocks + r * blocks_per_row;
+        float w[WEIGHT_PER_SUPER_BLOCK];
+        float acc = 0.0f;
+        for (uint64_t b = 0; b < blocks_per_row; ++b) {
+            _decode_super_block(&blocks[b], w);
+            acc += bsq_dot_f32(w, x + b * WEIGHT_PER_SUPER_BLOCK, WEIGHT_PER_SUPER_BLOCK);
         }
+        y[r] = acc;
     }
     return 0;
 }
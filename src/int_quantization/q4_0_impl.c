@@ -1,4 +1,6 @@
 #include "int_quantization/q4_0_impl.h"
+#include "utils/alloc.h"
+#include "utils/dot.h"
 
 static int64_t _get_q4_0_array_size(const q4_0_array_t *q4_0_array) {
     if (!q4_0_array) return 0;
@@ -9,32 +11,46 @@ static int64_t _get_q4_0_array_size(const q4_0_array_t *q4_0_array) {
          + num_elements_for_data * sizeof(int8_t);
 }
 
-q4_0_array_t *allocate_q4_0_array(uint64_t num_elements,
-                                  uint64_t block_size) {
-    if (!num_elements || !block_size) return NULL;
+int64_t compute_q4_0_array_size(uint64_t num_elements,
+                                uint64_t block_size) {
+    if (!num_elements || !block_size) return 0;
 
     uint64_t num_blocks = (num_elements + block_size - 1) / block_size;
     uint64_t num_elements_for_data = (num_elements + 1) / 2;
 
-    size_t total = sizeof(q4_0_array_t)
-                 + num_blocks * sizeof(float)
-                 + num_elements_for_data * sizeof(int8_t);
+    return sizeof(q4_0_array_t)
+         + num_blocks * sizeof(float)
+         + num_elements_for_data * sizeof(int8_t);
+}
 
-    q4_0_array_t *qa = (q4_0_array_t *)calloc(1, total);
-    if (!qa) return NULL;
+q4_0_array_t *init_q4_0_array(void *buffer,
+                              uint64_t num_elements,
+                              uint64_t block_size) {
+    if (!buffer || !num_elements || !block_size) return NULL;
 
+    q4_0_array_t *qa = (q4_0_array_t *)buffer;
     qa->num_elements = num_elements;
-    qa->num_blocks   = num_blocks;
+    qa->num_blocks   = (num_elements + block_size - 1) / block_size;
     qa->block_size   = block_size;
 
     qa->scales = (float *)(qa + 1);
-    qa->data   = (int8_t *)(qa->scales + num_blocks);
+    qa->data   = (int8_t *)(qa->scales + qa->num_blocks);
     return qa;
 }
 
+q4_0_array_t *allocate_q4_0_array(uint64_t num_elements,
+                                  uint64_t block_size) {
+    const int64_t total = compute_q4_0_array_size(num_elements, block_size);
+    if (total <= 0) return NULL;
+
+    void *buffer = bsq_alloc_bytes((size_t)total, 0, 0);
+    if (!buffer) return NULL;
+    return init_q4_0_array(buffer, num_elements, block_size);
+}
+
 void free_q4_0_array(q4_0_array_t *q4_0_array) {
     if (!q4_0_array) return;
-    free(q4_0_array);
+    bsq_free_bytes(q4_0_array);
 }
 
 int64_t get_q4_0_array_size(const q4_0_array_t *q4_0_array) {
@@ -44,13 +60,13 @@ int64_t get_q4_0_array_size(const q4_0_array_t *q4_0_array) {
 q4_0_array_t *load_q4_0_array_from_buffer(const void *buffer, int64_t buffer_size) {
     if (!buffer || buffer_size < (int64_t)sizeof(q4_0_array_t)) return NULL;
 
-    q4_0_array_t *q4_0_array = (q4_0_array_t *)calloc(1, buffer_size);
+    q4_0_array_t *q4_0_array = (q4_0_array_t *)bsq_alloc_bytes((size_t)buffer_size, 0, BSQ_ALLOC_UNINITIALIZED);
     if (!q4_0_array) return NULL;
 
     memcpy(q4_0_array, buffer, buffer_size);
     const int64_t expected = _get_q4_0_array_size(q4_0_array);
     if (buffer_size < expected) {
-        free(q4_0_array);
+        bsq_free_bytes(q4_0_array);
         return NULL;
     }
 
@@ -59,51 +75,75 @@ q4_0_array_t *load_q4_0_array_from_buffer(const void *buffer, int64_t buffer_siz
     return q4_0_array;
 }
 
-static int _quantize_q4_0(const float *float_array, q4_0_array_t *q4_0_array) {
-    if (!float_array || !q4_0_array) return 1;
+void q4_0_quantize_block(const float *float_array, uint64_t count, float *scale_out, uint8_t *packed) {
+    float abs_max = 0.0f;
+    for (uint64_t i = 0; i < count; ++i) {
+        float v = fabsf(float_array[i]);
+        if (v > abs_max) abs_max = v;
+    }
+
+    float scale = (abs_max > 0.0f) ? (abs_max / 7.0f) : 0.0f;
+    float inv_scale = (scale > 0.0f) ? (1.0f / scale) : 0.0f;
+    *scale_out = scale;
+
+    for (uint64_t i = 0; i < count; ++i) {
+        float val = float_array[i] * inv_scale;
+        long qi   = lrintf(val);
+        if (qi < -7) qi = -7;
+        if (qi >  7) qi =  7;
+
+        const uint8_t four_bit_qi = ((uint8_t)qi) & 0x0F;
+        if (i % 2 == 0) {
+            packed[i / 2] = (uint8_t)(four_bit_qi << 4);
+        } else {
+            packed[i / 2] = (uint8_t)(packed[i / 2] | four_bit_qi);
+        }
+    }
+}
 
+/* Quantize block b of float_array into q4_0_array. */
+static void _compress_step(const float *float_array, q4_0_array_t *q4_0_array, uint8_t *data, uint64_t b) {
     const uint64_t block_size   = q4_0_array->block_size;
-    const uint64_t num_blocks   = q4_0_array->num_blocks;
     const uint64_t num_elements = q4_0_array->num_elements;
+
+    const uint64_t start = b * block_size;
+    const uint64_t remain = (start + block_size <= num_elements)
+                              ? block_size
+                              : (num_elements - start);
+    q4_0_quantize_block(float_array + start, remain, &q4_0_array->scales[b], data + start / 2);
+}
+
+static int _compress_into(const float *float_array, q4_0_array_t *q4_0_array, int parallel) {
+    if (!float_array || !q4_0_array) return 1;
+
+    const uint64_t num_blocks = q4_0_array->num_blocks;
     uint8_t *data = (uint8_t *)q4_0_array->data;
 
 #if defined(__linux__) && defined(_OPENMP)
+    if (parallel) {
 #pragma omp parallel for
+        for (uint64_t b = 0; b < num_blocks; ++b) {
+            _compress_step(float_array, q4_0_array, data, b);
+        }
+        return 0;
+    }
+#else
+    (void)parallel;
 #endif
     for (uint64_t b = 0; b < num_blocks; ++b) {
-        const uint64_t start = b * block_size;
-        const uint64_t remain = (start + block_size <= num_elements)
-                                  ? block_size
-                                  : (num_elements - start);
-
-        float abs_max = 0.0f;
-        for (uint64_t i = 0; i < remain; ++i) {
-            float v = fabsf(float_array[start + i]);
-            if (v > abs_max) abs_max = v;
-        }
-
-        float scale = (abs_max > 0.0f) ? (abs_max / 7.0f) : 0.0f;
-        float inv_scale = (scale > 0.0f) ? (1.0f / scale) : 0.0f;
-        q4_0_array->scales[b] = scale;
-
-        for (uint64_t i = 0; i < remain; ++i) {
-            float val = float_array[start + i] * inv_scale;
-            long qi   = lrintf(val);
-            if (qi < -7) qi = -7;
-            if (qi >  7) qi =  7;
-
-            const uint8_t four_bit_qi = ((uint8_t)qi) & 0x0F;
-            const int data_index = (start + i) / 2;
-            if (i % 2 == 0) {
-                data[data_index] = (uint8_t)(four_bit_qi << 4);
-            } else {
-                data[data_index] = (uint8_t)(data[data_index] | four_bit_qi);
-            }
-        }
+        _compress_step(float_array, q4_0_array, data, b);
     }
     return 0;
 }
 
+int q4_0_compress_into(const float *float_array, q4_0_array_t *q4_0_array) {
+    return _compress_into(float_array, q4_0_array, 1);
+}
+
+int q4_0_compress_into_serial(const float *float_array, q4_0_array_t *q4_0_array) {
+    return _compress_into(float_array, q4_0_array, 0);
+}
+
 int q4_0_compress(const float *float_array,
              uint64_t num_elements,
              uint8_t quantized_type,
@@ -115,36 +155,109 @@ int q4_0_compress(const float *float_array,
     *q4_0_array = allocate_q4_0_array(num_elements, DEFAULT_Q4_0_BLOCK_SIZE);
     if (!*q4_0_array) return 1;
 
-    return _quantize_q4_0(float_array, *q4_0_array);
+    if (q4_0_compress_into(float_array, *q4_0_array)) {
+        free_q4_0_array(*q4_0_array);
+        *q4_0_array = NULL;
+        return 1;
+    }
+    return 0;
 }
 
-int q4_0_decompress(const q4_0_array_t *q4_0_array,
-               float *float_array) {
+/* Decode the share of block b in [offset, end) into float_array, indexed from offset. */
+static void _decode_range_step(const q4_0_array_t *q4_0_array, uint64_t b, uint64_t offset, uint64_t end,
+                               float *float_array) {
+    const uint64_t block_size = q4_0_array->block_size;
+    const uint8_t *src_data = (const uint8_t *)q4_0_array->data;
+    const uint64_t start = (b * block_size > offset) ? b * block_size : offset;
+    const uint64_t stop  = ((b + 1) * block_size < end) ? (b + 1) * block_size : end;
+    const float scale = q4_0_array->scales[b];
+
+    for (uint64_t i = start; i < stop; ++i) {
+        const uint8_t packed_qi = src_data[i / 2];
+        uint8_t qi = ((i - b * block_size) % 2 == 0) ? (packed_qi >> 4) : (packed_qi & 0x0F);
+        const int8_t signed_qi = (int8_t)(qi << 4) >> 4;
+        float_array[i - offset] = scale * (float)(signed_qi);
+    }
+}
+
+static int _decompress_range(const q4_0_array_t *q4_0_array, uint64_t offset, uint64_t count, float *float_array,
+                             int parallel) {
     if (!q4_0_array || !float_array) return 1;
+    if (offset > q4_0_array->num_elements || count > q4_0_array->num_elements - offset) return 1;
+    if (count == 0) return 0;
 
-    const uint64_t block_size   = q4_0_array->block_size;
-    const uint64_t num_blocks   = q4_0_array->num_blocks;
-    const uint64_t num_elements = q4_0_array->num_elements;
-    const uint8_t *src_data = (const uint8_t *)q4_0_array->data;
+    const uint64_t block_size  = q4_0_array->block_size;
+    const uint64_t end         = offset + count;
+    const uint64_t first_block = offset / block_size;
+    const uint64_t last_block  = (end - 1) / block_size;
 
 #if defined(__linux__) && defined(_OPENMP)
+    if (parallel) {
 #pragma omp parallel for
+        for (uint64_t b = first_block; b <= last_block; ++b) {
+            _decode_range_step(q4_0_array, b, offset, end, float_array);
+        }
+        return 0;
+    }
+#else
+    (void)parallel;
 #endif
-    for (uint64_t b = 0; b < num_blocks; ++b) {
-        const uint64_t start = b * block_size;
-        const uint64_t remain = (start + block_size <= num_elements)
-                                  ? block_size
-                                  : (num_elements - start);
-        const float scale = q4_0_array->scales[b];
-
-        for (uint64_t i = 0; i < remain; ++i) {
-            const int data_index = (start + i) / 2;
-            const uint8_t packed_qi = src_data[data_index];
-
-            uint8_t qi = (i % 2 == 0) ? (packed_qi >> 4) : (packed_qi & 0x0F);
-            const int8_t signed_qi = (int8_t)(qi << 4) >> 4;
-            float_array[start + i] = scale * (float)(signed_qi);
+    for (uint64_t b = first_block; b <= last_block; ++b) {
+        _decode_range_step(q4_0_array, b, offset, end, float_array);
+    }
+    return 0;
+}
+
+int q4_0_decompress_range(const q4_0_array_t *q4_0_array,
+                          uint64_t offset,
+                          uint64_t count,
+                          float *float_array) {
+    return _decompress_range(q4_0_array, offset, count, float_array, 1);
+}
+
+int q4_0_decompress_range_serial(const q4_0_array_t *q4_0_array,
+                                 uint64_t offset,
+                                 uint64_t count,
+                                 float *float_array) {
+    return _decompress_range(q4_0_array, offset, count, float_array, 0);
+}
+
+int q4_0_decompress(const q4_0_array_t *q4_0_array,
+                    float *float_array) {
+    if (!q4_0_array) return 1;
+    return q4_0_decompress_range(q4_0_array, 0, q4_0_array->num_elements, float_array);
+}
+
+int q4_0_gemv(const q4_0_array_t *q4_0_array,
+              uint64_t rows,
+              uint64_t cols,
+              const float *x,
+              float *y) {
+    if (!q4_0_array || !x || !y) return 1;
+    const uint64_t block_size = q4_0_array->block_size;
+    if (block_size == 0 || block_size % 2 != 0 || block_size > BSQ_DOT_PANEL || cols % block_size != 0 ||
+        rows * cols != q4_0_array->num_elements) {
+        return 1;
+    }
+    const uint64_t blocks_per_row = cols / block_size;
+
+#if defined(__linux__) && defined(_OPENMP)
+#pragma omp parallel for
+#endif
+    for (uint64_t r = 0; r < rows; ++r) {
+        const uint8_t *q = (const uint8_t *)q4_0_array->data + r * cols / 2;
+        const float *scales = q4_0_array->scales + r * blocks_per_row;
+        float w[BSQ_DOT_PANEL];
+        float acc = 0.0f;
+        for (uint64_t b = 0; b < blocks_per_row; ++b) {
+            const uint8_t *qb = q + b * block_size / 2;
+            for (uint64_t j = 0; j < block_size / 2; ++j) {
+                w[2 * j]     = (float)((int8_t)(qb[j] & 0xF0) >> 4);
+                w[2 * j + 1] = (float)((int8_t)(qb[j] << 4) >> 4);
+            }
+            acc += scales[b] * bsq_dot_f32(w, x + b * block_size, block_size);
         }
+        y[r] = acc;
     }
     return 0;
 }
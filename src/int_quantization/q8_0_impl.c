@@ -1,4 +1,6 @@
 #include "int_quantization/q8_0_impl.h"
+#include "utils/alloc.h"
+#include "utils/dot.h"
 
 static int64_t _get_q8_0_array_size(const q8_0_array_t *q8_0_array) {
     if (!q8_0_array) return 0;
@@ -7,30 +9,44 @@ static int64_t _get_q8_0_array_size(const q8_0_array_t *q8_0_array) {
          + q8_0_array->num_elements * sizeof(int8_t);
 }
 
-q8_0_array_t *allocate_q8_0_array(uint64_t num_elements,
-                                  uint64_t block_size) {
-    if (!num_elements || !block_size) return NULL;
+int64_t compute_q8_0_array_size(uint64_t num_elements,
+                                uint64_t block_size) {
+    if (!num_elements || !block_size) return 0;
 
     uint64_t num_blocks = (num_elements + block_size - 1) / block_size;
-    size_t total = sizeof(q8_0_array_t)
-                 + num_blocks * sizeof(float)
-                 + num_elements * sizeof(int8_t);
+    return sizeof(q8_0_array_t)
+         + num_blocks * sizeof(float)
+         + num_elements * sizeof(int8_t);
+}
 
-    q8_0_array_t *qa = (q8_0_array_t *)calloc(1, total);
-    if (!qa) return NULL;
+q8_0_array_t *init_q8_0_array(void *buffer,
+                              uint64_t num_elements,
+                              uint64_t block_size) {
+    if (!buffer || !num_elements || !block_size) return NULL;
 
+    q8_0_array_t *qa = (q8_0_array_t *)buffer;
     qa->num_elements = num_elements;
-    qa->num_blocks   = num_blocks;
+    qa->num_blocks   = (num_elements + block_size - 1) / block_size;
     qa->block_size   = block_size;
 
     qa->scales = (float *)(qa + 1);
-    qa->data   = (int8_t *)(qa->scales + num_blocks);
+    qa->data   = (int8_t *)(qa->scales + qa->num_blocks);
     return qa;
 }
 
+q8_0_array_t *allocate_q8_0_array(uint64_t num_elements,
+                                  uint64_t block_size) {
+    const int64_t total = compute_q8_0_array_size(num_elements, block_size);
+    if (total <= 0) return NULL;
+
+    void *buffer = bsq_alloc_bytes((size_t)total, 0, 0);
+    if (!buffer) return NULL;
+    return init_q8_0_array(buffer, num_elements, block_size);
+}
+
 void free_q8_0_array(q8_0_array_t *q8_0_array) {
     if (!q8_0_array) return;
-    free(q8_0_array);
+    bsq_free_bytes(q8_0_array);
 }
 
 int64_t get_q8_0_array(const q8_0_array_t *q8_0_array) {
@@ -40,13 +56,13 @@ int64_t get_q8_0_array(const q8_0_array_t *q8_0_array) {
 q8_0_array_t *load_quantized_array_from_buffer(const void *buffer, int64_t buffer_size) {
     if (!buffer || buffer_size < (int64_t)sizeof(q8_0_array_t)) return NULL;
 
-    q8_0_array_t *q8_0_array = (q8_0_array_t *)calloc(1, buffer_size);
+    q8_0_array_t *q8_0_array = (q8_0_array_t *)bsq_alloc_bytes((size_t)buffer_size, 0, BSQ_ALLOC_UNINITIALIZED);
     if (!q8_0_array) return NULL;
 
     memcpy(q8_0_array, buffer, buffer_size);
     const int64_t expected = _get_q8_0_array_size(q8_0_array);
     if (buffer_size < expected) {
-        free(q8_0_array);
+        bsq_free_bytes(q8_0_array);
         return NULL;
     }
 
@@ -55,39 +71,84 @@ q8_0_array_t *load_quantized_array_from_buffer(const void *buffer, int64_t buffe
     return q8_0_array;
 }
 
-static int _quantize_q8_0(const float *float_array, q8_0_array_t *q8_0_array) {
-    if (!float_array || !q8_0_array) return 1;
+/* Quantize count values to codes against one absmax / 127 scale. */
+static float _quantize_block(const float *src, uint64_t count, int8_t *codes) {
+    float abs_max = 0.0f;
+    for (uint64_t i = 0; i < count; ++i) {
+        float v = fabsf(src[i]);
+        if (v > abs_max) abs_max = v;
+    }
+
+    float scale = (abs_max > 0.0f) ? (abs_max / 127.0f) : 0.0f;
+    float inv_scale = (scale > 0.0f) ? (1.0f / scale) : 0.0f;
 
+    for (uint64_t i = 0; i < count; ++i) {
+        float val = src[i] * inv_scale;
+        long qi   = lrintf(val);
+        if (qi < -127) qi = -127;
+        if (qi >  127) qi =  127;
+        codes[i] = (int8_t)qi;
+    }
+    return scale;
+}
+
+/* Quantize block b of float_array into q8_0_array. */
+static void _compress_step(const float *float_array, q8_0_array_t *q8_0_array, uint64_t b) {
     const uint64_t block_size   = q8_0_array->block_size;
-    const uint64_t num_blocks   = q8_0_array->num_blocks;
     const uint64_t num_elements = q8_0_array->num_elements;
 
+    const uint64_t start = b * block_size;
+    const uint64_t remain = (start + block_size <= num_elements)
+                              ? block_size
+                              : (num_elements - start);
+    q8_0_array->scales[b] = _quantize_block(float_array + start, remain, q8_0_array->data + start);
+}
+
+static int _compress_into(const float *float_array, q8_0_array_t *q8_0_array, int parallel) {
+    if (!float_array || !q8_0_array) return 1;
+
+    const uint64_t num_blocks = q8_0_array->num_blocks;
+
 #if defined(__linux__) && defined(_OPENMP)
+    if (parallel) {
 #pragma omp parallel for
+        for (uint64_t b = 0; b < num_blocks; ++b) {
+            _compress_step(float_array, q8_0_array, b);
+        }
+        return 0;
+    }
+#else
+    (void)parallel;
 #endif
     for (uint64_t b = 0; b < num_blocks; ++b) {
-        const uint64_t start = b * block_size;
-        const uint64_t remain = (start + block_size <= num_elements)
-                                  ? block_size
-                                  : (num_elements - start);
-
-        float abs_max = 0.0f;
-        for (uint64_t i = 0; i < remain; ++i) {
-            float v = fabsf(float_array[start + i]);
-            if (v > abs_max) abs_max = v;
-        }
+        _compress_step(float_array, q8_0_array, b);
+    }
+    return 0;
+}
 
-        float scale = (abs_max > 0.0f) ? (abs_max / 127.0f) : 0.0f;
-        float inv_scale = (scale > 0.0f) ? (1.0f / scale) : 0.0f;
-        q8_0_array->scales[b] = scale;
+int q8_0_compress_into(const float *float_array, q8_0_array_t *q8_0_array) {
+    return _compress_into(float_array, q8_0_array, 1);
+}
 
-        for (uint64_t i = 0; i < remain; ++i) {
-            float val = float_array[start + i] * inv_scale;
-            long qi   = lrintf(val);
-            if (qi < -127) qi = -127;
-            if (qi >  127) qi =  127;
-            q8_0_array->data[start + i] = (int8_t)qi;
-        }
+int q8_0_compress_into_serial(const float *float_array, q8_0_array_t *q8_0_array) {
+    return _compress_into(float_array, q8_0_array, 0);
+}
+
+int q8_0_quantize_blocks(const float *float_array,
+                         uint64_t num_elements,
+                         int8_t *codes,
+                         float *scales) {
+    if (!float_array || !codes || !scales) return 1;
+    const uint64_t num_blocks = (num_elements + DEFAULT_Q8_0_BLOCK_SIZE - 1) / DEFAULT_Q8_0_BLOCK_SIZE;
+
+#if defined(__linux__) && defined(_OPENMP)
+#pragma omp parallel for
+#endif
+    for (uint64_t b = 0; b < num_blocks; ++b) {
+        const uint64_t start = b * DEFAULT_Q8_0_BLOCK_SIZE;
+        const uint64_t remain = num_elements - start < DEFAULT_Q8_0_BLOCK_SIZE ? num_elements - start
+                                                                               : DEFAULT_Q8_0_BLOCK_SIZE;
+        scales[b] = _quantize_block(float_array + start, remain, codes + start);
     }
     return 0;
 }
@@ -100,30 +161,101 @@ int q8_0_compress(const float *float_array,
     *q8_0_array = allocate_q8_0_array(num_elements, DEFAULT_Q8_0_BLOCK_SIZE);
     if (!*q8_0_array) return 1;
 
-    return _quantize_q8_0(float_array, *q8_0_array);
+    if (q8_0_compress_into(float_array, *q8_0_array)) {
+        free_q8_0_array(*q8_0_array);
+        *q8_0_array = NULL;
+        return 1;
+    }
+    return 0;
 }
 
-int q8_0_decompress(const q8_0_array_t *q8_0_array,
-               float *float_array) {
+/* Decode the share of block b in [offset, end) into float_array, indexed from offset. */
+static void _decode_range_step(const q8_0_array_t *q8_0_array, uint64_t b, uint64_t offset, uint64_t end,
+                               float *float_array) {
+    const uint64_t block_size = q8_0_array->block_size;
+    const uint64_t start = (b * block_size > offset) ? b * block_size : offset;
+    const uint64_t stop  = ((b + 1) * block_size < end) ? (b + 1) * block_size : end;
+    const float scale = q8_0_array->scales[b];
+
+    for (uint64_t i = start; i < stop; ++i) {
+        float_array[i - offset] = scale * (float)q8_0_array->data[i];
+    }
+}
+
+static int _decompress_range(const q8_0_array_t *q8_0_array, uint64_t offset, uint64_t count, float *float_array,
+                             int parallel) {
     if (!q8_0_array || !float_array) return 1;
+    if (offset > q8_0_array->num_elements || count > q8_0_array->num_elements - offset) return 1;
+    if (count == 0) return 0;
 
-    const uint64_t block_size   = q8_0_array->block_size;
-    const uint64_t num_blocks   = q8_0_array->num_blocks;
-    const uint64_t num_elements = q8_0_array->num_elements;
+    const uint64_t block_size  = q8_0_array->block_size;
+    const uint64_t end         = offset + count;
+    const uint64_t first_block = offset / block_size;
+    const uint64_t last_block  = (end - 1) / block_size;
 
 #if defined(__linux__) && defined(_OPENMP)
+    if (parallel) {
 #pragma omp parallel for
+        for (uint64_t b = first_block; b <= last_block; ++b) {
+            _decode_range_step(q8_0_array, b, offset, end, float_array);
+        }
+        return 0;
+    }
+#else
+    (void)parallel;
 #endif
-    for (uint64_t b = 0; b < num_blocks; ++b) {
-        const uint64_t start = b * block_size;
-        const uint64_t remain = (start + block_size <= num_elements)
-                                  ? block_size
-                                  : (num_elements - start);
-        const float scale = q8_0_array->scales[b];
-
-        for (uint64_t i = 0; i < remain; ++i) {
-            float_array[start + i] = scale * (float)q8_0_array->data[start + i];
+    for (uint64_t b = first_block; b <= last_block; ++b) {
+        _decode_range_step(q8_0_array, b, offset, end, float_array);
+    }
+    return 0;
+}
+
+int q8_0_decompress_range(const q8_0_array_t *q8_0_array,
+                          uint64_t offset,
+                          uint64_t count,
+                          float *float_array) {
+    return _decompress_range(q8_0_array, offset, count, float_array, 1);
+}
+
+int q8_0_decompress_range_serial(const q8_0_array_t *q8_0_array,
+                                 uint64_t offset,
+                                 uint64_t count,
+                                 float *float_array) {
+    return _decompress_range(q8_0_array, offset, count, float_array, 0);
+}
+
+int q8_0_decompress(const q8_0_array_t *q8_0_array,
+                    float *float_array) {
+    if (!q8_0_array) return 1;
+    return q8_0_decompress_range(q8_0_array, 0, q8_0_array->num_elements, float_array);
+}
+
+int q8_0_gemv(const q8_0_array_t *q8_0_array,
+              uint64_t rows,
+              uint64_t cols,
+              const float *x,
+              float *y) {
+    if (!q8_0_array || !x || !y) return 1;
+    const uint64_t block_size = q8_0_array->block_size;
+    if (block_size == 0 || block_size > BSQ_DOT_PANEL || cols % block_size != 0 ||
+        rows * cols != q8_0_array->num_elements) {
+        return 1;
+    }
+    const uint64_t blocks_per_row = cols / block_size;
+
+#if defined(__linux__) && defined(_OPENMP)
+#pragma omp parallel for
+#endif
+    for (uint64_t r = 0; r < rows; ++r) {
+        const int8_t *q = q8_0_array->data + r * cols;
+        const float *scales = q8_0_array->scales + r * blocks_per_row;
+        float w[BSQ_DOT_PANEL];
+        float acc = 0.0f;
+        for (uint64_t b = 0; b < blocks_per_row; ++b) {
+            for (uint64_t i = 0; i < block_size; ++i) w[i] = (float)q[b * block_size + i];
+            acc += scales[b] * bsq_dot_f32(w, x + b * block_size, block_size);
         }
+        y[r] = acc;
     }
     return 0;
 }
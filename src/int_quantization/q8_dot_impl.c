@@ -0,0 +1,210 @@
+#include "int_quantization/q8_dot_impl.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define Q8_DOT_X86 1
+#include <immintrin.h>
+#if (defined(__clang__) && __clang_major__ >= 12) || (!defined(__clang__) && __GNUC__ >= 11)
+#define Q8_DOT_HAVE_AVX_VNNI 1
+#endif
+#endif
+
+#define QK DEFAULT_Q8_0_BLOCK_SIZE
+
+typedef float (*q8_row_fn)(const void *w, const float *w_scales, const int8_t *x, const float *x_scales,
+                           uint64_t num_blocks);
+
+static q8_dot_isa_t max_isa = Q8_DOT_AVX512_VNNI;
+
+static int _isa_supported(q8_dot_isa_t isa) {
+    if (isa == Q8_DOT_SCALAR) return 1;
+#ifdef Q8_DOT_X86
+    __builtin_cpu_init();
+    if (!__builtin_cpu_supports("avx2") || !__builtin_cpu_supports("fma")) return 0;
+    switch (isa) {
+        case Q8_DOT_AVX2:        return 1;
+#ifdef Q8_DOT_HAVE_AVX_VNNI
+        case Q8_DOT_AVX_VNNI:    return __builtin_cpu_supports("avxvnni") != 0;
+#endif
+        case Q8_DOT_AVX512_VNNI: return __builtin_cpu_supports("avx512vnni") && __builtin_cpu_supports("avx512vl");
+        default:                 return 0;
+    }
+#else
+    return 0;
+#endif
+}
+
+q8_dot_isa_t q8_dot_isa(void) {
+    int isa = max_isa;
+    while (isa > Q8_DOT_SCALAR && !_isa_supported((q8_dot_isa_t)isa)) --isa;
+    return (q8_dot_isa_t)isa;
+}
+
+void q8_dot_set_max_isa(q8_dot_isa_t isa) {
+    max_isa = isa;
+}
+
+static float _q8_0_row_scalar(const void *w, const float *w_scales, const int8_t *x, const float *x_scales,
+                              uint64_t num_blocks) {
+    const int8_t *q = (const int8_t *)w;
+    float sum = 0.0f;
+    for (uint64_t b = 0; b < num_blocks; ++b) {
+        int32_t dot = 0;
+        for (int i = 0; i < QK; ++i) dot += (int32_t)q[b * QK + i] * x[b * QK + i];
+        sum += w_scales[b] * x_scales[b] * (float)dot;
+    }
+    return sum;
+}
+
+static float _q4_0_row_scalar(const void *w, const float *w_scales, const int8_t *x, const float *x_scales,
+                              uint64_t num_blocks) {
+    const uint8_t *q = (const uint8_t *)w;
+    float sum = 0.0f;
+    for (uint64_t b = 0; b < num_blocks; ++b) {
+        const uint8_t *qb = q + b * QK / 2;
+        const int8_t *xb = x + b * QK;
+        int32_t dot = 0;
+        for (int j = 0; j < QK / 2; ++j) {
+            dot += ((int8_t)(qb[j] & 0xF0) >> 4) * xb[2 * j];
+            dot += ((int8_t)(qb[j] << 4) >> 4) * xb[2 * j + 1];
+        }
+        sum += w_scales[b] * x_scales[b] * (float)dot;
+    }
+    return sum;
+}
+
+#ifdef Q8_DOT_X86
+__attribute__((target("avx2"))) static inline float _hsum_ps(__m256 v) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_movehdup_ps(s));
+    return _mm_cvtss_f32(s);
+}
+
+/* 16 packed Q4_0 bytes (high nibble first) as 32 signed bytes in element order. */
+__attribute__((target("avx2"))) static inline __m256i _unpack_q4(const uint8_t *p) {
+    const __m128i bytes = _mm_loadu_si128((const __m128i *)p);
+    const __m128i mask = _mm_set1_epi8(0x0F);
+    const __m128i hi = _mm_and_si128(_mm_srli_epi16(bytes, 4), mask);
+    const __m128i lo = _mm_and_si128(bytes, mask);
+    const __m256i v = _mm256_set_m128i(_mm_unpackhi_epi8(hi, lo), _mm_unpacklo_epi8(hi, lo));
+    const __m256i eight = _mm256_set1_epi8(8);
+    return _mm256_sub_epi8(_mm256_xor_si256(v, eight), eight);
+}
+
+/* Eight int32 partial sums of two signed blocks. The unsigned-by-signed multiplies see |w| and x * sign(w). */
+__attribute__((target("avx2"))) static inline __m256i _block_dot_avx2(__m256i w, __m256i x) {
+    const __m256i products = _mm256_maddubs_epi16(_mm256_sign_epi8(w, w), _mm256_sign_epi8(x, w));
+    return _mm256_madd_epi16(products, _mm256_set1_epi16(1));
+}
+
+#ifdef Q8_DOT_HAVE_AVX_VNNI
+__attribute__((target("avxvnni,avx2"))) static inline __m256i _block_dot_avx_vnni(__m256i w, __m256i x) {
+    return _mm256_dpbusd_avx_epi32(_mm256_setzero_si256(), _mm256_sign_epi8(w, w), _mm256_sign_epi8(x, w));
+}
+#endif
+
+__attribute__((target("avx512vnni,avx512vl,avx2"))) static inline __m256i _block_dot_avx512_vnni(__m256i w,
+                                                                                                 __m256i x) {
+    return _mm256_dpbusd_epi32(_mm256_setzero_si256(), _mm256_sign_epi8(w, w), _mm256_sign_epi8(x, w));
+}
+
+/* Q8_0 and Q4_0 row kernels for one ISA; BLOCK_DOT is one of the _block_dot_* helpers above. */
+#define Q8_DOT_ROW_KERNELS(SUFFIX, TARGET, BLOCK_DOT)                                                         \
+    __attribute__((target(TARGET))) static float _q8_0_row_##SUFFIX(const void *w, const float *w_scales,    \
+                                                                    const int8_t *x, const float *x_scales,   \
+                                                                    uint64_t num_blocks) {                    \
+        const int8_t *q = (const int8_t *)w;                                                                  \
+        __m256 acc = _mm256_setzero_ps();                                                                     \
+        for (uint64_t b = 0; b < num_blocks; ++b) {                                                           \
+            const __m256i wb = _mm256_loadu_si256((const __m256i *)(q + b * QK));                             \
+            const __m256i xb = _mm256_loadu_si256((const __m256i *)(x + b * QK));                             \
+            const __m256 d = _mm256_set1_ps(w_scales[b] * x_scales[b]);                                       \
+            acc = _mm256_fmadd_ps(d, _mm256_cvtepi32_ps(BLOCK_DOT(wb, xb)), acc);                             \
+        }                                                                                                     \
+        return _hsum_ps(acc);                                                                                 \
+    }                                                                                                         \
+    __attribute__((target(TARGET))) static float _q4_0_row_##SUFFIX(const void *w, const float *w_scales,    \
+                                                                    const int8_t *x, const float *x_scales,   \
+                                                                    uint64_t num_blocks) {                    \
+        const uint8_t *q = (const uint8_t *)w;                                                                \
+        __m256 acc = _mm256_setzero_ps();                                                                     \
+        for (uint64_t b = 0; b < num_blocks; ++b) {                                                           \
+            const __m256i wb = _unpack_q4(q + b * QK / 2);                                                    \
+            const __m256i xb = _mm256_loadu_si256((const __m256i *)(x + b * QK));                             \
+            const __m256 d = _mm256_set1_ps(w_scales[b] * x_scales[b]);                                       \
+            acc = _mm256_fmadd_ps(d, _mm256_cvtepi32_ps(BLOCK_DOT(wb, xb)), acc);                             \
+        }                                                                                                     \
+        return _hsum_ps(acc);                                                                                 \
+    }
+
+Q8_DOT_ROW_KERNELS(avx2, "avx2,fma", _block_dot_avx2)
+#ifdef Q8_DOT_HAVE_AVX_VNNI
+Q8_DOT_ROW_KERNELS(avx_vnni, "avxvnni,avx2,fma", _block_dot_avx_vnni)
+#endif
+Q8_DOT_ROW_KERNELS(avx512_vnni, "avx512vnni,avx512vl,avx2,fma", _block_dot_avx512_vnni)
+#endif
+
+/* Row kernel for the current ISA; is_q4 selects the Q4_0 weight layout. */
+static q8_row_fn _row_kernel(int is_q4) {
+    switch (q8_dot_isa()) {
+#ifdef Q8_DOT_X86
+        case Q8_DOT_AVX2:        return is_q4 ? _q4_0_row_avx2 : _q8_0_row_avx2;
+#ifdef Q8_DOT_HAVE_AVX_VNNI
+        case Q8_DOT_AVX_VNNI:    return is_q4 ? _q4_0_row_avx_vnni : _q8_0_row_avx_vnni;
+#endif
+        case Q8_DOT_AVX512_VNNI: return is_q4 ? _q4_0_row_avx512_vnni : _q8_0_row_avx512_vnni;
+#endif
+        default:                 return is_q4 ? _q4_0_row_scalar : _q8_0_row_scalar;
+    }
+}
+
+static int _gemv_q8(const void *w, uint64_t row_bytes, const float *w_scales, uint64_t rows, uint64_t cols,
+                    const int8_t *x_codes, const float *x_scales, float *y, int is_q4) {
+    const uint64_t blocks_per_row = cols / QK;
+    const q8_row_fn row = _row_kernel(is_q4);
+
+#if defined(__linux__) && defined(_OPENMP)
+#pragma omp parallel for
+#endif
+    for (uint64_t r = 0; r < rows; ++r) {
+        y[r] = row((const uint8_t *)w + r * row_bytes, w_scales + r * blocks_per_row, x_codes, x_scales,
+                   blocks_per_row);
+    }
+    return 0;
+}
+
+int q8_0_gemv_q8(const q8_0_array_t *q8_0_array,
+                 uint64_t rows,
+                 uint64_t cols,
+                 const int8_t *x_codes,
+                 const float *x_scales,
+                 float *y) {
+    if (!q8_0_array || !x_codes || !x_scales || !y) return 1;
+    if (q8_0_array->block_size != QK || cols % QK != 0 || rows * cols != q8_0_array->num_elements) return 1;
+    return _gemv_q8(q8_0_array->data, cols, q8_0_array->scales, rows, cols, x_codes, x_scales, y, 0);
+}
+
+int q4_0_gemv_q8(const q4_0_array_t *q4_0_array,
+                 uint64_t rows,
+                 uint64_t cols,
+                 const int8_t *x_codes,
+                 const float *x_scales,
+                 float *y) {
+    if (!q4_0_array || !x_codes || !x_scales || !y) return 1;
+    if (q4_0_array->block_size != QK || cols % QK != 0 || rows * cols != q4_0_array->num_elements) return 1;
+    return _gemv_q8(q4_0_array->data, cols / 2, q4_0_array->scales, rows, cols, x_codes, x_scales, y, 1);
+}
+
+int q8_0_dot_q8(const q8_0_array_t *q8_0_array, const int8_t *x_codes, const float *x_scales, float *result) {
+    if (!q8_0_array || !x_codes || !x_scales || !result) return 1;
+    if (q8_0_array->block_size != QK || q8_0_array->num_elements % QK != 0) return 1;
+    *result = _row_kernel(0)(q8_0_array->data, q8_0_array->scales, x_codes, x_scales, q8_0_array->num_elements / QK);
+    return 0;
+}
+
+int q4_0_dot_q8(const q4_0_array_t *q4_0_array, const int8_t *x_codes, const float *x_scales, float *result) {
+    if (!q4_0_array || !x_codes || !x_scales || !result) return 1;
+    if (q4_0_array->block_size != QK || q4_0_array->num_elements % QK != 0) return 1;
+    *result = _row_kernel(1)(q4_0_array->data, q4_0_array->scales, x_codes, x_scales, q4_0_array->num_elements / QK);
+    return 0;
+}
@@ -0,0 +1,59 @@
+#include "bitsqueeze.h"
+#include "bitsqueeze_internal.h"
+
+#include "utils/dot.h"
+
+/* Weight rows per output tile, the unit of parallel work. */
+#define GEMM_TILE_ROWS 64
+/* Columns per decoded panel: a multiple of every granule, so a 64 x 256 float panel (64 KiB) stays in L2. */
+#define GEMM_TILE_COLS 256
+
+/* Decode rows [r0, r0 + num_rows) x columns [k0, k0 + num_cols) of the weights into panel, GEMM_TILE_COLS apart.
+ * Runs inside the tile loop's parallel region, so each row goes through the serial range decoder. */
+static int _decode_panel(const bitsqueeze_buffer_t *buf, uint64_t cols, uint64_t r0, uint64_t num_rows,
+                         uint64_t k0, uint64_t num_cols, float *panel) {
+    for (uint64_t r = 0; r < num_rows; ++r) {
+        if (bsq_decompress_range_serial(buf, (r0 + r) * cols + k0, num_cols, panel + r * GEMM_TILE_COLS)) return 1;
+    }
+    return 0;
+}
+
+int bsq_gemm(const bitsqueeze_buffer_t *buf,
+             uint64_t rows,
+             uint64_t cols,
+             const float *x,
+             uint64_t num_tokens,
+             float *y) {
+    if (!buf || !x || !y || !buf->payload || rows == 0 || cols == 0) return 1;
+    if (bsq_payload_granule(buf) == 0 || buf->shape.num_elements != rows * cols) return 1;
+
+    const uint64_t num_tiles = (rows + GEMM_TILE_ROWS - 1) / GEMM_TILE_ROWS;
+    int failed = 0;
+
+#if defined(__linux__) && defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic) reduction(|:failed)
+#endif
+    for (uint64_t tile = 0; tile < num_tiles; ++tile) {
+        const uint64_t r0 = tile * GEMM_TILE_ROWS;
+        const uint64_t num_rows = rows - r0 < GEMM_TILE_ROWS ? rows - r0 : GEMM_TILE_ROWS;
+        float panel[GEMM_TILE_ROWS * GEMM_TILE_COLS];
+
+        for (uint64_t t = 0; t < num_tokens; ++t) {
+            for (uint64_t r = 0; r < num_rows; ++r) y[t * rows + r0 + r] = 0.0f;
+        }
+        /* Each panel is decoded once and reused by every token. */
+        for (uint64_t k0 = 0; k0 < cols && !failed; k0 += GEMM_TILE_COLS) {
+            const uint64_t num_cols = cols - k0 < GEMM_TILE_COLS ? cols - k0 : GEMM_TILE_COLS;
+            if (_decode_panel(buf, cols, r0, num_rows, k0, num_cols, panel)) {
+                failed = 1;
+                break;
+            }
+            for (uint64_t t = 0; t < num_tokens; ++t) {
+                const float *xt = x + t * cols + k0;
+                float *yt = y + t * rows + r0;
+                for (uint64_t r = 0; r < num_rows; ++r) yt[r] += bsq_dot_f32(panel + r * GEMM_TILE_COLS, xt, num_cols);
+            }
+        }
+    }
+    return failed;
+}
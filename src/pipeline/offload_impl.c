@@ -0,0 +1,280 @@
+#include "bitsqueeze.h"
+
+#include <stdlib.h>
+#include <time.h>
+
+/* Alignment of staging buffers and of each layer's packed buffer. */
+#define OFFLOAD_ALIGN 64
+
+/* A float buffer and the job (compress from it or decompress into it) that currently owns it. */
+typedef struct {
+    float     *data;
+    bsq_job_t *job;
+    int64_t    layer;          /* layer held or being produced, -1 when none */
+} slot_t;
+
+struct bsq_offload {
+    bsq_async_t         *async;
+    int                  owns_async;
+    bsq_method_t         method;
+    bsq_shape_t          shape;
+    uint64_t             num_elements;
+    int64_t              packed_size;
+    uint64_t             packed_stride;
+    uint32_t             num_layers;
+    uint32_t             lookahead;
+    uint8_t             *packed;         /* num_layers packed buffers, packed_stride apart */
+    uint8_t             *stored;         /* per layer: 1 once a store was submitted, 2 if it failed */
+    int32_t             *store_slot;     /* per layer: store slot still compressing it, -1 when settled */
+    int32_t             *load_slot;      /* per layer: load slot holding (or decoding) it, -1 when none */
+    slot_t              *store_slots;
+    uint32_t             num_staging;
+    uint32_t             next_stage;
+    int64_t              staged;         /* store slot handed out by bsq_offload_stage, -1 when none */
+    slot_t              *load_slots;     /* lookahead + 1 */
+    bsq_offload_stats_t  stats;
+};
+
+static uint64_t _now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int _is_sparse(bsq_method_t method) {
+    return method == TOPK || method == TOPK_IM;
+}
+
+static bitsqueeze_buffer_t *_packed(const bsq_offload_t *off, uint32_t layer) {
+    return (bitsqueeze_buffer_t *)(off->packed + (uint64_t)layer * off->packed_stride);
+}
+
+/* Settle slot's job, adding any time spent blocked to *stall_ns; returns the job's final status. */
+static bsq_job_status_t _settle(slot_t *slot, uint64_t *stall_ns) {
+    if (!slot->job) return BSQ_JOB_DONE;
+    bsq_job_status_t status = bsq_job_poll(slot->job);
+    if (status == BSQ_JOB_QUEUED || status == BSQ_JOB_RUNNING) {
+        const uint64_t start = _now_ns();
+        status = bsq_job_wait(slot->job);
+        *stall_ns += _now_ns() - start;
+    }
+    bsq_job_release(slot->job);
+    slot->job = NULL;
+    return status;
+}
+
+/* Finish the compression of whatever layer store slot i was producing. */
+static void _settle_store_slot(bsq_offload_t *off, uint32_t i) {
+    slot_t *slot = &off->store_slots[i];
+    if (_settle(slot, &off->stats.store_stall_ns) != BSQ_JOB_DONE && slot->layer >= 0) {
+        off->stored[slot->layer] = 2;
+    }
+    if (slot->layer >= 0 && off->store_slot[slot->layer] == (int32_t)i) off->store_slot[slot->layer] = -1;
+    slot->layer = -1;
+}
+
+/* Drop load slot i and whatever layer it held. */
+static void _evict_load_slot(bsq_offload_t *off, uint32_t i) {
+    slot_t *slot = &off->load_slots[i];
+    _settle(slot, &off->stats.load_stall_ns);
+    if (slot->layer >= 0) off->load_slot[slot->layer] = -1;
+    slot->layer = -1;
+}
+
+bsq_offload_t *bsq_offload_create(bsq_method_t method,
+                                  const bsq_shape_t *shape,
+                                  uint32_t num_layers,
+                                  uint32_t num_staging,
+                                  uint32_t lookahead,
+                                  bsq_async_t *async) {
+    if (!shape || num_layers == 0 || num_staging == 0 || method == TOPK_IM) return NULL;
+
+    const int sparse = _is_sparse(method);
+    const int64_t packed_size = sparse
+        ? bsq_compute_packed_size_2d(method, shape->num_tokens, shape->num_features, shape->sparse_ratio)
+        : bsq_compute_packed_size_1d(method, shape->num_elements);
+    if (packed_size <= 0) return NULL;
+
+    bsq_offload_t *off = (bsq_offload_t *)calloc(1, sizeof(bsq_offload_t));
+    if (!off) return NULL;
+    off->method = method;
+    off->shape = *shape;
+    off->num_elements = sparse ? (uint64_t)shape->num_tokens * shape->num_features : shape->num_elements;
+    off->packed_size = packed_size;
+    off->packed_stride = ((uint64_t)packed_size + OFFLOAD_ALIGN - 1) / OFFLOAD_ALIGN * OFFLOAD_ALIGN;
+    off->num_layers = num_layers;
+    off->lookahead = lookahead < num_layers ? lookahead : num_layers - 1;
+    off->num_staging = num_staging;
+    off->staged = -1;
+
+    const size_t floats_size = (off->num_elements * sizeof(float) + OFFLOAD_ALIGN - 1) / OFFLOAD_ALIGN * OFFLOAD_ALIGN;
+    const uint32_t num_load_slots = off->lookahead + 1;
+    off->packed = (uint8_t *)aligned_alloc(OFFLOAD_ALIGN, (size_t)(off->packed_stride * num_layers));
+    off->stored = (uint8_t *)calloc(num_layers, 1);
+    off->store_slot = (int32_t *)malloc(num_layers * sizeof(int32_t));
+    off->load_slot = (int32_t *)malloc(num_layers * sizeof(int32_t));
+    off->store_slots = (slot_t *)calloc(num_staging, sizeof(slot_t));
+    off->load_slots = (slot_t *)calloc(num_load_slots, sizeof(slot_t));
+    int failed = !off->packed || !off->stored || !off->store_slot || !off->load_slot ||
+                 !off->store_slots || !off->load_slots;
+    for (uint32_t i = 0; !failed && i < num_staging; ++i) {
+        off->store_slots[i].layer = -1;
+        off->store_slots[i].data = (float *)aligned_alloc(OFFLOAD_ALIGN, floats_size);
+        failed = !off->store_slots[i].data;
+    }
+    for (uint32_t i = 0; !failed && i < num_load_slots; ++i) {
+        off->load_slots[i].layer = -1;
+        off->load_slots[i].data = (float *)aligned_alloc(OFFLOAD_ALIGN, floats_size);
+        failed = !off->load_slots[i].data;
+    }
+    if (!failed) {
+        for (uint32_t l = 0; l < num_layers; ++l) off->store_slot[l] = off->load_slot[l] = -1;
+        off->async = async;
+        if (!async) {
+            /* One worker to compress, one to prefetch; each keeps the OpenMP default team. */
+            off->async = bsq_async_create(2, 0, num_staging + num_load_slots, 0);
+            off->owns_async = 1;
+            failed = !off->async;
+        }
+    }
+    if (failed) {
+        bsq_offload_destroy(off);
+        return NULL;
+    }
+    return off;
+}
+
+void bsq_offload_destroy(bsq_offload_t *off) {
+    if (!off) return;
+    for (uint32_t i = 0; off->store_slots && i < off->num_staging; ++i) {
+        bsq_job_release(off->store_slots[i].job);
+        free(off->store_slots[i].data);
+    }
+    for (uint32_t i = 0; off->load_slots && i <= off->lookahead; ++i) {
+        bsq_job_release(off->load_slots[i].job);
+        free(off->load_slots[i].data);
+    }
+    if (off->owns_async) bsq_async_destroy(off->async);
+    free(off->packed);
+    free(off->stored);
+    free(off->store_slot);
+    free(off->load_slot);
+    free(off->store_slots);
+    free(off->load_slots);
+    free(off);
+}
+
+float *bsq_offload_stage(bsq_offload_t *off) {
+    if (!off) return NULL;
+    if (off->staged >= 0) return off->store_slots[off->staged].data;
+
+    const uint32_t i = off->next_stage;
+    _settle_store_slot(off, i);
+    off->next_stage = (i + 1) % off->num_staging;
+    off->staged = i;
+    return off->store_slots[i].data;
+}
+
+int bsq_offload_store(bsq_offload_t *off, uint32_t layer) {
+    if (!off || layer >= off->num_layers || off->staged < 0) return 1;
+    const uint32_t i = (uint32_t)off->staged;
+    off->staged = -1;
+
+    /* The packed buffer is about to change: nothing may still read or write it. */
+    if (off->load_slot[layer] >= 0) _evict_load_slot(off, (uint32_t)off->load_slot[layer]);
+    if (off->store_slot[layer] >= 0) _settle_store_slot(off, (uint32_t)off->store_slot[layer]);
+
+    slot_t *slot = &off->store_slots[i];
+    void *dst = _packed(off, layer);
+    slot->job = _is_sparse(off->method)
+        ? bsq_async_compress_2d_into(off->async, slot->data, off->shape.num_tokens, off->shape.num_features,
+                                     off->shape.sparse_ratio, off->method, dst, off->packed_size, NULL, NULL, NULL)
+        : bsq_async_compress_1d_into(off->async, slot->data, off->num_elements, off->method,
+                                     dst, off->packed_size, NULL, NULL, NULL);
+    if (!slot->job) {
+        off->stored[layer] = 2;
+        return 1;
+    }
+    slot->layer = layer;
+    off->store_slot[layer] = (int32_t)i;
+    off->stored[layer] = 1;
+    off->stats.stores++;
+    return 0;
+}
+
+/* A load slot free to take a layer, chosen outside the window [first, first + lookahead]. */
+static uint32_t _claim_load_slot(bsq_offload_t *off, uint32_t first) {
+    const uint32_t num_slots = off->lookahead + 1;
+    for (uint32_t i = 0; i < num_slots; ++i) {
+        const int64_t held = off->load_slots[i].layer;
+        const uint32_t distance = held < 0 ? num_slots
+                                           : ((uint32_t)held + off->num_layers - first) % off->num_layers;
+        if (distance >= num_slots) {
+            _evict_load_slot(off, i);
+            return i;
+        }
+    }
+    return 0;   /* unreachable: the window holds lookahead + 1 layers and one of them has no slot yet */
+}
+
+/* Start decoding layer into a claimed slot; 1 if its compressed data is not (or not yet) usable. */
+static int _start_load(bsq_offload_t *off, uint32_t layer, uint32_t first, int wait_for_store) {
+    if (off->stored[layer] != 1) return 1;
+    if (off->store_slot[layer] >= 0) {
+        if (!wait_for_store && bsq_job_poll(off->store_slots[off->store_slot[layer]].job) < BSQ_JOB_DONE) return 1;
+        _settle_store_slot(off, (uint32_t)off->store_slot[layer]);
+        if (off->stored[layer] != 1) return 1;
+    }
+
+    const uint32_t i = _claim_load_slot(off, first);
+    slot_t *slot = &off->load_slots[i];
+    slot->job = bsq_async_decompress(off->async, _packed(off, layer), slot->data, off->num_elements, NULL, NULL);
+    if (!slot->job) return 1;
+    slot->layer = layer;
+    off->load_slot[layer] = (int32_t)i;
+    return 0;
+}
+
+const float *bsq_offload_load(bsq_offload_t *off, uint32_t layer) {
+    if (!off || layer >= off->num_layers || off->stored[layer] == 0) return NULL;
+
+    if (off->load_slot[layer] >= 0) {
+        off->stats.prefetch_hits++;
+    } else if (_start_load(off, layer, layer, 1)) {
+        return NULL;
+    }
+    slot_t *slot = &off->load_slots[off->load_slot[layer]];
+    if (_settle(slot, &off->stats.load_stall_ns) != BSQ_JOB_DONE) {
+        off->load_slot[layer] = -1;
+        slot->layer = -1;
+        return NULL;
+    }
+    off->stats.loads++;
+
+    /* Queue the next layers, wrapping to the start for the next pass. Layers still compressing are skipped
+     * rather than waited for; they are decoded on demand. */
+    for (uint32_t k = 1; k <= off->lookahead; ++k) {
+        const uint32_t next = (layer + k) % off->num_layers;
+        if (off->load_slot[next] < 0) _start_load(off, next, layer, 0);
+    }
+    return slot->data;
+}
+
+const bitsqueeze_buffer_t *bsq_offload_buffer(bsq_offload_t *off, uint32_t layer) {
+    if (!off || layer >= off->num_layers || off->stored[layer] == 0) return NULL;
+    if (off->store_slot[layer] >= 0) _settle_store_slot(off, (uint32_t)off->store_slot[layer]);
+    return off->stored[layer] == 1 ? _packed(off, layer) : NULL;
+}
+
+int bsq_offload_sync(bsq_offload_t *off) {
+    if (!off) return 1;
+    for (uint32_t i = 0; i < off->num_staging; ++i) _settle_store_slot(off, i);
+    int failed = 0;
+    for (uint32_t l = 0; l < off->num_layers; ++l) failed |= off->stored[l] == 2;
+    return failed;
+}
+
+void bsq_offload_get_stats(const bsq_offload_t *off, bsq_offload_stats_t *stats) {
+    if (!off || !stats) return;
+    *stats = off->stats;
+}
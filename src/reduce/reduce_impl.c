@@ -0,0 +1,263 @@
+#include "bitsqueeze.h"
+#include "bitsqueeze_internal.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "int_quantization/q8_dot_impl.h"
+#include "sparsity/topk_impl.h"
+#include "utils/dot.h"
+
+/* Elements the generic path decodes per step: a multiple of every granule, so no block is decoded twice. */
+#define REDUCE_CHUNK 1024
+
+static int _is_sparse(bsq_method_t method) {
+    return method == TOPK || method == TOPK_IM;
+}
+
+static uint64_t _num_elements(const bitsqueeze_buffer_t *buf) {
+    return _is_sparse(buf->method) ? (uint64_t)buf->shape.num_tokens * buf->shape.num_features
+                                   : buf->shape.num_elements;
+}
+
+static int _q4_code(const uint8_t *data, uint64_t i) {
+    return i % 2 == 0 ? (int8_t)(data[i / 2] & 0xF0) >> 4 : (int8_t)(data[i / 2] << 4) >> 4;
+}
+
+/* Q8_0 and Q4_0: integer sums of each block's codes, scaled once per block. */
+static void _reduce_int_blocks(const bitsqueeze_buffer_t *buf, bsq_reduction_t *out) {
+    const int is_q4 = buf->method == Q4_0;
+    const q8_0_array_t *q8 = (const q8_0_array_t *)buf->payload;
+    const q4_0_array_t *q4 = (const q4_0_array_t *)buf->payload;
+    const uint64_t num_elements = is_q4 ? q4->num_elements : q8->num_elements;
+    const uint64_t num_blocks = is_q4 ? q4->num_blocks : q8->num_blocks;
+    const uint64_t block_size = is_q4 ? q4->block_size : q8->block_size;
+    const float *scales = is_q4 ? q4->scales : q8->scales;
+    double sum = 0.0, sum_squares = 0.0;
+    float abs_max = 0.0f;
+
+#if defined(__linux__) && defined(_OPENMP)
+#pragma omp parallel for reduction(+:sum, sum_squares) reduction(max:abs_max)
+#endif
+    for (uint64_t b = 0; b < num_blocks; ++b) {
+        const uint64_t start = b * block_size;
+        const uint64_t stop = start + block_size < num_elements ? start + block_size : num_elements;
+        int64_t code_sum = 0, code_squares = 0;
+        int code_max = 0;
+        for (uint64_t i = start; i < stop; ++i) {
+            const int q = is_q4 ? _q4_code((const uint8_t *)q4->data, i) : q8->data[i];
+            code_sum += q;
+            code_squares += q * q;
+            if (abs(q) > code_max) code_max = abs(q);
+        }
+        const float scale = scales[b];
+        sum += (double)scale * (double)code_sum;
+        sum_squares += (double)scale * scale * (double)code_squares;
+        if (fabsf(scale * (float)code_max) > abs_max) abs_max = fabsf(scale * (float)code_max);
+    }
+    out->sum = sum;
+    out->sum_squares = sum_squares;
+    out->abs_max = abs_max;
+}
+
+/* TOPK / TOPK_IM: dropped entries are zero, so only the kept values count. */
+static void _reduce_sparse(const sparse_array_t *arr, bsq_reduction_t *out) {
+    const uint64_t count = (uint64_t)arr->num_tokens * arr->num_sparse_features;
+    double sum = 0.0, sum_squares = 0.0;
+    float abs_max = 0.0f;
+
+#if defined(__linux__) && defined(_OPENMP)
+#pragma omp parallel for reduction(+:sum, sum_squares) reduction(max:abs_max)
+#endif
+    for (uint64_t i = 0; i < count; ++i) {
+        const float v = arr->values[i];
+        sum += v;
+        sum_squares += (double)v * v;
+        if (fabsf(v) > abs_max) abs_max = fabsf(v);
+    }
+    out->sum = sum;
+    out->sum_squares = sum_squares;
+    out->abs_max = abs_max;
+}
+
+/* Every other format: decode REDUCE_CHUNK elements at a time onto the stack. */
+static int _reduce_generic(const bitsqueeze_buffer_t *buf, bsq_reduction_t *out) {
+    const uint64_t num_elements = buf->shape.num_elements;
+    const uint64_t num_chunks = (num_elements + REDUCE_CHUNK - 1) / REDUCE_CHUNK;
+    double sum = 0.0, sum_squares = 0.0;
+    float abs_max = 0.0f;
+    int failed = 0;
+
+#if defined(__linux__) && defined(_OPENMP)
+#pragma omp parallel for reduction(+:sum, sum_squares) reduction(max:abs_max) reduction(|:failed)
+#endif
+    for (uint64_t c = 0; c < num_chunks; ++c) {
+        const uint64_t start = c * REDUCE_CHUNK;
+        const uint64_t count = num_elements - start < REDUCE_CHUNK ? num_elements - start : REDUCE_CHUNK;
+        float panel[REDUCE_CHUNK];
+        if (bsq_decompress_range_serial(buf, start, count, panel)) {
+            failed = 1;
+            continue;
+        }
+        for (uint64_t i = 0; i < count; ++i) {
+            sum += panel[i];
+            sum_squares += (double)panel[i] * panel[i];
+            if (fabsf(panel[i]) > abs_max) abs_max = fabsf(panel[i]);
+        }
+    }
+    out->sum = sum;
+    out->sum_squares = sum_squares;
+    out->abs_max = abs_max;
+    return failed;
+}
+
+int bsq_reduce(const bitsqueeze_buffer_t *buf, bsq_reduction_t *out) {
+    if (!buf || !buf->payload || !out) return 1;
+
+    switch (buf->method) {
+        case Q8_0:
+        case Q4_0:
+            _reduce_int_blocks(buf, out);
+            return 0;
+        case TOPK:
+        case TOPK_IM:
+            _reduce_sparse((const sparse_array_t *)buf->payload, out);
+            return 0;
+        default:
+            return _reduce_generic(buf, out);
+    }
+}
+
+int bsq_dot(const bitsqueeze_buffer_t *buf, const float *x, uint64_t num_elements, double *result) {
+    if (!buf || !buf->payload || !x || !result || num_elements != _num_elements(buf)) return 1;
+
+    double sum = 0.0;
+    int failed = 0;
+    if (_is_sparse(buf->method)) {
+        const sparse_array_t *arr = (const sparse_array_t *)buf->payload;
+        const uint16_t k = arr->num_sparse_features;
+
+#if defined(__linux__) && defined(_OPENMP)
+#pragma omp parallel for reduction(+:sum)
+#endif
+        for (uint32_t token = 0; token < arr->num_tokens; ++token) {
+            const float *row = x + (uint64_t)token * arr->num_features;
+            for (uint16_t j = 0; j < k; ++j) {
+                const uint64_t i = (uint64_t)token * k + j;
+                sum += (double)arr->values[i] * row[arr->sparse_indices[i]];
+            }
+        }
+    } else {
+        const uint64_t num_chunks = (num_elements + REDUCE_CHUNK - 1) / REDUCE_CHUNK;
+
+#if defined(__linux__) && defined(_OPENMP)
+#pragma omp parallel for reduction(+:sum) reduction(|:failed)
+#endif
+        for (uint64_t c = 0; c < num_chunks; ++c) {
+            const uint64_t start = c * REDUCE_CHUNK;
+            const uint64_t count = num_elements - start < REDUCE_CHUNK ? num_elements - start : REDUCE_CHUNK;
+            float panel[REDUCE_CHUNK];
+            if (bsq_decompress_range_serial(buf, start, count, panel)) {
+                failed = 1;
+                continue;
+            }
+            sum += bsq_dot_f32(panel, x + start, count);
+        }
+    }
+    *result = sum;
+    return failed;
+}
+
+/* Two sparse arrays of one shape: scatter a token of a into a dense row and gather b's kept entries from it. */
+static int _dot_sparse(const sparse_array_t *a, const sparse_array_t *b, double *result) {
+    if (a->num_tokens != b->num_tokens || a->num_features != b->num_features) return 1;
+    float *row = (float *)calloc(a->num_features, sizeof(float));
+    if (!row) return 1;
+
+    double sum = 0.0;
+    for (uint32_t token = 0; token < a->num_tokens; ++token) {
+        const uint64_t base_a = (uint64_t)token * a->num_sparse_features;
+        const uint64_t base_b = (uint64_t)token * b->num_sparse_features;
+        for (uint16_t j = 0; j < a->num_sparse_features; ++j) row[a->sparse_indices[base_a + j]] = a->values[base_a + j];
+        for (uint16_t j = 0; j < b->num_sparse_features; ++j) {
+            sum += (double)b->values[base_b + j] * row[b->sparse_indices[base_b + j]];
+        }
+        for (uint16_t j = 0; j < a->num_sparse_features; ++j) row[a->sparse_indices[base_a + j]] = 0.0f;
+    }
+    free(row);
+    *result = sum;
+    return 0;
+}
+
+static int _int_dot_compatible(const bitsqueeze_buffer_t *weights, const bitsqueeze_buffer_t *act) {
+    const uint64_t block_size = bsq_payload_granule(weights);
+    return (weights->method == Q8_0 || weights->method == Q4_0) && block_size == DEFAULT_Q8_0_BLOCK_SIZE &&
+           bsq_payload_granule(act) == DEFAULT_Q8_0_BLOCK_SIZE && act->shape.num_elements % block_size == 0;
+}
+
+static int _dot_int_blocks(const bitsqueeze_buffer_t *weights, const bitsqueeze_buffer_t *act, double *result) {
+    const uint64_t num_elements = act->shape.num_elements;
+    const uint64_t num_chunks = (num_elements + REDUCE_CHUNK - 1) / REDUCE_CHUNK;
+    double sum = 0.0;
+    int failed = 0;
+
+#if defined(__linux__) && defined(_OPENMP)
+#pragma omp parallel for reduction(+:sum) reduction(|:failed)
+#endif
+    for (uint64_t c = 0; c < num_chunks; ++c) {
+        const uint64_t start = c * REDUCE_CHUNK;
+        const uint64_t count = num_elements - start < REDUCE_CHUNK ? num_elements - start : REDUCE_CHUNK;
+        bsq_view_t w, x;
+        float y = 0.0f;
+        if (bsq_slice_payload(weights, start, count, &w) || bsq_slice_payload(act, start, count, &x)) {
+            failed = 1;
+            continue;
+        }
+        const q8_0_array_t *xa = (const q8_0_array_t *)x.buf.payload;
+        if (weights->method == Q8_0 ? q8_0_dot_q8((const q8_0_array_t *)w.buf.payload, xa->data, xa->scales, &y)
+                                    : q4_0_dot_q8((const q4_0_array_t *)w.buf.payload, xa->data, xa->scales, &y)) {
+            failed = 1;
+            continue;
+        }
+        sum += y;
+    }
+    *result = sum;
+    return failed;
+}
+
+int bsq_dot_buffers(const bitsqueeze_buffer_t *a, const bitsqueeze_buffer_t *b, double *result) {
+    if (!a || !b || !a->payload || !b->payload || !result) return 1;
+    if (_is_sparse(a->method) || _is_sparse(b->method)) {
+        if (!_is_sparse(a->method) || !_is_sparse(b->method)) return 1;
+        return _dot_sparse((const sparse_array_t *)a->payload, (const sparse_array_t *)b->payload, result);
+    }
+
+    const uint64_t num_elements = a->shape.num_elements;
+    if (num_elements != b->shape.num_elements) return 1;
+
+    /* Q8_0 against Q8_0 or Q4_0 runs on the integer block kernels, with a Q8_0 side as the activations. */
+    if (b->method == Q8_0 && _int_dot_compatible(a, b)) return _dot_int_blocks(a, b, result);
+    if (a->method == Q8_0 && _int_dot_compatible(b, a)) return _dot_int_blocks(b, a, result);
+
+    const uint64_t num_chunks = (num_elements + REDUCE_CHUNK - 1) / REDUCE_CHUNK;
+    double sum = 0.0;
+    int failed = 0;
+
+#if defined(__linux__) && defined(_OPENMP)
+#pragma omp parallel for reduction(+:sum) reduction(|:failed)
+#endif
+    for (uint64_t c = 0; c < num_chunks; ++c) {
+        const uint64_t start = c * REDUCE_CHUNK;
+        const uint64_t count = num_elements - start < REDUCE_CHUNK ? num_elements - start : REDUCE_CHUNK;
+        float panel_a[REDUCE_CHUNK];
+        float panel_b[REDUCE_CHUNK];
+        if (bsq_decompress_range_serial(a, start, count, panel_a) ||
+            bsq_decompress_range_serial(b, start, count, panel_b)) {
+            failed = 1;
+            continue;
+        }
+        sum += bsq_dot_f32(panel_a, panel_b, count);
+    }
+    *result = sum;
+    return failed;
+}
@@ -0,0 +1,451 @@
+/* posix_madvise needs POSIX.1-2001; the library builds with 199309L by default. */
+#ifdef _POSIX_C_SOURCE
+#undef _POSIX_C_SOURCE
+#endif
+#define _POSIX_C_SOURCE 200112L
+
+#include "bitsqueeze.h"
+#include "serialization/container_impl.h"
+#include "serialization/portable_impl.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define BSQ_CONTAINER_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+struct bsq_container_writer {
+    FILE     *fp;
+    uint64_t  offset;          /* bytes written so far */
+    uint32_t  num_tensors;
+    uint32_t  index_capacity;  /* entries */
+    uint8_t  *index;
+    char     *strings;
+    uint64_t  strings_size;
+    uint64_t  strings_capacity;
+    uint8_t  *scratch;         /* portable bytes of the tensor being added, reused */
+    int64_t   scratch_capacity;
+    int       failed;
+};
+
+struct bsq_container {
+    const uint8_t *base;
+    uint64_t       size;
+    int            mapped;
+    uint32_t       num_tensors;
+    uint32_t       entry_size;
+    const uint8_t *index;
+    const char    *strings;
+    uint64_t       strings_size;
+    uint32_t      *slots;      /* open-addressing name table holding index + 1, 0 = empty */
+    uint32_t       slot_mask;
+};
+
+static uint64_t _align_up(uint64_t v) {
+    return (v + BSQ_PORTABLE_ALIGNMENT - 1) & ~(uint64_t)(BSQ_PORTABLE_ALIGNMENT - 1);
+}
+
+/* FNV-1a */
+static uint32_t _hash_name(const char *name, uint64_t length) {
+    uint32_t h = 2166136261u;
+    for (uint64_t i = 0; i < length; ++i) {
+        h ^= (uint8_t)name[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static int _write_bytes(bsq_container_writer_t *writer, const void *data, uint64_t size) {
+    if (size && fwrite(data, 1, (size_t)size, writer->fp) != (size_t)size) return 1;
+    writer->offset += size;
+    return 0;
+}
+
+static int _write_padding(bsq_container_writer_t *writer) {
+    static const uint8_t zeros[BSQ_PORTABLE_ALIGNMENT] = {0};
+    return _write_bytes(writer, zeros, _align_up(writer->offset) - writer->offset);
+}
+
+bsq_container_writer_t *bsq_container_writer_open(const char *path) {
+    if (!path) return NULL;
+
+    bsq_container_writer_t *writer = (bsq_container_writer_t *)calloc(1, sizeof(*writer));
+    if (!writer) return NULL;
+
+    writer->fp = fopen(path, "wb");
+    if (!writer->fp) {
+        free(writer);
+        return NULL;
+    }
+
+    /* Placeholder header, rewritten on close once the index location is known. */
+    const uint8_t header[BSQ_CONTAINER_HEADER_SIZE] = {0};
+    if (_write_bytes(writer, header, sizeof(header)) || _write_padding(writer)) {
+        fclose(writer->fp);
+        free(writer);
+        return NULL;
+    }
+    return writer;
+}
+
+int bsq_container_writer_add(bsq_container_writer_t *writer, const char *name, const bitsqueeze_buffer_t *buf) {
+    if (!writer || !name || writer->failed) return 1;
+
+    const uint64_t name_length = strlen(name);
+    const int64_t size = bsq_get_portable_size(buf);
+    if (size == 0 || writer->num_tensors == UINT32_MAX ||
+        writer->strings_size + name_length + 1 > UINT32_MAX) {
+        return 1;
+    }
+
+    if (writer->num_tensors == writer->index_capacity) {
+        const uint32_t capacity = writer->index_capacity ? writer->index_capacity * 2 : 64;
+        uint8_t *index = (uint8_t *)realloc(writer->index, (size_t)capacity * BSQ_CONTAINER_ENTRY_SIZE);
+        if (!index) return 1;
+        writer->index = index;
+        writer->index_capacity = capacity;
+    }
+    if (writer->strings_size + name_length + 1 > writer->strings_capacity) {
+        uint64_t capacity = writer->strings_capacity ? writer->strings_capacity * 2 : 4096;
+        while (capacity < writer->strings_size + name_length + 1) capacity *= 2;
+        char *strings = (char *)realloc(writer->strings, (size_t)capacity);
+        if (!strings) return 1;
+        writer->strings = strings;
+        writer->strings_capacity = capacity;
+    }
+    if (size > writer->scratch_capacity) {
+        uint8_t *scratch = (uint8_t *)realloc(writer->scratch, (size_t)size);
+        if (!scratch) return 1;
+        writer->scratch = scratch;
+        writer->scratch_capacity = size;
+    }
+
+    if (bsq_write_portable(buf, writer->scratch, size)) return 1;
+
+    /* From here on a short write leaves the file inconsistent. */
+    const uint64_t data_offset = writer->offset;
+    if (_write_bytes(writer, writer->scratch, (uint64_t)size) || _write_padding(writer)) {
+        writer->failed = 1;
+        return 1;
+    }
+
+    uint8_t *entry = writer->index + (size_t)writer->num_tensors * BSQ_CONTAINER_ENTRY_SIZE;
+    uint32_t ratio_bits;
+    memcpy(&ratio_bits, &buf->shape.sparse_ratio, sizeof(ratio_bits));
+    memset(entry, 0, BSQ_CONTAINER_ENTRY_SIZE);
+    bsq_store_le64(entry, data_offset);
+    bsq_store_le64(entry + 8, (uint64_t)size);
+    bsq_store_le64(entry + 16, buf->shape.num_elements);
+    bsq_store_le32(entry + 24, (uint32_t)writer->strings_size);
+    bsq_store_le32(entry + 28, (uint32_t)name_length);
+    bsq_store_le32(entry + 32, (uint32_t)buf->method);
+    bsq_store_le16(entry + 36, buf->shape.num_tokens);
+    bsq_store_le16(entry + 38, buf->shape.num_features);
+    bsq_store_le32(entry + 40, ratio_bits);
+
+    memcpy(writer->strings + writer->strings_size, name, name_length + 1);
+    writer->strings_size += name_length + 1;
+    writer->num_tensors++;
+    return 0;
+}
+
+int bsq_container_writer_close(bsq_container_writer_t *writer) {
+    if (!writer) return 1;
+
+    int failed = writer->failed;
+    const uint64_t index_offset = writer->offset;
+    const uint64_t index_size = (uint64_t)writer->num_tensors * BSQ_CONTAINER_ENTRY_SIZE;
+    const uint64_t strings_offset = index_offset + index_size;
+
+    if (!failed) {
+        failed = _write_bytes(writer, writer->index, index_size) ||
+                 _write_bytes(writer, writer->strings, writer->strings_size) ||
+                 _write_padding(writer);
+    }
+
+    if (!failed) {
+        uint8_t header[BSQ_CONTAINER_HEADER_SIZE] = {0};
+        memcpy(header, BSQ_CONTAINER_MAGIC, 4);
+        bsq_store_le16(header + 4, BSQ_CONTAINER_VERSION);
+        bsq_store_le16(header + 6, BSQ_CONTAINER_HEADER_SIZE);
+        bsq_store_le32(header + 8, writer->num_tensors);
+        bsq_store_le32(header + 12, BSQ_CONTAINER_ENTRY_SIZE);
+        bsq_store_le64(header + 16, index_offset);
+        bsq_store_le64(header + 24, strings_offset);
+        bsq_store_le64(header + 32, writer->strings_size);
+        bsq_store_le64(header + 40, writer->offset);
+        failed = fseek(writer->fp, 0, SEEK_SET) != 0 ||
+                 fwrite(header, 1, sizeof(header), writer->fp) != sizeof(header);
+    }
+
+    if (fclose(writer->fp) != 0) failed = 1;
+    free(writer->index);
+    free(writer->strings);
+    free(writer->scratch);
+    free(writer);
+    return failed;
+}
+
+static const uint8_t *_entry(const bsq_container_t *container, uint32_t index) {
+    return container->index + (uint64_t)index * container->entry_size;
+}
+
+static void _unmap(bsq_container_t *container) {
+#ifdef BSQ_CONTAINER_MMAP
+    if (container->mapped) {
+        munmap((void *)(uintptr_t)container->base, (size_t)container->size);
+        return;
+    }
+#endif
+    free((void *)(uintptr_t)container->base);
+}
+
+/* Map the whole file; pages are only read once touched. */
+static int _map_file(const char *path, bsq_container_t *container) {
+#ifdef BSQ_CONTAINER_MMAP
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) return 1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < BSQ_CONTAINER_HEADER_SIZE) {
+        close(fd);
+        return 1;
+    }
+
+    void *base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return 1;
+
+    container->base = (const uint8_t *)base;
+    container->size = (uint64_t)st.st_size;
+    container->mapped = 1;
+    return 0;
+#else
+    /* No mmap on this platform: read the file into memory once. */
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return 1;
+
+    long size = -1;
+    if (fseek(fp, 0, SEEK_END) == 0) size = ftell(fp);
+    uint8_t *base = size >= BSQ_CONTAINER_HEADER_SIZE ? (uint8_t *)malloc((size_t)size) : NULL;
+    if (!base || fseek(fp, 0, SEEK_SET) != 0 || fread(base, 1, (size_t)size, fp) != (size_t)size) {
+        free(base);
+        fclose(fp);
+        return 1;
+    }
+    fclose(fp);
+
+    container->base = base;
+    container->size = (uint64_t)size;
+    container->mapped = 0;
+    return 0;
+#endif
+}
+
+/* Check the header and every index entry, and build the name table. Touches no tensor data. */
+static int _parse_index(bsq_container_t *container) {
+    const uint8_t *header = container->base;
+    if (memcmp(header, BSQ_CONTAINER_MAGIC, 4) != 0) return 1;
+    if (bsq_load_le16(header + 4) != BSQ_CONTAINER_VERSION) return 1;
+
+    const uint64_t header_size = bsq_load_le16(header + 6);
+    const uint64_t index_offset = bsq_load_le64(header + 16);
+    const uint64_t strings_offset = bsq_load_le64(header + 24);
+    const uint64_t strings_size = bsq_load_le64(header + 32);
+    const uint64_t total_size = bsq_load_le64(header + 40);
+    container->num_tensors = bsq_load_le32(header + 8);
+    container->entry_size = bsq_load_le32(header + 12);
+
+    if (header_size < BSQ_CONTAINER_HEADER_SIZE || container->entry_size < BSQ_CONTAINER_ENTRY_SIZE) return 1;
+    if (total_size > container->size) return 1;
+    if (index_offset > total_size ||
+        (uint64_t)container->num_tensors * container->entry_size > total_size - index_offset) {
+        return 1;
+    }
+    if (strings_offset > total_size || strings_size > total_size - strings_offset) return 1;
+
+    container->index = container->base + index_offset;
+    container->strings = (const char *)(container->base + strings_offset);
+    container->strings_size = strings_size;
+
+    uint32_t slots = 1;
+    while (slots < 2 * (uint64_t)container->num_tensors) slots <<= 1;
+    container->slots = (uint32_t *)calloc(slots, sizeof(uint32_t));
+    if (!container->slots) return 1;
+    container->slot_mask = slots - 1;
+
+    for (uint32_t i = 0; i < container->num_tensors; ++i) {
+        const uint8_t *entry = _entry(container, i);
+        const uint64_t data_offset = bsq_load_le64(entry);
+        const uint64_t data_size = bsq_load_le64(entry + 8);
+        const uint64_t name_offset = bsq_load_le32(entry + 24);
+        const uint64_t name_length = bsq_load_le32(entry + 28);
+
+        if (data_offset % BSQ_PORTABLE_ALIGNMENT != 0 ||
+            data_offset > total_size || data_size > total_size - data_offset) {
+            return 1;
+        }
+        if (name_offset + name_length >= strings_size || container->strings[name_offset + name_length] != '\0') {
+            return 1;
+        }
+
+        /* First entry wins for duplicate names. */
+        const char *name = container->strings + name_offset;
+        uint32_t slot = _hash_name(name, name_length) & container->slot_mask;
+        while (container->slots[slot]) {
+            const uint8_t *other = _entry(container, container->slots[slot] - 1);
+            if (bsq_load_le32(other + 28) == name_length &&
+                memcmp(container->strings + bsq_load_le32(other + 24), name, (size_t)name_length) == 0) {
+                break;
+            }
+            slot = (slot + 1) & container->slot_mask;
+        }
+        if (!container->slots[slot]) container->slots[slot] = i + 1;
+    }
+    return 0;
+}
+
+bsq_container_t *bsq_container_open(const char *path) {
+    if (!path) return NULL;
+
+    bsq_container_t *container = (bsq_container_t *)calloc(1, sizeof(*container));
+    if (!container) return NULL;
+
+    if (_map_file(path, container)) {
+        free(container);
+        return NULL;
+    }
+    if (_parse_index(container)) {
+        bsq_container_close(container);
+        return NULL;
+    }
+    return container;
+}
+
+void bsq_container_close(bsq_container_t *container) {
+    if (!container) return;
+    _unmap(container);
+    free(container->slots);
+    free(container);
+}
+
+uint32_t bsq_container_num_tensors(const bsq_container_t *container) {
+    return container ? container->num_tensors : 0;
+}
+
+int64_t bsq_container_find(const bsq_container_t *container, const char *name) {
+    if (!container || !name) return -1;
+
+    const uint64_t name_length = strlen(name);
+    uint32_t slot = _hash_name(name, name_length) & container->slot_mask;
+    while (container->slots[slot]) {
+        const uint32_t index = container->slots[slot] - 1;
+        const uint8_t *entry = _entry(container, index);
+        if (bsq_load_le32(entry + 28) == name_length &&
+            memcmp(container->strings + bsq_load_le32(entry + 24), name, (size_t)name_length) == 0) {
+            return index;
+        }
+        slot = (slot + 1) & container->slot_mask;
+    }
+    return -1;
+}
+
+const char *bsq_container_name(const bsq_container_t *container, uint32_t index) {
+    if (!container || index >= container->num_tensors) return NULL;
+    return container->strings + bsq_load_le32(_entry(container, index) + 24);
+}
+
+int bsq_container_info(const bsq_container_t *container,
+                       uint32_t index,
+                       bsq_method_t *method,
+                       bsq_shape_t *shape) {
+    if (!container || index >= container->num_tensors) return 1;
+
+    const uint8_t *entry = _entry(container, index);
+    if (method) *method = (bsq_method_t)bsq_load_le32(entry + 32);
+    if (shape) {
+        const uint32_t ratio_bits = bsq_load_le32(entry + 40);
+        memset(shape, 0, sizeof(*shape));
+        shape->num_elements = bsq_load_le64(entry + 16);
+        shape->num_tokens = bsq_load_le16(entry + 36);
+        shape->num_features = bsq_load_le16(entry + 38);
+        memcpy(&shape->sparse_ratio, &ratio_bits, sizeof(ratio_bits));
+    }
+    return 0;
+}
+
+static int _tensor_bytes(const bsq_container_t *container, uint32_t index,
+                         const uint8_t **data, uint64_t *size) {
+    if (!container || index >= container->num_tensors) return 1;
+    const uint8_t *entry = _entry(container, index);
+    *data = container->base + bsq_load_le64(entry);
+    *size = bsq_load_le64(entry + 8);
+    return 0;
+}
+
+/* The blob must describe the tensor the index promised. */
+static int _matches_index(const bsq_container_t *container, uint32_t index, const bitsqueeze_buffer_t *buf) {
+    bsq_method_t method;
+    bsq_shape_t shape;
+    bsq_container_info(container, index, &method, &shape);
+    return buf->method == method &&
+           buf->shape.num_elements == shape.num_elements &&
+           buf->shape.num_tokens == shape.num_tokens &&
+           buf->shape.num_features == shape.num_features;
+}
+
+int bsq_container_view(const bsq_container_t *container, uint32_t index, bsq_view_t *view) {
+    const uint8_t *data;
+    uint64_t size;
+    if (_tensor_bytes(container, index, &data, &size)) return 1;
+    if (bsq_view_portable(data, (int64_t)size, view)) return 1;
+    return _matches_index(container, index, &view->buf) ? 0 : 1;
+}
+
+bitsqueeze_buffer_t *bsq_container_load(const bsq_container_t *container, uint32_t index) {
+    const uint8_t *data;
+    uint64_t size;
+    if (_tensor_bytes(container, index, &data, &size)) return NULL;
+
+    bitsqueeze_buffer_t *buf = bsq_load_portable(data, (int64_t)size);
+    if (buf && !_matches_index(container, index, buf)) {
+        bsq_free(buf);
+        return NULL;
+    }
+    return buf;
+}
+
+#ifdef BSQ_CONTAINER_MMAP
+static int _advise(const bsq_container_t *container, uint32_t index, int advice) {
+    const uint8_t *data;
+    uint64_t size;
+    if (_tensor_bytes(container, index, &data, &size)) return 1;
+    if (!container->mapped || size == 0) return 0;
+
+    const uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+    const uintptr_t begin = (uintptr_t)data & ~(page - 1);
+    return posix_madvise((void *)begin, (size_t)((uintptr_t)data + size - begin), advice) != 0;
+}
+#endif
+
+int bsq_container_prefetch(const bsq_container_t *container, uint32_t index) {
+#ifdef BSQ_CONTAINER_MMAP
+    return _advise(container, index, POSIX_MADV_WILLNEED);
+#else
+    return !container || index >= container->num_tensors;
+#endif
+}
+
+int bsq_container_evict(const bsq_container_t *container, uint32_t index) {
+#ifdef BSQ_CONTAINER_MMAP
+    return _advise(container, index, POSIX_MADV_DONTNEED);
+#else
+    return !container || index >= container->num_tensors;
+#endif
+}
@@ -0,0 +1,327 @@
+#include "bitsqueeze.h"
+#include "bitsqueeze_internal.h"
+#include "serialization/portable_impl.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "float_quantization/bf16_impl.h"
+#include "float_quantization/fp16_impl.h"
+#include "float_quantization/mxfp8_impl.h"
+#include "float_quantization/mxfp4_impl.h"
+#include "float_quantization/nvfp4_impl.h"
+#include "float_quantization/nf4_impl.h"
+#include "float_quantization/nf4_dq_impl.h"
+#include "int_quantization/q8_0_impl.h"
+#include "int_quantization/q4_0_impl.h"
+#include "int_quantization/q2_k_impl.h"
+#include "int_quantization/iq2_xxs_impl.h"
+#include "int_quantization/iq2_xs_impl.h"
+#include "int_quantization/iq2_s_impl.h"
+#include "sparsity/topk_impl.h"
+#include "utils/alloc.h"
+
+/* How the elements of a section are converted between host and little-endian order. */
+typedef enum {
+    SWAP_NONE = 0,
+    SWAP_U16,
+    SWAP_U32,
+    SWAP_Q2_K     /* super_block_q2_k: two u16 fields followed by bytes */
+} swap_kind_t;
+
+typedef struct {
+    const uint8_t *data;
+    uint64_t       size;
+    swap_kind_t    swap;
+} section_t;
+
+typedef struct {
+    bsq_method_t method;
+    bsq_shape_t  shape;
+    uint64_t     block_size;
+    float        global_scale;
+    uint16_t     num_sparse_features;
+    uint32_t     num_sections;
+    uint64_t     offsets[BSQ_PORTABLE_MAX_SECTIONS];
+    uint64_t     sizes[BSQ_PORTABLE_MAX_SECTIONS];
+} portable_header_t;
+
+static uint64_t _align_up(uint64_t v) {
+    return (v + BSQ_PORTABLE_ALIGNMENT - 1) & ~(uint64_t)(BSQ_PORTABLE_ALIGNMENT - 1);
+}
+
+static uint32_t _f32_bits(float v) {
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    return bits;
+}
+
+static float _f32_from_bits(uint32_t bits) {
+    float v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+static void _section(section_t *s, const void *data, uint64_t size, swap_kind_t swap) {
+    s->data = (const uint8_t *)data;
+    s->size = size;
+    s->swap = swap;
+}
+
+/* Byte order of the index-th codec array of method, in bsq_payload_arrays order. */
+static swap_kind_t _section_swap(bsq_method_t method, uint32_t index) {
+    switch (method) {
+        case Q8_0:
+        case Q4_0:
+        case NF4:       return index == 0 ? SWAP_U32 : SWAP_NONE;
+        case Q2_K:
+        case Q2_K_FAST: return SWAP_Q2_K;
+        case TOPK:
+        case TOPK_IM:   return index == 0 ? SWAP_U16 : SWAP_U32;
+        case BF16:
+        case FP16:      return SWAP_U16;
+        case IQ2_XXS:   return index == 0 ? SWAP_U16 : SWAP_U32;    /* qs holds host-order u32 grid words */
+        case IQ2_S:     return index == 0 ? SWAP_U16 : SWAP_NONE;
+        case IQ2_XS:    return index < 2 ? SWAP_U16 : SWAP_NONE;
+        default:        return SWAP_NONE;
+    }
+}
+
+/* Codec arrays of buf in on-disk order; returns the section count, 0 for unknown methods. */
+static uint32_t _describe_sections(const bitsqueeze_buffer_t *buf, section_t *s) {
+    void *arrays[BSQ_MAX_PAYLOAD_ARRAYS];
+    uint64_t sizes[BSQ_MAX_PAYLOAD_ARRAYS];
+    const uint32_t num_sections = bsq_payload_arrays(buf, arrays, sizes);
+    for (uint32_t i = 0; i < num_sections; ++i) {
+        _section(&s[i], arrays[i], sizes[i], _section_swap(buf->method, i));
+    }
+    return num_sections;
+}
+
+static uint64_t _get_block_size(const bitsqueeze_buffer_t *buf) {
+    const void *p = buf->payload;
+    switch (buf->method) {
+        case Q8_0:   return ((const q8_0_array_t *)p)->block_size;
+        case Q4_0:   return ((const q4_0_array_t *)p)->block_size;
+        case MXFP8:  return ((const mxfp8_array_t *)p)->block_size;
+        case MXFP4:  return ((const mxfp4_array_t *)p)->block_size;
+        case NVFP4:  return ((const nvfp4_array_t *)p)->block_size;
+        case NF4:    return ((const nf4_array_t *)p)->block_size;
+        case NF4_DQ: return ((const nf4_dq_array_t *)p)->block_size;
+        default:     return 0;
+    }
+}
+
+static uint16_t _get_num_sparse_features(const bitsqueeze_buffer_t *buf) {
+    if (buf->method != TOPK && buf->method != TOPK_IM) return 0;
+    return ((const sparse_array_t *)buf->payload)->num_sparse_features;
+}
+
+/* Host order -> little-endian. dst and src must not overlap. */
+static void _encode_section(uint8_t *dst, const uint8_t *src, uint64_t size, swap_kind_t swap) {
+    switch (swap) {
+        case SWAP_U16:
+            for (uint64_t i = 0; i + 2 <= size; i += 2) {
+                uint16_t v;
+                memcpy(&v, src + i, sizeof(v));
+                bsq_store_le16(dst + i, v);
+            }
+            break;
+        case SWAP_U32:
+            for (uint64_t i = 0; i + 4 <= size; i += 4) {
+                uint32_t v;
+                memcpy(&v, src + i, sizeof(v));
+                bsq_store_le32(dst + i, v);
+            }
+            break;
+        case SWAP_Q2_K:
+            memcpy(dst, src, size);
+            for (uint64_t i = 0; i + sizeof(super_block_q2_k) <= size; i += sizeof(super_block_q2_k)) {
+                const super_block_q2_k *sb = (const super_block_q2_k *)(src + i);
+                bsq_store_le16(dst + i + offsetof(super_block_q2_k, super_scale), sb->super_scale);
+                bsq_store_le16(dst + i + offsetof(super_block_q2_k, super_min), sb->super_min);
+            }
+            break;
+        default:
+            memcpy(dst, src, size);
+            break;
+    }
+}
+
+/* Little-endian -> host order. dst and src must not overlap. */
+static void _decode_section(uint8_t *dst, const uint8_t *src, uint64_t size, swap_kind_t swap) {
+    switch (swap) {
+        case SWAP_U16:
+            for (uint64_t i = 0; i + 2 <= size; i += 2) {
+                const uint16_t v = bsq_load_le16(src + i);
+                memcpy(dst + i, &v, sizeof(v));
+            }
+            break;
+        case SWAP_U32:
+            for (uint64_t i = 0; i + 4 <= size; i += 4) {
+                const uint32_t v = bsq_load_le32(src + i);
+                memcpy(dst + i, &v, sizeof(v));
+            }
+            break;
+        case SWAP_Q2_K:
+            memcpy(dst, src, size);
+            for (uint64_t i = 0; i + sizeof(super_block_q2_k) <= size; i += sizeof(super_block_q2_k)) {
+                super_block_q2_k *sb = (super_block_q2_k *)(dst + i);
+                sb->super_scale = bsq_load_le16(src + i + offsetof(super_block_q2_k, super_scale));
+                sb->super_min = bsq_load_le16(src + i + offsetof(super_block_q2_k, super_min));
+            }
+            break;
+        default:
+            memcpy(dst, src, size);
+            break;
+    }
+}
+
+static int _parse_header(const uint8_t *src, int64_t src_size, portable_header_t *hdr) {
+    if (!src || src_size < BSQ_PORTABLE_HEADER_SIZE) return 1;
+    if (memcmp(src, BSQ_PORTABLE_MAGIC, 4) != 0) return 1;
+    if (bsq_load_le16(src + 4) != BSQ_PORTABLE_VERSION) return 1;
+
+    const uint64_t header_size = bsq_load_le16(src + 6);
+    const uint64_t total_size = bsq_load_le64(src + 48);
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->method = (bsq_method_t)bsq_load_le32(src + 8);
+    hdr->num_sections = bsq_load_le32(src + 12);
+    hdr->shape.num_elements = bsq_load_le64(src + 16);
+    hdr->block_size = bsq_load_le64(src + 24);
+    hdr->global_scale = _f32_from_bits(bsq_load_le32(src + 32));
+    hdr->shape.num_tokens = bsq_load_le16(src + 36);
+    hdr->shape.num_features = bsq_load_le16(src + 38);
+    hdr->num_sparse_features = bsq_load_le16(src + 40);
+    hdr->shape.sparse_ratio = _f32_from_bits(bsq_load_le32(src + 44));
+
+    if (header_size < BSQ_PORTABLE_HEADER_SIZE || total_size > (uint64_t)src_size) return 1;
+    if (hdr->num_sections == 0 || hdr->num_sections > BSQ_PORTABLE_MAX_SECTIONS) return 1;
+    if (header_size + (uint64_t)hdr->num_sections * BSQ_PORTABLE_SECTION_SIZE > total_size) return 1;
+
+    for (uint32_t i = 0; i < hdr->num_sections; ++i) {
+        const uint8_t *entry = src + header_size + (uint64_t)i * BSQ_PORTABLE_SECTION_SIZE;
+        hdr->offsets[i] = bsq_load_le64(entry);
+        hdr->sizes[i] = bsq_load_le64(entry + 8);
+        if (hdr->offsets[i] % BSQ_PORTABLE_ALIGNMENT != 0 ||
+            hdr->offsets[i] > total_size || hdr->sizes[i] > total_size - hdr->offsets[i]) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Lay out the codec header at buf->payload from hdr and check that it describes the same sections. */
+static int _bind_header(const portable_header_t *hdr, bitsqueeze_buffer_t *buf) {
+    buf->method = hdr->method;
+    buf->shape = hdr->shape;
+    if (bsq_payload_header_size(buf->method) == 0 || bsq_init_payload(buf)) return 1;
+    if (bsq_validate_payload_header(buf)) return 1;
+    if (_get_block_size(buf) != hdr->block_size) return 1;
+    if (_get_num_sparse_features(buf) != hdr->num_sparse_features) return 1;
+    bsq_set_payload_tensor_scale(buf, hdr->global_scale);
+
+    section_t sections[BSQ_PORTABLE_MAX_SECTIONS];
+    if (_describe_sections(buf, sections) != hdr->num_sections) return 1;
+    for (uint32_t i = 0; i < hdr->num_sections; ++i) {
+        if (sections[i].size != hdr->sizes[i]) return 1;
+    }
+    return 0;
+}
+
+int64_t bsq_get_portable_size(const bitsqueeze_buffer_t *buf) {
+    if (!buf || !buf->payload) return 0;
+
+    section_t sections[BSQ_PORTABLE_MAX_SECTIONS];
+    const uint32_t num_sections = _describe_sections(buf, sections);
+    if (num_sections == 0) return 0;
+
+    uint64_t size = _align_up(BSQ_PORTABLE_HEADER_SIZE + (uint64_t)num_sections * BSQ_PORTABLE_SECTION_SIZE);
+    for (uint32_t i = 0; i < num_sections; ++i) size = _align_up(size + sections[i].size);
+    return (int64_t)size;
+}
+
+int bsq_write_portable(const bitsqueeze_buffer_t *buf, void *dst, int64_t dst_size) {
+    const int64_t total_size = bsq_get_portable_size(buf);
+    if (!dst || total_size == 0 || dst_size < total_size) return 1;
+
+    section_t sections[BSQ_PORTABLE_MAX_SECTIONS];
+    const uint32_t num_sections = _describe_sections(buf, sections);
+    uint8_t *out = (uint8_t *)dst;
+    uint64_t offset = _align_up(BSQ_PORTABLE_HEADER_SIZE + (uint64_t)num_sections * BSQ_PORTABLE_SECTION_SIZE);
+
+    memset(out, 0, offset);
+    memcpy(out, BSQ_PORTABLE_MAGIC, 4);
+    bsq_store_le16(out + 4, BSQ_PORTABLE_VERSION);
+    bsq_store_le16(out + 6, BSQ_PORTABLE_HEADER_SIZE);
+    bsq_store_le32(out + 8, (uint32_t)buf->method);
+    bsq_store_le32(out + 12, num_sections);
+    bsq_store_le64(out + 16, buf->shape.num_elements);
+    bsq_store_le64(out + 24, _get_block_size(buf));
+    bsq_store_le32(out + 32, _f32_bits(bsq_payload_tensor_scale(buf)));
+    bsq_store_le16(out + 36, buf->shape.num_tokens);
+    bsq_store_le16(out + 38, buf->shape.num_features);
+    bsq_store_le16(out + 40, _get_num_sparse_features(buf));
+    bsq_store_le32(out + 44, _f32_bits(buf->shape.sparse_ratio));
+    bsq_store_le64(out + 48, (uint64_t)total_size);
+
+    for (uint32_t i = 0; i < num_sections; ++i) {
+        uint8_t *entry = out + BSQ_PORTABLE_HEADER_SIZE + (uint64_t)i * BSQ_PORTABLE_SECTION_SIZE;
+        bsq_store_le64(entry, offset);
+        bsq_store_le64(entry + 8, sections[i].size);
+
+        _encode_section(out + offset, sections[i].data, sections[i].size, sections[i].swap);
+        const uint64_t end = offset + sections[i].size;
+        offset = _align_up(end);
+        memset(out + end, 0, offset - end);
+    }
+    return 0;
+}
+
+int bsq_view_portable(const void *src, int64_t src_size, bsq_view_t *view) {
+    /* Sections are stored little-endian; big-endian hosts must go through bsq_load_portable. */
+    if (!bsq_host_is_little_endian()) return 1;
+    if (!src || !view || (uintptr_t)src % _Alignof(bitsqueeze_buffer_t) != 0) return 1;
+
+    portable_header_t hdr;
+    if (_parse_header((const uint8_t *)src, src_size, &hdr)) return 1;
+    if (bsq_payload_header_size(hdr.method) > sizeof(view->payload_header)) return 1;
+
+    memset(view, 0, sizeof(*view));
+    view->buf.payload = view->payload_header;
+    if (_bind_header(&hdr, &view->buf)) return 1;
+
+    void *bases[BSQ_PORTABLE_MAX_SECTIONS];
+    for (uint32_t i = 0; i < hdr.num_sections; ++i) {
+        bases[i] = (uint8_t *)(uintptr_t)src + hdr.offsets[i];
+    }
+    bsq_attach_payload_arrays(&view->buf, bases);
+    return 0;
+}
+
+bitsqueeze_buffer_t *bsq_load_portable(const void *src, int64_t src_size) {
+    portable_header_t hdr;
+    if (_parse_header((const uint8_t *)src, src_size, &hdr)) return NULL;
+
+    const int64_t packed_size = (hdr.method == TOPK || hdr.method == TOPK_IM)
+        ? bsq_compute_packed_size_2d(hdr.method, hdr.shape.num_tokens, hdr.shape.num_features, hdr.shape.sparse_ratio)
+        : bsq_compute_packed_size_1d(hdr.method, hdr.shape.num_elements);
+    if (packed_size <= 0) return NULL;
+
+    bitsqueeze_buffer_t *buf = (bitsqueeze_buffer_t *)bsq_alloc_bytes((size_t)packed_size, _Alignof(bitsqueeze_buffer_t), 0);
+    if (!buf) return NULL;
+    buf->payload = ((uint8_t *)buf) + sizeof(bitsqueeze_buffer_t);
+    if (_bind_header(&hdr, buf)) {
+        bsq_free(buf);
+        return NULL;
+    }
+
+    /* Decode into the compact in-memory layout laid out by _bind_header. */
+    section_t sections[BSQ_PORTABLE_MAX_SECTIONS];
+    _describe_sections(buf, sections);
+    for (uint32_t i = 0; i < hdr.num_sections; ++i) {
+        _decode_section((uint8_t *)(uintptr_t)sections[i].data, (const uint8_t *)src + hdr.offsets[i],
+                        sections[i].size, sections[i].swap);
+    }
+    return buf;
+}
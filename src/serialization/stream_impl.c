@@ -0,0 +1,287 @@
+#include "bitsqueeze.h"
+#include "bitsqueeze_internal.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "float_quantization/nf4_dq_impl.h"
+
+/* Elements encoded per flush (rounded up to the method's granule): 1 MiB of floats buffered at most. */
+#define STREAM_WINDOW_ELEMENTS (1u << 18)
+
+struct bsq_stream {
+    bsq_stream_write_fn write;
+    void               *user;
+    bsq_method_t        method;
+    uint64_t            num_elements;
+    uint64_t            window;        /* elements per flush, a multiple of the granule */
+    uint64_t            fed;           /* elements handed to feed, flushed or pending */
+    uint64_t            flushed;       /* elements already encoded and written */
+    float              *pending;       /* partial window, window floats */
+    float              *pending_im;    /* matching importance values, allocated on the first feed with im */
+    int                 has_im;        /* -1 until the first feed */
+    uint8_t            *scratch;       /* packed buffer for one window */
+    int64_t             scratch_size;
+    bsq_view_t          full;          /* codec header of the whole tensor, arrays unattached */
+    uint64_t            array_offsets[BSQ_MAX_PAYLOAD_ARRAYS];
+    uint32_t            num_arrays;
+    int                 has_scale;     /* tensor scale known, for formats that need one */
+    float               scale;
+    float               scan_abs_max;  /* running pre-pass statistic */
+    uint64_t            scanned;
+    int                 failed;
+};
+
+static uint64_t _round_up(uint64_t v, uint64_t granule) {
+    return (v + granule - 1) / granule * granule;
+}
+
+static float _finite_abs_max(const float *src, uint64_t count, float abs_max) {
+    for (uint64_t i = 0; i < count; ++i) {
+        const float v = src[i];
+        if (!isfinite(v)) continue;
+        const float av = fabsf(v);
+        if (av > abs_max) abs_max = av;
+    }
+    return abs_max;
+}
+
+static uint64_t _nf4_dq_block_size(const bsq_stream_t *stream) {
+    return ((const nf4_dq_array_t *)stream->full.buf.payload)->block_size;
+}
+
+bsq_stream_t *bsq_stream_begin(bsq_method_t method,
+                               uint64_t num_elements,
+                               bsq_stream_write_fn write,
+                               void *user) {
+    if (!write || num_elements == 0 || method == TOPK || method == TOPK_IM) return NULL;
+    const int64_t packed_size = bsq_compute_packed_size_1d(method, num_elements);
+    if (packed_size <= 0) return NULL;
+    const size_t payload_header_size = bsq_payload_header_size(method);
+
+    bsq_stream_t *stream = (bsq_stream_t *)calloc(1, sizeof(bsq_stream_t));
+    if (!stream) return NULL;
+    stream->write = write;
+    stream->user = user;
+    stream->method = method;
+    stream->num_elements = num_elements;
+    stream->has_im = -1;
+
+    /* Lay out a one-element buffer first: the granule comes from the block size init picks. */
+    const bsq_shape_t probe_shape = {1, 0, 0, 0.0f};
+    const int64_t probe_size = bsq_compute_packed_size_1d(method, 1);
+    uint64_t probe[64];
+    bitsqueeze_buffer_t *probe_buf = NULL;
+    if (probe_size > 0 && probe_size <= (int64_t)sizeof(probe) && payload_header_size <= sizeof(stream->full.payload_header)) {
+        probe_buf = bsq_prepare_buffer(method, &probe_shape, probe, (int64_t)sizeof(probe));
+    }
+    const uint64_t granule = probe_buf ? bsq_payload_granule(probe_buf) : 0;
+    if (granule == 0) {
+        free(stream);
+        return NULL;
+    }
+
+    stream->window = _round_up(STREAM_WINDOW_ELEMENTS, granule);
+    if (stream->window > _round_up(num_elements, granule)) stream->window = _round_up(num_elements, granule);
+    stream->scratch_size = bsq_compute_packed_size_1d(method, stream->window);
+    stream->scratch = stream->scratch_size > 0 ? (uint8_t *)malloc((size_t)stream->scratch_size) : NULL;
+    stream->pending = (float *)malloc(stream->window * sizeof(float));
+    if (!stream->scratch || !stream->pending) {
+        bsq_stream_end(stream);
+        return NULL;
+    }
+
+    /* Whole-tensor header: only its counts matter, the arrays live at array_offsets of the writer's bytes. */
+    stream->full.buf = *probe_buf;
+    memcpy(stream->full.payload_header, probe_buf->payload, payload_header_size);
+    stream->full.buf.payload = stream->full.payload_header;
+    if (bsq_resize_payload(&stream->full.buf, num_elements)) {
+        bsq_stream_end(stream);
+        return NULL;
+    }
+
+    void *arrays[BSQ_MAX_PAYLOAD_ARRAYS];
+    uint64_t sizes[BSQ_MAX_PAYLOAD_ARRAYS];
+    stream->num_arrays = bsq_payload_arrays(&stream->full.buf, arrays, sizes);
+    uint64_t offset = sizeof(bitsqueeze_buffer_t) + payload_header_size;
+    for (uint32_t i = 0; i < stream->num_arrays; ++i) {
+        stream->array_offsets[i] = offset;
+        offset += sizes[i];
+    }
+    if (stream->num_arrays == 0 || offset != (uint64_t)packed_size) {
+        bsq_stream_end(stream);
+        return NULL;
+    }
+    return stream;
+}
+
+int bsq_stream_set_scale(bsq_stream_t *stream, float scale) {
+    if (!stream || stream->failed || stream->fed != 0) return 1;
+    if (!bsq_payload_has_tensor_scale(stream->method) || !isfinite(scale) || scale <= 0.0f) return 1;
+    stream->scale = scale;
+    stream->has_scale = 1;
+    return 0;
+}
+
+int bsq_stream_scan(bsq_stream_t *stream, const float *src, uint64_t count) {
+    if (!stream || stream->failed || stream->fed != 0 || stream->has_scale) return 1;
+    if (!bsq_payload_has_tensor_scale(stream->method)) return 1;
+    if (!src || count > stream->num_elements - stream->scanned) return 1;
+
+    if (stream->method != NF4_DQ) {
+        stream->scan_abs_max = _finite_abs_max(src, count, stream->scan_abs_max);
+        stream->scanned += count;
+        return 0;
+    }
+
+    /* NF4_DQ scales by the largest block scale, so the pre-pass has to see whole blocks; a block cut by
+     * the chunk boundary waits in the pending buffer, which feed has not started using yet. */
+    const uint64_t block_size = _nf4_dq_block_size(stream);
+    while (count > 0) {
+        const uint64_t in_block = stream->scanned % block_size;
+        const uint64_t block_end = stream->scanned - in_block + block_size;
+        const uint64_t block_len = (block_end < stream->num_elements ? block_end : stream->num_elements)
+                                   - (stream->scanned - in_block);
+        uint64_t take = block_len - in_block;
+        if (take > count) take = count;
+
+        const float *block = src;
+        if (in_block != 0 || take < block_len) {
+            memcpy(stream->pending + in_block, src, take * sizeof(float));
+            block = stream->pending;
+        }
+        if (in_block + take == block_len) {
+            const float block_scale = nf4_dq_block_scale(block, block_len);
+            if (block_scale > stream->scan_abs_max) stream->scan_abs_max = block_scale;
+        }
+        stream->scanned += take;
+        src += take;
+        count -= take;
+    }
+    return 0;
+}
+
+/* Encode one window from src into scratch and hand each of its arrays to the writer at its final offset. */
+static int _flush(bsq_stream_t *stream, const float *src, const float *im, uint64_t count) {
+    const bsq_shape_t shape = {count, 0, 0, 0.0f};
+    bitsqueeze_buffer_t *window = bsq_prepare_buffer(stream->method, &shape, stream->scratch, stream->scratch_size);
+    if (!window) return 1;
+
+    const int rc = bsq_payload_has_tensor_scale(stream->method)
+        ? bsq_compress_payload_scaled(window, src, stream->scale)
+        : bsq_compress_payload(window, src, im);
+    if (rc) return 1;
+
+    /* The elements before this window fill exactly the head of every array, as flushed is granule-aligned. */
+    bsq_view_t head = stream->full;
+    head.buf.payload = head.payload_header;
+    if (bsq_resize_payload(&head.buf, stream->flushed)) return 1;
+
+    void *head_arrays[BSQ_MAX_PAYLOAD_ARRAYS], *arrays[BSQ_MAX_PAYLOAD_ARRAYS];
+    uint64_t head_sizes[BSQ_MAX_PAYLOAD_ARRAYS], sizes[BSQ_MAX_PAYLOAD_ARRAYS];
+    bsq_payload_arrays(&head.buf, head_arrays, head_sizes);
+    bsq_payload_arrays(window, arrays, sizes);
+    for (uint32_t i = 0; i < stream->num_arrays; ++i) {
+        if (stream->write(stream->user, stream->array_offsets[i] + head_sizes[i], arrays[i], sizes[i])) return 1;
+    }
+    stream->flushed += count;
+    return 0;
+}
+
+int bsq_stream_feed(bsq_stream_t *stream, const float *src, uint64_t count, const float *im) {
+    if (!stream || stream->failed) return 1;
+    if (count == 0) return 0;
+    if (!src || count > stream->num_elements - stream->fed) {
+        stream->failed = 1;
+        return 1;
+    }
+
+    if (stream->fed == 0 && bsq_payload_has_tensor_scale(stream->method) && !stream->has_scale) {
+        if (stream->scanned != stream->num_elements) {
+            stream->failed = 1;
+            return 1;
+        }
+        stream->scale = bsq_tensor_scale_for_absmax(stream->method, stream->scan_abs_max);
+        stream->has_scale = 1;
+    }
+
+    /* im must be given on every feed or on none, so pending windows stay paired with their weights. */
+    if (stream->has_im < 0) {
+        stream->has_im = im != NULL;
+        if (im) stream->pending_im = (float *)malloc(stream->window * sizeof(float));
+        if (im && !stream->pending_im) {
+            stream->failed = 1;
+            return 1;
+        }
+    } else if (stream->has_im != (im != NULL)) {
+        stream->failed = 1;
+        return 1;
+    }
+
+    while (count > 0) {
+        const uint64_t pending = stream->fed - stream->flushed;
+        /* Whole windows straight from the caller's memory, no copy. */
+        if (pending == 0 && count >= stream->window) {
+            if (_flush(stream, src, im, stream->window)) {
+                stream->failed = 1;
+                return 1;
+            }
+            stream->fed += stream->window;
+            src += stream->window;
+            if (im) im += stream->window;
+            count -= stream->window;
+            continue;
+        }
+
+        uint64_t take = stream->window - pending;
+        if (take > count) take = count;
+        memcpy(stream->pending + pending, src, take * sizeof(float));
+        if (im) memcpy(stream->pending_im + pending, im, take * sizeof(float));
+        stream->fed += take;
+        src += take;
+        if (im) im += take;
+        count -= take;
+
+        if (pending + take == stream->window &&
+            _flush(stream, stream->pending, stream->pending_im, stream->window)) {
+            stream->failed = 1;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int bsq_stream_end(bsq_stream_t *stream) {
+    if (!stream) return 1;
+
+    int failed = stream->failed || stream->fed != stream->num_elements;
+    if (!failed && stream->fed > stream->flushed) {
+        failed = _flush(stream, stream->pending, stream->pending_im, stream->fed - stream->flushed);
+    }
+
+    if (!failed) {
+        /* Header last, so a reader never sees a complete header over missing blocks. The codec header is
+         * taken from the final window, which carries the tensor scale, and its array pointers are cleared. */
+        const size_t payload_header_size = bsq_payload_header_size(stream->method);
+        bitsqueeze_buffer_t *window = (bitsqueeze_buffer_t *)stream->scratch;
+        bsq_view_t header;
+        header.buf = *window;
+        memcpy(header.payload_header, window->payload, payload_header_size);
+        header.buf.payload = header.payload_header;
+        void *none[BSQ_MAX_PAYLOAD_ARRAYS] = {0};
+        failed = bsq_resize_payload(&header.buf, stream->num_elements);
+        if (!failed) {
+            bsq_attach_payload_arrays(&header.buf, none);
+            header.buf.payload = NULL;
+            failed = stream->write(stream->user, 0, &header.buf, sizeof(bitsqueeze_buffer_t)) ||
+                     stream->write(stream->user, sizeof(bitsqueeze_buffer_t), header.payload_header, payload_header_size);
+        }
+    }
+
+    free(stream->pending);
+    free(stream->pending_im);
+    free(stream->scratch);
+    free(stream);
+    return failed;
+}
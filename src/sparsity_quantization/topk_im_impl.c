@@ -1,5 +1,9 @@
 #include "sparsity/topk_im_impl.h"
 
+#if defined(__linux__) && defined(_OPENMP)
+#include <omp.h>
+#endif
+
 typedef struct {
     float im_val;    // importance key
     float val;        // original value
@@ -44,17 +48,57 @@ static inline void heapify_min(heap_entry_t *h, uint16_t K) {
     }
 }
 
-int topk_im_compress(const float *float_array, const float *importance_array, uint16_t num_tokens, uint16_t num_features,  float sparse_ratio, sparse_array_t **sparse_array) {
-    if (!float_array || !sparse_array || !importance_array) return 1;
-    if (num_tokens == 0 || num_features == 0) return 1;
-    if (*sparse_array) return 1;
+size_t topk_im_thread_scratch_size(const sparse_array_t *sa) {
+    return (size_t)sa->num_sparse_features * sizeof(heap_entry_t);
+}
 
-    *sparse_array = allocate_sparse_array(num_tokens, num_features, sparse_ratio);
-    if (!*sparse_array) return 1;
+int topk_im_compress_into(const float *float_array, const float *importance_array, sparse_array_t *sa) {
+    return topk_im_compress_into_scratch(float_array, importance_array, sa, NULL);
+}
 
-    sparse_array_t *sa = *sparse_array;
+/* Keep the top K entries of token t, using heap (K entries) as working memory. */
+static void _compress_token(const float *float_array, const float *importance_array, sparse_array_t *sa, heap_entry_t *heap, int t) {
+    const uint16_t K = sa->num_sparse_features;
+    const uint16_t F = sa->num_features;
+
+    const uint32_t dense_base  = (uint32_t)t * (uint32_t)F;
+    const uint32_t sparse_base = (uint32_t)t * (uint32_t)K;
+    const float *x = float_array + dense_base;
+    const float *im = importance_array + dense_base;
+
+    for (uint16_t i = 0; i < K; ++i) {
+        heap[i].idx = i;
+        heap[i].val = x[i];
+        heap[i].im_val = importance_key(im[i]);
+    }
+
+    heapify_min(heap, K);
+
+    for (uint16_t i = K; i < F; ++i) {
+        float v = x[i];
+        float im_v = importance_key(im[i]);
+        if (im_v > heap[0].im_val) {
+            heap[0].idx = i;
+            heap[0].val = v;
+            heap[0].im_val = im_v;
+            sift_down_min(heap, K, 0);
+        }
+    }
+
+    for (uint16_t j = 0; j < K; ++j) {
+        sa->sparse_indices[sparse_base + j] = heap[j].idx;
+        sa->values[sparse_base + j] = heap[j].val;
+    }
+}
+
+int topk_im_compress_into_scratch(const float *float_array,
+                                  const float *importance_array,
+                                  sparse_array_t *sa,
+                                  void *const *thread_scratch) {
+    if (!float_array || !importance_array || !sa) return 1;
+
+    const uint16_t num_tokens = sa->num_tokens;
     const uint16_t K = sa->num_sparse_features;
-    const uint16_t F = num_features;
     if (K == 0) return 0;
 
     int alloc_error = 0;
@@ -63,7 +107,14 @@ int topk_im_compress(const float *float_array, const float *importance_array, ui
 #pragma omp parallel
     {
 #endif
-        heap_entry_t *heap = (heap_entry_t *)malloc((size_t)K * sizeof(heap_entry_t));
+#if defined(__linux__) && defined(_OPENMP)
+        const int thread_id = omp_get_thread_num();
+#else
+        const int thread_id = 0;
+#endif
+        heap_entry_t *heap = thread_scratch
+            ? (heap_entry_t *)thread_scratch[thread_id]
+            : (heap_entry_t *)malloc((size_t)K * sizeof(heap_entry_t));
         if (!heap) {
 #if defined(__linux__) && defined(_OPENMP)
 #pragma omp critical
@@ -75,43 +126,37 @@ int topk_im_compress(const float *float_array, const float *importance_array, ui
 #endif
         for (int t = 0; t < (int)num_tokens; ++t) {
             if (!heap) continue; // this thread cannot do work
-
-            const uint32_t dense_base  = (uint32_t)t * (uint32_t)F;
-            const uint32_t sparse_base = (uint32_t)t * (uint32_t)K;
-            const float *x = float_array + dense_base;
-            const float *im = importance_array + dense_base;
-
-            for (uint16_t i = 0; i < K; ++i) {
-                heap[i].idx = i;
-                heap[i].val = x[i];
-                heap[i].im_val = importance_key(im[i]);
-            }
-
-            heapify_min(heap, K);
-
-            for (uint16_t i = K; i < F; ++i) {
-                float v = x[i];
-                float im_v = importance_key(im[i]);
-                if (im_v > heap[0].im_val) {
-                    heap[0].idx = i;
-                    heap[0].val = v;
-                    heap[0].im_val = im_v;
-                    sift_down_min(heap, K, 0);
-                }
-            }
-
-            for (uint16_t j = 0; j < K; ++j) {
-                sa->sparse_indices[sparse_base + j] = heap[j].idx;
-                sa->values[sparse_base + j] = heap[j].val;
-            }
+            _compress_token(float_array, importance_array, sa, heap, t);
         }
 
-        free(heap);
+        if (!thread_scratch) free(heap);
 #if defined(__linux__) && defined(_OPENMP)
     }
 #endif
 
-    if (alloc_error) {
+    return alloc_error;
+}
+
+int topk_im_compress_into_serial(const float *float_array, const float *importance_array, sparse_array_t *sa) {
+    if (!float_array || !importance_array || !sa) return 1;
+    if (sa->num_sparse_features == 0) return 0;
+
+    heap_entry_t *heap = (heap_entry_t *)malloc((size_t)sa->num_sparse_features * sizeof(heap_entry_t));
+    if (!heap) return 1;
+    for (int t = 0; t < (int)sa->num_tokens; ++t) _compress_token(float_array, importance_array, sa, heap, t);
+    free(heap);
+    return 0;
+}
+
+int topk_im_compress(const float *float_array, const float *importance_array, uint16_t num_tokens, uint16_t num_features,  float sparse_ratio, sparse_array_t **sparse_array) {
+    if (!float_array || !sparse_array || !importance_array) return 1;
+    if (num_tokens == 0 || num_features == 0) return 1;
+    if (*sparse_array) return 1;
+
+    *sparse_array = allocate_sparse_array(num_tokens, num_features, sparse_ratio);
+    if (!*sparse_array) return 1;
+
+    if (topk_im_compress_into(float_array, importance_array, *sparse_array)) {
         free_sparse_array(*sparse_array);
         *sparse_array = NULL;
         return 1;
@@ -1,9 +1,11 @@
 #include "sparsity/topk_impl.h"
+#include "utils/alloc.h"
 
-sparse_array_t *allocate_sparse_array(uint16_t num_tokens, uint16_t num_features, float sparse_ratio) {
-    if (!num_tokens || !num_features) return NULL;
-    if (sparse_ratio < 0.0f || sparse_ratio > 1.0f) return NULL;
-    
+#if defined(__linux__) && defined(_OPENMP)
+#include <omp.h>
+#endif
+
+static uint16_t _get_num_sparse_features(uint16_t num_features, float sparse_ratio) {
     float raw_sparse = (float)num_features * sparse_ratio;
     uint16_t num_sparse_features = (uint16_t)roundf(raw_sparse);
     
@@ -13,11 +15,24 @@ sparse_array_t *allocate_sparse_array(uint16_t num_tokens, uint16_t num_features
     } else if (num_sparse_features == 0 && sparse_ratio > 0.0f) {
         num_sparse_features = 1;  // Avoid total sparsity if ratio positive;
     }
+    return num_sparse_features;
+}
+
+uint64_t compute_sparse_array_size(uint16_t num_tokens, uint16_t num_features, float sparse_ratio) {
+    if (!num_tokens || !num_features) return 0;
+    if (sparse_ratio < 0.0f || sparse_ratio > 1.0f) return 0;
 
+    uint32_t sparse_elements = (uint32_t)num_tokens * _get_num_sparse_features(num_features, sparse_ratio);
+    return sizeof(sparse_array_t) + sparse_elements * (sizeof(float) + sizeof(uint16_t));
+}
+
+sparse_array_t *init_sparse_array(void *buffer, uint16_t num_tokens, uint16_t num_features, float sparse_ratio) {
+    if (!buffer || !num_tokens || !num_features) return NULL;
+    if (sparse_ratio < 0.0f || sparse_ratio > 1.0f) return NULL;
+
+    uint16_t num_sparse_features = _get_num_sparse_features(num_features, sparse_ratio);
     uint32_t sparse_elements = (uint32_t)num_tokens * num_sparse_features;
-    uint64_t total = sizeof(sparse_array_t) + sparse_elements * (sizeof(float) + sizeof(uint16_t));
-    sparse_array_t *sparse_array = (sparse_array_t*)calloc(1, total);
-    if (!sparse_array) return NULL;
+    sparse_array_t *sparse_array = (sparse_array_t *)buffer;
 
     /* initialise the header fields */
     sparse_array->num_tokens = num_tokens;
@@ -27,11 +42,20 @@ sparse_array_t *allocate_sparse_array(uint16_t num_tokens, uint16_t num_features
     sparse_array->values = (float*)(sparse_array->sparse_indices + sparse_elements);     /* after the sparse_indices */
 
     return sparse_array;
+}
+
+sparse_array_t *allocate_sparse_array(uint16_t num_tokens, uint16_t num_features, float sparse_ratio) {
+    uint64_t total = compute_sparse_array_size(num_tokens, num_features, sparse_ratio);
+    if (!total) return NULL;
+
+    void *buffer = bsq_alloc_bytes(total, 0, 0);
+    if (!buffer) return NULL;
+    return init_sparse_array(buffer, num_tokens, num_features, sparse_ratio);
 }                          
 
 void free_sparse_array(sparse_array_t *sparse_array) {
     if (!sparse_array) return;
-    free(sparse_array);
+    bsq_free_bytes(sparse_array);
 }
 
 uint64_t get_sparse_array_size(const sparse_array_t *sparse_array) {
@@ -43,7 +67,7 @@ uint64_t get_sparse_array_size(const sparse_array_t *sparse_array) {
 }
 
 sparse_array_t *load_sparse_array_from_buffer(const void *buffer, uint64_t buffer_size) {
-    sparse_array_t *sparse_array = (sparse_array_t*)calloc(1, buffer_size);
+    sparse_array_t *sparse_array = (sparse_array_t*)bsq_alloc_bytes((size_t)buffer_size, 0, BSQ_ALLOC_UNINITIALIZED);
     if (!sparse_array) return NULL;
     
     memcpy(sparse_array, buffer, buffer_size);
@@ -101,21 +125,54 @@ static inline void heapify_min(heap_entry_t *h, uint16_t K) {
     }
 }
 
-int topk_compress(const float *float_array,
-                  uint16_t num_tokens,
-                  uint16_t num_features,
-                  float sparse_ratio,
-                  sparse_array_t **sparse_array) {
-    if (!float_array || !sparse_array) return 1;
-    if (num_tokens == 0 || num_features == 0) return 1;
-    if (*sparse_array) return 1;
+size_t topk_thread_scratch_size(const sparse_array_t *sa) {
+    return (size_t)sa->num_sparse_features * sizeof(heap_entry_t);
+}
 
-    *sparse_array = allocate_sparse_array(num_tokens, num_features, sparse_ratio);
-    if (!*sparse_array) return 1;
+int topk_compress_into(const float *float_array, sparse_array_t *sa) {
+    return topk_compress_into_scratch(float_array, sa, NULL);
+}
 
-    sparse_array_t *sa = *sparse_array;
+/* Keep the top K entries of token t, using heap (K entries) as working memory. */
+static void _compress_token(const float *float_array, sparse_array_t *sa, heap_entry_t *heap, int t) {
+    const uint16_t K = sa->num_sparse_features;
+    const uint16_t F = sa->num_features;
+
+    const uint32_t dense_base  = (uint32_t)t * (uint32_t)F;
+    const uint32_t sparse_base = (uint32_t)t * (uint32_t)K;
+    const float *x = float_array + dense_base;
+
+    for (uint16_t i = 0; i < K; ++i) {
+        float v = x[i];
+        heap[i].idx = i;
+        heap[i].val = v;
+        heap[i].abs_val = importance_abs(v);
+    }
+
+    heapify_min(heap, K);
+
+    for (uint16_t i = K; i < F; ++i) {
+        float v = x[i];
+        float a = importance_abs(v);
+        if (a > heap[0].abs_val) {
+            heap[0].idx = i;
+            heap[0].val = v;
+            heap[0].abs_val = a;
+            sift_down_min(heap, K, 0);
+        }
+    }
+
+    for (uint16_t j = 0; j < K; ++j) {
+        sa->sparse_indices[sparse_base + j] = heap[j].idx;
+        sa->values[sparse_base + j] = heap[j].val;
+    }
+}
+
+int topk_compress_into_scratch(const float *float_array, sparse_array_t *sa, void *const *thread_scratch) {
+    if (!float_array || !sa) return 1;
+
+    const uint16_t num_tokens = sa->num_tokens;
     const uint16_t K = sa->num_sparse_features;
-    const uint16_t F = num_features;
     if (K == 0) return 0;
 
     int alloc_error = 0;
@@ -124,7 +181,14 @@ int topk_compress(const float *float_array,
 #pragma omp parallel
     {
 #endif
-        heap_entry_t *heap = (heap_entry_t *)malloc((size_t)K * sizeof(heap_entry_t));
+#if defined(__linux__) && defined(_OPENMP)
+        const int thread_id = omp_get_thread_num();
+#else
+        const int thread_id = 0;
+#endif
+        heap_entry_t *heap = thread_scratch
+            ? (heap_entry_t *)thread_scratch[thread_id]
+            : (heap_entry_t *)malloc((size_t)K * sizeof(heap_entry_t));
         if (!heap) {
 #if defined(__linux__) && defined(_OPENMP)
 #pragma omp critical
@@ -136,43 +200,41 @@ int topk_compress(const float *float_array,
 #endif
         for (int t = 0; t < (int)num_tokens; ++t) {
             if (!heap) continue; // this thread cannot do work
-
-            const uint32_t dense_base  = (uint32_t)t * (uint32_t)F;
-            const uint32_t sparse_base = (uint32_t)t * (uint32_t)K;
-            const float *x = float_array + dense_base;
-
-            for (uint16_t i = 0; i < K; ++i) {
-                float v = x[i];
-                heap[i].idx = i;
-                heap[i].val = v;
-                heap[i].abs_val = importance_abs(v);
-            }
-
-            heapify_min(heap, K);
-
-            for (uint16_t i = K; i < F; ++i) {
-                float v = x[i];
-                float a = importance_abs(v);
-                if (a > heap[0].abs_val) {
-                    heap[0].idx = i;
-                    heap[0].val = v;
-                    heap[0].abs_val = a;
-                    sift_down_min(heap, K, 0);
-                }
-            }
-
-            for (uint16_t j = 0; j < K; ++j) {
-                sa->sparse_indices[sparse_base + j] = heap[j].idx;
-                sa->values[sparse_base + j] = heap[j].val;
-            }
+            _compress_token(float_array, sa, heap, t);
         }
 
-        free(heap);
+        if (!thread_scratch) free(heap);
 #if defined(__linux__) && defined(_OPENMP)
     }
 #endif
 
-    if (alloc_error) {
+    return alloc_error;
+}
+
+int topk_compress_into_serial(const float *float_array, sparse_array_t *sa) {
+    if (!float_array || !sa) return 1;
+    if (sa->num_sparse_features == 0) return 0;
+
+    heap_entry_t *heap = (heap_entry_t *)malloc((size_t)sa->num_sparse_features * sizeof(heap_entry_t));
+    if (!heap) return 1;
+    for (int t = 0; t < (int)sa->num_tokens; ++t) _compress_token(float_array, sa, heap, t);
+    free(heap);
+    return 0;
+}
+
+int topk_compress(const float *float_array,
+                  uint16_t num_tokens,
+                  uint16_t num_features,
+                  float sparse_ratio,
+                  sparse_array_t **sparse_array) {
+    if (!float_array || !sparse_array) return 1;
+    if (num_tokens == 0 || num_features == 0) return 1;
+    if (*sparse_array) return 1;
+
+    *sparse_array = allocate_sparse_array(num_tokens, num_features, sparse_ratio);
+    if (!*sparse_array) return 1;
+
+    if (topk_compress_into(float_array, *sparse_array)) {
         free_sparse_array(*sparse_array);
         *sparse_array = NULL;
         return 1;
@@ -202,3 +264,125 @@ int topk_decompress(const sparse_array_t *sparse_array, float *float_array) {
 
     return 0;
 }
+
+int topk_decompress_rows(const sparse_array_t *sparse_array, const uint16_t *token_indices, uint32_t num_rows, float *float_array) {
+    if (!float_array || !sparse_array || (num_rows && !token_indices)) return 1;
+
+    for (uint32_t row = 0; row < num_rows; row++) {
+        if (token_indices[row] >= sparse_array->num_tokens) return 1;
+    }
+
+    const uint16_t num_features = sparse_array->num_features;
+    const uint16_t num_sparse_features = sparse_array->num_sparse_features;
+
+#if defined(__linux__) && defined(_OPENMP)
+#pragma omp parallel for
+#endif
+    for (uint32_t row = 0; row < num_rows; row++) {
+        float *dense_row = float_array + (uint64_t)row * num_features;
+        uint32_t sparse_base = (uint32_t)token_indices[row] * num_sparse_features;
+
+        memset(dense_row, 0, num_features * sizeof(float));
+        for (uint16_t keep_feature_index = 0; keep_feature_index < num_sparse_features; keep_feature_index++) {
+            uint16_t original_feature_index = sparse_array->sparse_indices[sparse_base + keep_feature_index];
+            dense_row[original_feature_index] = sparse_array->values[sparse_base + keep_feature_index];
+        }
+    }
+
+    return 0;
+}
+
+/* float_array row token += alpha * the kept entries of that token. */
+static void _accumulate_token(const sparse_array_t *sparse_array, float *float_array, float alpha, uint32_t token) {
+    const uint16_t num_sparse_features = sparse_array->num_sparse_features;
+    float *dense_row = float_array + (uint64_t)token * sparse_array->num_features;
+    const uint64_t sparse_base = (uint64_t)token * num_sparse_features;
+    for (uint16_t k = 0; k < num_sparse_features; k++) {
+        dense_row[sparse_array->sparse_indices[sparse_base + k]] += alpha * sparse_array->values[sparse_base + k];
+    }
+}
+
+int topk_accumulate(const sparse_array_t *sparse_array, float *float_array, float alpha) {
+    if (!float_array || !sparse_array) return 1;
+
+#if defined(__linux__) && defined(_OPENMP)
+#pragma omp parallel for
+#endif
+    for (uint32_t token = 0; token < sparse_array->num_tokens; token++) {
+        _accumulate_token(sparse_array, float_array, alpha, token);
+    }
+    return 0;
+}
+
+int topk_accumulate_serial(const sparse_array_t *sparse_array, float *float_array, float alpha) {
+    if (!float_array || !sparse_array) return 1;
+
+    for (uint32_t token = 0; token < sparse_array->num_tokens; token++) {
+        _accumulate_token(sparse_array, float_array, alpha, token);
+    }
+    return 0;
+}
+
+int topk_spmm(const sparse_array_t *sparse_array, const float *dense, uint64_t out_features, float *out) {
+    if (!sparse_array || !dense || !out || out_features == 0) return 1;
+
+    const uint16_t num_sparse_features = sparse_array->num_sparse_features;
+
+#if defined(__linux__) && defined(_OPENMP)
+#pragma omp parallel for
+#endif
+    for (uint32_t token = 0; token < sparse_array->num_tokens; token++) {
+        float *out_row = out + (uint64_t)token * out_features;
+        const uint64_t sparse_base = (uint64_t)token * num_sparse_features;
+
+        memset(out_row, 0, out_features * sizeof(float));
+        for (uint16_t k = 0; k < num_sparse_features; k++) {
+            const float value = sparse_array->values[sparse_base + k];
+            const float *dense_row = dense + (uint64_t)sparse_array->sparse_indices[sparse_base + k] * out_features;
+            for (uint64_t o = 0; o < out_features; o++) out_row[o] += value * dense_row[o];
+        }
+    }
+    return 0;
+}
+
+int topk_spmm_t(const sparse_array_t *sparse_array, const float *dense, uint64_t num_rows, float *out) {
+    if (!sparse_array || !dense || !out) return 1;
+
+    const uint16_t num_tokens = sparse_array->num_tokens;
+    const uint16_t num_features = sparse_array->num_features;
+    const uint16_t num_sparse_features = sparse_array->num_sparse_features;
+
+#if defined(__linux__) && defined(_OPENMP)
+#pragma omp parallel for
+#endif
+    for (uint64_t row = 0; row < num_rows; row++) {
+        const float *dense_row = dense + row * num_features;
+        float *out_row = out + row * num_tokens;
+        for (uint32_t token = 0; token < num_tokens; token++) {
+            const uint16_t *indices = sparse_array->sparse_indices + (uint64_t)token * num_sparse_features;
+            const float *values = sparse_array->values + (uint64_t)token * num_sparse_features;
+            float sum = 0.0f;
+            for (uint16_t k = 0; k < num_sparse_features; k++) sum += values[k] * dense_row[indices[k]];
+            out_row[token] = sum;
+        }
+    }
+    return 0;
+}
+
+int topk_spmv(const sparse_array_t *sparse_array, const float *x, float *y) {
+    if (!sparse_array || !x || !y) return 1;
+
+    const uint16_t num_sparse_features = sparse_array->num_sparse_features;
+
+#if defined(__linux__) && defined(_OPENMP)
+#pragma omp parallel for
+#endif
+    for (uint32_t token = 0; token < sparse_array->num_tokens; token++) {
+        const uint16_t *indices = sparse_array->sparse_indices + (uint64_t)token * num_sparse_features;
+        const float *values = sparse_array->values + (uint64_t)token * num_sparse_features;
+        float sum = 0.0f;
+        for (uint16_t k = 0; k < num_sparse_features; k++) sum += values[k] * x[indices[k]];
+        y[token] = sum;
+    }
+    return 0;
+}
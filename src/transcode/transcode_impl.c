@@ -0,0 +1,287 @@
+#include "bitsqueeze.h"
+#include "bitsqueeze_internal.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "float_quantization/bf16_impl.h"
+#include "float_quantization/fp16_impl.h"
+#include "float_quantization/fp8_impl.h"
+#include "float_quantization/mxfp4_impl.h"
+#include "float_quantization/mxfp8_impl.h"
+#include "float_quantization/nvfp4_impl.h"
+#include "int_quantization/q2_k_fast_impl.h"
+#include "int_quantization/q4_0_impl.h"
+#include "int_quantization/q8_0_impl.h"
+#include "utils/alloc.h"
+
+/* Alignment of buffers bsq_transcode allocates. */
+#define TRANSCODE_ALIGN 64
+/* Elements decoded per step of the generic path: a multiple of every granule, small enough to stay in L1/L2. */
+#define TRANSCODE_CHUNK 4096
+/* Largest destination block a fused kernel stages on the stack. */
+#define TRANSCODE_MAX_BLOCK WEIGHT_PER_SUPER_BLOCK
+
+/*
+ * Every path reproduces bsq_compress_1d(decompress(src)) bit for bit: the fused kernels decode each
+ * destination block into a stack tile with the exact expression of the source decoder and hand it to the
+ * destination block encoder, and the generic path does the same per TRANSCODE_CHUNK through the codec tables.
+ */
+
+static void _e4m3_table(float scale, float *table) {
+    for (int c = 0; c < 256; ++c) table[c] = scale * fp8_e4m3_to_fp32((uint8_t)c);
+}
+
+static int _q8_0_to_q4_0(const q8_0_array_t *src, q4_0_array_t *dst) {
+    const uint64_t n = dst->num_elements;
+    const uint64_t src_block = src->block_size;
+    const uint64_t block_size = dst->block_size;
+    if (block_size > TRANSCODE_MAX_BLOCK) return 1;
+    uint8_t *data = (uint8_t *)dst->data;
+
+#if defined(__linux__) && defined(_OPENMP)
+#pragma omp parallel for
+#endif
+    for (uint64_t b = 0; b < dst->num_blocks; ++b) {
+        float tile[TRANSCODE_MAX_BLOCK];
+        const uint64_t start = b * block_size;
+        const uint64_t remain = (start + block_size <= n) ? block_size : (n - start);
+        for (uint64_t i = 0; i < remain; ++i) {
+            const uint64_t j = start + i;
+            tile[i] = src->scales[j / src_block] * (float)src->data[j];
+        }
+        q4_0_quantize_block(tile, remain, &dst->scales[b], data + start / 2);
+    }
+    return 0;
+}
+
+static int _q8_0_to_q2_k_fast(const q8_0_array_t *src, q2_k_array_t *dst) {
+    const uint64_t n = dst->num_elements;
+    const uint64_t src_block = src->block_size;
+
+#if defined(__linux__) && defined(_OPENMP)
+#pragma omp parallel for
+#endif
+    for (uint32_t b = 0; b < dst->num_super_blocks; ++b) {
+        float tile[WEIGHT_PER_SUPER_BLOCK];
+        const uint64_t start = (uint64_t)b * WEIGHT_PER_SUPER_BLOCK;
+        const uint64_t remain = (start + WEIGHT_PER_SUPER_BLOCK <= n) ? WEIGHT_PER_SUPER_BLOCK : (n - start);
+        for (uint64_t i = 0; i < remain; ++i) {
+            const uint64_t j = start + i;
+            tile[i] = src->scales[j / src_block] * (float)src->data[j];
+        }
+        q2_k_fast_quantize_super_block(tile, remain, &dst->super_blocks[b]);
+    }
+    return 0;
+}
+
+static int _mxfp8_to_mxfp4(const mxfp8_array_t *src, mxfp4_array_t *dst) {
+    const uint64_t n = dst->num_elements;
+    const uint64_t src_block = src->block_size;
+    const uint64_t block_size = dst->block_size;
+    if (block_size > TRANSCODE_MAX_BLOCK) return 1;
+    float codes[256];
+    _e4m3_table(1.0f, codes);
+
+#if defined(__linux__) && defined(_OPENMP)
+#pragma omp parallel for
+#endif
+    for (uint64_t b = 0; b < dst->num_blocks; ++b) {
+        float tile[TRANSCODE_MAX_BLOCK];
+        const uint64_t start = b * block_size;
+        const uint64_t remain = (start + block_size <= n) ? block_size : (n - start);
+        for (uint64_t i = 0; i < remain; ++i) {
+            const uint64_t j = start + i;
+            tile[i] = ldexpf(1.0f, src->scales[j / src_block]) * codes[src->data[j]];
+        }
+        mxfp4_quantize_block(tile, remain, &dst->scales[b], dst->data + start / 2);
+    }
+    return 0;
+}
+
+static int _fp8_to_nvfp4(const fp8_array_t *src, nvfp4_array_t *dst) {
+    const uint64_t n = dst->num_elements;
+    const uint64_t block_size = dst->block_size;
+    if (block_size > TRANSCODE_MAX_BLOCK) return 1;
+    float values[256];
+    _e4m3_table(src->scale, values);
+
+    /* The tensor scale nvfp4 would scan from the decoded floats, read through the table instead. */
+    float abs_max = 0.0f;
+
+#if defined(__linux__) && defined(_OPENMP)
+#pragma omp parallel for reduction(max:abs_max)
+#endif
+    for (uint64_t i = 0; i < n; ++i) {
+        const float v = values[src->data[i]];
+        if (isfinite(v) && fabsf(v) > abs_max) abs_max = fabsf(v);
+    }
+    const float tensor_scale = nvfp4_tensor_scale_for_absmax(abs_max);
+    dst->tensor_scale = tensor_scale;
+
+#if defined(__linux__) && defined(_OPENMP)
+#pragma omp parallel for
+#endif
+    for (uint64_t b = 0; b < dst->num_blocks; ++b) {
+        float tile[TRANSCODE_MAX_BLOCK];
+        const uint64_t start = b * block_size;
+        const uint64_t remain = (start + block_size <= n) ? block_size : (n - start);
+        for (uint64_t i = 0; i < remain; ++i) tile[i] = values[src->data[start + i]];
+        nvfp4_quantize_block(tile, remain, tensor_scale, &dst->block_scales[b], dst->data + start / 2);
+    }
+    return 0;
+}
+
+static int _fp16_to_bf16(const fp16_array_t *src, bf16_array_t *dst) {
+    const uint64_t n = dst->num_elements;
+
+#if defined(__linux__) && defined(_OPENMP)
+#pragma omp parallel for
+#endif
+    for (uint64_t i = 0; i < n; ++i) {
+        dst->data[i] = bf16_from_fp32_value(fp16_ieee_to_fp32_value(src->data[i]));
+    }
+    return 0;
+}
+
+static int _bf16_to_fp16(const bf16_array_t *src, fp16_array_t *dst) {
+    const uint64_t n = dst->num_elements;
+
+#if defined(__linux__) && defined(_OPENMP)
+#pragma omp parallel for
+#endif
+    for (uint64_t i = 0; i < n; ++i) {
+        dst->data[i] = fp16_ieee_from_fp32_value(fp32_from_bf16_value(src->data[i]));
+    }
+    return 0;
+}
+
+/* Run the fused kernel for the pair; *handled stays 0 when there is none. */
+static int _transcode_fused(const bitsqueeze_buffer_t *src, bitsqueeze_buffer_t *dst, int *handled) {
+    const void *s = src->payload;
+    void *d = dst->payload;
+    *handled = 1;
+    switch (src->method) {
+        case Q8_0:
+            if (dst->method == Q4_0) return _q8_0_to_q4_0((const q8_0_array_t *)s, (q4_0_array_t *)d);
+            if (dst->method == Q2_K_FAST) return _q8_0_to_q2_k_fast((const q8_0_array_t *)s, (q2_k_array_t *)d);
+            break;
+        case MXFP8:
+            if (dst->method == MXFP4) return _mxfp8_to_mxfp4((const mxfp8_array_t *)s, (mxfp4_array_t *)d);
+            break;
+        case FP8:
+            if (dst->method == NVFP4) return _fp8_to_nvfp4((const fp8_array_t *)s, (nvfp4_array_t *)d);
+            break;
+        case FP16:
+            if (dst->method == BF16) return _fp16_to_bf16((const fp16_array_t *)s, (bf16_array_t *)d);
+            break;
+        case BF16:
+            if (dst->method == FP16) return _bf16_to_fp16((const bf16_array_t *)s, (fp16_array_t *)d);
+            break;
+        default:
+            break;
+    }
+    *handled = 0;
+    return 0;
+}
+
+/* Tensor-scale statistic of src, decoded one chunk at a time. */
+static int _chunked_statistic(const bitsqueeze_buffer_t *src, const bitsqueeze_buffer_t *dst, float *out) {
+    const uint64_t n = dst->shape.num_elements;
+    const uint64_t num_chunks = (n + TRANSCODE_CHUNK - 1) / TRANSCODE_CHUNK;
+    const uint64_t block_size = bsq_payload_granule(dst);
+    float stat = 0.0f;
+    int failed = 0;
+
+#if defined(__linux__) && defined(_OPENMP)
+#pragma omp parallel for reduction(max:stat) reduction(|:failed)
+#endif
+    for (uint64_t c = 0; c < num_chunks; ++c) {
+        float panel[TRANSCODE_CHUNK];
+        const uint64_t first = c * TRANSCODE_CHUNK;
+        const uint64_t count = n - first < TRANSCODE_CHUNK ? n - first : TRANSCODE_CHUNK;
+        if (bsq_decompress_range_serial(src, first, count, panel)) {
+            failed = 1;
+            continue;
+        }
+        const float panel_stat = bsq_tensor_scale_statistic(dst->method, block_size, panel, count);
+        if (panel_stat > stat) stat = panel_stat;
+    }
+    *out = stat;
+    return failed;
+}
+
+static int _transcode_chunked(const bitsqueeze_buffer_t *src, bitsqueeze_buffer_t *dst) {
+    const uint64_t n = dst->shape.num_elements;
+    const uint64_t granule = bsq_payload_granule(dst);
+    if (granule == 0 || TRANSCODE_CHUNK % granule != 0) return 1;
+
+    /* Tensor-scale formats see the whole source once for the scale, then encode every chunk under it. */
+    const int has_scale = bsq_payload_has_tensor_scale(dst->method);
+    float scale = 0.0f;
+    if (has_scale) {
+        float stat = 0.0f;
+        if (_chunked_statistic(src, dst, &stat)) return 1;
+        scale = bsq_tensor_scale_for_absmax(dst->method, stat);
+    }
+
+    bsq_prepare_codec_tables(dst->method);
+
+    const uint64_t num_chunks = (n + TRANSCODE_CHUNK - 1) / TRANSCODE_CHUNK;
+    float stored_scale = 0.0f;
+    int failed = 0;
+
+#if defined(__linux__) && defined(_OPENMP)
+#pragma omp parallel for reduction(|:failed)
+#endif
+    for (uint64_t c = 0; c < num_chunks; ++c) {
+        float panel[TRANSCODE_CHUNK];
+        const uint64_t first = c * TRANSCODE_CHUNK;
+        const uint64_t count = n - first < TRANSCODE_CHUNK ? n - first : TRANSCODE_CHUNK;
+        bsq_view_t slice;
+        if (bsq_decompress_range_serial(src, first, count, panel) || bsq_slice_payload(dst, first, count, &slice) ||
+            (has_scale ? bsq_compress_payload_scaled_serial(&slice.buf, panel, scale)
+                       : bsq_compress_payload_serial(&slice.buf, panel, NULL))) {
+            failed = 1;
+            continue;
+        }
+        if (has_scale && c == 0) stored_scale = bsq_payload_tensor_scale(&slice.buf);
+    }
+    if (failed) return 1;
+    if (has_scale) bsq_set_payload_tensor_scale(dst, stored_scale);
+    return 0;
+}
+
+int bsq_transcode_into(const bitsqueeze_buffer_t *src, bsq_method_t dst_method, void *dst, int64_t dst_size) {
+    if (!src || !src->payload || !dst) return 1;
+    if (src->method == TOPK || src->method == TOPK_IM || dst_method == TOPK || dst_method == TOPK_IM) return 1;
+
+    bsq_shape_t shape;
+    memset(&shape, 0, sizeof(shape));
+    shape.num_elements = src->shape.num_elements;
+    if (shape.num_elements == 0) return 1;
+
+    bitsqueeze_buffer_t *out = bsq_prepare_buffer(dst_method, &shape, dst, dst_size);
+    if (!out) return 1;
+
+    int handled = 0;
+    if (_transcode_fused(src, out, &handled)) return 1;
+    return handled ? 0 : _transcode_chunked(src, out);
+}
+
+int bsq_transcode(const bitsqueeze_buffer_t *src, bsq_method_t dst_method, bitsqueeze_buffer_t **out) {
+    if (!src || !out || *out) return 1;
+    if (src->method == TOPK || src->method == TOPK_IM) return 1;
+
+    const int64_t size = bsq_compute_packed_size_1d(dst_method, src->shape.num_elements);
+    if (size <= 0) return 1;
+    void *mem = bsq_alloc_bytes((size_t)size, TRANSCODE_ALIGN, BSQ_ALLOC_UNINITIALIZED);
+    if (!mem) return 1;
+
+    if (bsq_transcode_into(src, dst_method, mem, size)) {
+        bsq_free_bytes(mem);
+        return 1;
+    }
+    *out = (bitsqueeze_buffer_t *)mem;
+    return 0;
+}
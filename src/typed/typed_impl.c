@@ -0,0 +1,221 @@
+#include "bitsqueeze.h"
+#include "bitsqueeze_internal.h"
+
+#include <string.h>
+
+#if defined(__linux__) && defined(_OPENMP)
+#include <omp.h>
+#endif
+
+#include "datatype/bf16.h"
+#include "datatype/fp16/fp16.h"
+#include "utils/alloc.h"
+
+/* Elements widened per step: a multiple of every granule, small enough that a step's floats stay in L1/L2. */
+#define TYPED_CHUNK 4096
+/* Alignment of the per-thread float panels. */
+#define TYPED_ALIGN 64
+
+/*
+ * The typed entry points widen one chunk of the 16-bit input into a per-thread float panel and encode it into
+ * the matching slice of the payload, so the input is read at its own width and no full float copy exists.
+ * Slices are independently coded (whole blocks, or whole token rows for TOPK), so the result is exactly that
+ * of bsq_compress_* on the widened tensor.
+ */
+
+typedef struct {
+    const void *src;
+    bsq_dtype_t dtype;
+    uint64_t    row_elements;    /* elements per slicing row: num_features for TOPK/TOPK_IM, else 1 */
+    uint64_t    num_rows;
+    uint64_t    rows_per_chunk;
+} typed_plan_t;
+
+static int _is_sparse(bsq_method_t method) {
+    return method == TOPK || method == TOPK_IM;
+}
+
+static int _num_threads(void) {
+#if defined(__linux__) && defined(_OPENMP)
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+static int _thread_id(void) {
+#if defined(__linux__) && defined(_OPENMP)
+    return omp_get_thread_num();
+#else
+    return 0;
+#endif
+}
+
+static void _widen(const void *src, bsq_dtype_t dtype, uint64_t first, uint64_t count, float *dst) {
+    const uint16_t *h = (const uint16_t *)src + first;
+    if (dtype == BSQ_DTYPE_FP16) {
+        for (uint64_t i = 0; i < count; ++i) dst[i] = fp16_ieee_to_fp32_value(h[i]);
+    } else {
+        for (uint64_t i = 0; i < count; ++i) dst[i] = fp32_from_bf16_value(h[i]);
+    }
+}
+
+/* Tensor-scale statistic of the input, widened one chunk at a time. */
+static float _typed_statistic(const typed_plan_t *plan, const bitsqueeze_buffer_t *buf, float *panels) {
+    const uint64_t n = plan->num_rows;
+    const uint64_t num_chunks = (n + TYPED_CHUNK - 1) / TYPED_CHUNK;
+    const uint64_t block_size = bsq_payload_granule(buf);
+    float stat = 0.0f;
+
+#if defined(__linux__) && defined(_OPENMP)
+#pragma omp parallel for reduction(max:stat)
+#endif
+    for (uint64_t c = 0; c < num_chunks; ++c) {
+        float *panel = panels + (size_t)_thread_id() * TYPED_CHUNK;
+        const uint64_t first = c * TYPED_CHUNK;
+        const uint64_t count = n - first < TYPED_CHUNK ? n - first : TYPED_CHUNK;
+        _widen(plan->src, plan->dtype, first, count, panel);
+        const float panel_stat = bsq_tensor_scale_statistic(buf->method, block_size, panel, count);
+        if (panel_stat > stat) stat = panel_stat;
+    }
+    return stat;
+}
+
+static int _compress_typed(const typed_plan_t *plan, bitsqueeze_buffer_t *buf, const float *im) {
+    if (plan->dtype != BSQ_DTYPE_FP16 && plan->dtype != BSQ_DTYPE_BF16) return 1;
+    if (buf->method == TOPK_IM && !im) return 1;
+    if (!_is_sparse(buf->method)) {
+        const uint64_t granule = bsq_payload_granule(buf);
+        if (granule == 0 || TYPED_CHUNK % granule != 0) return 1;
+    }
+
+    const uint64_t panel_elements = plan->rows_per_chunk * plan->row_elements;
+    float *panels = (float *)bsq_alloc_bytes((size_t)_num_threads() * panel_elements * sizeof(float),
+                                             TYPED_ALIGN, BSQ_ALLOC_UNINITIALIZED);
+    if (!panels) return 1;
+
+    /* Tensor-scale formats widen the input once for the scale, then encode every chunk under it. */
+    const int has_scale = bsq_payload_has_tensor_scale(buf->method);
+    const float scale = has_scale
+        ? bsq_tensor_scale_for_absmax(buf->method, _typed_statistic(plan, buf, panels))
+        : 0.0f;
+
+    bsq_prepare_codec_tables(buf->method);
+
+    const uint64_t num_chunks = (plan->num_rows + plan->rows_per_chunk - 1) / plan->rows_per_chunk;
+    float stored_scale = 0.0f;
+    int failed = 0;
+
+#if defined(__linux__) && defined(_OPENMP)
+#pragma omp parallel for reduction(|:failed)
+#endif
+    for (uint64_t c = 0; c < num_chunks; ++c) {
+        float *panel = panels + (size_t)_thread_id() * panel_elements;
+        const uint64_t first = c * plan->rows_per_chunk;
+        const uint64_t rows = plan->num_rows - first < plan->rows_per_chunk ? plan->num_rows - first
+                                                                            : plan->rows_per_chunk;
+        const uint64_t offset = first * plan->row_elements;
+        const uint64_t count = rows * plan->row_elements;
+        _widen(plan->src, plan->dtype, offset, count, panel);
+
+        bsq_view_t slice;
+        if (bsq_slice_payload_rows(buf, plan->row_elements, first, rows, &slice) ||
+            (has_scale ? bsq_compress_payload_scaled_serial(&slice.buf, panel, scale)
+                       : bsq_compress_payload_serial(&slice.buf, panel, im ? im + offset : NULL))) {
+            failed = 1;
+            continue;
+        }
+        if (has_scale && c == 0) stored_scale = bsq_payload_tensor_scale(&slice.buf);
+    }
+    bsq_free_bytes(panels);
+    if (failed) return 1;
+    if (has_scale) bsq_set_payload_tensor_scale(buf, stored_scale);
+    return 0;
+}
+
+int bsq_compress_1d_typed_into(const void *src,
+                               bsq_dtype_t dtype,
+                               uint64_t num_elements,
+                               bsq_method_t method,
+                               void *dst,
+                               int64_t dst_size,
+                               const float *im) {
+    if (!src || num_elements == 0 || !dst || _is_sparse(method)) return 1;
+
+    bsq_shape_t shape;
+    memset(&shape, 0, sizeof(shape));
+    shape.num_elements = num_elements;
+    bitsqueeze_buffer_t *buf = bsq_prepare_buffer(method, &shape, dst, dst_size);
+    if (!buf) return 1;
+
+    const typed_plan_t plan = {src, dtype, 1, num_elements, TYPED_CHUNK};
+    return _compress_typed(&plan, buf, im);
+}
+
+int bsq_compress_2d_typed_into(const void *src,
+                               bsq_dtype_t dtype,
+                               uint16_t num_tokens,
+                               uint16_t num_features,
+                               float sparse_ratio,
+                               bsq_method_t method,
+                               void *dst,
+                               int64_t dst_size,
+                               const float *im) {
+    if (!src || num_tokens == 0 || num_features == 0 || !dst || !_is_sparse(method)) return 1;
+
+    bsq_shape_t shape;
+    memset(&shape, 0, sizeof(shape));
+    shape.num_tokens = num_tokens;
+    shape.num_features = num_features;
+    shape.sparse_ratio = sparse_ratio;
+    bitsqueeze_buffer_t *buf = bsq_prepare_buffer(method, &shape, dst, dst_size);
+    if (!buf) return 1;
+
+    const uint64_t rows_per_chunk = num_features < TYPED_CHUNK ? TYPED_CHUNK / num_features : 1;
+    const typed_plan_t plan = {src, dtype, num_features, num_tokens, rows_per_chunk};
+    return _compress_typed(&plan, buf, im);
+}
+
+int bsq_compress_1d_typed(const void *src,
+                          bsq_dtype_t dtype,
+                          uint64_t num_elements,
+                          bsq_method_t method,
+                          bitsqueeze_buffer_t **out,
+                          const float *im) {
+    if (!src || num_elements == 0 || !out || *out) return 1;
+
+    const int64_t size = bsq_compute_packed_size_1d(method, num_elements);
+    if (size <= 0) return 1;
+    void *mem = bsq_alloc_bytes((size_t)size, TYPED_ALIGN, BSQ_ALLOC_UNINITIALIZED);
+    if (!mem) return 1;
+
+    if (bsq_compress_1d_typed_into(src, dtype, num_elements, method, mem, size, im)) {
+        bsq_free_bytes(mem);
+        return 1;
+    }
+    *out = (bitsqueeze_buffer_t *)mem;
+    return 0;
+}
+
+int bsq_compress_2d_typed(const void *src,
+                          bsq_dtype_t dtype,
+                          uint16_t num_tokens,
+                          uint16_t num_features,
+                          float sparse_ratio,
+                          bsq_method_t method,
+                          bitsqueeze_buffer_t **out,
+                          const float *im) {
+    if (!src || num_tokens == 0 || num_features == 0 || !out || *out) return 1;
+
+    const int64_t size = bsq_compute_packed_size_2d(method, num_tokens, num_features, sparse_ratio);
+    if (size <= 0) return 1;
+    void *mem = bsq_alloc_bytes((size_t)size, TYPED_ALIGN, BSQ_ALLOC_UNINITIALIZED);
+    if (!mem) return 1;
+
+    if (bsq_compress_2d_typed_into(src, dtype, num_tokens, num_features, sparse_ratio, method, mem, size, im)) {
+        bsq_free_bytes(mem);
+        return 1;
+    }
+    *out = (bitsqueeze_buffer_t *)mem;
+    return 0;
+}
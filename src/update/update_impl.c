@@ -0,0 +1,116 @@
+#include "bitsqueeze.h"
+#include "bitsqueeze_internal.h"
+
+#include "sparsity/topk_impl.h"
+
+/* Blocks [begin, end) of the update, restricted to the set bits of bitmap when it is given. */
+typedef struct {
+    const uint8_t *bitmap;
+    uint64_t       begin;
+    uint64_t       end;
+} dirty_t;
+
+static int _is_dirty(const dirty_t *dirty, uint64_t block) {
+    return !dirty->bitmap || ((dirty->bitmap[block >> 3] >> (block & 7)) & 1);
+}
+
+/* Advance *block to the next dirty run and set *run_end past it; 0 once no dirty block is left. */
+static int _next_run(const dirty_t *dirty, uint64_t *block, uint64_t *run_end) {
+    while (*block < dirty->end && !_is_dirty(dirty, *block)) ++*block;
+    if (*block >= dirty->end) return 0;
+    uint64_t end = *block + 1;
+    while (end < dirty->end && _is_dirty(dirty, end)) ++end;
+    *run_end = end;
+    return 1;
+}
+
+static int _is_sparse(bsq_method_t method) {
+    return method == TOPK || method == TOPK_IM;
+}
+
+static uint64_t _num_elements(const bitsqueeze_buffer_t *buf) {
+    return _is_sparse(buf->method) ? (uint64_t)buf->shape.num_tokens * buf->shape.num_features
+                                   : buf->shape.num_elements;
+}
+
+uint64_t bsq_update_block_size(const bitsqueeze_buffer_t *buf) {
+    if (!buf || !buf->payload) return 0;
+    if (_is_sparse(buf->method)) return ((const sparse_array_t *)buf->payload)->num_features;
+    return bsq_payload_granule(buf);
+}
+
+/* Tensor-scale statistic of the dirty blocks only. */
+static float _dirty_statistic(const bitsqueeze_buffer_t *buf, const float *src, const dirty_t *dirty,
+                              uint64_t block_size, uint64_t num_elements) {
+    float stat = 0.0f;
+    uint64_t block = dirty->begin, run_end = 0;
+    while (_next_run(dirty, &block, &run_end)) {
+        for (; block < run_end; ++block) {
+            const uint64_t start = block * block_size;
+            const uint64_t len = (start + block_size < num_elements ? start + block_size : num_elements) - start;
+            const float value = bsq_tensor_scale_statistic(buf->method, block_size, src + start, len);
+            if (value > stat) stat = value;
+        }
+    }
+    return stat;
+}
+
+static int _update(bitsqueeze_buffer_t *buf, const float *src, const float *im, const dirty_t *dirty) {
+    const uint64_t block_size = bsq_update_block_size(buf);
+    const uint64_t num_elements = _num_elements(buf);
+    if (block_size == 0) return 1;
+    if (buf->method == TOPK_IM && !im) return 1;
+
+    /* A tensor scale is kept while the new values fit under it; otherwise the whole tensor moves to a new one. */
+    const int has_scale = bsq_payload_has_tensor_scale(buf->method);
+    const float scale = has_scale ? bsq_payload_tensor_scale(buf) : 0.0f;
+    if (has_scale) {
+        const float stat = _dirty_statistic(buf, src, dirty, block_size, num_elements);
+        if (stat > 0.0f && bsq_tensor_scale_for_absmax(buf->method, stat) > scale) {
+            return bsq_compress_payload(buf, src, im);
+        }
+    }
+
+    uint64_t block = dirty->begin, run_end = 0;
+    while (_next_run(dirty, &block, &run_end)) {
+        const uint64_t first = block * block_size;
+        const uint64_t end = run_end * block_size < num_elements ? run_end * block_size : num_elements;
+        bsq_view_t slice;
+        const int rc = _is_sparse(buf->method) ? bsq_slice_payload_rows(buf, block_size, block, run_end - block, &slice)
+                                               : bsq_slice_payload(buf, first, end - first, &slice);
+        if (rc) return 1;
+        if (has_scale ? bsq_compress_payload_scaled(&slice.buf, src + first, scale)
+                      : bsq_compress_payload(&slice.buf, src + first, im ? im + first : NULL)) {
+            return 1;
+        }
+        block = run_end;
+    }
+    return 0;
+}
+
+int bsq_update_range(bitsqueeze_buffer_t *buf,
+                     const float *src,
+                     uint64_t offset,
+                     uint64_t count,
+                     const float *im) {
+    if (!buf || !buf->payload || !src) return 1;
+    const uint64_t block_size = bsq_update_block_size(buf);
+    const uint64_t num_elements = _num_elements(buf);
+    if (block_size == 0 || offset > num_elements || count > num_elements - offset) return 1;
+    if (count == 0) return 0;
+
+    const dirty_t dirty = {NULL, offset / block_size, (offset + count + block_size - 1) / block_size};
+    return _update(buf, src, im, &dirty);
+}
+
+int bsq_update_blocks(bitsqueeze_buffer_t *buf,
+                      const float *src,
+                      const uint8_t *dirty_blocks,
+                      const float *im) {
+    if (!buf || !buf->payload || !src || !dirty_blocks) return 1;
+    const uint64_t block_size = bsq_update_block_size(buf);
+    if (block_size == 0) return 1;
+
+    const dirty_t dirty = {dirty_blocks, 0, (_num_elements(buf) + block_size - 1) / block_size};
+    return _update(buf, src, im, &dirty);
+}
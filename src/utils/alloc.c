@@ -0,0 +1,225 @@
+#if defined(__linux__)
+#define _GNU_SOURCE
+#include <sys/mman.h>
+#endif
+
+#include "utils/alloc.h"
+
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* alloc == NULL selects calloc/free. */
+static bsq_allocator_t g_allocator;
+
+int bsq_set_allocator(const bsq_allocator_t *allocator) {
+    if (!allocator) {
+        memset(&g_allocator, 0, sizeof(g_allocator));
+        return 0;
+    }
+    if (!allocator->alloc || !allocator->free) return 1;
+    g_allocator = *allocator;
+    return 0;
+}
+
+void *bsq_alloc_bytes(size_t size, size_t alignment, uint32_t flags) {
+    if (size == 0 || (alignment & (alignment - 1)) != 0) return NULL;
+    if (g_allocator.alloc) return g_allocator.alloc(g_allocator.user, size, alignment, flags);
+
+    if (alignment <= alignof(max_align_t)) {
+        return (flags & BSQ_ALLOC_UNINITIALIZED) ? malloc(size) : calloc(1, size);
+    }
+    void *ptr = aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+    if (ptr && !(flags & BSQ_ALLOC_UNINITIALIZED)) memset(ptr, 0, size);
+    return ptr;
+}
+
+void bsq_free_bytes(void *ptr) {
+    if (!ptr) return;
+    if (g_allocator.free) {
+        g_allocator.free(g_allocator.user, ptr);
+    } else {
+        free(ptr);
+    }
+}
+
+/*
+ * Size-class pool. Classes are 256 bytes, then four steps per power of two above it, so a request wastes at
+ * most a quarter of its size. Every block carries a POOL_HEADER_SIZE prefix that records its class, which is
+ * also the largest alignment the pool serves.
+ */
+#define POOL_HEADER_SIZE    64
+#define POOL_MIN_CLASS_LOG2 8
+#define POOL_MAX_CLASS_LOG2 48
+#define POOL_STEPS          4
+#define POOL_NUM_CLASSES    (1 + (POOL_MAX_CLASS_LOG2 - POOL_MIN_CLASS_LOG2) * POOL_STEPS)
+#define POOL_HUGE_PAGE_SIZE ((size_t)2 << 20)
+
+typedef struct pool_block {
+    struct pool_block *next;
+    size_t             mapped;    /* bytes from mmap, 0 for heap blocks */
+    uint32_t           cls;
+} pool_block_t;
+
+struct bsq_pool {
+    atomic_flag       lock;
+    uint64_t          max_cached_bytes;
+    uint32_t          flags;
+    pool_block_t     *free_lists[POOL_NUM_CLASSES];
+    bsq_pool_stats_t  stats;
+};
+
+/* Class index for size, or -1 past the largest class. */
+static int _size_class(size_t size, size_t *class_size) {
+    if (size <= ((size_t)1 << POOL_MIN_CLASS_LOG2)) {
+        *class_size = (size_t)1 << POOL_MIN_CLASS_LOG2;
+        return 0;
+    }
+    /* 2^k < size <= 2^(k+1), split into POOL_STEPS steps of 2^(k-2). */
+    uint32_t k = POOL_MIN_CLASS_LOG2;
+    while (k < POOL_MAX_CLASS_LOG2 && ((size - 1) >> (k + 1)) != 0) ++k;
+    if (k >= POOL_MAX_CLASS_LOG2) return -1;
+    const size_t step = (size_t)1 << (k - 2);
+    const size_t q = (size + step - 1) / step;
+    *class_size = q * step;
+    return 1 + (int)((k - POOL_MIN_CLASS_LOG2) * POOL_STEPS + (q - POOL_STEPS - 1));
+}
+
+static size_t _class_size(uint32_t cls) {
+    if (cls == 0) return (size_t)1 << POOL_MIN_CLASS_LOG2;
+    const uint32_t k = POOL_MIN_CLASS_LOG2 + (cls - 1) / POOL_STEPS;
+    return (size_t)((cls - 1) % POOL_STEPS + POOL_STEPS + 1) << (k - 2);
+}
+
+static void _pool_lock(bsq_pool_t *pool) {
+    while (atomic_flag_test_and_set_explicit(&pool->lock, memory_order_acquire)) {
+    }
+}
+
+static void _pool_unlock(bsq_pool_t *pool) {
+    atomic_flag_clear_explicit(&pool->lock, memory_order_release);
+}
+
+/* A fresh block of class cls; mmapped (and so already zero) when huge pages are requested and it spans one. */
+static pool_block_t *_pool_block_new(const bsq_pool_t *pool, uint32_t cls) {
+    const size_t total = POOL_HEADER_SIZE + _class_size(cls);
+    pool_block_t *block = NULL;
+    size_t mapped = 0;
+#if defined(__linux__)
+    if ((pool->flags & BSQ_POOL_HUGE_PAGES) && total >= POOL_HUGE_PAGE_SIZE) {
+        mapped = (total + POOL_HUGE_PAGE_SIZE - 1) / POOL_HUGE_PAGE_SIZE * POOL_HUGE_PAGE_SIZE;
+        void *addr = mmap(NULL, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (addr == MAP_FAILED) {
+            mapped = 0;
+        } else {
+            madvise(addr, mapped, MADV_HUGEPAGE);
+            block = (pool_block_t *)addr;
+        }
+    }
+#else
+    (void)pool;
+#endif
+    if (!block) block = (pool_block_t *)aligned_alloc(POOL_HEADER_SIZE, total);
+    if (!block) return NULL;
+    block->next = NULL;
+    block->mapped = mapped;
+    block->cls = cls;
+    return block;
+}
+
+static void _pool_block_release(pool_block_t *block) {
+#if defined(__linux__)
+    if (block->mapped) {
+        munmap(block, block->mapped);
+        return;
+    }
+#endif
+    free(block);
+}
+
+bsq_pool_t *bsq_pool_create(uint64_t max_cached_bytes, uint32_t flags) {
+    bsq_pool_t *pool = (bsq_pool_t *)calloc(1, sizeof(bsq_pool_t));
+    if (!pool) return NULL;
+    atomic_flag_clear(&pool->lock);
+    pool->max_cached_bytes = max_cached_bytes;
+    pool->flags = flags;
+    return pool;
+}
+
+void bsq_pool_destroy(bsq_pool_t *pool) {
+    if (!pool) return;
+    for (uint32_t c = 0; c < POOL_NUM_CLASSES; ++c) {
+        pool_block_t *block = pool->free_lists[c];
+        while (block) {
+            pool_block_t *next = block->next;
+            _pool_block_release(block);
+            block = next;
+        }
+    }
+    free(pool);
+}
+
+void *bsq_pool_alloc(void *user, size_t size, size_t alignment, uint32_t flags) {
+    bsq_pool_t *pool = (bsq_pool_t *)user;
+    size_t class_size = 0;
+    const int cls = _size_class(size, &class_size);
+    if (!pool || size == 0 || alignment > POOL_HEADER_SIZE || cls < 0) return NULL;
+
+    _pool_lock(pool);
+    pool_block_t *block = pool->free_lists[cls];
+    if (block) {
+        pool->free_lists[cls] = block->next;
+        pool->stats.cached_bytes -= class_size;
+        pool->stats.hits++;
+    } else {
+        pool->stats.misses++;
+    }
+    _pool_unlock(pool);
+
+    const int fresh = block == NULL;
+    if (fresh) block = _pool_block_new(pool, (uint32_t)cls);
+    if (!block) return NULL;
+
+    _pool_lock(pool);
+    pool->stats.live_bytes += class_size;
+    _pool_unlock(pool);
+
+    void *ptr = (uint8_t *)block + POOL_HEADER_SIZE;
+    if (!(flags & BSQ_ALLOC_UNINITIALIZED) && !(fresh && block->mapped)) memset(ptr, 0, size);
+    return ptr;
+}
+
+void bsq_pool_release(void *user, void *ptr) {
+    bsq_pool_t *pool = (bsq_pool_t *)user;
+    if (!pool || !ptr) return;
+    pool_block_t *block = (pool_block_t *)((uint8_t *)ptr - POOL_HEADER_SIZE);
+    const size_t class_size = _class_size(block->cls);
+
+    _pool_lock(pool);
+    pool->stats.live_bytes -= class_size;
+    const int keep = pool->stats.cached_bytes + class_size <= pool->max_cached_bytes;
+    if (keep) {
+        block->next = pool->free_lists[block->cls];
+        pool->free_lists[block->cls] = block;
+        pool->stats.cached_bytes += class_size;
+    }
+    _pool_unlock(pool);
+
+    if (!keep) _pool_block_release(block);
+}
+
+bsq_allocator_t bsq_pool_allocator(bsq_pool_t *pool) {
+    bsq_allocator_t allocator;
+    allocator.alloc = bsq_pool_alloc;
+    allocator.free = bsq_pool_release;
+    allocator.user = pool;
+    return allocator;
+}
+
+void bsq_pool_get_stats(bsq_pool_t *pool, bsq_pool_stats_t *stats) {
+    if (!pool || !stats) return;
+    _pool_lock(pool);
+    *stats = pool->stats;
+    _pool_unlock(pool);
+}
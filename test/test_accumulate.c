@@ -0,0 +1,91 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bitsqueeze.h"
+#include "utils/random.h"
+#include "utils/evaluation.h"
+
+#define N (1u << 20)
+#define TOKENS 256
+#define FEATURES 4096
+
+static const bsq_method_t METHODS_1D[] = {
+    Q8_0, Q4_0, Q2_K, Q2_K_FAST, BF16, FP16, FP8, FP4, MXFP8, MXFP4,
+    NVFP4, NF4, NF4_DQ, IQ2_XXS, IQ2_XS, IQ2_S
+};
+
+/* acc must equal base + alpha * decoded elementwise, as decompress followed by an axpy would compute it. */
+static int check(const float *acc, const float *base, const float *decoded, float alpha, uint64_t n) {
+    for (uint64_t i = 0; i < n; ++i) {
+        if (acc[i] != base[i] + alpha * decoded[i]) return 1;
+    }
+    return 0;
+}
+
+/* Accumulates buf into a copy of base and times it against decompressing to a temporary and adding that. */
+static int run(const bitsqueeze_buffer_t *buf, const float *base, uint64_t n, float *acc, float *decoded,
+               const char *label) {
+    const float alpha = -0.375f;
+    memcpy(acc, base, n * sizeof(float));
+    double t0 = get_time_ms();
+    const int rc = bsq_accumulate(buf, acc, n, alpha);
+    const double fused_time = get_time_ms() - t0;
+
+    memcpy(decoded, base, n * sizeof(float));
+    t0 = get_time_ms();
+    float *tmp = (float *)malloc(n * sizeof(float));
+    int failed = !tmp || bsq_decompress(buf, tmp, n);
+    for (uint64_t i = 0; i < n && !failed; ++i) decoded[i] += alpha * tmp[i];
+    const double split_time = get_time_ms() - t0;
+    printf("[%s] accumulate=%.3f ms, decompress+axpy=%.3f ms\n", label, fused_time, split_time);
+
+    if (!failed) failed = bsq_decompress(buf, tmp, n);
+    failed = failed || rc || check(acc, base, tmp, alpha, n) || bsq_accumulate(buf, acc, n - 1, alpha) == 0;
+    free(tmp);
+    return failed;
+}
+
+int main(void) {
+    float **inputs = gen_random_float_arrays(3, N, -2.0f, 2.0f, 2121);
+    float *acc = (float *)malloc(N * sizeof(float));
+    float *decoded = (float *)malloc(N * sizeof(float));
+    if (!inputs || !acc || !decoded) {
+        fprintf(stderr, "failed to allocate test buffers\n");
+        return EXIT_FAILURE;
+    }
+
+    int failed = 0;
+    char label[32];
+    const size_t num_methods = sizeof(METHODS_1D) / sizeof(METHODS_1D[0]);
+    for (size_t m = 0; m < num_methods && !failed; ++m) {
+        bitsqueeze_buffer_t *buf = NULL;
+        /* An odd length leaves a partial final block and chunk. */
+        const uint64_t n = N - 5;
+        snprintf(label, sizeof(label), "method %d", METHODS_1D[m]);
+        if (bsq_compress_1d(inputs[0], n, METHODS_1D[m], &buf, NULL) || run(buf, inputs[1], n, acc, decoded, label)) {
+            fprintf(stderr, "method %d: accumulate differs\n", METHODS_1D[m]);
+            failed = 1;
+        }
+        bsq_free(buf);
+    }
+
+    const bsq_method_t methods_2d[] = {TOPK, TOPK_IM};
+    for (int m = 0; m < 2 && !failed; ++m) {
+        bitsqueeze_buffer_t *buf = NULL;
+        snprintf(label, sizeof(label), "method %d", methods_2d[m]);
+        if (bsq_compress_2d(inputs[0], TOKENS, FEATURES, 0.05f, methods_2d[m], &buf, inputs[2]) ||
+            run(buf, inputs[1], (uint64_t)TOKENS * FEATURES, acc, decoded, label)) {
+            fprintf(stderr, "method %d: accumulate differs\n", methods_2d[m]);
+            failed = 1;
+        }
+        bsq_free(buf);
+    }
+
+    free(acc);
+    free(decoded);
+    free_random_float_arrays(inputs, 3);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
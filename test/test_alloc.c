@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bitsqueeze.h"
+#include "int_quantization/q8_0_impl.h"
+#include "utils/random.h"
+
+#define N 4099
+#define LARGE_N (1u << 20)     /* a Q8_0 buffer of just over 1 MiB: 2 MiB class with its header */
+#define STEPS 16
+
+typedef struct {
+    int allocs;
+    int frees;
+    int uninitialized;
+} counts_t;
+
+static void *counting_alloc(void *user, size_t size, size_t alignment, uint32_t flags) {
+    counts_t *counts = (counts_t *)user;
+    counts->allocs++;
+    if (flags & BSQ_ALLOC_UNINITIALIZED) counts->uninitialized++;
+    (void)alignment;
+    return (flags & BSQ_ALLOC_UNINITIALIZED) ? malloc(size) : calloc(1, size);
+}
+
+static void counting_free(void *user, void *ptr) {
+    ((counts_t *)user)->frees++;
+    free(ptr);
+}
+
+/* Compress and free src STEPS times, as a decode loop does with same-size blocks; returns non-zero on error. */
+static int churn(const float *src, uint64_t n, float *out) {
+    for (int step = 0; step < STEPS; ++step) {
+        bitsqueeze_buffer_t *buf = NULL;
+        const int failed = bsq_compress_1d(src, n, Q8_0, &buf, NULL) || bsq_decompress(buf, out, n);
+        bsq_free(buf);
+        if (failed) return 1;
+    }
+    return 0;
+}
+
+int main(void) {
+    float **inputs = gen_random_float_arrays(1, LARGE_N, -4.0f, 4.0f, 99);
+    float *out = (float *)malloc(LARGE_N * sizeof(float));
+    float *ref = (float *)malloc(N * sizeof(float));
+    if (!inputs || !out || !ref) {
+        fprintf(stderr, "failed to allocate test buffers\n");
+        return EXIT_FAILURE;
+    }
+
+    int failed = 0;
+    bitsqueeze_buffer_t *plain = NULL;
+    if (bsq_compress_1d(inputs[0], N, Q8_0, &plain, NULL) || bsq_decompress(plain, ref, N)) {
+        fprintf(stderr, "setup failed\n");
+        failed = 1;
+    }
+
+    /* Hooks see every allocation, and compression skips the zero fill. */
+    if (!failed) {
+        counts_t counts = {0, 0, 0};
+        const bsq_allocator_t allocator = {counting_alloc, counting_free, &counts};
+        bitsqueeze_buffer_t *buf = NULL;
+        bitsqueeze_buffer_t *loaded = NULL;
+        q8_0_array_t *arr = NULL;
+        if (bsq_set_allocator(&allocator) || bsq_compress_1d(inputs[0], N, Q8_0, &buf, NULL) ||
+            !(loaded = load_bsq_from_buffer(buf, bsq_get_packed_size(buf))) ||
+            !(arr = allocate_q8_0_array(N, 32)) || bsq_decompress(loaded, out, N) ||
+            memcmp(out, ref, N * sizeof(float)) != 0) {
+            fprintf(stderr, "hooked allocation failed\n");
+            failed = 1;
+        }
+        bsq_free(buf);
+        bsq_free(loaded);
+        free_q8_0_array(arr);
+        if (!failed && (counts.allocs != 3 || counts.frees != 3 || counts.uninitialized != 2)) {
+            fprintf(stderr, "hooks saw %d allocs (%d uninitialized), %d frees\n",
+                    counts.allocs, counts.uninitialized, counts.frees);
+            failed = 1;
+        }
+        const bsq_allocator_t incomplete = {counting_alloc, NULL, NULL};
+        if (bsq_set_allocator(&incomplete) == 0 || bsq_set_allocator(NULL) != 0) {
+            fprintf(stderr, "bsq_set_allocator argument checks failed\n");
+            failed = 1;
+        }
+    }
+
+    /* Same-size blocks cycle through one cached block; zeroed requests get zeroes back from a dirty block. */
+    if (!failed) {
+        bsq_pool_t *pool = bsq_pool_create(64u << 20, 0);
+        const bsq_allocator_t allocator = bsq_pool_allocator(pool);
+        bsq_pool_stats_t stats;
+        memset(&stats, 0, sizeof(stats));
+        if (!pool || bsq_set_allocator(&allocator) || churn(inputs[0], N, out)) {
+            fprintf(stderr, "pooled allocation failed\n");
+            failed = 1;
+        }
+        bsq_pool_get_stats(pool, &stats);
+        if (!failed && (stats.misses != 1 || stats.hits != STEPS - 1 || stats.live_bytes != 0 ||
+                        stats.cached_bytes == 0)) {
+            fprintf(stderr, "pool: %llu hits, %llu misses, %llu live\n", (unsigned long long)stats.hits,
+                    (unsigned long long)stats.misses, (unsigned long long)stats.live_bytes);
+            failed = 1;
+        }
+
+        q8_0_array_t *arr = failed ? NULL : allocate_q8_0_array(N, 32);
+        for (uint64_t i = 0; arr && i < N; ++i) {
+            if (arr->data[i] != 0) {
+                fprintf(stderr, "pool: recycled block was not zeroed\n");
+                failed = 1;
+                break;
+            }
+        }
+        if (!failed && (!arr || memcmp(out, ref, N * sizeof(float)) != 0)) {
+            fprintf(stderr, "pool: output differs\n");
+            failed = 1;
+        }
+        free_q8_0_array(arr);
+        bsq_set_allocator(NULL);
+        bsq_pool_destroy(pool);
+    }
+
+    /* A cap of zero caches nothing; huge-page blocks behave like any other. */
+    if (!failed) {
+        bsq_pool_t *pool = bsq_pool_create(0, BSQ_POOL_HUGE_PAGES);
+        const bsq_allocator_t allocator = bsq_pool_allocator(pool);
+        bsq_pool_stats_t stats;
+        memset(&stats, 0, sizeof(stats));
+        if (!pool || bsq_set_allocator(&allocator) || churn(inputs[0], LARGE_N, out)) {
+            fprintf(stderr, "huge-page pool failed\n");
+            failed = 1;
+        }
+        bsq_pool_get_stats(pool, &stats);
+        if (!failed && (stats.misses != STEPS || stats.cached_bytes != 0 || stats.live_bytes != 0)) {
+            fprintf(stderr, "uncached pool kept blocks\n");
+            failed = 1;
+        }
+        bsq_set_allocator(NULL);
+        bsq_pool_destroy(pool);
+    }
+
+    bsq_free(plain);
+    free(out);
+    free(ref);
+    free_random_float_arrays(inputs, 1);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
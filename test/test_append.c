@@ -0,0 +1,96 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bitsqueeze.h"
+#include "utils/random.h"
+
+#define TOKENS 45
+#define FEATURES 256
+#define N ((uint64_t)TOKENS * FEATURES)
+#define SPARSE_RATIO 0.1f
+
+static const bsq_method_t METHODS[] = {
+    Q8_0, Q4_0, Q2_K, Q2_K_FAST, BF16, FP16, MXFP8, MXFP4, NF4, IQ2_XXS, IQ2_XS, IQ2_S, TOPK, TOPK_IM
+};
+
+/* Token counts per append: single decode steps mixed with prefills that cross chunk boundaries. */
+static const uint64_t STEPS[] = {1, 1, 3, 7, 1, 20, 1, 11};
+
+static int is_sparse(bsq_method_t method) {
+    return method == TOPK || method == TOPK_IM;
+}
+
+int main(void) {
+    float **inputs = gen_random_float_arrays(2, N, -6.0f, 6.0f, 1515);
+    float *expect = (float *)malloc(N * sizeof(float));
+    float *out = (float *)malloc(N * sizeof(float));
+    if (!inputs || !expect || !out) {
+        fprintf(stderr, "failed to allocate test buffers\n");
+        return EXIT_FAILURE;
+    }
+
+    int failed = 0;
+    const size_t num_methods = sizeof(METHODS) / sizeof(METHODS[0]);
+    for (size_t m = 0; m < num_methods && !failed; ++m) {
+        const bsq_method_t method = METHODS[m];
+        const float *im = method == Q2_K || method == TOPK_IM ? inputs[1] : NULL;
+        bitsqueeze_buffer_t *fresh = NULL;
+        bitsqueeze_buffer_t *packed = NULL;
+        bsq_append_t *app = bsq_append_create(method, FEATURES, SPARSE_RATIO, 4);
+        if (!app || (is_sparse(method) ? bsq_compress_2d(inputs[0], TOKENS, FEATURES, SPARSE_RATIO, method, &fresh, im)
+                                       : bsq_compress_1d(inputs[0], N, method, &fresh, im)) ||
+            bsq_decompress(fresh, expect, N)) {
+            fprintf(stderr, "method %d: setup failed\n", method);
+            failed = 1;
+        }
+
+        /* Rows are coded independently, so growing a row at a time matches compressing the whole tensor. */
+        uint64_t row = 0;
+        for (size_t s = 0; s < sizeof(STEPS) / sizeof(STEPS[0]) && !failed; ++s) {
+            const uint64_t offset = row * FEATURES;
+            if (bsq_append_tokens(app, inputs[0] + offset, STEPS[s], im ? im + offset : NULL)) failed = 1;
+            row += STEPS[s];
+        }
+        if (!failed && (row != TOKENS || bsq_append_num_tokens(app) != TOKENS ||
+                        bsq_append_decompress(app, out, N) || memcmp(expect, out, N * sizeof(float)) != 0)) {
+            fprintf(stderr, "method %d: appended rows differ\n", method);
+            failed = 1;
+        }
+
+        /* Rows 3..40 span four chunks. */
+        if (!failed && (bsq_append_decompress_range(app, 3, 38, out) ||
+                        memcmp(expect + 3 * FEATURES, out, 38 * FEATURES * sizeof(float)) != 0)) {
+            fprintf(stderr, "method %d: row range differs\n", method);
+            failed = 1;
+        }
+
+        if (!failed && (bsq_append_pack(app, &packed) || bsq_get_packed_size(packed) != bsq_get_packed_size(fresh) ||
+                        bsq_decompress(packed, out, N) || memcmp(expect, out, N * sizeof(float)) != 0)) {
+            fprintf(stderr, "method %d: packed buffer differs\n", method);
+            failed = 1;
+        }
+
+        if (!failed && (bsq_append_decompress_range(app, TOKENS, 1, out) == 0 ||
+                        bsq_append_decompress(app, out, N - 1) == 0)) {
+            fprintf(stderr, "method %d: argument checks failed\n", method);
+            failed = 1;
+        }
+        bsq_free(packed);
+        bsq_free(fresh);
+        bsq_append_free(app);
+    }
+
+    if (!failed && (bsq_append_create(FP8, FEATURES, 0.0f, 4) != NULL ||
+                    bsq_append_create(Q2_K, 100, 0.0f, 4) != NULL ||
+                    bsq_append_create(Q8_0, FEATURES, 0.0f, 0) != NULL)) {
+        fprintf(stderr, "unsupported configurations accepted\n");
+        failed = 1;
+    }
+
+    free(expect);
+    free(out);
+    free_random_float_arrays(inputs, 2);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include "bitsqueeze.h"
+#include "utils/random.h"
+
+#define N 4099
+#define NUM_JOBS 12
+
+static const bsq_method_t METHODS[] = {Q8_0, Q4_0, Q2_K, NF4_DQ, IQ2_XS, MXFP4};
+
+typedef struct {
+    atomic_int calls;
+    atomic_int last_status;
+    atomic_int *gate;           /* when set, the callback holds its worker until *gate is 0 */
+} probe_t;
+
+static void on_done(void *user, bsq_job_status_t status) {
+    probe_t *probe = (probe_t *)user;
+    atomic_store(&probe->last_status, (int)status);
+    atomic_fetch_add(&probe->calls, 1);
+    while (probe->gate && atomic_load(probe->gate)) {
+    }
+}
+
+static void probe_init(probe_t *probe, atomic_int *gate) {
+    atomic_init(&probe->calls, 0);
+    atomic_init(&probe->last_status, -1);
+    probe->gate = gate;
+}
+
+/* Submit a job whose callback parks the only worker until *gate clears. */
+static bsq_job_t *occupy_worker(bsq_async_t *async, const float *src, void *dst, int64_t size, probe_t *probe) {
+    bsq_job_t *job = bsq_async_compress_1d_into(async, src, N, Q8_0, dst, size, NULL, on_done, probe);
+    while (job && atomic_load(&probe->calls) == 0) {
+    }
+    return job;
+}
+
+int main(void) {
+    float **inputs = gen_random_float_arrays(1, N, -6.0f, 6.0f, 31337);
+    float *ref = (float *)malloc(N * sizeof(float));
+    float *outs = (float *)malloc((size_t)NUM_JOBS * N * sizeof(float));
+    void *dsts[NUM_JOBS];
+    int64_t sizes[NUM_JOBS];
+    if (!inputs || !ref || !outs) {
+        fprintf(stderr, "failed to allocate test buffers\n");
+        return EXIT_FAILURE;
+    }
+    for (int j = 0; j < NUM_JOBS; ++j) {
+        sizes[j] = bsq_compute_packed_size_1d(METHODS[j % 6], N);
+        dsts[j] = aligned_alloc(8, (size_t)(sizes[j] + 7) / 8 * 8);
+        if (!dsts[j]) return EXIT_FAILURE;
+    }
+
+    int failed = 0;
+
+    /* More jobs than queue slots: submits block until workers drain the queue. */
+    {
+        bsq_async_t *async = bsq_async_create(2, 1, 4, 0);
+        bsq_job_t *jobs[NUM_JOBS];
+        probe_t probe;
+        probe_init(&probe, NULL);
+        for (int j = 0; j < NUM_JOBS; ++j) {
+            jobs[j] = async ? bsq_async_compress_1d_into(async, inputs[0], N, METHODS[j % 6], dsts[j], sizes[j],
+                                                         NULL, on_done, &probe) : NULL;
+            if (!jobs[j]) failed = 1;
+        }
+        for (int j = 0; j < NUM_JOBS && !failed; ++j) {
+            if (bsq_job_wait(jobs[j]) != BSQ_JOB_DONE) failed = 1;
+        }
+        for (int j = 0; j < NUM_JOBS; ++j) bsq_job_release(jobs[j]);
+        for (int j = 0; j < NUM_JOBS && !failed; ++j) {
+            jobs[j] = bsq_async_decompress(async, (const bitsqueeze_buffer_t *)dsts[j], outs + (size_t)j * N, N,
+                                           NULL, NULL);
+            if (!jobs[j]) failed = 1;
+        }
+        for (int j = 0; j < NUM_JOBS && !failed; ++j) {
+            bitsqueeze_buffer_t *buf = NULL;
+            if (bsq_job_wait(jobs[j]) != BSQ_JOB_DONE || bsq_job_poll(jobs[j]) != BSQ_JOB_DONE ||
+                bsq_compress_1d(inputs[0], N, METHODS[j % 6], &buf, NULL) || bsq_decompress(buf, ref, N) ||
+                memcmp(ref, outs + (size_t)j * N, N * sizeof(float)) != 0) {
+                fprintf(stderr, "job %d (method %d): async output differs\n", j, METHODS[j % 6]);
+                failed = 1;
+            }
+            bsq_free(buf);
+            bsq_job_release(jobs[j]);
+        }
+        if (!failed && atomic_load(&probe.calls) != NUM_JOBS) {
+            fprintf(stderr, "callbacks ran %d times\n", atomic_load(&probe.calls));
+            failed = 1;
+        }
+        bsq_async_destroy(async);
+    }
+
+    /* Cancelling a queued job, backpressure without waiting, and destroying with work still queued. */
+    if (!failed) {
+        atomic_int gate;
+        atomic_init(&gate, 1);
+        probe_t busy, queued, rejected;
+        probe_init(&busy, &gate);
+        probe_init(&queued, NULL);
+        probe_init(&rejected, NULL);
+        bsq_async_t *async = bsq_async_create(1, 1, 1, BSQ_ASYNC_NO_WAIT);
+        bsq_job_t *first = async ? occupy_worker(async, inputs[0], dsts[0], sizes[0], &busy) : NULL;
+        bsq_job_t *second = bsq_async_compress_1d_into(async, inputs[0], N, Q8_0, dsts[1], sizes[1], NULL,
+                                                       on_done, &queued);
+        bsq_job_t *third = bsq_async_compress_1d_into(async, inputs[0], N, Q8_0, dsts[2], sizes[2], NULL,
+                                                      on_done, &rejected);
+        if (!first || !second || third || bsq_job_cancel(second) != 0 || bsq_job_cancel(first) == 0 ||
+            bsq_job_poll(second) != BSQ_JOB_CANCELLED || atomic_load(&queued.calls) != 1 ||
+            atomic_load(&queued.last_status) != BSQ_JOB_CANCELLED || atomic_load(&rejected.calls) != 0) {
+            fprintf(stderr, "cancel or backpressure checks failed\n");
+            failed = 1;
+        }
+        bsq_job_release(second);
+
+        probe_init(&queued, NULL);
+        second = bsq_async_compress_1d_into(async, inputs[0], N, Q8_0, dsts[1], sizes[1], NULL, on_done, &queued);
+        atomic_store(&gate, 0);
+        bsq_job_wait(first);
+        bsq_async_destroy(async);
+        /* The queued job either ran once the gate opened or was cancelled by destroy, exactly once. */
+        const int status = second ? (int)bsq_job_poll(second) : -1;
+        if (!second || (status != BSQ_JOB_DONE && status != BSQ_JOB_CANCELLED) ||
+            atomic_load(&queued.calls) != 1 || bsq_job_poll(first) != BSQ_JOB_DONE) {
+            fprintf(stderr, "destroy left a job unfinished\n");
+            failed = 1;
+        }
+        bsq_job_release(first);
+        bsq_job_release(second);
+    }
+
+    if (!failed && (bsq_async_create(0, 1, 4, 0) != NULL || bsq_async_create(1, 1, 0, 0) != NULL)) {
+        fprintf(stderr, "argument checks failed\n");
+        failed = 1;
+    }
+
+    for (int j = 0; j < NUM_JOBS; ++j) free(dsts[j]);
+    free(ref);
+    free(outs);
+    free_random_float_arrays(inputs, 1);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,62 @@
+#include <coroutine>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <future>
+#include <vector>
+
+#include "bitsqueeze_async.hpp"
+extern "C" {
+#include "utils/random.h"
+}
+
+#define N 4099
+
+/* Minimal eager coroutine that reports its result through a promise. */
+struct task {
+    struct promise_type {
+        std::promise<int> result;
+        task get_return_object() { return task{result.get_future()}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_value(int value) { result.set_value(value); }
+        void unhandled_exception() { result.set_exception(std::current_exception()); }
+    };
+    std::future<int> done;
+};
+
+static task round_trip(bsq_async_t *async, const float *src, bsq_method_t method, float *out) {
+    const int64_t size = bsq_compute_packed_size_1d(method, N);
+    std::vector<uint64_t> dst((size_t)(size + 7) / 8);
+    if (co_await bsq::compress_1d_into(async, src, N, method, dst.data(), size) != BSQ_JOB_DONE) co_return 1;
+    const bitsqueeze_buffer_t *buf = reinterpret_cast<const bitsqueeze_buffer_t *>(dst.data());
+    co_return co_await bsq::decompress(async, buf, out, N) == BSQ_JOB_DONE ? 0 : 1;
+}
+
+int main() {
+    float **inputs = gen_random_float_arrays(1, N, -3.0f, 3.0f, 8080);
+    std::vector<float> ref(N), out(N);
+    bsq_async_t *async = bsq_async_create(2, 1, 2, 0);
+    if (!inputs || !async) {
+        std::fprintf(stderr, "failed to set up\n");
+        return EXIT_FAILURE;
+    }
+
+    int failed = 0;
+    const bsq_method_t methods[] = {Q8_0, NVFP4, IQ2_XXS};
+    for (bsq_method_t method : methods) {
+        bitsqueeze_buffer_t *buf = nullptr;
+        if (round_trip(async, inputs[0], method, out.data()).done.get() != 0 ||
+            bsq_compress_1d(inputs[0], N, method, &buf, nullptr) || bsq_decompress(buf, ref.data(), N) ||
+            std::memcmp(ref.data(), out.data(), N * sizeof(float)) != 0) {
+            std::fprintf(stderr, "method %d: awaited round trip differs\n", method);
+            failed = 1;
+        }
+        bsq_free(buf);
+    }
+
+    bsq_async_destroy(async);
+    free_random_float_arrays(inputs, 1);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
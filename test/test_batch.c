@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bitsqueeze.h"
+#include "utils/random.h"
+
+#define TOKENS 16
+#define FEATURES 64
+#define SPARSE_RATIO 0.25f
+
+static const bsq_method_t METHODS_1D[] = {
+    Q8_0, Q4_0, Q2_K, Q2_K_FAST, BF16, FP16, FP8, FP4, MXFP8, MXFP4,
+    NVFP4, NF4, NF4_DQ, IQ2_XXS, IQ2_XS, IQ2_S
+};
+#define NUM_METHODS (sizeof(METHODS_1D) / sizeof(METHODS_1D[0]))
+/* Two tensors per method: one smaller than a block, one spanning many chunks with a partial tail. */
+#define NUM_TENSORS (2 * NUM_METHODS)
+
+static uint64_t tensor_size(size_t i) {
+    return i % 2 ? 100003 - (uint64_t)i * 5 : 7 + (uint64_t)i;
+}
+
+int main(void) {
+    const uint64_t max_n = tensor_size(1);
+    float **inputs = gen_random_float_arrays(NUM_TENSORS + 1, max_n, -6.0f, 6.0f, 4242);
+    bsq_compress_desc_t cdescs[NUM_TENSORS];
+    bsq_decompress_desc_t ddescs[NUM_TENSORS + 1];
+    bitsqueeze_buffer_t *refs[NUM_TENSORS + 1] = {0};
+    void *dsts[NUM_TENSORS] = {0};
+    float *outs[NUM_TENSORS + 1] = {0};
+    float *ref_out = (float *)malloc(max_n * sizeof(float));
+    if (!inputs || !ref_out) {
+        fprintf(stderr, "failed to allocate test buffers\n");
+        return EXIT_FAILURE;
+    }
+
+    int failed = 0;
+    for (size_t i = 0; i < NUM_TENSORS && !failed; ++i) {
+        const bsq_method_t method = METHODS_1D[i / 2];
+        const uint64_t n = tensor_size(i);
+        const float *im = method == Q2_K ? inputs[NUM_TENSORS] : NULL;
+        const int64_t size = bsq_compute_packed_size_1d(method, n);
+        dsts[i] = malloc((size_t)size);
+        outs[i] = (float *)malloc(n * sizeof(float));
+        if (!dsts[i] || !outs[i] || bsq_compress_1d(inputs[i], n, method, &refs[i], im)) {
+            fprintf(stderr, "tensor %zu: setup failed\n", i);
+            failed = 1;
+            break;
+        }
+        cdescs[i] = (bsq_compress_desc_t){inputs[i], n, method, im, dsts[i], size};
+    }
+
+    if (!failed && bsq_compress_batch(cdescs, NUM_TENSORS)) {
+        fprintf(stderr, "bsq_compress_batch failed\n");
+        failed = 1;
+    }
+    for (size_t i = 0; i < NUM_TENSORS && !failed; ++i) {
+        if (bsq_get_packed_size(refs[i]) != cdescs[i].dst_size) {
+            fprintf(stderr, "tensor %zu: packed size mismatch\n", i);
+            failed = 1;
+            break;
+        }
+        const bitsqueeze_buffer_t *batch = (const bitsqueeze_buffer_t *)dsts[i];
+        if (bsq_decompress(refs[i], ref_out, cdescs[i].num_elements) ||
+            bsq_decompress(batch, outs[i], cdescs[i].num_elements) ||
+            memcmp(ref_out, outs[i], cdescs[i].num_elements * sizeof(float)) != 0) {
+            fprintf(stderr, "tensor %zu (method %d): batch compression differs\n", i, refs[i]->method);
+            failed = 1;
+        }
+    }
+
+    /* Decompress the reference buffers plus a TOPK tensor in one batch. */
+    if (!failed) {
+        const uint64_t n = (uint64_t)TOKENS * FEATURES;
+        outs[NUM_TENSORS] = (float *)malloc(n * sizeof(float));
+        if (!outs[NUM_TENSORS] ||
+            bsq_compress_2d(inputs[NUM_TENSORS], TOKENS, FEATURES, SPARSE_RATIO, TOPK, &refs[NUM_TENSORS], NULL)) {
+            fprintf(stderr, "TOPK: setup failed\n");
+            failed = 1;
+        }
+        for (size_t i = 0; i <= NUM_TENSORS && !failed; ++i) {
+            const uint64_t count = i < NUM_TENSORS ? cdescs[i].num_elements : n;
+            memset(outs[i], 0xFF, count * sizeof(float));
+            ddescs[i] = (bsq_decompress_desc_t){refs[i], outs[i], count};
+        }
+        if (!failed && bsq_decompress_batch(ddescs, NUM_TENSORS + 1)) {
+            fprintf(stderr, "bsq_decompress_batch failed\n");
+            failed = 1;
+        }
+        for (size_t i = 0; i <= NUM_TENSORS && !failed; ++i) {
+            const uint64_t count = ddescs[i].dst_num_elements;
+            if (bsq_decompress(refs[i], ref_out, count) || memcmp(ref_out, outs[i], count * sizeof(float)) != 0) {
+                fprintf(stderr, "tensor %zu: batch decompression differs\n", i);
+                failed = 1;
+            }
+        }
+    }
+
+    /* A bad descriptor fails the whole call; an empty batch is a no-op. */
+    if (!failed) {
+        bsq_compress_desc_t bad = cdescs[0];
+        bad.dst_size -= 1;
+        bsq_decompress_desc_t short_dst = ddescs[1];
+        short_dst.dst_num_elements -= 1;
+        if (bsq_compress_batch(&bad, 1) == 0 || bsq_decompress_batch(&short_dst, 1) == 0 ||
+            bsq_compress_batch(NULL, 0) != 0 || bsq_decompress_batch(NULL, 1) == 0) {
+            fprintf(stderr, "argument checks failed\n");
+            failed = 1;
+        }
+    }
+
+    for (size_t i = 0; i <= NUM_TENSORS; ++i) {
+        bsq_free(refs[i]);
+        free(outs[i]);
+        if (i < NUM_TENSORS) free(dsts[i]);
+    }
+    free(ref_out);
+    free_random_float_arrays(inputs, NUM_TENSORS + 1);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,187 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "bitsqueeze.h"
+#include "utils/random.h"
+#include "utils/evaluation.h"
+
+#define WORLD 4
+#define N ((1u << 19) + 1000)    /* not a multiple of the segment or chunk size */
+#define TOKENS 64
+#define FEATURES 1024
+#define MAX_CASES 16
+
+static const struct {
+    bsq_method_t method;
+    double       max_error;      /* relative L2 error of the sum */
+} REDUCE_CASES[] = {{FP16, 1e-3}, {Q8_0, 2e-2}, {Q4_0, 2e-1}};
+
+/* What every rank reports per case, for the parent to compare across ranks. */
+typedef struct {
+    uint64_t hash[MAX_CASES][WORLD];
+} results_t;
+
+static uint64_t _hash(const float *data, uint64_t n) {
+    const uint8_t *bytes = (const uint8_t *)data;
+    uint64_t h = 1469598103934665603ull;
+    for (uint64_t i = 0; i < n * sizeof(float); ++i) h = (h ^ bytes[i]) * 1099511628211ull;
+    return h;
+}
+
+static float *_rank_data(uint32_t rank) {
+    float **arrays = gen_random_float_arrays(1, N, -1.0f, 1.0f, 2300 + rank);
+    if (!arrays) return NULL;
+    float *data = arrays[0];
+    free(arrays);
+    return data;
+}
+
+/* Every rank's input, compressed the way rank compresses its own for all-gather. */
+static bitsqueeze_buffer_t *_rank_buffer(uint32_t rank, int sparse) {
+    float *data = _rank_data(rank);
+    bitsqueeze_buffer_t *buf = NULL;
+    const int failed = !data || (sparse ? bsq_compress_2d(data, TOKENS, FEATURES, 0.05f, TOPK, &buf, NULL)
+                                        : bsq_compress_1d(data, N, Q4_0, &buf, NULL));
+    free(data);
+    return failed ? NULL : buf;
+}
+
+static int _run_rank(bsq_transport_kind_t transport, const char *address, uint32_t rank, results_t *results) {
+    bsq_comm_t *comm = bsq_comm_create(transport, address, rank, WORLD);
+    float *data = (float *)malloc(N * sizeof(float));
+    float *expect = (float *)calloc(N, sizeof(float));
+    float *gathered = (float *)malloc((uint64_t)WORLD * N * sizeof(float));
+    float *decoded = (float *)malloc(N * sizeof(float));
+    if (!comm || !data || !expect || !gathered || !decoded || bsq_comm_rank(comm) != rank ||
+        bsq_comm_size(comm) != WORLD) {
+        fprintf(stderr, "rank %u: setup failed\n", rank);
+        return 1;
+    }
+    for (uint32_t r = 0; r < WORLD; ++r) {
+        float *other = _rank_data(r);
+        if (!other) return 1;
+        for (uint64_t i = 0; i < N; ++i) expect[i] += other[i];
+        free(other);
+    }
+
+    int failed = 0;
+    uint32_t c = 0;
+    const bsq_collective_algo_t algos[] = {BSQ_COLLECTIVE_RING, BSQ_COLLECTIVE_TREE};
+    for (int a = 0; a < 2 && !failed; ++a) {
+        for (size_t m = 0; m < sizeof(REDUCE_CASES) / sizeof(REDUCE_CASES[0]) && !failed; ++m, ++c) {
+            float *own = _rank_data(rank);
+            if (!own) return 1;
+            memcpy(data, own, N * sizeof(float));
+            free(own);
+            const double t0 = get_time_ms();
+            if (bsq_allreduce(comm, data, N, REDUCE_CASES[m].method, algos[a])) {
+                fprintf(stderr, "rank %u: allreduce %d/%d failed\n", rank, algos[a], REDUCE_CASES[m].method);
+                failed = 1;
+                break;
+            }
+            const double elapsed = get_time_ms() - t0;
+            double err = 0.0, norm = 0.0;
+            for (uint64_t i = 0; i < N; ++i) {
+                err += ((double)data[i] - expect[i]) * ((double)data[i] - expect[i]);
+                norm += (double)expect[i] * expect[i];
+            }
+            if (sqrt(err / norm) > REDUCE_CASES[m].max_error) {
+                fprintf(stderr, "rank %u: allreduce %d/%d error %f\n", rank, algos[a], REDUCE_CASES[m].method,
+                        sqrt(err / norm));
+                failed = 1;
+            }
+            if (rank == 0) {
+                printf("[transport %d, algo %d, method %d] allreduce=%.3f ms, error %.5f\n", transport, algos[a],
+                       REDUCE_CASES[m].method, elapsed, sqrt(err / norm));
+            }
+            results->hash[c][rank] = _hash(data, N);
+        }
+
+        /* Each slot of the gathered tensor must decode exactly like the owning rank's buffer. */
+        for (int sparse = 0; sparse < 2 && !failed; ++sparse) {
+            const uint64_t n = sparse ? (uint64_t)TOKENS * FEATURES : N;
+            bitsqueeze_buffer_t *buf = _rank_buffer(rank, sparse);
+            failed = !buf || bsq_allgather(comm, buf, gathered, (uint64_t)WORLD * n, algos[a]);
+            bsq_free(buf);
+            for (uint32_t r = 0; r < WORLD && !failed; ++r) {
+                bitsqueeze_buffer_t *other = _rank_buffer(r, sparse);
+                failed = !other || bsq_decompress(other, decoded, n) ||
+                         memcmp(decoded, gathered + (uint64_t)r * n, n * sizeof(float)) != 0;
+                bsq_free(other);
+            }
+            if (failed) fprintf(stderr, "rank %u: allgather %d (sparse %d) differs\n", rank, algos[a], sparse);
+        }
+    }
+
+    free(data);
+    free(expect);
+    free(gathered);
+    free(decoded);
+    bsq_comm_free(comm);
+    return failed;
+}
+
+/* Run one group as WORLD forked processes; every rank must succeed and agree bit for bit. */
+static int _run_group(bsq_transport_kind_t transport, const char *address) {
+    results_t *results = (results_t *)mmap(NULL, sizeof(results_t), PROT_READ | PROT_WRITE,
+                                           MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (results == MAP_FAILED) return 1;
+    memset(results, 0, sizeof(results_t));
+
+    fflush(stdout);
+    pid_t pids[WORLD];
+    for (uint32_t rank = 0; rank < WORLD; ++rank) {
+        pids[rank] = fork();
+        if (pids[rank] == 0) {
+            const int rc = _run_rank(transport, address, rank, results);
+            fflush(stdout);
+            _exit(rc ? EXIT_FAILURE : EXIT_SUCCESS);
+        }
+    }
+
+    int failed = 0;
+    for (uint32_t rank = 0; rank < WORLD; ++rank) {
+        int status = 0;
+        if (pids[rank] < 0 || waitpid(pids[rank], &status, 0) != pids[rank] || !WIFEXITED(status) ||
+            WEXITSTATUS(status) != 0) {
+            fprintf(stderr, "transport %d: rank %u failed\n", transport, rank);
+            failed = 1;
+        }
+    }
+    for (uint32_t c = 0; c < MAX_CASES && !failed; ++c) {
+        for (uint32_t rank = 1; rank < WORLD; ++rank) {
+            if (results->hash[c][rank] != results->hash[c][0]) {
+                fprintf(stderr, "transport %d: case %u differs between ranks\n", transport, c);
+                failed = 1;
+            }
+        }
+    }
+    munmap(results, sizeof(results_t));
+    return failed;
+}
+
+int main(void) {
+    char shm_name[64];
+    char tcp_address[64];
+    snprintf(shm_name, sizeof(shm_name), "/bsq-test-collective-%d", (int)getpid());
+    snprintf(tcp_address, sizeof(tcp_address), "127.0.0.1:%d", 20000 + (int)(getpid() % 20000));
+
+    int failed = _run_group(BSQ_TRANSPORT_SHM, shm_name) || _run_group(BSQ_TRANSPORT_TCP, tcp_address);
+
+    /* A group of one needs no transport; all-reduce leaves data alone. */
+    bsq_comm_t *solo = bsq_comm_create(BSQ_TRANSPORT_TCP, "unused", 0, 1);
+    float x[4] = {1.0f, 2.0f, 3.0f, 4.0f};
+    if (!solo || bsq_allreduce(solo, x, 4, Q8_0, BSQ_COLLECTIVE_RING) || x[2] != 3.0f ||
+        bsq_allreduce(solo, x, 4, TOPK, BSQ_COLLECTIVE_RING) == 0 || bsq_comm_create(BSQ_TRANSPORT_SHM, "/x", 2, 2)) {
+        fprintf(stderr, "argument checks failed\n");
+        failed = 1;
+    }
+    bsq_comm_free(solo);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
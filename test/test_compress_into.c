@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bitsqueeze.h"
+#include "utils/random.h"
+
+#define N 4099            /* odd and not a multiple of any block size */
+#define TOKENS 16
+#define FEATURES 96
+#define SPARSE_RATIO 0.1f
+
+static const bsq_method_t METHODS_1D[] = {
+    Q8_0, Q4_0, Q2_K, Q2_K_FAST, BF16, FP16, FP8, FP4, MXFP8, MXFP4,
+    NVFP4, NF4, NF4_DQ, IQ2_XXS, IQ2_XS, IQ2_S
+};
+
+static int same_output(const bitsqueeze_buffer_t *a,
+                       const bitsqueeze_buffer_t *b,
+                       uint64_t n,
+                       float *out_a,
+                       float *out_b) {
+    if (bsq_decompress(a, out_a, n) || bsq_decompress(b, out_b, n)) return 0;
+    return memcmp(out_a, out_b, n * sizeof(float)) == 0;
+}
+
+int main(void) {
+    float **inputs = gen_random_float_arrays(2, N, -10.0f, 10.0f, 12345);
+    float *out_a = (float *)malloc(N * sizeof(float));
+    float *out_b = (float *)malloc(N * sizeof(float));
+    if (!inputs || !out_a || !out_b) {
+        fprintf(stderr, "failed to allocate test buffers\n");
+        return EXIT_FAILURE;
+    }
+
+    int failed = 0;
+    const size_t num_methods = sizeof(METHODS_1D) / sizeof(METHODS_1D[0]);
+    for (size_t m = 0; m < num_methods && !failed; ++m) {
+        const bsq_method_t method = METHODS_1D[m];
+
+        bitsqueeze_buffer_t *ref = NULL;
+        if (bsq_compress_1d(inputs[0], N, method, &ref, NULL) || !ref) {
+            fprintf(stderr, "method %d: bsq_compress_1d failed\n", method);
+            failed = 1;
+            break;
+        }
+
+        const int64_t size = bsq_compute_packed_size_1d(method, N);
+        if (size != bsq_get_packed_size(ref)) {
+            fprintf(stderr, "method %d: size query %lld != packed size %lld\n",
+                    method, (long long)size, (long long)bsq_get_packed_size(ref));
+            failed = 1;
+        }
+
+        /* Dirty caller memory must not leak into the result. */
+        uint64_t *mem = (uint64_t *)malloc((size_t)size);
+        if (!failed && !mem) failed = 1;
+        if (!failed) {
+            memset(mem, 0xAB, (size_t)size);
+            if (bsq_compress_1d_into(inputs[0], N, method, mem, size - 1, NULL) == 0) {
+                fprintf(stderr, "method %d: undersized destination accepted\n", method);
+                failed = 1;
+            } else if (bsq_compress_1d_into(inputs[0], N, method, mem, size, NULL) ||
+                       !same_output(ref, (bitsqueeze_buffer_t *)mem, N, out_a, out_b)) {
+                fprintf(stderr, "method %d: compress_into mismatch\n", method);
+                failed = 1;
+            }
+        }
+
+        /* Re-use both the caller memory and the library-allocated buffer for a new tensor. */
+        if (!failed) {
+            bitsqueeze_buffer_t *ref2 = NULL;
+            if (bsq_compress_1d(inputs[1], N, method, &ref2, NULL) ||
+                bsq_compress_1d_into(inputs[1], N, method, mem, size, NULL) ||
+                bsq_compress_1d_into(inputs[1], N, method, ref, bsq_get_packed_size(ref), NULL) ||
+                !same_output(ref2, (bitsqueeze_buffer_t *)mem, N, out_a, out_b) ||
+                !same_output(ref2, ref, N, out_a, out_b)) {
+                fprintf(stderr, "method %d: re-use mismatch\n", method);
+                failed = 1;
+            }
+            bsq_free(ref2);
+        }
+
+        free(mem);
+        bsq_free(ref);
+    }
+
+    if (!failed) {
+        const uint64_t n2d = (uint64_t)TOKENS * FEATURES;
+        bitsqueeze_buffer_t *ref = NULL;
+        const int64_t size = bsq_compute_packed_size_2d(TOPK, TOKENS, FEATURES, SPARSE_RATIO);
+        uint64_t *mem = (uint64_t *)malloc((size_t)size);
+
+        if (!mem || bsq_compress_2d(inputs[0], TOKENS, FEATURES, SPARSE_RATIO, TOPK, &ref, NULL) || !ref) {
+            fprintf(stderr, "TOPK: setup failed\n");
+            failed = 1;
+        } else {
+            memset(mem, 0xAB, (size_t)size);
+            if (size != bsq_get_packed_size(ref) ||
+                bsq_compress_2d_into(inputs[0], TOKENS, FEATURES, SPARSE_RATIO, TOPK, mem, size, NULL) ||
+                !same_output(ref, (bitsqueeze_buffer_t *)mem, n2d, out_a, out_b)) {
+                fprintf(stderr, "TOPK: compress_into mismatch\n");
+                failed = 1;
+            }
+        }
+        if (bsq_compute_packed_size_1d(TOPK, N) != 0 || bsq_compute_packed_size_2d(Q8_0, TOKENS, FEATURES, SPARSE_RATIO) != 0) {
+            fprintf(stderr, "size query accepted a method of the wrong rank\n");
+            failed = 1;
+        }
+
+        free(mem);
+        bsq_free(ref);
+    }
+
+    free(out_a);
+    free(out_b);
+    free_random_float_arrays(inputs, 2);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bitsqueeze.h"
+#include "utils/random.h"
+
+#define PATH "test_container.bsqc"
+#define NUM_TENSORS 64
+#define N 1000
+#define TOKENS 8
+#define FEATURES 64
+#define SPARSE_RATIO 0.25f
+
+static const bsq_method_t METHODS_1D[] = {
+    Q8_0, Q4_0, Q2_K, Q2_K_FAST, BF16, FP16, FP8, FP4, MXFP8, MXFP4,
+    NVFP4, NF4, NF4_DQ, IQ2_XXS, IQ2_XS, IQ2_S
+};
+
+static int same_output(const bitsqueeze_buffer_t *a, const bitsqueeze_buffer_t *b,
+                       uint64_t n, float *out_a, float *out_b) {
+    if (bsq_decompress(a, out_a, n) || bsq_decompress(b, out_b, n)) return 0;
+    return memcmp(out_a, out_b, n * sizeof(float)) == 0;
+}
+
+int main(void) {
+    const size_t num_methods = sizeof(METHODS_1D) / sizeof(METHODS_1D[0]);
+    float **inputs = gen_random_float_arrays(NUM_TENSORS, N, -4.0f, 4.0f, 99);
+    float *out_a = (float *)malloc(N * sizeof(float));
+    float *out_b = (float *)malloc(N * sizeof(float));
+    bitsqueeze_buffer_t *bufs[NUM_TENSORS] = {0};
+    uint64_t sizes[NUM_TENSORS];
+    if (!inputs || !out_a || !out_b) {
+        fprintf(stderr, "failed to allocate test buffers\n");
+        return EXIT_FAILURE;
+    }
+
+    int failed = 0;
+    bsq_container_writer_t *writer = bsq_container_writer_open(PATH);
+    if (!writer) {
+        fprintf(stderr, "bsq_container_writer_open failed\n");
+        failed = 1;
+    }
+
+    /* Last tensor is TOPK, the rest cycle through the 1D methods with varying lengths. */
+    for (int i = 0; i < NUM_TENSORS && !failed; ++i) {
+        char name[32];
+        snprintf(name, sizeof(name), "layers.%d.weight", i);
+        int rc;
+        if (i == NUM_TENSORS - 1) {
+            sizes[i] = (uint64_t)TOKENS * FEATURES;
+            rc = bsq_compress_2d(inputs[i], TOKENS, FEATURES, SPARSE_RATIO, TOPK, &bufs[i], NULL);
+        } else {
+            sizes[i] = N - (uint64_t)i * 7;
+            rc = bsq_compress_1d(inputs[i], sizes[i], METHODS_1D[i % num_methods], &bufs[i], NULL);
+        }
+        if (rc || bsq_container_writer_add(writer, name, bufs[i])) {
+            fprintf(stderr, "tensor %d: add failed\n", i);
+            failed = 1;
+        }
+    }
+    if (writer && bsq_container_writer_close(writer)) {
+        fprintf(stderr, "bsq_container_writer_close failed\n");
+        failed = 1;
+    }
+
+    bsq_container_t *container = failed ? NULL : bsq_container_open(PATH);
+    if (!failed && (!container || bsq_container_num_tensors(container) != NUM_TENSORS)) {
+        fprintf(stderr, "bsq_container_open failed\n");
+        failed = 1;
+    }
+
+    /* Look tensors up in reverse order to exercise the name table rather than file order. */
+    for (int i = NUM_TENSORS - 1; i >= 0 && !failed; --i) {
+        char name[32];
+        snprintf(name, sizeof(name), "layers.%d.weight", i);
+        const int64_t index = bsq_container_find(container, name);
+
+        bsq_method_t method;
+        bsq_shape_t shape;
+        bsq_view_t view;
+        bitsqueeze_buffer_t *loaded = NULL;
+        if (index < 0 || strcmp(bsq_container_name(container, (uint32_t)index), name) != 0 ||
+            bsq_container_info(container, (uint32_t)index, &method, &shape) ||
+            method != bufs[i]->method || shape.num_elements != bufs[i]->shape.num_elements) {
+            fprintf(stderr, "tensor %d: index lookup mismatch\n", i);
+            failed = 1;
+        } else if (bsq_container_prefetch(container, (uint32_t)index) ||
+                   bsq_container_view(container, (uint32_t)index, &view) ||
+                   !same_output(bufs[i], &view.buf, sizes[i], out_a, out_b) ||
+                   bsq_container_evict(container, (uint32_t)index)) {
+            fprintf(stderr, "tensor %d: view mismatch\n", i);
+            failed = 1;
+        } else if (!(loaded = bsq_container_load(container, (uint32_t)index)) ||
+                   !same_output(bufs[i], loaded, sizes[i], out_a, out_b)) {
+            fprintf(stderr, "tensor %d: load mismatch\n", i);
+            failed = 1;
+        }
+        bsq_free(loaded);
+    }
+
+    if (!failed && (bsq_container_find(container, "layers.999.weight") != -1 ||
+                    bsq_container_name(container, NUM_TENSORS) != NULL)) {
+        fprintf(stderr, "lookup of a missing tensor succeeded\n");
+        failed = 1;
+    }
+    bsq_container_close(container);
+
+    /* A file cut short before its index must not open. */
+    if (!failed) {
+        FILE *fp = fopen(PATH, "r+b");
+        uint8_t header[64];
+        if (!fp || fread(header, 1, sizeof(header), fp) != sizeof(header)) {
+            failed = 1;
+        }
+        if (fp) fclose(fp);
+        fp = failed ? NULL : fopen(PATH, "wb");
+        if (fp) {
+            fwrite(header, 1, sizeof(header), fp);
+            fclose(fp);
+            container = bsq_container_open(PATH);
+            if (container) {
+                fprintf(stderr, "truncated container opened\n");
+                bsq_container_close(container);
+                failed = 1;
+            }
+        }
+    }
+
+    remove(PATH);
+    for (int i = 0; i < NUM_TENSORS; ++i) bsq_free(bufs[i]);
+    free(out_a);
+    free(out_b);
+    free_random_float_arrays(inputs, NUM_TENSORS);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
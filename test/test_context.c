@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__linux__) && defined(_OPENMP)
+#include <omp.h>
+#endif
+
+#include "bitsqueeze.h"
+#include "utils/random.h"
+
+#define N 4099
+#define TOKENS 64
+#define FEATURES 128
+#define SPARSE_RATIO 0.1f
+#define REPEATS 3
+
+static const bsq_method_t METHODS_1D[] = {
+    Q8_0, Q4_0, Q2_K, Q2_K_FAST, BF16, FP16, FP8, FP4, MXFP8, MXFP4,
+    NVFP4, NF4, NF4_DQ, IQ2_XXS, IQ2_XS, IQ2_S
+};
+
+static int max_threads(void) {
+#if defined(__linux__) && defined(_OPENMP)
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+/* Compress through ctx into dst and require the output of the plain calls. */
+static int check_1d(bsq_ctx_t *ctx, const float *src, bsq_method_t method, void *dst, int64_t size, float *out) {
+    bitsqueeze_buffer_t *ref = NULL;
+    float *ref_out = (float *)malloc(N * sizeof(float));
+    int failed = !ref_out || bsq_compress_1d(src, N, method, &ref, NULL) || bsq_decompress(ref, ref_out, N) ||
+                 bsq_ctx_compress_1d_into(ctx, src, N, method, dst, size, NULL) ||
+                 bsq_ctx_decompress(ctx, (bitsqueeze_buffer_t *)dst, out, N) ||
+                 memcmp(ref_out, out, N * sizeof(float)) != 0 ||
+                 bsq_ctx_decompress_range(ctx, (bitsqueeze_buffer_t *)dst, 100, 300, out) ||
+                 memcmp(ref_out + 100, out, 300 * sizeof(float)) != 0;
+    bsq_free(ref);
+    free(ref_out);
+    return failed;
+}
+
+int main(void) {
+    const uint64_t n2d = (uint64_t)TOKENS * FEATURES;
+    float **inputs = gen_random_float_arrays(2, n2d, -10.0f, 10.0f, 4242);
+    float *out = (float *)malloc(n2d * sizeof(float));
+    float *ref_out = (float *)malloc(n2d * sizeof(float));
+    bsq_ctx_t *ctx = bsq_ctx_create(2);
+    if (!inputs || !out || !ref_out || !ctx) {
+        fprintf(stderr, "failed to allocate test buffers\n");
+        return EXIT_FAILURE;
+    }
+
+    int failed = 0;
+    const int threads_before = max_threads();
+    const size_t num_methods = sizeof(METHODS_1D) / sizeof(METHODS_1D[0]);
+    for (size_t m = 0; m < num_methods && !failed; ++m) {
+        const int64_t size = bsq_compute_packed_size_1d(METHODS_1D[m], N);
+        void *dst = aligned_alloc(8, (size_t)(size + 7) / 8 * 8);
+        if (!dst || check_1d(ctx, inputs[0], METHODS_1D[m], dst, size, out)) {
+            fprintf(stderr, "method %d: context output differs\n", METHODS_1D[m]);
+            failed = 1;
+        }
+        free(dst);
+    }
+
+    /* The sparse codecs draw their heaps from the context: one sizing, then reuse. */
+    const bsq_method_t methods_2d[] = {TOPK, TOPK_IM};
+    for (int m = 0; m < 2 && !failed; ++m) {
+        const float *im = methods_2d[m] == TOPK_IM ? inputs[1] : NULL;
+        const int64_t size = bsq_compute_packed_size_2d(methods_2d[m], TOKENS, FEATURES, SPARSE_RATIO);
+        void *dst = aligned_alloc(8, (size_t)(size + 7) / 8 * 8);
+        bitsqueeze_buffer_t *ref = NULL;
+        if (!dst || bsq_compress_2d(inputs[0], TOKENS, FEATURES, SPARSE_RATIO, methods_2d[m], &ref, im) ||
+            bsq_decompress(ref, ref_out, n2d)) {
+            fprintf(stderr, "method %d: setup failed\n", methods_2d[m]);
+            failed = 1;
+        }
+
+        uint64_t scratch = 0;
+        for (int r = 0; r < REPEATS && !failed; ++r) {
+            const uint16_t rows[] = {7, 0, 63};
+            if (bsq_ctx_compress_2d_into(ctx, inputs[0], TOKENS, FEATURES, SPARSE_RATIO, methods_2d[m],
+                                         dst, size, im) ||
+                bsq_ctx_decompress(ctx, (bitsqueeze_buffer_t *)dst, out, n2d) ||
+                memcmp(ref_out, out, n2d * sizeof(float)) != 0 ||
+                bsq_ctx_decompress_rows(ctx, (bitsqueeze_buffer_t *)dst, rows, 3, out, 3 * FEATURES) ||
+                memcmp(ref_out + 7 * FEATURES, out, FEATURES * sizeof(float)) != 0) {
+                fprintf(stderr, "method %d: context output differs\n", methods_2d[m]);
+                failed = 1;
+            } else if (r == 0) {
+                scratch = bsq_ctx_scratch_bytes(ctx);
+                if (scratch == 0) {
+                    fprintf(stderr, "method %d: no scratch recorded\n", methods_2d[m]);
+                    failed = 1;
+                }
+            } else if (bsq_ctx_scratch_bytes(ctx) != scratch) {
+                fprintf(stderr, "method %d: scratch regrown on a repeated shape\n", methods_2d[m]);
+                failed = 1;
+            }
+        }
+        bsq_free(ref);
+        free(dst);
+    }
+
+    if (!failed && max_threads() != threads_before) {
+        fprintf(stderr, "context leaked its thread count\n");
+        failed = 1;
+    }
+
+    if (!failed) {
+        const int cpus[] = {0};
+        bsq_ctx_t *pinned = bsq_ctx_create(0);
+        const int64_t size = bsq_compute_packed_size_1d(Q8_0, N);
+        void *dst = aligned_alloc(8, (size_t)(size + 7) / 8 * 8);
+#if defined(__linux__)
+        const int affinity_ok = pinned && bsq_ctx_set_affinity(pinned, cpus, 1) == 0;
+#else
+        const int affinity_ok = pinned && bsq_ctx_set_affinity(pinned, cpus, 1) != 0;
+#endif
+        if (!dst || !affinity_ok || check_1d(pinned, inputs[0], Q8_0, dst, size, out) ||
+            bsq_ctx_create(-1) != NULL || bsq_ctx_compress_1d_into(NULL, inputs[0], N, Q8_0, dst, size, NULL) == 0 ||
+            bsq_ctx_set_affinity(pinned, cpus, 0) == 0) {
+            fprintf(stderr, "argument or affinity checks failed\n");
+            failed = 1;
+        }
+        free(dst);
+        bsq_ctx_free(pinned);
+    }
+
+    bsq_ctx_free(ctx);
+    free(out);
+    free(ref_out);
+    free_random_float_arrays(inputs, 2);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
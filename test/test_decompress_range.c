@@ -0,0 +1,81 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bitsqueeze.h"
+#include "utils/random.h"
+
+#define N 4099            /* odd and not a multiple of any block size */
+#define CANARY -12345.0f
+
+static const bsq_method_t METHODS_1D[] = {
+    Q8_0, Q4_0, Q2_K, Q2_K_FAST, BF16, FP16, FP8, FP4, MXFP8, MXFP4,
+    NVFP4, NF4, NF4_DQ, IQ2_XXS, IQ2_XS, IQ2_S
+};
+
+/* Head/tail partial blocks for every block size in use (16, 32, 64, 256), single elements and the full range. */
+static const uint64_t RANGES[][2] = {
+    {0, N}, {0, 1}, {N - 1, 1}, {0, 0}, {N, 0},
+    {1, 14}, {15, 2}, {31, 34}, {63, 130}, {255, 2}, {100, 3000}, {256, 512}, {3840, N - 3840}, {17, N - 17}
+};
+
+int main(void) {
+    float **inputs = gen_random_float_arrays(1, N, -10.0f, 10.0f, 2024);
+    float *ref = (float *)malloc(N * sizeof(float));
+    float *out = (float *)malloc((N + 1) * sizeof(float));
+    if (!inputs || !ref || !out) {
+        fprintf(stderr, "failed to allocate test buffers\n");
+        return EXIT_FAILURE;
+    }
+
+    int failed = 0;
+    const size_t num_methods = sizeof(METHODS_1D) / sizeof(METHODS_1D[0]);
+    const size_t num_ranges = sizeof(RANGES) / sizeof(RANGES[0]);
+    for (size_t m = 0; m < num_methods && !failed; ++m) {
+        const bsq_method_t method = METHODS_1D[m];
+        bitsqueeze_buffer_t *buf = NULL;
+        if (bsq_compress_1d(inputs[0], N, method, &buf, NULL) || !buf || bsq_decompress(buf, ref, N)) {
+            fprintf(stderr, "method %d: setup failed\n", method);
+            failed = 1;
+            bsq_free(buf);
+            break;
+        }
+
+        for (size_t r = 0; r < num_ranges && !failed; ++r) {
+            const uint64_t offset = RANGES[r][0];
+            const uint64_t count = RANGES[r][1];
+            for (uint64_t i = 0; i <= count; ++i) out[i] = CANARY;
+
+            if (bsq_decompress_range(buf, offset, count, out) ||
+                memcmp(out, ref + offset, count * sizeof(float)) != 0 || out[count] != CANARY) {
+                fprintf(stderr, "method %d: range [%llu, +%llu) mismatch\n",
+                        method, (unsigned long long)offset, (unsigned long long)count);
+                failed = 1;
+            }
+        }
+
+        if (!failed && (bsq_decompress_range(buf, N - 1, 2, out) == 0 ||
+                        bsq_decompress_range(buf, N + 1, 0, out) == 0 ||
+                        bsq_decompress_range(buf, 1, UINT64_MAX, out) == 0)) {
+            fprintf(stderr, "method %d: out-of-bounds range accepted\n", method);
+            failed = 1;
+        }
+        bsq_free(buf);
+    }
+
+    if (!failed) {
+        bitsqueeze_buffer_t *buf = NULL;
+        if (bsq_compress_2d(inputs[0], 8, 64, 0.25f, TOPK, &buf, NULL) || !buf ||
+            bsq_decompress_range(buf, 0, 8, out) == 0) {
+            fprintf(stderr, "TOPK: range decompression should be rejected\n");
+            failed = 1;
+        }
+        bsq_free(buf);
+    }
+
+    free(ref);
+    free(out);
+    free_random_float_arrays(inputs, 1);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bitsqueeze.h"
+#include "utils/random.h"
+
+#define TOKENS 64
+#define FEATURES 128
+#define SPARSE_RATIO 0.1f
+
+int main(void) {
+    const uint64_t n = (uint64_t)TOKENS * FEATURES;
+    /* Out of order, repeated, and both ends of the token range. */
+    const uint16_t rows[] = {63, 0, 5, 5, 40, 62};
+    const uint32_t num_rows = sizeof(rows) / sizeof(rows[0]);
+
+    float **inputs = gen_random_float_arrays(2, n, -10.0f, 10.0f, 555);
+    float *ref = (float *)malloc(n * sizeof(float));
+    float *out = (float *)malloc(num_rows * FEATURES * sizeof(float));
+    if (!inputs || !ref || !out) {
+        fprintf(stderr, "failed to allocate test buffers\n");
+        return EXIT_FAILURE;
+    }
+
+    int failed = 0;
+    const bsq_method_t methods[] = {TOPK, TOPK_IM};
+    for (int m = 0; m < 2 && !failed; ++m) {
+        bitsqueeze_buffer_t *buf = NULL;
+        const float *im = methods[m] == TOPK_IM ? inputs[1] : NULL;
+        if (bsq_compress_2d(inputs[0], TOKENS, FEATURES, SPARSE_RATIO, methods[m], &buf, im) || !buf ||
+            bsq_decompress(buf, ref, n)) {
+            fprintf(stderr, "method %d: setup failed\n", methods[m]);
+            bsq_free(buf);
+            failed = 1;
+            break;
+        }
+
+        /* Dirty output: rows must be fully rewritten, including the dropped features. */
+        memset(out, 0xFF, num_rows * FEATURES * sizeof(float));
+        if (bsq_decompress_rows(buf, rows, num_rows, out, (uint64_t)num_rows * FEATURES)) {
+            fprintf(stderr, "method %d: bsq_decompress_rows failed\n", methods[m]);
+            failed = 1;
+        }
+        for (uint32_t r = 0; r < num_rows && !failed; ++r) {
+            if (memcmp(out + (uint64_t)r * FEATURES, ref + (uint64_t)rows[r] * FEATURES, FEATURES * sizeof(float)) != 0) {
+                fprintf(stderr, "method %d: row %u (token %u) mismatch\n", methods[m], r, rows[r]);
+                failed = 1;
+            }
+        }
+
+        const uint16_t bad_rows[] = {1, TOKENS};
+        if (!failed && (bsq_decompress_rows(buf, bad_rows, 2, out, 2 * FEATURES) == 0 ||
+                        bsq_decompress_rows(buf, rows, num_rows, out, (uint64_t)num_rows * FEATURES - 1) == 0 ||
+                        bsq_decompress_rows(buf, rows, 0, out, 0) != 0)) {
+            fprintf(stderr, "method %d: argument checks failed\n", methods[m]);
+            failed = 1;
+        }
+        bsq_free(buf);
+    }
+
+    if (!failed) {
+        bitsqueeze_buffer_t *buf = NULL;
+        if (bsq_compress_1d(inputs[0], n, Q8_0, &buf, NULL) || !buf ||
+            bsq_decompress_rows(buf, rows, 1, out, FEATURES) == 0) {
+            fprintf(stderr, "Q8_0: row decompression should be rejected\n");
+            failed = 1;
+        }
+        bsq_free(buf);
+    }
+
+    free(ref);
+    free(out);
+    free_random_float_arrays(inputs, 2);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
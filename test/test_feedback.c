@@ -0,0 +1,117 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bitsqueeze.h"
+#include "utils/random.h"
+
+#define TOKENS 64
+#define FEATURES 1024
+#define N ((uint64_t)TOKENS * FEATURES)
+#define STEPS 50
+
+/* IQ2_XXS first, so its tables are built cold inside bsq_feedback_compress. */
+static const bsq_method_t METHODS[] = {IQ2_XXS, Q8_0, Q4_0, Q2_K_FAST, MXFP4, FP8, NVFP4, TOPK, TOPK_IM};
+
+static bsq_feedback_t *create(bsq_method_t method) {
+    return method == TOPK || method == TOPK_IM ? bsq_feedback_create_2d(method, TOKENS, FEATURES, 0.01f)
+                                               : bsq_feedback_create_1d(method, N);
+}
+
+/* Relative L2 distance between what was sent over STEPS and what STEPS constant gradients add up to. */
+static double drift(const double *sent, const float *grad) {
+    double err = 0.0, norm = 0.0;
+    for (uint64_t i = 0; i < N; ++i) {
+        const double expect = (double)STEPS * grad[i];
+        err += (sent[i] - expect) * (sent[i] - expect);
+        norm += expect * expect;
+    }
+    return sqrt(err / norm);
+}
+
+/* Every call must leave residual == (old residual + grad) - decoded exactly, and carrying the error must
+ * track the running sum of a constant gradient better than compressing each step on its own. */
+static int run(bsq_method_t method, float **inputs, float *expect, float *decoded, double *sent, double *plain) {
+    bsq_feedback_t *fb = create(method);
+    if (!fb) return 1;
+
+    const float *grad = inputs[0];
+    const float *im = inputs[1];
+    int failed = 0;
+    memset(sent, 0, N * sizeof(double));
+    memset(plain, 0, N * sizeof(double));
+    for (int step = 0; step < STEPS && !failed; ++step) {
+        const bitsqueeze_buffer_t *out = NULL;
+        const float *residual = bsq_feedback_residual(fb);
+        for (uint64_t i = 0; i < N; ++i) expect[i] = residual[i] + grad[i];
+        if (bsq_feedback_compress(fb, grad, im, &out) || bsq_decompress(out, decoded, N)) {
+            failed = 1;
+            break;
+        }
+        for (uint64_t i = 0; i < N && !failed; ++i) {
+            failed = residual[i] != expect[i] - decoded[i];
+            sent[i] += decoded[i];
+        }
+    }
+
+    bitsqueeze_buffer_t *once = NULL;
+    const int sparse = method == TOPK || method == TOPK_IM;
+    if (!failed && (sparse ? bsq_compress_2d(grad, TOKENS, FEATURES, 0.01f, method, &once, im)
+                           : bsq_compress_1d(grad, N, method, &once, NULL))) {
+        failed = 1;
+    }
+    if (!failed && bsq_decompress(once, decoded, N) == 0) {
+        for (uint64_t i = 0; i < N; ++i) plain[i] = (double)STEPS * decoded[i];
+        const double with = drift(sent, grad), without = drift(plain, grad);
+        printf("[method %d] drift after %d steps: %.4f with feedback, %.4f without\n", method, STEPS, with,
+               without);
+        failed = with > without;
+    }
+    bsq_free(once);
+
+    bsq_feedback_reset(fb);
+    for (uint64_t i = 0; i < N && !failed; ++i) failed = bsq_feedback_residual(fb)[i] != 0.0f;
+    bsq_feedback_free(fb);
+    return failed;
+}
+
+int main(void) {
+    float **inputs = gen_random_float_arrays(2, N, -1.0f, 1.0f, 2222);
+    float *expect = (float *)malloc(N * sizeof(float));
+    float *decoded = (float *)malloc(N * sizeof(float));
+    double *sent = (double *)malloc(N * sizeof(double));
+    double *plain = (double *)malloc(N * sizeof(double));
+    if (!inputs || !expect || !decoded || !sent || !plain) {
+        fprintf(stderr, "failed to allocate test buffers\n");
+        return EXIT_FAILURE;
+    }
+
+    int failed = 0;
+    const size_t num_methods = sizeof(METHODS) / sizeof(METHODS[0]);
+    for (size_t m = 0; m < num_methods && !failed; ++m) {
+        if (run(METHODS[m], inputs, expect, decoded, sent, plain)) {
+            fprintf(stderr, "method %d: error feedback failed\n", METHODS[m]);
+            failed = 1;
+        }
+    }
+
+    if (!failed) {
+        const bitsqueeze_buffer_t *out = NULL;
+        bsq_feedback_t *fb = bsq_feedback_create_2d(TOPK_IM, TOKENS, FEATURES, 0.01f);
+        if (bsq_feedback_create_1d(TOPK, N) || bsq_feedback_create_2d(Q4_0, TOKENS, FEATURES, 0.01f) || !fb ||
+            bsq_feedback_compress(fb, inputs[0], NULL, &out) == 0) {
+            fprintf(stderr, "argument checks failed\n");
+            failed = 1;
+        }
+        bsq_feedback_free(fb);
+    }
+
+    free(expect);
+    free(decoded);
+    free(sent);
+    free(plain);
+    free_random_float_arrays(inputs, 2);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
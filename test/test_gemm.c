@@ -0,0 +1,103 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "bitsqueeze.h"
+#include "utils/random.h"
+#include "utils/evaluation.h"
+
+#define ROWS 256
+#define COLS 1024
+#define TOKENS 64
+
+static const bsq_method_t METHODS[] = {Q8_0, Q4_0, Q2_K, IQ2_XXS, IQ2_XS, IQ2_S};
+
+/* y = x w^T in the textbook loop order, as a caller would after bsq_decompress. */
+static void naive_matmul(const float *w, const float *x, uint64_t rows, uint64_t cols, uint64_t tokens, float *y) {
+    for (uint64_t t = 0; t < tokens; ++t) {
+        for (uint64_t r = 0; r < rows; ++r) {
+            float sum = 0.0f;
+            for (uint64_t c = 0; c < cols; ++c) sum += x[t * cols + c] * w[r * cols + c];
+            y[t * rows + r] = sum;
+        }
+    }
+}
+
+/* y must match the decompressed product up to float summation order. */
+static int check(const float *w, const float *x, uint64_t rows, uint64_t cols, uint64_t tokens, const float *y) {
+    for (uint64_t t = 0; t < tokens; ++t) {
+        for (uint64_t r = 0; r < rows; ++r) {
+            double expect = 0.0, magnitude = 0.0;
+            for (uint64_t c = 0; c < cols; ++c) {
+                expect += (double)x[t * cols + c] * w[r * cols + c];
+                magnitude += fabs((double)x[t * cols + c] * w[r * cols + c]);
+            }
+            if (fabs(y[t * rows + r] - expect) > 1e-5 * magnitude + 1e-6) return 1;
+        }
+    }
+    return 0;
+}
+
+int main(void) {
+    const uint64_t n = (uint64_t)ROWS * COLS;
+    float **inputs = gen_random_float_arrays(2, n, -1.0f, 1.0f, 1717);
+    float *w = (float *)malloc(n * sizeof(float));
+    float *y = (float *)malloc((uint64_t)TOKENS * ROWS * sizeof(float));
+    float *y_ref = (float *)malloc((uint64_t)TOKENS * ROWS * sizeof(float));
+    if (!inputs || !w || !y || !y_ref) {
+        fprintf(stderr, "failed to allocate test buffers\n");
+        return EXIT_FAILURE;
+    }
+    const float *x = inputs[1];
+
+    int failed = 0;
+    const size_t num_methods = sizeof(METHODS) / sizeof(METHODS[0]);
+    for (size_t m = 0; m < num_methods && !failed; ++m) {
+        const bsq_method_t method = METHODS[m];
+        bitsqueeze_buffer_t *buf = NULL;
+        if (bsq_compress_1d(inputs[0], n, method, &buf, NULL)) {
+            fprintf(stderr, "method %d: compress failed\n", method);
+            failed = 1;
+            break;
+        }
+
+        double t0 = get_time_ms();
+        const int rc = bsq_gemm(buf, ROWS, COLS, x, TOKENS, y);
+        double t1 = get_time_ms();
+        const double fused_time = t1 - t0;
+
+        t0 = get_time_ms();
+        const int ref_rc = bsq_decompress(buf, w, n);
+        naive_matmul(w, x, ROWS, COLS, TOKENS, y_ref);
+        t1 = get_time_ms();
+        const double naive_time = t1 - t0;
+
+        if (rc || ref_rc || check(w, x, ROWS, COLS, TOKENS, y)) {
+            fprintf(stderr, "method %d: fused gemm differs\n", method);
+            failed = 1;
+        }
+        printf("[method %d] %dx%d weights, %d tokens: fused=%.3f ms, decompress+naive=%.3f ms\n",
+               method, ROWS, COLS, TOKENS, fused_time, naive_time);
+        bsq_free(buf);
+    }
+
+    /* Ragged edges: a partial row tile, columns that end inside a panel and inside a block. */
+    if (!failed) {
+        const uint64_t rows = 70, cols = 300, tokens = 3;
+        bitsqueeze_buffer_t *buf = NULL;
+        if (bsq_compress_1d(inputs[0], rows * cols, Q8_0, &buf, NULL) || bsq_decompress(buf, w, rows * cols) ||
+            bsq_gemm(buf, rows, cols, x, tokens, y) || check(w, x, rows, cols, tokens, y) ||
+            bsq_gemm(buf, rows, cols + 1, x, tokens, y) == 0) {
+            fprintf(stderr, "ragged gemm differs\n");
+            failed = 1;
+        }
+        bsq_free(buf);
+    }
+
+    free(w);
+    free(y);
+    free(y_ref);
+    free_random_float_arrays(inputs, 2);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
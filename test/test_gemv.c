@@ -0,0 +1,70 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "bitsqueeze.h"
+#include "utils/random.h"
+
+#define ROWS 48
+#define COLS 512
+#define N ((uint64_t)ROWS * COLS)
+
+static const bsq_method_t METHODS[] = {Q8_0, Q4_0, Q2_K, Q2_K_FAST, NF4, MXFP4, NVFP4};
+
+int main(void) {
+    float **inputs = gen_random_float_arrays(2, N, -2.0f, 2.0f, 1616);
+    float *w = (float *)malloc(N * sizeof(float));
+    if (!inputs || !w) {
+        fprintf(stderr, "failed to allocate test buffers\n");
+        return EXIT_FAILURE;
+    }
+    const float *x = inputs[1];
+
+    int failed = 0;
+    const size_t num_methods = sizeof(METHODS) / sizeof(METHODS[0]);
+    for (size_t m = 0; m < num_methods && !failed; ++m) {
+        const bsq_method_t method = METHODS[m];
+        bitsqueeze_buffer_t *buf = NULL;
+        float y[ROWS];
+        if (bsq_compress_1d(inputs[0], N, method, &buf, NULL) || bsq_decompress(buf, w, N) ||
+            bsq_gemv(buf, ROWS, COLS, x, y)) {
+            fprintf(stderr, "method %d: gemv failed\n", method);
+            failed = 1;
+        }
+
+        /* Same products as the decompressed matrix, up to float summation order. */
+        for (uint64_t r = 0; r < ROWS && !failed; ++r) {
+            double expect = 0.0, magnitude = 0.0;
+            for (uint64_t c = 0; c < COLS; ++c) {
+                expect += (double)w[r * COLS + c] * x[c];
+                magnitude += fabs((double)w[r * COLS + c] * x[c]);
+            }
+            if (fabs(y[r] - expect) > 1e-5 * magnitude + 1e-6) {
+                fprintf(stderr, "method %d: row %llu got %f, expected %f\n", method, (unsigned long long)r,
+                        y[r], expect);
+                failed = 1;
+            }
+        }
+
+        if (!failed && (bsq_gemv(buf, ROWS + 1, COLS, x, y) == 0 || bsq_gemv(buf, ROWS, COLS - 1, x, y) == 0)) {
+            fprintf(stderr, "method %d: argument checks failed\n", method);
+            failed = 1;
+        }
+        bsq_free(buf);
+    }
+
+    if (!failed) {
+        bitsqueeze_buffer_t *buf = NULL;
+        float y[ROWS];
+        if (bsq_compress_1d(inputs[0], N, FP8, &buf, NULL) || bsq_gemv(buf, ROWS, COLS, x, y) == 0) {
+            fprintf(stderr, "FP8: unsupported gemv accepted\n");
+            failed = 1;
+        }
+        bsq_free(buf);
+    }
+
+    free(w);
+    free_random_float_arrays(inputs, 2);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
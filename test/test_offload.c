@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bitsqueeze.h"
+#include "utils/random.h"
+
+#define LAYERS 6
+#define TOKENS 32
+#define FEATURES 128
+#define N ((uint64_t)TOKENS * FEATURES)
+
+/* Layer l's activations are inputs[0] shifted by l * 7 elements, so every layer differs. */
+static const float *layer_src(float *const *inputs, uint32_t layer) {
+    return inputs[0] + (uint64_t)layer * 7;
+}
+
+static int fill_and_store(bsq_offload_t *off, float *const *inputs, uint32_t layer) {
+    float *stage = bsq_offload_stage(off);
+    if (!stage) return 1;
+    memcpy(stage, layer_src(inputs, layer), N * sizeof(float));
+    return bsq_offload_store(off, layer);
+}
+
+static int reference(bsq_method_t method, const float *src, float *out) {
+    bitsqueeze_buffer_t *buf = NULL;
+    const int failed = (method == TOPK ? bsq_compress_2d(src, TOKENS, FEATURES, 0.25f, method, &buf, NULL)
+                                       : bsq_compress_1d(src, N, method, &buf, NULL)) ||
+                       bsq_decompress(buf, out, N);
+    bsq_free(buf);
+    return failed;
+}
+
+int main(void) {
+    float **inputs = gen_random_float_arrays(1, N + LAYERS * 7, -5.0f, 5.0f, 6060);
+    float *ref = (float *)malloc(N * sizeof(float));
+    if (!inputs || !ref) {
+        fprintf(stderr, "failed to allocate test buffers\n");
+        return EXIT_FAILURE;
+    }
+
+    int failed = 0;
+    const bsq_method_t methods[] = {Q8_0, Q4_0, TOPK};
+    for (int m = 0; m < 3 && !failed; ++m) {
+        bsq_shape_t shape;
+        memset(&shape, 0, sizeof(shape));
+        shape.num_elements = N;
+        shape.num_tokens = TOKENS;
+        shape.num_features = FEATURES;
+        shape.sparse_ratio = 0.25f;
+        bsq_offload_t *off = bsq_offload_create(methods[m], &shape, LAYERS, 2, 2, NULL);
+        if (!off) {
+            fprintf(stderr, "method %d: create failed\n", methods[m]);
+            failed = 1;
+            break;
+        }
+
+        if (bsq_offload_load(off, 0) != NULL) {
+            fprintf(stderr, "method %d: load of an empty layer succeeded\n", methods[m]);
+            failed = 1;
+        }
+        for (uint32_t l = 0; l < LAYERS && !failed; ++l) failed = fill_and_store(off, inputs, l);
+
+        /* Two passes: the second starts with layers prefetched by the end of the first. */
+        for (int pass = 0; pass < 2 && !failed; ++pass) {
+            for (uint32_t l = 0; l < LAYERS && !failed; ++l) {
+                const float *out = bsq_offload_load(off, l);
+                if (!out || reference(methods[m], layer_src(inputs, l), ref) ||
+                    memcmp(out, ref, N * sizeof(float)) != 0) {
+                    fprintf(stderr, "method %d: pass %d layer %u differs\n", methods[m], pass, l);
+                    failed = 1;
+                }
+            }
+        }
+
+        /* Restoring a prefetched layer replaces what a later load returns. */
+        if (!failed) {
+            bsq_offload_load(off, 0);
+            if (fill_and_store(off, inputs, 2 + 3) || bsq_offload_sync(off)) failed = 1;
+            const float *out = bsq_offload_load(off, 5);
+            if (failed || !out || reference(methods[m], layer_src(inputs, 5), ref) ||
+                memcmp(out, ref, N * sizeof(float)) != 0 || !bsq_offload_buffer(off, 5)) {
+                fprintf(stderr, "method %d: restored layer differs\n", methods[m]);
+                failed = 1;
+            }
+        }
+
+        bsq_offload_stats_t stats;
+        bsq_offload_get_stats(off, &stats);
+        if (!failed && (stats.stores != LAYERS + 1 || stats.loads != 2 * LAYERS + 2 || stats.prefetch_hits == 0)) {
+            fprintf(stderr, "method %d: stats %llu stores, %llu loads, %llu hits\n", methods[m],
+                    (unsigned long long)stats.stores, (unsigned long long)stats.loads,
+                    (unsigned long long)stats.prefetch_hits);
+            failed = 1;
+        }
+        bsq_offload_destroy(off);
+    }
+
+    if (!failed) {
+        bsq_shape_t shape = {N, TOKENS, FEATURES, 0.25f};
+        bsq_offload_t *off = bsq_offload_create(Q8_0, &shape, LAYERS, 1, 0, NULL);
+        if (bsq_offload_create(TOPK_IM, &shape, LAYERS, 2, 1, NULL) != NULL || !off ||
+            bsq_offload_store(off, 0) == 0 || !bsq_offload_stage(off) || bsq_offload_store(off, LAYERS) == 0) {
+            fprintf(stderr, "argument checks failed\n");
+            failed = 1;
+        }
+        bsq_offload_destroy(off);
+    }
+
+    free(ref);
+    free_random_float_arrays(inputs, 1);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
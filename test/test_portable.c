@@ -0,0 +1,215 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bitsqueeze.h"
+#include "serialization/portable_impl.h"
+#include "utils/random.h"
+
+#define N 4099            /* odd and not a multiple of any block size */
+#define TOKENS 16
+#define FEATURES 96
+#define SPARSE_RATIO 0.1f
+
+static const bsq_method_t METHODS_1D[] = {
+    Q8_0, Q4_0, Q2_K, Q2_K_FAST, BF16, FP16, FP8, FP4, MXFP8, MXFP4,
+    NVFP4, NF4, NF4_DQ, IQ2_XXS, IQ2_XS, IQ2_S
+};
+
+static int same_output(const bitsqueeze_buffer_t *a, const bitsqueeze_buffer_t *b,
+                       uint64_t n, float *out_a, float *out_b) {
+    if (bsq_decompress(a, out_a, n) || bsq_decompress(b, out_b, n)) return 0;
+    return memcmp(out_a, out_b, n * sizeof(float)) == 0;
+}
+
+static int check_portable(const bitsqueeze_buffer_t *buf, uint64_t n, float *out_a, float *out_b) {
+    const int64_t size = bsq_get_portable_size(buf);
+    if (size <= 0 || size % BSQ_PORTABLE_ALIGNMENT != 0) {
+        fprintf(stderr, "method %d: bad portable size %lld\n", buf->method, (long long)size);
+        return 1;
+    }
+
+    uint64_t *bytes = (uint64_t *)malloc((size_t)size);
+    uint64_t *again = (uint64_t *)malloc((size_t)size);
+    if (!bytes || !again) {
+        free(bytes);
+        free(again);
+        return 1;
+    }
+    memset(bytes, 0xAB, (size_t)size);
+
+    int failed = 0;
+    const uint8_t *raw = (const uint8_t *)bytes;
+    if (bsq_write_portable(buf, bytes, size - 1) == 0 || bsq_write_portable(buf, bytes, size)) {
+        fprintf(stderr, "method %d: bsq_write_portable size check failed\n", buf->method);
+        failed = 1;
+    } else if (memcmp(raw, BSQ_PORTABLE_MAGIC, 4) != 0 ||
+               bsq_load_le32(raw + 8) != (uint32_t)buf->method ||
+               bsq_load_le64(raw + 16) != buf->shape.num_elements ||
+               bsq_load_le64(raw + 48) != (uint64_t)size) {
+        fprintf(stderr, "method %d: header fields are not little-endian as specified\n", buf->method);
+        failed = 1;
+    }
+
+    const uint32_t num_sections = failed ? 0 : bsq_load_le32(raw + 12);
+    for (uint32_t i = 0; i < num_sections && !failed; ++i) {
+        if (bsq_load_le64(raw + BSQ_PORTABLE_HEADER_SIZE + i * BSQ_PORTABLE_SECTION_SIZE) % BSQ_PORTABLE_ALIGNMENT != 0) {
+            fprintf(stderr, "method %d: section %u is not aligned\n", buf->method, i);
+            failed = 1;
+        }
+    }
+
+    bsq_view_t view;
+    bitsqueeze_buffer_t *loaded = NULL;
+    if (!failed) {
+        loaded = bsq_load_portable(bytes, size);
+        if (!loaded || bsq_get_packed_size(loaded) != bsq_get_packed_size(buf) ||
+            !same_output(buf, loaded, n, out_a, out_b)) {
+            fprintf(stderr, "method %d: bsq_load_portable mismatch\n", buf->method);
+            failed = 1;
+        }
+    }
+    if (!failed) {
+        if (bsq_view_portable(bytes, size, &view) || !same_output(buf, &view.buf, n, out_a, out_b)) {
+            fprintf(stderr, "method %d: bsq_view_portable mismatch\n", buf->method);
+            failed = 1;
+        } else if (bsq_write_portable(&view.buf, again, size) || memcmp(bytes, again, (size_t)size) != 0) {
+            /* A view has scattered sections; re-serializing it must reproduce the same bytes. */
+            fprintf(stderr, "method %d: re-serialized view differs\n", buf->method);
+            failed = 1;
+        }
+    }
+    if (!failed && (bsq_view_portable(bytes, size - 1, &view) == 0 || bsq_load_portable(bytes, size - 1) != NULL)) {
+        fprintf(stderr, "method %d: truncated portable bytes accepted\n", buf->method);
+        failed = 1;
+    }
+
+    bsq_free(loaded);
+    free(bytes);
+    free(again);
+    return failed;
+}
+
+/*
+ * bsq_write_portable output for IQ2_XXS over fixture_input(), captured on a little-endian host. Loading it must
+ * give what compressing the same input gives on this host, whatever its byte order; a round trip cannot show that.
+ */
+static _Alignas(64) const uint8_t IQ2_XXS_FIXTURE[256] = {
+    0x42, 0x53, 0x51, 0x50, 0x01, 0x00, 0x40, 0x00, 0x0d, 0x00, 0x00, 0x00,
+    0x02, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xdf, 0x22, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xef, 0xcd, 0xc2, 0x37, 0x87, 0x61, 0x38, 0xee, 0x39, 0xb1, 0xb1, 0xcd,
+    0x78, 0x9e, 0xe7, 0xe0, 0xc2, 0x37, 0x39, 0x10, 0xc3, 0x70, 0x9c, 0xe7,
+    0xb1, 0xef, 0xcd, 0x6b, 0x9e, 0xc3, 0x30, 0xdc, 0x39, 0x39, 0xb1, 0xef,
+    0x71, 0x3c, 0xcf, 0xc3, 0xcd, 0xc2, 0x37, 0x39, 0x87, 0x73, 0x1c, 0xef,
+    0x10, 0xb1, 0xcd, 0xc2, 0x3c, 0xcf, 0x61, 0xf8, 0x6b, 0x39, 0x10, 0xb1,
+    0xe1, 0x38, 0x9e, 0xd7
+};
+
+static void fixture_input(float *x, uint64_t n) {
+    for (uint64_t i = 0; i < n; ++i) x[i] = (float)((int)((i * 37) % 256) - 128) / 64.0f;
+}
+
+static int check_fixture(float *out_a, float *out_b) {
+    float x[256];
+    fixture_input(x, 256);
+    bitsqueeze_buffer_t *expect = NULL;
+    bitsqueeze_buffer_t *loaded = bsq_load_portable(IQ2_XXS_FIXTURE, sizeof(IQ2_XXS_FIXTURE));
+    int failed = !loaded || bsq_compress_1d(x, 256, IQ2_XXS, &expect, NULL) ||
+                 !same_output(expect, loaded, 256, out_a, out_b);
+    if (failed) fprintf(stderr, "IQ2_XXS: little-endian fixture does not decode as on this host\n");
+    bsq_free(expect);
+    bsq_free(loaded);
+    return failed;
+}
+
+/* Corrupt one header field of a fresh Q8_0 serialization and expect both readers to reject it. */
+static int check_rejected(const bitsqueeze_buffer_t *buf, uint64_t *bytes, int64_t size,
+                          uint64_t field, uint64_t value, int width) {
+    bsq_view_t view;
+    uint8_t *raw = (uint8_t *)bytes;
+    if (bsq_write_portable(buf, bytes, size)) return 1;
+    if (width == 2) bsq_store_le16(raw + field, (uint16_t)value);
+    else if (width == 4) bsq_store_le32(raw + field, (uint32_t)value);
+    else bsq_store_le64(raw + field, value);
+
+    if (bsq_view_portable(bytes, size, &view) == 0 || bsq_load_portable(bytes, size) != NULL) {
+        fprintf(stderr, "corrupted field at offset %llu accepted\n", (unsigned long long)field);
+        return 1;
+    }
+    return 0;
+}
+
+int main(void) {
+    float **inputs = gen_random_float_arrays(1, N, -10.0f, 10.0f, 777);
+    float *out_a = (float *)malloc(N * sizeof(float));
+    float *out_b = (float *)malloc(N * sizeof(float));
+    if (!inputs || !out_a || !out_b) {
+        fprintf(stderr, "failed to allocate test buffers\n");
+        return EXIT_FAILURE;
+    }
+
+    int failed = 0;
+    const size_t num_methods = sizeof(METHODS_1D) / sizeof(METHODS_1D[0]);
+    for (size_t m = 0; m < num_methods && !failed; ++m) {
+        bitsqueeze_buffer_t *buf = NULL;
+        if (bsq_compress_1d(inputs[0], N, METHODS_1D[m], &buf, NULL) || !buf) {
+            fprintf(stderr, "method %d: bsq_compress_1d failed\n", METHODS_1D[m]);
+            failed = 1;
+            break;
+        }
+        failed = check_portable(buf, N, out_a, out_b);
+        bsq_free(buf);
+    }
+
+    if (!failed) {
+        bitsqueeze_buffer_t *buf = NULL;
+        if (bsq_compress_2d(inputs[0], TOKENS, FEATURES, SPARSE_RATIO, TOPK, &buf, NULL) || !buf) {
+            fprintf(stderr, "TOPK: bsq_compress_2d failed\n");
+            failed = 1;
+        } else {
+            failed = check_portable(buf, (uint64_t)TOKENS * FEATURES, out_a, out_b);
+        }
+        bsq_free(buf);
+    }
+
+    if (!failed) failed = check_fixture(out_a, out_b);
+
+    if (!failed) {
+        bitsqueeze_buffer_t *buf = NULL;
+        if (bsq_compress_1d(inputs[0], N, Q8_0, &buf, NULL) || !buf) {
+            failed = 1;
+        } else {
+            const int64_t size = bsq_get_portable_size(buf);
+            uint64_t *bytes = (uint64_t *)malloc((size_t)size);
+            failed = !bytes ||
+                     check_rejected(buf, bytes, size, 0, 0x46515342u, 4) ||   /* magic */
+                     check_rejected(buf, bytes, size, 4, 2, 2) ||             /* version */
+                     check_rejected(buf, bytes, size, 8, 255, 4) ||           /* method */
+                     check_rejected(buf, bytes, size, 16, N + 1, 8) ||        /* num_elements */
+                     check_rejected(buf, bytes, size, 24, 64, 8) ||           /* block_size */
+                     check_rejected(buf, bytes, size, BSQ_PORTABLE_HEADER_SIZE, 72, 8); /* section offset */
+            free(bytes);
+        }
+        bsq_free(buf);
+    }
+
+    free(out_a);
+    free(out_b);
+    free_random_float_arrays(inputs, 1);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,93 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bitsqueeze.h"
+#include "int_quantization/q8_dot_impl.h"
+#include "utils/random.h"
+#include "utils/evaluation.h"
+
+#define ROWS 256
+#define COLS 2048
+#define N ((uint64_t)ROWS * COLS)
+
+static const char *ISA_NAMES[] = {"scalar", "avx2", "avx-vnni", "avx512-vnni"};
+
+int main(void) {
+    float **inputs = gen_random_float_arrays(2, N, -3.0f, 3.0f, 1818);
+    float *w = (float *)malloc(N * sizeof(float));
+    int8_t codes[COLS];
+    float scales[COLS / 32];
+    float xq[COLS];
+    float y[ROWS];
+    if (!inputs || !w) {
+        fprintf(stderr, "failed to allocate test buffers\n");
+        return EXIT_FAILURE;
+    }
+    const float *x = inputs[1];
+
+    /* The activation quantizer rounds exactly like a Q8_0 buffer of the same values. */
+    int failed = 0;
+    bitsqueeze_buffer_t *ref = NULL;
+    if (bsq_quantize_q8(x, 2, COLS / 2, codes, scales) || bsq_compress_1d(x, COLS, Q8_0, &ref, NULL) ||
+        memcmp(codes, ((const q8_0_array_t *)ref->payload)->data, COLS) != 0 ||
+        memcmp(scales, ((const q8_0_array_t *)ref->payload)->scales, sizeof(scales)) != 0 ||
+        bsq_quantize_q8(x, 1, COLS - 1, codes, scales) == 0) {
+        fprintf(stderr, "activation quantizer differs from Q8_0\n");
+        failed = 1;
+    }
+    bsq_free(ref);
+    for (uint64_t i = 0; i < COLS; ++i) xq[i] = scales[i / 32] * codes[i];
+
+    const bsq_method_t methods[] = {Q8_0, Q4_0};
+    for (int m = 0; m < 2 && !failed; ++m) {
+        bitsqueeze_buffer_t *buf = NULL;
+        if (bsq_compress_1d(inputs[0], N, methods[m], &buf, NULL) || bsq_decompress(buf, w, N)) {
+            fprintf(stderr, "method %d: setup failed\n", methods[m]);
+            failed = 1;
+            bsq_free(buf);
+            break;
+        }
+
+        double t0 = get_time_ms();
+        bsq_gemv(buf, ROWS, COLS, x, y);
+        const double float_time = get_time_ms() - t0;
+
+        /* Every ISA this CPU has must match the decoded product up to float summation order. */
+        for (int isa = Q8_DOT_SCALAR; isa <= Q8_DOT_AVX512_VNNI && !failed; ++isa) {
+            q8_dot_set_max_isa((q8_dot_isa_t)isa);
+            if (q8_dot_isa() != (q8_dot_isa_t)isa) continue;
+
+            t0 = get_time_ms();
+            const int rc = bsq_gemv_q8(buf, ROWS, COLS, codes, scales, y);
+            const double int_time = get_time_ms() - t0;
+            for (uint64_t r = 0; r < ROWS && !failed; ++r) {
+                double expect = 0.0, magnitude = 0.0;
+                for (uint64_t c = 0; c < COLS; ++c) {
+                    expect += (double)w[r * COLS + c] * xq[c];
+                    magnitude += fabs((double)w[r * COLS + c] * xq[c]);
+                }
+                if (rc || fabs(y[r] - expect) > 1e-5 * magnitude + 1e-6) {
+                    fprintf(stderr, "method %d, %s: row %llu got %f, expected %f\n", methods[m], ISA_NAMES[isa],
+                            (unsigned long long)r, y[r], expect);
+                    failed = 1;
+                }
+            }
+            printf("[method %d] %s int8 gemv=%.3f ms, float gemv=%.3f ms\n", methods[m], ISA_NAMES[isa],
+                   int_time, float_time);
+        }
+        q8_dot_set_max_isa(Q8_DOT_AVX512_VNNI);
+
+        if (!failed && bsq_gemv_q8(buf, ROWS + 1, COLS, codes, scales, y) == 0) {
+            fprintf(stderr, "method %d: argument checks failed\n", methods[m]);
+            failed = 1;
+        }
+        bsq_free(buf);
+    }
+
+    free(w);
+    free_random_float_arrays(inputs, 2);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,117 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "bitsqueeze.h"
+#include "utils/random.h"
+
+#define N 8195
+#define TOKENS 16
+#define FEATURES 512
+
+static const bsq_method_t METHODS_1D[] = {
+    Q8_0, Q4_0, Q2_K, Q2_K_FAST, BF16, FP16, FP8, FP4, MXFP8, MXFP4,
+    NVFP4, NF4, NF4_DQ, IQ2_XXS, IQ2_XS, IQ2_S
+};
+
+/* got matches expect up to summation error over terms whose absolute values add up to magnitude. */
+static int close_to(double got, double expect, double magnitude) {
+    return fabs(got - expect) <= 1e-6 * magnitude + 1e-9;
+}
+
+/* Reductions and the dot with x must agree with the decoded values of buf. */
+static int check_buffer(const bitsqueeze_buffer_t *buf, const float *x, uint64_t n, float *decoded) {
+    bsq_reduction_t r;
+    double dot = 0.0;
+    if (bsq_decompress(buf, decoded, n) || bsq_reduce(buf, &r) || bsq_dot(buf, x, n, &dot)) return 1;
+
+    double sum = 0.0, sum_abs = 0.0, sum_squares = 0.0, dot_expect = 0.0, dot_abs = 0.0;
+    float abs_max = 0.0f;
+    for (uint64_t i = 0; i < n; ++i) {
+        sum += decoded[i];
+        sum_abs += fabs(decoded[i]);
+        sum_squares += (double)decoded[i] * decoded[i];
+        dot_expect += (double)decoded[i] * x[i];
+        dot_abs += fabs((double)decoded[i] * x[i]);
+        if (fabsf(decoded[i]) > abs_max) abs_max = fabsf(decoded[i]);
+    }
+    return !close_to(r.sum, sum, sum_abs) || !close_to(r.sum_squares, sum_squares, sum_squares) ||
+           r.abs_max != abs_max || !close_to(dot, dot_expect, dot_abs * 10.0) ||
+           bsq_dot(buf, x, n - 1, &dot) == 0;
+}
+
+static int check_pair(const float *src_a, const float *src_b, uint64_t n, bsq_method_t ma, bsq_method_t mb,
+                      float *da, float *db) {
+    bitsqueeze_buffer_t *a = NULL, *b = NULL;
+    double dot = 0.0, expect = 0.0, magnitude = 0.0;
+    int failed = bsq_compress_1d(src_a, n, ma, &a, NULL) || bsq_compress_1d(src_b, n, mb, &b, NULL) ||
+                 bsq_decompress(a, da, n) || bsq_decompress(b, db, n) || bsq_dot_buffers(a, b, &dot);
+    for (uint64_t i = 0; i < n && !failed; ++i) {
+        expect += (double)da[i] * db[i];
+        magnitude += fabs((double)da[i] * db[i]);
+    }
+    failed = failed || !close_to(dot, expect, magnitude * 10.0);
+    bsq_free(a);
+    bsq_free(b);
+    return failed;
+}
+
+int main(void) {
+    const uint64_t n2d = (uint64_t)TOKENS * FEATURES;
+    float **inputs = gen_random_float_arrays(3, N, -4.0f, 4.0f, 2020);
+    float *da = (float *)malloc(N * sizeof(float));
+    float *db = (float *)malloc(N * sizeof(float));
+    if (!inputs || !da || !db) {
+        fprintf(stderr, "failed to allocate test buffers\n");
+        return EXIT_FAILURE;
+    }
+
+    int failed = 0;
+    const size_t num_methods = sizeof(METHODS_1D) / sizeof(METHODS_1D[0]);
+    for (size_t m = 0; m < num_methods && !failed; ++m) {
+        bitsqueeze_buffer_t *buf = NULL;
+        if (bsq_compress_1d(inputs[0], N, METHODS_1D[m], &buf, NULL) || check_buffer(buf, inputs[1], N, da)) {
+            fprintf(stderr, "method %d: reductions differ\n", METHODS_1D[m]);
+            failed = 1;
+        }
+        bsq_free(buf);
+    }
+
+    const bsq_method_t methods_2d[] = {TOPK, TOPK_IM};
+    for (int m = 0; m < 2 && !failed; ++m) {
+        bitsqueeze_buffer_t *buf = NULL, *other = NULL;
+        double dot = 0.0, expect = 0.0, magnitude = 0.0;
+        if (bsq_compress_2d(inputs[0], TOKENS, FEATURES, 0.1f, methods_2d[m], &buf, inputs[2]) ||
+            check_buffer(buf, inputs[1], n2d, da) ||
+            bsq_compress_2d(inputs[1], TOKENS, FEATURES, 0.3f, TOPK, &other, NULL) ||
+            bsq_decompress(other, db, n2d) || bsq_dot_buffers(buf, other, &dot)) {
+            failed = 1;
+        }
+        for (uint64_t i = 0; i < n2d && !failed; ++i) {
+            expect += (double)da[i] * db[i];
+            magnitude += fabs((double)da[i] * db[i]);
+        }
+        if (failed || !close_to(dot, expect, magnitude)) {
+            fprintf(stderr, "method %d: sparse reductions differ\n", methods_2d[m]);
+            failed = 1;
+        }
+        bsq_free(buf);
+        bsq_free(other);
+    }
+
+    /* Integer block kernels on 32-aligned lengths, the decoding fallback otherwise. */
+    const bsq_method_t pairs[][2] = {{Q8_0, Q8_0}, {Q4_0, Q8_0}, {Q8_0, Q4_0}, {Q4_0, Q4_0}, {NF4, Q2_K}};
+    for (size_t p = 0; p < sizeof(pairs) / sizeof(pairs[0]) && !failed; ++p) {
+        if (check_pair(inputs[0], inputs[1], N - 3, pairs[p][0], pairs[p][1], da, db) ||
+            check_pair(inputs[0], inputs[1], N, pairs[p][0], pairs[p][1], da, db)) {
+            fprintf(stderr, "pair %d x %d: dot differs\n", pairs[p][0], pairs[p][1]);
+            failed = 1;
+        }
+    }
+
+    free(da);
+    free(db);
+    free_random_float_arrays(inputs, 3);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,118 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bitsqueeze.h"
+#include "utils/random.h"
+#include "utils/evaluation.h"
+
+#define TOKENS 128
+#define FEATURES 1024
+#define OUT 256        /* columns of W, rows of D */
+
+/* got matches expect up to float summation error; magnitude is the sum of the absolute terms. */
+static int close_to(float got, double expect, double magnitude) {
+    return fabs(got - expect) <= 1e-5 * magnitude + 1e-6;
+}
+
+int main(void) {
+    const uint64_t n = (uint64_t)TOKENS * FEATURES;
+    float **inputs = gen_random_float_arrays(3, n, -1.0f, 1.0f, 1919);
+    float *s = (float *)malloc(n * sizeof(float));
+    float *out = (float *)malloc((uint64_t)TOKENS * OUT * sizeof(float));
+    float *dense_out = (float *)malloc((uint64_t)TOKENS * OUT * sizeof(float));
+    if (!inputs || !s || !out || !dense_out) {
+        fprintf(stderr, "failed to allocate test buffers\n");
+        return EXIT_FAILURE;
+    }
+    const float *w = inputs[1];   /* [FEATURES, OUT] */
+    const float *d = inputs[2];   /* [OUT, FEATURES] */
+
+    int failed = 0;
+    const float ratios[] = {0.01f, 0.1f};
+    const bsq_method_t methods[] = {TOPK, TOPK_IM};
+    for (int m = 0; m < 2 && !failed; ++m) {
+        bitsqueeze_buffer_t *buf = NULL;
+        if (bsq_compress_2d(inputs[0], TOKENS, FEATURES, ratios[m], methods[m], &buf, inputs[1]) ||
+            bsq_decompress(buf, s, n)) {
+            fprintf(stderr, "method %d: setup failed\n", methods[m]);
+            failed = 1;
+            bsq_free(buf);
+            break;
+        }
+
+        double t0 = get_time_ms();
+        const int rc = bsq_spmm(buf, w, OUT, out);
+        const double sparse_time = get_time_ms() - t0;
+        for (uint64_t t = 0; t < TOKENS && !failed; ++t) {
+            for (uint64_t o = 0; o < OUT && !failed; ++o) {
+                double expect = 0.0, magnitude = 0.0;
+                for (uint64_t f = 0; f < FEATURES; ++f) {
+                    expect += (double)s[t * FEATURES + f] * w[f * OUT + o];
+                    magnitude += fabs((double)s[t * FEATURES + f] * w[f * OUT + o]);
+                }
+                if (rc || !close_to(out[t * OUT + o], expect, magnitude)) {
+                    fprintf(stderr, "method %d: spmm differs at (%llu, %llu)\n", methods[m],
+                            (unsigned long long)t, (unsigned long long)o);
+                    failed = 1;
+                }
+            }
+        }
+
+        /* The dense path it replaces: densify, then multiply. */
+        t0 = get_time_ms();
+        bsq_decompress(buf, s, n);
+        for (uint64_t t = 0; t < TOKENS; ++t) {
+            for (uint64_t o = 0; o < OUT; ++o) dense_out[t * OUT + o] = 0.0f;
+            for (uint64_t f = 0; f < FEATURES; ++f) {
+                const float v = s[t * FEATURES + f];
+                for (uint64_t o = 0; o < OUT; ++o) dense_out[t * OUT + o] += v * w[f * OUT + o];
+            }
+        }
+        const double dense_time = get_time_ms() - t0;
+        printf("[method %d] ratio %.2f: spmm=%.3f ms, decompress+dense=%.3f ms\n", methods[m], ratios[m],
+               sparse_time, dense_time);
+
+        const int rc_t = bsq_spmm_t(buf, d, OUT, out);
+        for (uint64_t r = 0; r < OUT && !failed; ++r) {
+            for (uint64_t t = 0; t < TOKENS && !failed; ++t) {
+                double expect = 0.0, magnitude = 0.0;
+                for (uint64_t f = 0; f < FEATURES; ++f) {
+                    expect += (double)d[r * FEATURES + f] * s[t * FEATURES + f];
+                    magnitude += fabs((double)d[r * FEATURES + f] * s[t * FEATURES + f]);
+                }
+                if (rc_t || !close_to(out[r * TOKENS + t], expect, magnitude)) {
+                    fprintf(stderr, "method %d: spmm_t differs at (%llu, %llu)\n", methods[m],
+                            (unsigned long long)r, (unsigned long long)t);
+                    failed = 1;
+                }
+            }
+        }
+
+        /* S x is the first row of D S^T with D = x. */
+        float y[TOKENS];
+        if (!failed && (bsq_spmv(buf, d, y) || memcmp(y, out, sizeof(y)) != 0)) {
+            fprintf(stderr, "method %d: spmv differs\n", methods[m]);
+            failed = 1;
+        }
+        bsq_free(buf);
+    }
+
+    if (!failed) {
+        bitsqueeze_buffer_t *buf = NULL;
+        if (bsq_compress_1d(inputs[0], n, Q8_0, &buf, NULL) || bsq_spmm(buf, w, OUT, out) == 0 ||
+            bsq_spmv(buf, d, out) == 0) {
+            fprintf(stderr, "Q8_0: sparse products accepted\n");
+            failed = 1;
+        }
+        bsq_free(buf);
+    }
+
+    free(s);
+    free(out);
+    free(dense_out);
+    free_random_float_arrays(inputs, 3);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
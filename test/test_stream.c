@@ -0,0 +1,146 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bitsqueeze.h"
+#include "float_quantization/fp8_impl.h"
+#include "utils/random.h"
+
+#define N 270001          /* just over one stream window, odd tail */
+
+static const bsq_method_t METHODS_1D[] = {
+    Q8_0, Q4_0, Q2_K, Q2_K_FAST, BF16, FP16, FP8, FP4, MXFP8, MXFP4,
+    NVFP4, NF4, NF4_DQ, IQ2_XXS, IQ2_XS, IQ2_S
+};
+
+/* Chunk sizes cycled through by feed and scan: tiny, block-straddling and larger than a window. */
+static const uint64_t CHUNKS[] = {1, 7, 1000, 262149, 33};
+
+typedef struct {
+    uint8_t *bytes;
+    uint64_t size;
+    uint64_t written;
+} sink_t;
+
+static int sink_write(void *user, uint64_t offset, const void *data, uint64_t size) {
+    sink_t *sink = (sink_t *)user;
+    if (offset > sink->size || size > sink->size - offset) return 1;
+    memcpy(sink->bytes + offset, data, size);
+    sink->written += size;
+    return 0;
+}
+
+static int stream_tensor(bsq_stream_t *stream, const float *src, const float *im, int scan) {
+    uint64_t done = 0;
+    for (size_t c = 0; scan && done < N; ++c) {
+        uint64_t count = CHUNKS[c % (sizeof(CHUNKS) / sizeof(CHUNKS[0]))];
+        if (count > N - done) count = N - done;
+        if (bsq_stream_scan(stream, src + done, count)) return 1;
+        done += count;
+    }
+    done = 0;
+    for (size_t c = 0; done < N; ++c) {
+        uint64_t count = CHUNKS[(c + 2) % (sizeof(CHUNKS) / sizeof(CHUNKS[0]))];
+        if (count > N - done) count = N - done;
+        if (bsq_stream_feed(stream, src + done, count, im ? im + done : NULL)) return 1;
+        done += count;
+    }
+    return 0;
+}
+
+int main(void) {
+    float **inputs = gen_random_float_arrays(2, N, -8.0f, 8.0f, 777);
+    float *ref_out = (float *)malloc(N * sizeof(float));
+    float *out = (float *)malloc(N * sizeof(float));
+    if (!inputs || !ref_out || !out) {
+        fprintf(stderr, "failed to allocate test buffers\n");
+        return EXIT_FAILURE;
+    }
+    /* A run of zeros exercises the all-zero block scale rule of NF4_DQ. */
+    memset(inputs[0] + 1000, 0, 200 * sizeof(float));
+
+    int failed = 0;
+    const size_t num_methods = sizeof(METHODS_1D) / sizeof(METHODS_1D[0]);
+    for (size_t m = 0; m < num_methods && !failed; ++m) {
+        const bsq_method_t method = METHODS_1D[m];
+        const int global_scale = method == FP8 || method == FP4 || method == NVFP4 || method == NF4_DQ;
+        const float *im = method == Q2_K ? inputs[1] : NULL;
+
+        bitsqueeze_buffer_t *ref = NULL;
+        sink_t sink = {NULL, 0, 0};
+        sink.size = (uint64_t)bsq_compute_packed_size_1d(method, N);
+        sink.bytes = (uint8_t *)malloc(sink.size);
+        bsq_stream_t *stream = bsq_stream_begin(method, N, sink_write, &sink);
+        if (!sink.bytes || !stream || bsq_compress_1d(inputs[0], N, method, &ref, im) ||
+            bsq_decompress(ref, ref_out, N)) {
+            fprintf(stderr, "method %d: setup failed\n", method);
+            bsq_stream_end(stream);
+            failed = 1;
+        } else if (stream_tensor(stream, inputs[0], im, global_scale) | bsq_stream_end(stream)) {
+            fprintf(stderr, "method %d: streaming failed\n", method);
+            failed = 1;
+        } else {
+            bitsqueeze_buffer_t *loaded = load_bsq_from_buffer(sink.bytes, (int64_t)sink.size);
+            if (sink.written != sink.size || !loaded || bsq_decompress(loaded, out, N) ||
+                memcmp(ref_out, out, N * sizeof(float)) != 0) {
+                fprintf(stderr, "method %d: streamed tensor differs\n", method);
+                failed = 1;
+            }
+            bsq_free(loaded);
+        }
+
+        bsq_free(ref);
+        free(sink.bytes);
+    }
+
+    /* A caller-supplied scale replaces the pre-pass. */
+    if (!failed) {
+        bitsqueeze_buffer_t *ref = NULL;
+        sink_t sink = {NULL, (uint64_t)bsq_compute_packed_size_1d(FP8, N), 0};
+        sink.bytes = (uint8_t *)malloc(sink.size);
+        bsq_stream_t *stream = bsq_stream_begin(FP8, N, sink_write, &sink);
+        if (!sink.bytes || !stream || bsq_compress_1d(inputs[0], N, FP8, &ref, NULL) ||
+            bsq_stream_set_scale(stream, ((const fp8_array_t *)ref->payload)->scale) ||
+            stream_tensor(stream, inputs[0], NULL, 0) | bsq_stream_end(stream)) {
+            fprintf(stderr, "FP8: streaming with a given scale failed\n");
+            failed = 1;
+        } else {
+            bitsqueeze_buffer_t *loaded = load_bsq_from_buffer(sink.bytes, (int64_t)sink.size);
+            if (!loaded || bsq_decompress(ref, ref_out, N) || bsq_decompress(loaded, out, N) ||
+                memcmp(ref_out, out, N * sizeof(float)) != 0) {
+                fprintf(stderr, "FP8: given scale output differs\n");
+                failed = 1;
+            }
+            bsq_free(loaded);
+        }
+        bsq_free(ref);
+        free(sink.bytes);
+    }
+
+    /* Misuse: overfeeding, ending short and feeding a global-scale format with no scale. */
+    if (!failed) {
+        uint8_t *bytes = (uint8_t *)malloc((size_t)bsq_compute_packed_size_1d(FP8, N));
+        sink_t sink = {bytes, (uint64_t)bsq_compute_packed_size_1d(FP8, N), 0};
+        bsq_stream_t *over = bsq_stream_begin(Q8_0, 10, sink_write, &sink);
+        bsq_stream_t *short_fed = bsq_stream_begin(Q8_0, 10, sink_write, &sink);
+        bsq_stream_t *no_scale = bsq_stream_begin(FP8, 10, sink_write, &sink);
+        if (!bytes || !over || !short_fed || !no_scale ||
+            bsq_stream_feed(over, inputs[0], 11, NULL) == 0 ||
+            bsq_stream_feed(short_fed, inputs[0], 9, NULL) != 0 ||
+            bsq_stream_feed(no_scale, inputs[0], 10, NULL) == 0) {
+            failed = 1;
+        }
+        if (bsq_stream_end(over) == 0 || bsq_stream_end(short_fed) == 0 || bsq_stream_end(no_scale) == 0 ||
+            bsq_stream_begin(TOPK, 10, sink_write, &sink) != NULL) {
+            failed = 1;
+        }
+        if (failed) fprintf(stderr, "argument checks failed\n");
+        free(bytes);
+    }
+
+    free(ref_out);
+    free(out);
+    free_random_float_arrays(inputs, 2);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
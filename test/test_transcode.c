@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bitsqueeze.h"
+#include "utils/random.h"
+#include "utils/evaluation.h"
+
+/* Odd, and not a multiple of any block, so every tail path runs. */
+#define N ((1u << 18) + 77)
+
+/* Cold IQ2 targets first, so their tables are built inside bsq_transcode; then the fused pairs, then pairs that
+ * go through decoded chunks, tensor-scale targets among them. */
+static const bsq_method_t PAIRS[][2] = {
+    {Q8_0, IQ2_XXS}, {Q8_0, IQ2_XS},
+    {Q8_0, Q4_0}, {Q8_0, Q2_K_FAST}, {MXFP8, MXFP4}, {FP8, NVFP4}, {FP16, BF16}, {BF16, FP16},
+    {Q4_0, Q8_0}, {NF4, FP8}, {Q2_K, NF4_DQ}, {MXFP4, NVFP4}, {FP16, FP4}, {IQ2_XS, MXFP8}, {Q8_0, Q8_0}
+};
+
+/* Transcodes src and compares the result against decompressing it and compressing the floats again. */
+static int run(const bitsqueeze_buffer_t *src, bsq_method_t dst_method, float *a, float *b) {
+    bitsqueeze_buffer_t *fused = NULL, *split = NULL;
+    double t0 = get_time_ms();
+    int failed = bsq_transcode(src, dst_method, &fused);
+    const double fused_time = get_time_ms() - t0;
+
+    t0 = get_time_ms();
+    float *tmp = (float *)malloc(N * sizeof(float));
+    failed = failed || !tmp || bsq_decompress(src, tmp, N) || bsq_compress_1d(tmp, N, dst_method, &split, NULL);
+    const double split_time = get_time_ms() - t0;
+    printf("[%d -> %d] transcode=%.3f ms, decompress+compress=%.3f ms\n",
+           src->method, dst_method, fused_time, split_time);
+
+    failed = failed || bsq_get_packed_size(fused) != bsq_get_packed_size(split) ||
+             bsq_decompress(fused, a, N) || bsq_decompress(split, b, N) || memcmp(a, b, N * sizeof(float)) != 0;
+
+    /* The caller-memory variant rejects a destination one byte short. */
+    const int64_t size = bsq_get_packed_size(split);
+    void *mem = aligned_alloc(64, ((size_t)size + 63) & ~(size_t)63);
+    failed = failed || !mem || bsq_transcode_into(src, dst_method, mem, size - 1) == 0 ||
+             bsq_transcode_into(src, dst_method, mem, size) ||
+             bsq_decompress((const bitsqueeze_buffer_t *)mem, a, N) || memcmp(a, b, N * sizeof(float)) != 0;
+
+    free(mem);
+    free(tmp);
+    bsq_free(fused);
+    bsq_free(split);
+    return failed;
+}
+
+int main(void) {
+    float **inputs = gen_random_float_arrays(1, N, -3.0f, 3.0f, 2424);
+    float *a = (float *)malloc(N * sizeof(float));
+    float *b = (float *)malloc(N * sizeof(float));
+    if (!inputs || !a || !b) {
+        fprintf(stderr, "failed to allocate test buffers\n");
+        return EXIT_FAILURE;
+    }
+
+    int failed = 0;
+    const size_t num_pairs = sizeof(PAIRS) / sizeof(PAIRS[0]);
+    for (size_t p = 0; p < num_pairs && !failed; ++p) {
+        bitsqueeze_buffer_t *src = NULL;
+        if (bsq_compress_1d(inputs[0], N, PAIRS[p][0], &src, NULL) || run(src, PAIRS[p][1], a, b)) {
+            fprintf(stderr, "pair %d -> %d: transcode differs from decompress + compress\n",
+                    PAIRS[p][0], PAIRS[p][1]);
+            failed = 1;
+        }
+        bsq_free(src);
+    }
+
+    /* Sparse buffers are neither a source nor a target. */
+    bitsqueeze_buffer_t *sparse = NULL, *out = NULL;
+    if (!failed && (bsq_compress_2d(inputs[0], 64, 256, 0.1f, TOPK, &sparse, NULL) ||
+                    bsq_transcode(sparse, Q8_0, &out) == 0)) {
+        fprintf(stderr, "sparse transcode was not rejected\n");
+        failed = 1;
+    }
+    bsq_free(sparse);
+    bsq_free(out);
+
+    free(a);
+    free(b);
+    free_random_float_arrays(inputs, 1);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
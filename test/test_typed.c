@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bitsqueeze.h"
+#include "datatype/bf16.h"
+#include "datatype/fp16/fp16.h"
+#include "utils/random.h"
+#include "utils/evaluation.h"
+
+/* Odd, and not a multiple of any block, so every tail path runs. */
+#define N ((1u << 18) + 77)
+#define TOKENS 96
+#define FEATURES 2000
+
+static const bsq_method_t METHODS_1D[] = {
+    Q8_0, Q4_0, Q2_K, Q2_K_FAST, BF16, FP16, FP8, FP4, MXFP8, MXFP4,
+    NVFP4, NF4, NF4_DQ, IQ2_XXS, IQ2_XS, IQ2_S
+};
+
+static void narrow(const float *src, uint64_t n, bsq_dtype_t dtype, uint16_t *half, float *wide) {
+    for (uint64_t i = 0; i < n; ++i) {
+        if (dtype == BSQ_DTYPE_FP16) {
+            half[i] = fp16_ieee_from_fp32_value(src[i]);
+            wide[i] = fp16_ieee_to_fp32_value(half[i]);
+        } else {
+            half[i] = bf16_from_fp32_value(src[i]);
+            wide[i] = fp32_from_bf16_value(half[i]);
+        }
+    }
+}
+
+/* typed must decode to exactly what reference decodes to. */
+static int same(const bitsqueeze_buffer_t *typed, const bitsqueeze_buffer_t *reference, uint64_t n,
+                float *a, float *b) {
+    return bsq_get_packed_size(typed) != bsq_get_packed_size(reference) ||
+           bsq_decompress(typed, a, n) || bsq_decompress(reference, b, n) || memcmp(a, b, n * sizeof(float)) != 0;
+}
+
+int main(void) {
+    float **inputs = gen_random_float_arrays(2, N, -3.0f, 3.0f, 2525);
+    uint16_t *half = (uint16_t *)malloc(N * sizeof(uint16_t));
+    float *wide = (float *)malloc(N * sizeof(float));
+    float *a = (float *)malloc(N * sizeof(float));
+    float *b = (float *)malloc(N * sizeof(float));
+    if (!inputs || !half || !wide || !a || !b) {
+        fprintf(stderr, "failed to allocate test buffers\n");
+        return EXIT_FAILURE;
+    }
+
+    int failed = 0;
+    const bsq_dtype_t dtypes[] = {BSQ_DTYPE_FP16, BSQ_DTYPE_BF16};
+    const size_t num_methods = sizeof(METHODS_1D) / sizeof(METHODS_1D[0]);
+    for (int d = 0; d < 2 && !failed; ++d) {
+        narrow(inputs[0], N, dtypes[d], half, wide);
+        for (size_t m = 0; m < num_methods && !failed; ++m) {
+            bitsqueeze_buffer_t *typed = NULL, *reference = NULL;
+            double t0 = get_time_ms();
+            int rc = bsq_compress_1d_typed(half, dtypes[d], N, METHODS_1D[m], &typed, NULL);
+            const double typed_time = get_time_ms() - t0;
+
+            /* The path the typed entry point replaces: widen into a temporary, then compress. */
+            t0 = get_time_ms();
+            float *tmp = (float *)malloc(N * sizeof(float));
+            if (tmp) memcpy(tmp, wide, N * sizeof(float));
+            rc = rc || !tmp || bsq_compress_1d(tmp, N, METHODS_1D[m], &reference, NULL);
+            const double split_time = get_time_ms() - t0;
+            printf("[dtype %d, method %d] typed=%.3f ms, widen+compress=%.3f ms\n",
+                   dtypes[d], METHODS_1D[m], typed_time, split_time);
+
+            if (rc || same(typed, reference, N, a, b)) {
+                fprintf(stderr, "dtype %d, method %d: typed compress differs\n", dtypes[d], METHODS_1D[m]);
+                failed = 1;
+            }
+            free(tmp);
+            bsq_free(typed);
+            bsq_free(reference);
+        }
+    }
+
+    /* Q2_K with an importance matrix, and the caller-memory variant rejecting a destination one byte short. */
+    if (!failed) {
+        bitsqueeze_buffer_t *reference = NULL;
+        narrow(inputs[0], N, BSQ_DTYPE_BF16, half, wide);
+        const int64_t size = bsq_compute_packed_size_1d(Q2_K, N);
+        void *mem = aligned_alloc(64, ((size_t)size + 63) & ~(size_t)63);
+        if (!mem || bsq_compress_1d(wide, N, Q2_K, &reference, inputs[1]) ||
+            bsq_compress_1d_typed_into(half, BSQ_DTYPE_BF16, N, Q2_K, mem, size - 1, inputs[1]) == 0 ||
+            bsq_compress_1d_typed_into(half, BSQ_DTYPE_BF16, N, Q2_K, mem, size, inputs[1]) ||
+            same((const bitsqueeze_buffer_t *)mem, reference, N, a, b)) {
+            fprintf(stderr, "typed Q2_K with importance differs\n");
+            failed = 1;
+        }
+        free(mem);
+        bsq_free(reference);
+    }
+
+    const bsq_method_t methods_2d[] = {TOPK, TOPK_IM};
+    const uint64_t n2d = (uint64_t)TOKENS * FEATURES;
+    for (int d = 0; d < 2 && !failed; ++d) {
+        narrow(inputs[0], n2d, dtypes[d], half, wide);
+        for (int m = 0; m < 2 && !failed; ++m) {
+            bitsqueeze_buffer_t *typed = NULL, *reference = NULL;
+            if (bsq_compress_2d_typed(half, dtypes[d], TOKENS, FEATURES, 0.1f, methods_2d[m], &typed, inputs[1]) ||
+                bsq_compress_2d(wide, TOKENS, FEATURES, 0.1f, methods_2d[m], &reference, inputs[1]) ||
+                same(typed, reference, n2d, a, b)) {
+                fprintf(stderr, "dtype %d, method %d: typed sparse compress differs\n", dtypes[d], methods_2d[m]);
+                failed = 1;
+            }
+            bsq_free(typed);
+            bsq_free(reference);
+        }
+    }
+
+    /* 1D methods through the 2d entry point, and the reverse, are rejected. */
+    bitsqueeze_buffer_t *out = NULL;
+    if (!failed && (bsq_compress_1d_typed(half, BSQ_DTYPE_FP16, N, TOPK, &out, NULL) == 0 ||
+                    bsq_compress_2d_typed(half, BSQ_DTYPE_FP16, TOKENS, FEATURES, 0.1f, Q8_0, &out, NULL) == 0)) {
+        fprintf(stderr, "mismatched method was not rejected\n");
+        failed = 1;
+    }
+    bsq_free(out);
+
+    free(half);
+    free(wide);
+    free(a);
+    free(b);
+    free_random_float_arrays(inputs, 2);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
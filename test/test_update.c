@@ -0,0 +1,133 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bitsqueeze.h"
+#include "float_quantization/fp8_impl.h"
+#include "utils/random.h"
+
+#define N 4099
+#define TOKENS 24
+#define FEATURES 256
+#define SPARSE_RATIO 0.1f
+#define ANCHOR 20.0f           /* keeps the tensor scale when edits stay below it */
+
+static const bsq_method_t METHODS_1D[] = {
+    Q8_0, Q4_0, Q2_K, Q2_K_FAST, BF16, FP16, FP8, FP4, MXFP8, MXFP4,
+    NVFP4, NF4, NF4_DQ, IQ2_XXS, IQ2_XS, IQ2_S
+};
+
+/* buf, updated in place, must decode exactly like a fresh compression of updated. */
+static int matches_fresh(const bitsqueeze_buffer_t *buf, const float *updated, const float *im,
+                         float *expect, float *out) {
+    bitsqueeze_buffer_t *fresh = NULL;
+    const int is_2d = buf->method == TOPK || buf->method == TOPK_IM;
+    const uint64_t n = is_2d ? (uint64_t)TOKENS * FEATURES : N;
+    const int failed = (is_2d ? bsq_compress_2d(updated, TOKENS, FEATURES, SPARSE_RATIO, buf->method, &fresh, im)
+                              : bsq_compress_1d(updated, N, buf->method, &fresh, im)) ||
+                       bsq_decompress(fresh, expect, n) || bsq_decompress(buf, out, n) ||
+                       memcmp(expect, out, n * sizeof(float)) != 0;
+    bsq_free(fresh);
+    return failed;
+}
+
+int main(void) {
+    const uint64_t n2d = (uint64_t)TOKENS * FEATURES;
+    float **inputs = gen_random_float_arrays(2, n2d, -8.0f, 8.0f, 1414);
+    float *updated = (float *)malloc(n2d * sizeof(float));
+    float *expect = (float *)malloc(n2d * sizeof(float));
+    float *out = (float *)malloc(n2d * sizeof(float));
+    if (!inputs || !updated || !expect || !out) {
+        fprintf(stderr, "failed to allocate test buffers\n");
+        return EXIT_FAILURE;
+    }
+    inputs[0][5] = ANCHOR;
+
+    int failed = 0;
+    const size_t num_methods = sizeof(METHODS_1D) / sizeof(METHODS_1D[0]);
+    for (size_t m = 0; m < num_methods && !failed; ++m) {
+        const bsq_method_t method = METHODS_1D[m];
+        const float *im = method == Q2_K ? inputs[1] : NULL;
+        bitsqueeze_buffer_t *buf = NULL;
+        if (bsq_compress_1d(inputs[0], N, method, &buf, im)) {
+            fprintf(stderr, "method %d: setup failed\n", method);
+            failed = 1;
+            break;
+        }
+        memcpy(updated, inputs[0], N * sizeof(float));
+
+        /* An edit under the tensor scale, straddling block boundaries. */
+        for (uint64_t i = 1000; i < 1100; ++i) updated[i] *= 0.5f;
+        if (bsq_update_range(buf, updated, 1000, 100, im) || matches_fresh(buf, updated, im, expect, out)) {
+            fprintf(stderr, "method %d: range update differs\n", method);
+            failed = 1;
+        }
+
+        /* Scattered blocks, one of them pushing past the tensor scale. */
+        const uint64_t block_size = bsq_update_block_size(buf);
+        const uint64_t num_blocks = (N + block_size - 1) / block_size;
+        uint8_t dirty[(N + 7) / 8];
+        memset(dirty, 0, sizeof(dirty));
+        const uint64_t marked[] = {0, 3 % num_blocks, num_blocks - 1};
+        for (int k = 0; k < 3 && !failed; ++k) {
+            dirty[marked[k] >> 3] |= (uint8_t)(1u << (marked[k] & 7));
+            updated[marked[k] * block_size] = k == 2 ? 2.0f * ANCHOR : -1.0f;
+        }
+        if (!failed && (bsq_update_blocks(buf, updated, dirty, im) || matches_fresh(buf, updated, im, expect, out))) {
+            fprintf(stderr, "method %d: block update differs\n", method);
+            failed = 1;
+        }
+
+        if (!failed && (bsq_update_range(buf, updated, N - 1, 2, im) == 0 ||
+                        bsq_update_range(buf, updated, N, 0, im) != 0)) {
+            fprintf(stderr, "method %d: argument checks failed\n", method);
+            failed = 1;
+        }
+        bsq_free(buf);
+    }
+
+    const bsq_method_t methods_2d[] = {TOPK, TOPK_IM};
+    for (int m = 0; m < 2 && !failed; ++m) {
+        const float *im = methods_2d[m] == TOPK_IM ? inputs[1] : NULL;
+        bitsqueeze_buffer_t *buf = NULL;
+        memcpy(updated, inputs[0], n2d * sizeof(float));
+        for (uint64_t i = 3 * FEATURES + 10; i < 5 * FEATURES + 7; ++i) updated[i] = -updated[i] * 1.5f;
+        uint8_t dirty[(TOKENS + 7) / 8] = {0};
+        dirty[TOKENS / 8 - 1] = 0x80;  /* last row */
+        updated[(TOKENS - 1) * FEATURES] = 100.0f;
+
+        if (bsq_compress_2d(inputs[0], TOKENS, FEATURES, SPARSE_RATIO, methods_2d[m], &buf, im) ||
+            bsq_update_block_size(buf) != FEATURES ||
+            bsq_update_range(buf, updated, 3 * FEATURES + 10, 2 * FEATURES - 3, im) ||
+            bsq_update_blocks(buf, updated, dirty, im) || matches_fresh(buf, updated, im, expect, out)) {
+            fprintf(stderr, "method %d: row update differs\n", methods_2d[m]);
+            failed = 1;
+        }
+        bsq_free(buf);
+    }
+
+    /* Lowering the element that set the scale keeps the scale: no global re-quantization. */
+    if (!failed) {
+        bitsqueeze_buffer_t *buf = NULL;
+        memcpy(updated, inputs[0], N * sizeof(float));
+        updated[5] = 1.0f;
+        if (bsq_compress_1d(inputs[0], N, FP8, &buf, NULL)) {
+            failed = 1;
+        } else {
+            const float scale = ((const fp8_array_t *)buf->payload)->scale;
+            if (bsq_update_range(buf, updated, 5, 1, NULL) || ((const fp8_array_t *)buf->payload)->scale != scale ||
+                bsq_decompress(buf, out, N) || out[5] == ANCHOR) {
+                fprintf(stderr, "FP8: scale not kept on a shrinking edit\n");
+                failed = 1;
+            }
+        }
+        bsq_free(buf);
+    }
+
+    free(updated);
+    free(expect);
+    free(out);
+    free_random_float_arrays(inputs, 2);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bitsqueeze.h"
+#include "int_quantization/q8_0_impl.h"
+#include "utils/random.h"
+
+#define N 4099            /* odd and not a multiple of any block size */
+#define TOKENS 16
+#define FEATURES 96
+#define SPARSE_RATIO 0.1f
+
+static const bsq_method_t METHODS_1D[] = {
+    Q8_0, Q4_0, Q2_K, Q2_K_FAST, BF16, FP16, FP8, FP4, MXFP8, MXFP4,
+    NVFP4, NF4, NF4_DQ, IQ2_XXS, IQ2_XS, IQ2_S
+};
+
+/* Serialize buf into fresh memory, view it and compare against decompressing buf itself. */
+static int check_view(const bitsqueeze_buffer_t *buf, uint64_t n, float *out_a, float *out_b) {
+    const int64_t size = bsq_get_packed_size(buf);
+    uint64_t *bytes = (uint64_t *)malloc((size_t)size);
+    if (!bytes) return 1;
+    memcpy(bytes, buf, (size_t)size);
+
+    int failed = 0;
+    bsq_view_t view;
+    if (bsq_view_from_buffer(bytes, size, &view)) {
+        fprintf(stderr, "method %d: view rejected a valid buffer\n", buf->method);
+        failed = 1;
+    } else if (bsq_get_packed_size(&view.buf) != size ||
+               bsq_decompress(buf, out_a, n) || bsq_decompress(&view.buf, out_b, n) ||
+               memcmp(out_a, out_b, n * sizeof(float)) != 0) {
+        fprintf(stderr, "method %d: view output mismatch\n", buf->method);
+        failed = 1;
+    }
+
+    if (!failed && bsq_view_from_buffer(bytes, size - 1, &view) == 0) {
+        fprintf(stderr, "method %d: truncated buffer accepted\n", buf->method);
+        failed = 1;
+    }
+    if (!failed && bsq_view_from_buffer((uint8_t *)bytes + 1, size - 1, &view) == 0) {
+        fprintf(stderr, "method %d: misaligned buffer accepted\n", buf->method);
+        failed = 1;
+    }
+
+    free(bytes);
+    return failed;
+}
+
+int main(void) {
+    float **inputs = gen_random_float_arrays(1, N, -10.0f, 10.0f, 4242);
+    float *out_a = (float *)malloc(N * sizeof(float));
+    float *out_b = (float *)malloc(N * sizeof(float));
+    if (!inputs || !out_a || !out_b) {
+        fprintf(stderr, "failed to allocate test buffers\n");
+        return EXIT_FAILURE;
+    }
+
+    int failed = 0;
+    const size_t num_methods = sizeof(METHODS_1D) / sizeof(METHODS_1D[0]);
+    for (size_t m = 0; m < num_methods && !failed; ++m) {
+        bitsqueeze_buffer_t *buf = NULL;
+        if (bsq_compress_1d(inputs[0], N, METHODS_1D[m], &buf, NULL) || !buf) {
+            fprintf(stderr, "method %d: bsq_compress_1d failed\n", METHODS_1D[m]);
+            failed = 1;
+            break;
+        }
+        failed = check_view(buf, N, out_a, out_b);
+        bsq_free(buf);
+    }
+
+    if (!failed) {
+        bitsqueeze_buffer_t *buf = NULL;
+        if (bsq_compress_2d(inputs[0], TOKENS, FEATURES, SPARSE_RATIO, TOPK, &buf, NULL) || !buf) {
+            fprintf(stderr, "TOPK: bsq_compress_2d failed\n");
+            failed = 1;
+        } else {
+            failed = check_view(buf, (uint64_t)TOKENS * FEATURES, out_a, out_b);
+        }
+        bsq_free(buf);
+    }
+
+    /* The view must alias the caller's bytes, and corrupted headers must be rejected. */
+    if (!failed) {
+        bitsqueeze_buffer_t *buf = NULL;
+        if (bsq_compress_1d(inputs[0], N, Q8_0, &buf, NULL) || !buf) {
+            fprintf(stderr, "Q8_0: bsq_compress_1d failed\n");
+            failed = 1;
+        } else {
+            const int64_t size = bsq_get_packed_size(buf);
+            uint64_t *bytes = (uint64_t *)malloc((size_t)size);
+            bsq_view_t view;
+            if (!bytes) {
+                failed = 1;
+            } else {
+                memcpy(bytes, buf, (size_t)size);
+                if (bsq_view_from_buffer(bytes, size, &view) ||
+                    bsq_decompress(&view.buf, out_a, N)) {
+                    failed = 1;
+                } else {
+                    /* Zeroing the first block scale in place must show up through the view. */
+                    float *scales = (float *)((uint8_t *)bytes + sizeof(bitsqueeze_buffer_t) + sizeof(q8_0_array_t));
+                    scales[0] = 0.0f;
+                    if (((const q8_0_array_t *)view.buf.payload)->scales != scales ||
+                        bsq_decompress(&view.buf, out_b, N) || out_b[0] != 0.0f ||
+                        memcmp(out_a + 32, out_b + 32, (N - 32) * sizeof(float)) != 0) {
+                        fprintf(stderr, "Q8_0: view does not alias the caller's bytes\n");
+                        failed = 1;
+                    }
+                }
+
+                memcpy(bytes, buf, (size_t)size);
+                ((bitsqueeze_buffer_t *)bytes)->shape.num_elements = N + 1;
+                if (!failed && bsq_view_from_buffer(bytes, size, &view) == 0) {
+                    fprintf(stderr, "Q8_0: inconsistent shape accepted\n");
+                    failed = 1;
+                }
+                ((bitsqueeze_buffer_t *)bytes)->method = (bsq_method_t)255;
+                if (!failed && (bsq_view_from_buffer(bytes, size, &view) == 0 ||
+                                load_bsq_from_buffer(bytes, size) != NULL)) {
+                    fprintf(stderr, "Q8_0: unknown method accepted\n");
+                    failed = 1;
+                }
+            }
+            free(bytes);
+        }
+        bsq_free(buf);
+    }
+
+    free(out_a);
+    free(out_b);
+    free_random_float_arrays(inputs, 1);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}